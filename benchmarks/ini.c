@@ -0,0 +1,106 @@
+/**
+ * @file
+ *
+ * @brief Compares the line engines of the ini plugin
+ *
+ * Parses a generated file with ini_parse_file(), which copies every
+ * line with fgets(), and with ini_parse_mapped(), which terminates the
+ * lines of a mapping in place. Only the parser is measured, the
+ * handlers just count.
+ *
+ * @copyright BSD License (see doc/COPYING or http://www.libelektra.org)
+ */
+
+#include <benchmarks.h>
+
+#include <fcntl.h>
+#include <inih.h>
+
+#define INI_LINES 100000
+#define INI_KEYS_PER_SECTION 100
+
+static char file[] = "/tmp/elektra-benchmark-ini-XXXXXX";
+static long count;
+
+static int countKey (void * user ELEKTRA_UNUSED, const char * section ELEKTRA_UNUSED, const char * name ELEKTRA_UNUSED,
+		     const char * value ELEKTRA_UNUSED, unsigned short lineContinuation ELEKTRA_UNUSED)
+{
+	++count;
+	return 1;
+}
+
+static int countSection (void * user ELEKTRA_UNUSED, const char * section ELEKTRA_UNUSED)
+{
+	++count;
+	return 1;
+}
+
+static int countComment (void * user ELEKTRA_UNUSED, const char * comment ELEKTRA_UNUSED)
+{
+	++count;
+	return 1;
+}
+
+static void ignoreBom (void * user ELEKTRA_UNUSED, short bom ELEKTRA_UNUSED)
+{
+}
+
+static struct IniConfig config = { countKey, countSection, countComment, ignoreBom, 1, 0, "\t", '=' };
+
+static void benchmarkWriteFile ()
+{
+	int fd = mkstemp (file);
+	FILE * fh = fd == -1 ? NULL : fdopen (fd, "w");
+	if (!fh)
+	{
+		perror ("could not create file");
+		exit (1);
+	}
+	for (int i = 0; i < INI_LINES; ++i)
+	{
+		if (i % INI_KEYS_PER_SECTION == 0)
+			fprintf (fh, "[section%d]\n", i / INI_KEYS_PER_SECTION);
+		else if (i % INI_KEYS_PER_SECTION == 1)
+			fprintf (fh, "; comment of section %d\n", i / INI_KEYS_PER_SECTION);
+		else
+			fprintf (fh, "key%d = value of the key number %d ; comment\n", i, i);
+	}
+	fclose (fh);
+}
+
+static void benchmarkFgets ()
+{
+	for (int i = 0; i < NR; ++i)
+	{
+		FILE * fh = fopen (file, "r");
+		ini_parse_file (fh, &config, 0);
+		fclose (fh);
+	}
+}
+
+static void benchmarkMapped ()
+{
+	for (int i = 0; i < NR; ++i)
+	{
+		int fd = open (file, O_RDONLY);
+		ini_parse_mapped (fd, &config, 0);
+		close (fd);
+	}
+}
+
+int main ()
+{
+	benchmarkWriteFile ();
+
+	timeInit ();
+	count = 0;
+	benchmarkFgets ();
+	timePrint ("ini_parse_file");
+	printf ("%20s: %20ld\n", "elements", count / NR);
+	count = 0;
+	benchmarkMapped ();
+	timePrint ("ini_parse_mapped");
+	printf ("%20s: %20ld\n", "elements", count / NR);
+
+	unlink (file);
+}
@@ -0,0 +1,759 @@
+/**
+ * @file
+ *
+ * @brief Benchmark suite with statistics, JSON output and comparison of results
+ *
+ * @copyright BSD License (see doc/COPYING or http://www.libelektra.org)
+ */
+
+#include <benchmarks.h>
+
+#include <kdbmodule.h>
+
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <time.h>
+
+#define SUITE_MAX_SIZES 16
+#define SUITE_THRESHOLD 10.0
+
+typedef struct
+{
+	size_t size;	   ///< number of keys of the benchmark
+	KeySet * ks;	   ///< the keys, created by the setup
+	Key ** keys;	   ///< the keys to look up
+	int ownKeys;	   ///< keys are not part of ks
+	char ** names;	   ///< the names of the keys
+	KeySet * work;	   ///< prepared before every run
+	Plugin * plugin;   ///< the storage plugin
+	KeySet * modules;  ///< modules of the storage plugin
+	Key * parentKey;   ///< parent of the keys and the file of the storage
+	KDB * handle;	   ///< handle for kdbGet() and kdbSet()
+	const char * arg; ///< argument of the benchmark, e.g. the plugin
+} Fixture;
+
+typedef struct
+{
+	const char * name;
+	const char * arg;
+	/// untimed, once before all runs, returns -1 if the benchmark cannot run
+	int (*setup) (Fixture *);
+	/// untimed, before every run
+	void (*prepare) (Fixture *);
+	void (*run) (Fixture *);
+	/// untimed, once after all runs
+	void (*teardown) (Fixture *);
+} Benchmark;
+
+typedef struct
+{
+	size_t sizes[SUITE_MAX_SIZES];
+	size_t nrSizes;
+	int warmup;
+	int repetitions;
+	int threads;
+	const char * filter;
+	const char * json;
+} Options;
+
+static Options options = { { 100, 1000, 10000 }, 3, 3, 10, 4, 0, 0 };
+
+
+// fixtures
+
+static char * benchmarkName (const char * ns, size_t i)
+{
+	return elektraFormat ("%s/benchmark/dir%zu/key%zu", ns, i / 100, i % 100);
+}
+
+static int setupNames (Fixture * f)
+{
+	f->names = elektraMalloc (f->size * sizeof (char *));
+	for (size_t i = 0; i < f->size; ++i)
+	{
+		f->names[i] = benchmarkName ("user", i);
+	}
+	return 0;
+}
+
+static int setupKeySet (Fixture * f)
+{
+	setupNames (f);
+	f->ks = ksNew (f->size, KS_END);
+	f->keys = elektraMalloc (f->size * sizeof (Key *));
+	for (size_t i = 0; i < f->size; ++i)
+	{
+		f->keys[i] = keyNew (f->names[i], KEY_VALUE, "value", KEY_END);
+		ksAppendKey (f->ks, f->keys[i]);
+	}
+	return 0;
+}
+
+static int setupCascading (Fixture * f)
+{
+	setupNames (f);
+	f->ks = ksNew (2 * f->size, KS_END);
+	f->keys = elektraMalloc (f->size * sizeof (Key *));
+	for (size_t i = 0; i < f->size; ++i)
+	{
+		char * name = benchmarkName ("system", i);
+		ksAppendKey (f->ks, keyNew (name, KEY_VALUE, "system", KEY_END));
+		elektraFree (name);
+		// only every second key is overwritten in user
+		if (i % 2) ksAppendKey (f->ks, keyNew (f->names[i], KEY_VALUE, "user", KEY_END));
+		name = benchmarkName ("", i);
+		f->keys[i] = keyNew (name, KEY_CASCADING_NAME, KEY_END);
+		elektraFree (name);
+	}
+	f->ownKeys = 1;
+	return 0;
+}
+
+static int setupSpec (Fixture * f)
+{
+	setupNames (f);
+	f->ks = ksNew (2 * f->size, KS_END);
+	f->keys = elektraMalloc (f->size * sizeof (Key *));
+	for (size_t i = 0; i < f->size; ++i)
+	{
+		char * name = benchmarkName ("spec", i);
+		char * fallback = benchmarkName ("", (i + 1) % f->size);
+		ksAppendKey (f->ks, keyNew (name, KEY_META, "fallback/#0", fallback, KEY_END));
+		elektraFree (fallback);
+		elektraFree (name);
+		if (i % 2) ksAppendKey (f->ks, keyNew (f->names[i], KEY_VALUE, "user", KEY_END));
+		name = benchmarkName ("", i);
+		f->keys[i] = keyNew (name, KEY_CASCADING_NAME, KEY_END);
+		elektraFree (name);
+	}
+	f->ownKeys = 1;
+	return 0;
+}
+
+static int setupStorage (Fixture * f)
+{
+	setupKeySet (f);
+	Key * errorKey = keyNew ("", KEY_END);
+	f->modules = ksNew (0, KS_END);
+	elektraModulesInit (f->modules, 0);
+	f->plugin = elektraPluginOpen (f->arg, f->modules, ksNew (0, KS_END), errorKey);
+	keyDel (errorKey);
+	if (!f->plugin || !f->plugin->kdbGet || !f->plugin->kdbSet) return -1;
+
+	char * file = elektraFormat ("/tmp/elektra-benchmark-%d.%s", (int)getpid (), f->arg);
+	f->parentKey = keyNew ("user/benchmark", KEY_VALUE, file, KEY_END);
+	elektraFree (file);
+	if (f->plugin->kdbSet (f->plugin, f->ks, f->parentKey) == -1) return -1;
+	return 0;
+}
+
+static int setupKdb (Fixture * f)
+{
+	setupKeySet (f);
+	f->parentKey = keyNew (KEY_ROOT, KEY_END);
+	f->handle = kdbOpen (f->parentKey);
+	if (!f->handle) return -1;
+	KeySet * ks = ksNew (0, KS_END);
+	int ret = kdbGet (f->handle, ks, f->parentKey);
+	ksDel (ks);
+	if (ret == -1) return -1;
+
+	ks = ksDup (f->ks);
+	ret = kdbSet (f->handle, ks, f->parentKey);
+	ksDel (ks);
+	return ret == -1 ? -1 : 0;
+}
+
+static void teardown (Fixture * f)
+{
+	if (f->handle)
+	{
+		kdbClose (f->handle, f->parentKey);
+		f->handle = kdbOpen (f->parentKey);
+		KeySet * ks = ksNew (0, KS_END);
+		kdbGet (f->handle, ks, f->parentKey);
+		ksDel (ksCut (ks, f->parentKey));
+		kdbSet (f->handle, ks, f->parentKey);
+		ksDel (ks);
+		kdbClose (f->handle, f->parentKey);
+	}
+	if (f->plugin)
+	{
+		unlink (keyString (f->parentKey));
+		elektraPluginClose (f->plugin, 0);
+	}
+	if (f->modules)
+	{
+		elektraModulesClose (f->modules, 0);
+		ksDel (f->modules);
+	}
+	for (size_t i = 0; f->names && i < f->size; ++i)
+	{
+		elektraFree (f->names[i]);
+	}
+	for (size_t i = 0; f->ownKeys && i < f->size; ++i)
+	{
+		keyDel (f->keys[i]);
+	}
+	elektraFree (f->names);
+	elektraFree (f->keys);
+	ksDel (f->ks);
+	ksDel (f->work);
+	keyDel (f->parentKey);
+}
+
+
+// benchmarks of keys and keysets
+
+static void runKeyNew (Fixture * f)
+{
+	for (size_t i = 0; i < f->size; ++i)
+	{
+		keyDel (keyNew (f->names[i], KEY_VALUE, "value", KEY_END));
+	}
+}
+
+static void runKeySetName (Fixture * f)
+{
+	Key * key = keyNew ("", KEY_END);
+	for (size_t i = 0; i < f->size; ++i)
+	{
+		keySetName (key, f->names[i]);
+	}
+	keyDel (key);
+}
+
+static void prepareAppend (Fixture * f)
+{
+	ksDel (f->work);
+	f->work = ksNew (f->size, KS_END);
+}
+
+static void runAppend (Fixture * f)
+{
+	for (size_t i = 0; i < f->size; ++i)
+	{
+		ksAppendKey (f->work, f->keys[i]);
+	}
+}
+
+static void runAppendReverse (Fixture * f)
+{
+	for (size_t i = f->size; i > 0; --i)
+	{
+		ksAppendKey (f->work, f->keys[i - 1]);
+	}
+}
+
+static void runLookup (Fixture * f)
+{
+	for (size_t i = 0; i < f->size; ++i)
+	{
+		ksLookup (f->ks, f->keys[i], 0);
+	}
+}
+
+static void runLookupByName (Fixture * f)
+{
+	for (size_t i = 0; i < f->size; ++i)
+	{
+		ksLookupByName (f->ks, f->names[i], 0);
+	}
+}
+
+static void prepareCut (Fixture * f)
+{
+	ksDel (f->work);
+	f->work = ksDeepDup (f->ks);
+}
+
+static void runCut (Fixture * f)
+{
+	Key * cutpoint = keyNew ("", KEY_END);
+	char name[64];
+	for (size_t i = 0; i < f->size; i += 100)
+	{
+		snprintf (name, sizeof (name), "user/benchmark/dir%zu", i / 100);
+		keySetName (cutpoint, name);
+		ksDel (ksCut (f->work, cutpoint));
+	}
+	keyDel (cutpoint);
+}
+
+static void runDup (Fixture * f)
+{
+	// a fixed number of duplicates, so that the time shows how ksDup() scales with the size
+	for (size_t i = 0; i < 1000; ++i)
+	{
+		ksDel (ksDup (f->ks));
+	}
+}
+
+
+// benchmarks of storage plugins and kdb
+
+static void prepareStorageGet (Fixture * f)
+{
+	ksDel (f->work);
+	f->work = ksNew (0, KS_END);
+}
+
+static void runStorageGet (Fixture * f)
+{
+	f->plugin->kdbGet (f->plugin, f->work, f->parentKey);
+}
+
+static void runStorageSet (Fixture * f)
+{
+	f->plugin->kdbSet (f->plugin, f->ks, f->parentKey);
+}
+
+static void prepareKdbGet (Fixture * f)
+{
+	// a new handle, otherwise the resolver finds no update
+	kdbClose (f->handle, f->parentKey);
+	f->handle = kdbOpen (f->parentKey);
+	prepareStorageGet (f);
+}
+
+static void runKdbGet (Fixture * f)
+{
+	kdbGet (f->handle, f->work, f->parentKey);
+}
+
+static void prepareKdbSet (Fixture * f)
+{
+	prepareKdbGet (f);
+	kdbGet (f->handle, f->work, f->parentKey);
+	// otherwise nothing needs to be written
+	keySetString (ksLookup (f->work, f->keys[0], 0), "changed");
+}
+
+static void runKdbSet (Fixture * f)
+{
+	kdbSet (f->handle, f->work, f->parentKey);
+}
+
+
+// multi-threaded benchmarks, every thread does the work of a run
+
+static void * threadKeyNew (void * arg)
+{
+	runKeyNew (arg);
+	return 0;
+}
+
+static void * threadLookup (void * arg)
+{
+	runLookup (arg);
+	return 0;
+}
+
+static void runThreads (Fixture * f, void * (*fn) (void *), int ownKeySet)
+{
+	pthread_t threads[options.threads];
+	Fixture own[options.threads];
+	for (int i = 0; i < options.threads; ++i)
+	{
+		own[i] = *f;
+		// lookups modify the keyset, so every thread needs its own,
+		// duplicated before any thread runs
+		if (ownKeySet) own[i].ks = ksDup (f->ks);
+	}
+	for (int i = 0; i < options.threads; ++i)
+	{
+		pthread_create (&threads[i], 0, fn, &own[i]);
+	}
+	for (int i = 0; i < options.threads; ++i)
+	{
+		pthread_join (threads[i], 0);
+		if (ownKeySet) ksDel (own[i].ks);
+	}
+}
+
+static void runThreadsKeyNew (Fixture * f)
+{
+	runThreads (f, threadKeyNew, 0);
+}
+
+static void runThreadsLookup (Fixture * f)
+{
+	runThreads (f, threadLookup, 1);
+}
+
+
+// clang-format off
+static Benchmark benchmarks[] = {
+	{ "key/new", 0, setupNames, 0, runKeyNew, teardown },
+	{ "key/setname", 0, setupNames, 0, runKeySetName, teardown },
+	{ "ks/append", 0, setupKeySet, prepareAppend, runAppend, teardown },
+	{ "ks/append/reverse", 0, setupKeySet, prepareAppend, runAppendReverse, teardown },
+	{ "ks/lookup/exact", 0, setupKeySet, 0, runLookup, teardown },
+	{ "ks/lookup/name", 0, setupKeySet, 0, runLookupByName, teardown },
+	{ "ks/lookup/cascading", 0, setupCascading, 0, runLookup, teardown },
+	{ "ks/lookup/spec", 0, setupSpec, 0, runLookup, teardown },
+	{ "ks/cut", 0, setupKeySet, prepareCut, runCut, teardown },
+	{ "ks/dup", 0, setupKeySet, 0, runDup, teardown },
+	{ "storage/dump/get", "dump", setupStorage, prepareStorageGet, runStorageGet, teardown },
+	{ "storage/dump/set", "dump", setupStorage, 0, runStorageSet, teardown },
+	{ "storage/ini/get", "ini", setupStorage, prepareStorageGet, runStorageGet, teardown },
+	{ "storage/ini/set", "ini", setupStorage, 0, runStorageSet, teardown },
+	{ "storage/mmapstorage/get", "mmapstorage", setupStorage, prepareStorageGet, runStorageGet, teardown },
+	{ "storage/mmapstorage/set", "mmapstorage", setupStorage, 0, runStorageSet, teardown },
+	{ "storage/ni/get", "ni", setupStorage, prepareStorageGet, runStorageGet, teardown },
+	{ "storage/ni/set", "ni", setupStorage, 0, runStorageSet, teardown },
+	{ "storage/simpleini/get", "simpleini", setupStorage, prepareStorageGet, runStorageGet, teardown },
+	{ "storage/simpleini/set", "simpleini", setupStorage, 0, runStorageSet, teardown },
+	{ "storage/xmltool/get", "xmltool", setupStorage, prepareStorageGet, runStorageGet, teardown },
+	{ "storage/xmltool/set", "xmltool", setupStorage, 0, runStorageSet, teardown },
+	{ "storage/yajl/get", "yajl", setupStorage, prepareStorageGet, runStorageGet, teardown },
+	{ "storage/yajl/set", "yajl", setupStorage, 0, runStorageSet, teardown },
+	{ "kdb/get", 0, setupKdb, prepareKdbGet, runKdbGet, teardown },
+	{ "kdb/set", 0, setupKdb, prepareKdbSet, runKdbSet, teardown },
+	{ "threads/key/new", 0, setupNames, 0, runThreadsKeyNew, teardown },
+	{ "threads/ks/lookup", 0, setupKeySet, 0, runThreadsLookup, teardown },
+};
+// clang-format on
+
+
+// statistics
+
+typedef struct
+{
+	const char * name;
+	size_t size;
+	int repetitions;
+	double min;
+	double median;
+	double p90;
+	double p99;
+	double max;
+	double mean;
+	double stddev;
+} Result;
+
+static double now (void)
+{
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int compareDouble (const void * a, const void * b)
+{
+	double x = *(const double *)a;
+	double y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+/// nearest-rank percentile of sorted samples
+static double percentile (const double * samples, int n, double p)
+{
+	int rank = (int)ceil (p / 100.0 * n);
+	if (rank < 1) rank = 1;
+	return samples[rank - 1];
+}
+
+static void statistics (Result * r, double * samples, int n)
+{
+	qsort (samples, n, sizeof (double), compareDouble);
+	double sum = 0;
+	for (int i = 0; i < n; ++i)
+	{
+		sum += samples[i];
+	}
+	r->mean = sum / n;
+	double var = 0;
+	for (int i = 0; i < n; ++i)
+	{
+		var += (samples[i] - r->mean) * (samples[i] - r->mean);
+	}
+	r->stddev = n > 1 ? sqrt (var / (n - 1)) : 0;
+	r->min = samples[0];
+	r->max = samples[n - 1];
+	r->median = n % 2 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+	r->p90 = percentile (samples, n, 90);
+	r->p99 = percentile (samples, n, 99);
+	r->repetitions = n;
+}
+
+/**
+ * @retval 0 if the benchmark ran
+ * @retval -1 if it could not be set up
+ */
+static int runBenchmark (Benchmark * b, size_t size, Result * r)
+{
+	Fixture f;
+	memset (&f, 0, sizeof (Fixture));
+	f.size = size;
+	f.arg = b->arg;
+	if (b->setup (&f) == -1)
+	{
+		b->teardown (&f);
+		return -1;
+	}
+
+	double * samples = elektraMalloc (options.repetitions * sizeof (double));
+	for (int i = -options.warmup; i < options.repetitions; ++i)
+	{
+		if (b->prepare) b->prepare (&f);
+		double start = now ();
+		b->run (&f);
+		double stop = now ();
+		if (i >= 0) samples[i] = stop - start;
+	}
+	b->teardown (&f);
+
+	r->name = b->name;
+	r->size = size;
+	statistics (r, samples, options.repetitions);
+	elektraFree (samples);
+	return 0;
+}
+
+
+// output
+
+static void printJsonHeader (FILE * out)
+{
+	char hostname[256] = "";
+	gethostname (hostname, sizeof (hostname) - 1);
+	fprintf (out, "{\n");
+	fprintf (out, "\"version\": 1,\n");
+	fprintf (out, "\"hostname\": \"%s\",\n", hostname);
+	fprintf (out, "\"timestamp\": %ld,\n", (long)time (0));
+	fprintf (out, "\"warmup\": %d,\n", options.warmup);
+	fprintf (out, "\"repetitions\": %d,\n", options.repetitions);
+	fprintf (out, "\"threads\": %d,\n", options.threads);
+	fprintf (out, "\"unit\": \"ns\",\n");
+	fprintf (out, "\"results\": [\n");
+}
+
+/// one result per line, so that compare does not need a JSON parser
+static void printJsonResult (FILE * out, Result * r, int first)
+{
+	fprintf (out,
+		 "%s{\"name\": \"%s\", \"size\": %zu, \"repetitions\": %d, \"min\": %.0f, \"median\": %.0f, \"p90\": %.0f, \"p99\": %.0f, "
+		 "\"max\": %.0f, \"mean\": %.0f, \"stddev\": %.0f}",
+		 first ? "" : ",\n", r->name, r->size, r->repetitions, r->min, r->median, r->p90, r->p99, r->max, r->mean, r->stddev);
+}
+
+static void printResult (Result * r)
+{
+	printf ("%-26s %8zu %12.0f %12.0f %12.0f %12.0f %10.1f\n", r->name, r->size, r->median, r->p90, r->p99, r->min,
+		r->median / r->size);
+}
+
+
+// comparison
+
+typedef struct
+{
+	char name[128];
+	size_t size;
+	double median;
+	double stddev;
+} Entry;
+
+/**
+ * @brief Read the results of a JSON file written by this suite
+ *
+ * @return the number of results, -1 on errors
+ */
+static int readResults (const char * file, Entry ** entries)
+{
+	FILE * in = fopen (file, "r");
+	if (!in)
+	{
+		fprintf (stderr, "could not open %s: %s\n", file, strerror (errno));
+		return -1;
+	}
+
+	int n = 0;
+	int alloc = 64;
+	*entries = elektraMalloc (alloc * sizeof (Entry));
+	char line[1024];
+	while (fgets (line, sizeof (line), in))
+	{
+		Entry e;
+		double ignore;
+		int repetitions;
+		const char * start = strchr (line, '{');
+		if (!start || sscanf (start,
+				      "{\"name\": \"%127[^\"]\", \"size\": %zu, \"repetitions\": %d, \"min\": %lf, \"median\": %lf, \"p90\": %lf, "
+				      "\"p99\": %lf, \"max\": %lf, \"mean\": %lf, \"stddev\": %lf}",
+				      e.name, &e.size, &repetitions, &ignore, &e.median, &ignore, &ignore, &ignore, &ignore, &e.stddev) != 10)
+		{
+			continue;
+		}
+		if (n == alloc)
+		{
+			alloc *= 2;
+			elektraRealloc ((void **)entries, alloc * sizeof (Entry));
+		}
+		(*entries)[n++] = e;
+	}
+	fclose (in);
+	return n;
+}
+
+/**
+ * @brief Compare the medians of two result files
+ *
+ * @retval 0 if no benchmark got slower by more than threshold percent
+ * @retval 1 if there are regressions
+ * @retval 2 on errors
+ */
+static int compare (const char * oldFile, const char * newFile, double threshold)
+{
+	Entry * olds;
+	Entry * news;
+	int nrOld = readResults (oldFile, &olds);
+	if (nrOld == -1) return 2;
+	int nrNew = readResults (newFile, &news);
+	if (nrNew == -1)
+	{
+		elektraFree (olds);
+		return 2;
+	}
+
+	int regressions = 0;
+	printf ("%-26s %8s %12s %12s %8s\n", "benchmark", "size", "old median", "new median", "change");
+	for (int i = 0; i < nrNew; ++i)
+	{
+		Entry * o = 0;
+		for (int j = 0; j < nrOld && !o; ++j)
+		{
+			if (!strcmp (olds[j].name, news[i].name) && olds[j].size == news[i].size) o = &olds[j];
+		}
+		if (!o)
+		{
+			printf ("%-26s %8zu %12s %12.0f %8s\n", news[i].name, news[i].size, "-", news[i].median, "new");
+			continue;
+		}
+
+		double change = (news[i].median - o->median) / o->median * 100.0;
+		const char * verdict = "";
+		if (change > threshold)
+		{
+			verdict = "REGRESSION";
+			++regressions;
+		}
+		else if (change < -threshold)
+		{
+			verdict = "improved";
+		}
+		printf ("%-26s %8zu %12.0f %12.0f %+7.1f%% %s\n", news[i].name, news[i].size, o->median, news[i].median, change, verdict);
+	}
+	printf ("\n%d regression(s) above %.1f%%\n", regressions, threshold);
+
+	elektraFree (olds);
+	elektraFree (news);
+	return regressions ? 1 : 0;
+}
+
+
+static void usage (const char * name)
+{
+	printf ("Usage: %s [options]\n", name);
+	printf ("   or: %s --compare <old.json> <new.json> [threshold in %%, default %.0f]\n\n", name, SUITE_THRESHOLD);
+	printf ("Options:\n");
+	printf ("  --filter <prefix>      only run benchmarks starting with prefix, e.g. ks/lookup\n");
+	printf ("  --sizes <n,n,...>      number of keys, default 100,1000,10000\n");
+	printf ("  --warmup <n>           untimed runs before the measurement, default 3\n");
+	printf ("  --repetitions <n>      timed runs, default 10\n");
+	printf ("  --threads <n>          threads of the threads/ benchmarks, default 4\n");
+	printf ("  --json <file>          write the results as JSON\n");
+	printf ("  --list                 list the benchmarks\n");
+}
+
+static int parseSizes (const char * arg)
+{
+	options.nrSizes = 0;
+	char * end;
+	do
+	{
+		long long size = strtoll (arg, &end, 10);
+		if (end == arg || size <= 0 || options.nrSizes == SUITE_MAX_SIZES) return -1;
+		options.sizes[options.nrSizes++] = size;
+		arg = end + 1;
+	} while (*end == ',');
+	return *end ? -1 : 0;
+}
+
+int main (int argc, char ** argv)
+{
+	const size_t nrBenchmarks = sizeof (benchmarks) / sizeof (benchmarks[0]);
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const char * opt = argv[i];
+		const char * arg = i + 1 < argc ? argv[i + 1] : 0;
+		if (!strcmp (opt, "--compare") && i + 2 < argc)
+		{
+			return compare (argv[i + 1], argv[i + 2], i + 3 < argc ? atof (argv[i + 3]) : SUITE_THRESHOLD);
+		}
+		else if (!strcmp (opt, "--list"))
+		{
+			for (size_t b = 0; b < nrBenchmarks; ++b)
+				printf ("%s\n", benchmarks[b].name);
+			return 0;
+		}
+		else if (!strcmp (opt, "--filter") && arg)
+			options.filter = argv[++i];
+		else if (!strcmp (opt, "--sizes") && arg && parseSizes (arg) == 0)
+			++i;
+		else if (!strcmp (opt, "--warmup") && arg)
+			options.warmup = atoi (argv[++i]);
+		else if (!strcmp (opt, "--repetitions") && arg && atoi (arg) > 0)
+			options.repetitions = atoi (argv[++i]);
+		else if (!strcmp (opt, "--threads") && arg && atoi (arg) > 0)
+			options.threads = atoi (argv[++i]);
+		else if (!strcmp (opt, "--json") && arg)
+			options.json = argv[++i];
+		else
+		{
+			usage (argv[0]);
+			return 2;
+		}
+	}
+
+	FILE * json = 0;
+	if (options.json)
+	{
+		json = fopen (options.json, "w");
+		if (!json)
+		{
+			fprintf (stderr, "could not open %s: %s\n", options.json, strerror (errno));
+			return 2;
+		}
+		printJsonHeader (json);
+	}
+
+	printf ("%-26s %8s %12s %12s %12s %12s %10s\n", "benchmark", "size", "median ns", "p90 ns", "p99 ns", "min ns", "ns/key");
+	int first = 1;
+	for (size_t b = 0; b < nrBenchmarks; ++b)
+	{
+		if (options.filter && strncmp (benchmarks[b].name, options.filter, strlen (options.filter))) continue;
+		for (size_t s = 0; s < options.nrSizes; ++s)
+		{
+			Result r;
+			if (runBenchmark (&benchmarks[b], options.sizes[s], &r) == -1)
+			{
+				printf ("%-26s %8zu skipped\n", benchmarks[b].name, options.sizes[s]);
+				break;
+			}
+			printResult (&r);
+			if (json) printJsonResult (json, &r, first);
+			first = 0;
+		}
+	}
+
+	if (json)
+	{
+		fprintf (json, "\n]\n}\n");
+		fclose (json);
+	}
+	return 0;
+}
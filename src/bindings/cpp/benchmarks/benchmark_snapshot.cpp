@@ -0,0 +1,139 @@
+/**
+ * @file
+ *
+ * @brief Compares the publication of snapshots with the Coordinator
+ *
+ * @copyright BSD License (see doc/COPYING or http://www.libelektra.org)
+ */
+
+#include <kdbsnapshot.hpp>
+#include <kdbthread.hpp>
+#include <kdbtimer.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+long long iterations = 100000LL;
+int readers = 8;
+const int updates = 1000;
+
+const int benchmarkIterations = 11; // is a good number to not need mean values for median
+
+/**
+ * @brief Every reader syncs its ThreadContext and reads the value,
+ * one writer assigns it via Coordinator::execute.
+ */
+__attribute__ ((noinline)) void benchmark_coordinator ()
+{
+	static Timer t ("coordinator");
+
+	kdb::Coordinator gc;
+	kdb::KeySet ks;
+	ks.append (kdb::Key ("user/benchmark/value", KEY_VALUE, "0", KEY_END));
+	kdb::Key specKey ("/benchmark/value", KEY_CASCADING_NAME, KEY_END);
+	std::atomic<long long> sum (0);
+
+	t.start ();
+	std::vector<std::thread> threads;
+	for (int i = 0; i < readers; ++i)
+	{
+		threads.emplace_back ([&] {
+			kdb::ThreadContext c (gc);
+			kdb::KeySet local (ks.dup ());
+			kdb::ThreadValue<int> v (local, c, specKey);
+			long long s = 0;
+			for (long long j = 0; j < iterations; ++j)
+			{
+				c.syncLayers ();
+				s += v;
+			}
+			sum += s;
+		});
+	}
+	threads.emplace_back ([&] {
+		kdb::ThreadContext c (gc);
+		kdb::KeySet local (ks.dup ());
+		kdb::ThreadValue<int> v (local, c, specKey);
+		for (int j = 0; j < updates; ++j)
+		{
+			v = j;
+		}
+	});
+	for (auto & thread : threads)
+	{
+		thread.join ();
+	}
+	t.stop ();
+	std::cout << t;
+	std::cout << "sum " << sum << std::endl;
+}
+
+/**
+ * @brief Every reader pins the snapshot and looks up the value,
+ * one writer publishes new snapshots.
+ */
+__attribute__ ((noinline)) void benchmark_snapshot ()
+{
+	static Timer t ("snapshot");
+
+	kdb::KeySet ks;
+	ks.append (kdb::Key ("user/benchmark/value", KEY_VALUE, "0", KEY_END));
+	kdb::SnapshotPublisher publisher (ks);
+	std::atomic<long long> sum (0);
+
+	t.start ();
+	std::vector<std::thread> threads;
+	for (int i = 0; i < readers; ++i)
+	{
+		threads.emplace_back ([&] {
+			kdb::SnapshotReader reader (publisher);
+			kdb::Key search ("user/benchmark/value", KEY_END);
+			long long s = 0;
+			for (long long j = 0; j < iterations; ++j)
+			{
+				s += atoll (ckdb::keyString (reader.pin ().lookup (search)));
+			}
+			sum += s;
+		});
+	}
+	threads.emplace_back ([&] {
+		kdb::KeySet local (ks.dup ());
+		kdb::Key k = local.lookup ("user/benchmark/value");
+		for (int j = 0; j < updates; ++j)
+		{
+			k.set<long long> (j);
+			publisher.publish (local);
+		}
+	});
+	for (auto & thread : threads)
+	{
+		thread.join ();
+	}
+	t.stop ();
+	std::cout << t;
+	std::cout << "sum " << sum << std::endl;
+}
+
+int main (int argc, char ** argv)
+{
+	if (argc >= 2)
+	{
+		iterations = atoll (argv[1]);
+	}
+	if (argc >= 3)
+	{
+		readers = atoi (argv[2]);
+	}
+
+	std::cout << "iterations " << iterations << std::endl;
+	std::cout << "readers " << readers << std::endl;
+
+	for (int i = 0; i < benchmarkIterations; ++i)
+	{
+		std::cout << i << std::endl;
+		benchmark_coordinator ();
+		benchmark_snapshot ();
+	}
+}
@@ -0,0 +1,310 @@
+/**
+ * @file
+ *
+ * @brief Publication of immutable KeySet snapshots to many reader threads
+ *
+ * @copyright BSD License (see doc/COPYING or http://www.libelektra.org)
+ */
+
+#ifndef ELEKTRA_KDBSNAPSHOT_HPP
+#define ELEKTRA_KDBSNAPSHOT_HPP
+
+#include <keyset.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace kdb
+{
+
+/**
+ * @brief An immutable KeySet published by a SnapshotPublisher.
+ *
+ * Many threads read a snapshot at the same time, so it only offers
+ * operations which do not modify the KeySet. In particular it has no
+ * cursor, and the metadata of its keys must not be looked up, because
+ * keyGetMeta() moves the cursor of the metadata.
+ * Names and values of the keys can be read freely, but the keys must
+ * not be wrapped in a kdb::Key, which changes their reference counter.
+ */
+class Snapshot
+{
+public:
+	Snapshot (ckdb::KeySet * ks, uint64_t version) : m_ks (ks), m_version (version)
+	{
+	}
+
+	~Snapshot ()
+	{
+		ckdb::ksDel (m_ks);
+	}
+
+	/**
+	 * @brief Binary search for a key with the same name
+	 *
+	 * Unlike ksLookup() it neither moves the cursor nor builds
+	 * an index, so it is safe to be used by many threads.
+	 *
+	 * @param key the key to search for
+	 *
+	 * @return the found key or nullptr
+	 */
+	ckdb::Key const * lookup (Key const & key) const
+	{
+		const char * name = static_cast<const char *> (ckdb::keyUnescapedName (key.getKey ()));
+		size_t const size = ckdb::keyGetUnescapedNameSize (key.getKey ());
+		if (!name) return nullptr;
+		size_t low = 0;
+		size_t high = this->size ();
+		while (low < high)
+		{
+			size_t const mid = low + (high - low) / 2;
+			ckdb::Key * cur = ckdb::ksAtCursor (m_ks, mid);
+			const char * curName = static_cast<const char *> (ckdb::keyUnescapedName (cur));
+			size_t const curSize = ckdb::keyGetUnescapedNameSize (cur);
+			int cmp = memcmp (curName, name, std::min (curSize, size));
+			if (cmp == 0 && curSize != size) cmp = curSize < size ? -1 : 1;
+			if (cmp == 0) return cur;
+			if (cmp < 0)
+			{
+				low = mid + 1;
+			}
+			else
+			{
+				high = mid;
+			}
+		}
+		return nullptr;
+	}
+
+	/// @copydoc lookup(Key const &) const
+	ckdb::Key const * lookup (std::string const & name) const
+	{
+		Key key (name, KEY_CASCADING_NAME, KEY_END);
+		if (!key) return nullptr;
+		return lookup (key);
+	}
+
+	ckdb::Key const * at (size_t pos) const
+	{
+		return ckdb::ksAtCursor (m_ks, pos);
+	}
+
+	size_t size () const
+	{
+		return ckdb::ksGetSize (m_ks);
+	}
+
+	/// Increases with every publication, starting with 0
+	uint64_t version () const
+	{
+		return m_version;
+	}
+
+private:
+	Snapshot (Snapshot const &) = delete;
+	Snapshot & operator= (Snapshot const &) = delete;
+
+	ckdb::KeySet * m_ks;
+	uint64_t m_version;
+};
+
+/**
+ * @brief Read-mostly sharing of configuration among threads.
+ *
+ * Writers publish a copy of a KeySet as new immutable Snapshot,
+ * readers (see SnapshotReader) pin the current snapshot without
+ * taking any lock. Old snapshots are deleted by the writers as
+ * soon as no reader has them pinned (hazard pointers).
+ *
+ * Unlike Coordinator, updates are not fanned out to every
+ * ThreadContext, a reader sees all changes with its next pin.
+ */
+class SnapshotPublisher
+{
+public:
+	explicit SnapshotPublisher (KeySet const & ks = KeySet ())
+	: m_current (new Snapshot (copy (ks), 0)), m_version (0), m_mutex (), m_slots (), m_retired ()
+	{
+	}
+
+	/**
+	 * @pre all SnapshotReader of this publisher are destroyed
+	 */
+	~SnapshotPublisher ()
+	{
+		for (auto s : m_retired)
+		{
+			delete s;
+		}
+		delete m_current.load ();
+	}
+
+	/**
+	 * @brief Make a copy of ks the current snapshot
+	 *
+	 * Can be called from many threads, writers are serialized.
+	 *
+	 * @param ks the new configuration, later changes of its keys
+	 *        are not visible to readers
+	 */
+	void publish (KeySet const & ks)
+	{
+		ckdb::KeySet * dup = copy (ks);
+		std::lock_guard<std::mutex> lock (m_mutex);
+		Snapshot * old = m_current.load ();
+		m_current.store (new Snapshot (dup, old->version () + 1));
+		m_version.store (old->version () + 1);
+		m_retired.push_back (old);
+		reclaim ();
+	}
+
+	/// @return the version of the current snapshot
+	uint64_t version () const
+	{
+		return m_version.load ();
+	}
+
+private:
+	friend class SnapshotReader;
+
+	/// The snapshot pinned by one reader
+	struct Slot
+	{
+		Slot () : hazard (nullptr), used (true)
+		{
+		}
+		std::atomic<Snapshot *> hazard;
+		bool used; ///< protected by m_mutex
+	};
+
+	static ckdb::KeySet * copy (KeySet const & ks)
+	{
+		ckdb::KeySet * dup = ckdb::ksNew (ks.size (), KS_END);
+		for (ssize_t i = 0; i < ks.size (); ++i)
+		{
+			ckdb::ksAppendKey (dup, ckdb::keyDup (ckdb::ksAtCursor (ks.getKeySet (), i)));
+		}
+		return dup;
+	}
+
+	Slot * acquire ()
+	{
+		std::lock_guard<std::mutex> lock (m_mutex);
+		for (auto & slot : m_slots)
+		{
+			if (!slot.used)
+			{
+				slot.used = true;
+				return &slot;
+			}
+		}
+		// deque does not move its elements
+		m_slots.emplace_back ();
+		return &m_slots.back ();
+	}
+
+	void release (Slot * slot)
+	{
+		slot->hazard.store (nullptr);
+		std::lock_guard<std::mutex> lock (m_mutex);
+		slot->used = false;
+		reclaim ();
+	}
+
+	/// delete retired snapshots not pinned by any reader, needs m_mutex
+	void reclaim ()
+	{
+		std::vector<Snapshot *> pinned;
+		for (auto & slot : m_slots)
+		{
+			Snapshot * s = slot.hazard.load ();
+			if (s) pinned.push_back (s);
+		}
+
+		auto keep = m_retired.begin ();
+		for (auto s : m_retired)
+		{
+			if (std::find (pinned.begin (), pinned.end (), s) != pinned.end ())
+			{
+				*keep++ = s;
+			}
+			else
+			{
+				delete s;
+			}
+		}
+		m_retired.erase (keep, m_retired.end ());
+	}
+
+	SnapshotPublisher (SnapshotPublisher const &) = delete;
+	SnapshotPublisher & operator= (SnapshotPublisher const &) = delete;
+
+	std::atomic<Snapshot *> m_current;
+	/// without hazard readers must not access m_current
+	std::atomic<uint64_t> m_version;
+	/// serializes writers and protects m_slots and m_retired
+	std::mutex m_mutex;
+	std::deque<Slot> m_slots;
+	std::vector<Snapshot *> m_retired;
+};
+
+/**
+ * @brief Lock-free access of one thread to the snapshots of a publisher
+ *
+ * Every reader thread needs its own SnapshotReader.
+ */
+class SnapshotReader
+{
+public:
+	explicit SnapshotReader (SnapshotPublisher & publisher) : m_publisher (publisher), m_slot (publisher.acquire ())
+	{
+	}
+
+	~SnapshotReader ()
+	{
+		m_publisher.release (m_slot);
+	}
+
+	/**
+	 * @brief Pin the current snapshot
+	 *
+	 * The snapshot stays valid until the next pin(), unpin() or
+	 * the destruction of the reader. No lock is taken.
+	 *
+	 * @return the current snapshot
+	 */
+	Snapshot const & pin ()
+	{
+		Snapshot * s = m_publisher.m_current.load ();
+		for (;;)
+		{
+			m_slot->hazard.store (s);
+			// a writer might have retired s before it saw our hazard
+			Snapshot * current = m_publisher.m_current.load ();
+			if (current == s) return *s;
+			s = current;
+		}
+	}
+
+	/// Allow the pinned snapshot to be deleted
+	void unpin ()
+	{
+		m_slot->hazard.store (nullptr);
+	}
+
+private:
+	SnapshotReader (SnapshotReader const &) = delete;
+	SnapshotReader & operator= (SnapshotReader const &) = delete;
+
+	SnapshotPublisher & m_publisher;
+	SnapshotPublisher::Slot * m_slot;
+};
+}
+
+#endif
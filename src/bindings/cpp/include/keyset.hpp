@@ -18,6 +18,7 @@
 #include <key.hpp>
 
 #include <kdb.h>
+#include <kdbproposal.h>
 
 namespace kdb
 {
@@ -41,6 +42,31 @@ struct VaAlloc
 	size_t alloc;
 };
 
+/**
+ * @brief A name compiled for repeated lookups in keysets.
+ *
+ * @copydoc elektraKeyLookupNew
+ *
+ * \invariant always holds an underlying compiled lookup.
+ */
+class KeyLookup
+{
+public:
+	inline explicit KeyLookup (std::string const & name);
+	inline ~KeyLookup ();
+
+	KeyLookup (KeyLookup const &) = delete;
+	KeyLookup & operator= (KeyLookup const &) = delete;
+
+	ckdb::KeyLookup * getLookup () const
+	{
+		return lookup;
+	}
+
+private:
+	ckdb::KeyLookup * lookup; ///< holds an elektra compiled lookup
+};
+
 /**
  * @brief A keyset holds together a set of keys.
  *
@@ -100,6 +126,7 @@ public:
 
 	Key lookup (const Key & k, const option_t options = KDB_O_NONE) const;
 	Key lookup (std::string const & name, const option_t options = KDB_O_NONE) const;
+	Key lookup (KeyLookup const & lookup, const option_t options = KDB_O_NONE) const;
 	template <typename T>
 	T get (std::string const & name, const option_t options = KDB_O_NONE) const;
 
@@ -823,6 +850,34 @@ inline Key KeySet::lookup (std::string const & name, option_t const options) con
 	return Key (k);
 }
 
+/**
+ * @copydoc ksLookupCompiled()
+ *
+ * @note That the internal key cursor will point to the found key
+ */
+inline Key KeySet::lookup (KeyLookup const & lookup, option_t const options) const
+{
+	ckdb::Key * k = ckdb::ksLookupCompiled (ks, lookup.getLookup (), options);
+	return Key (k);
+}
+
+/**
+ * @brief Compile a name for lookups
+ *
+ * @param name the name to look up
+ *
+ * @throw KeyInvalidName if the name could not be compiled
+ */
+inline KeyLookup::KeyLookup (std::string const & name) : lookup (ckdb::elektraKeyLookupNew (name.c_str ()))
+{
+	if (!lookup) throw KeyInvalidName ();
+}
+
+inline KeyLookup::~KeyLookup ()
+{
+	ckdb::elektraKeyLookupDel (lookup);
+}
+
 template <typename T>
 struct KeySetTypeWrapper;
 
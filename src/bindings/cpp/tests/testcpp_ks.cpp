@@ -251,6 +251,26 @@ TEST (ks, lookup)
 	succeed_if (!k4, "Key does not exist");
 }
 
+TEST (ks, lookupCompiled)
+{
+	KeySet ks (5, *Key ("system/key3/1", KEY_END), *Key ("user/key3/1", KEY_VALUE, "value", KEY_END), *Key ("system/key3/2", KEY_END),
+		   KS_END);
+
+	KeyLookup cascading ("/key3/1");
+	Key k1 = ks.lookup (cascading);
+	succeed_if (k1, "did not find key");
+	succeed_if (k1.getName () == "user/key3/1", "wrong keyname");
+	succeed_if (k1.getString () == "value", "wrong value");
+
+	KeyLookup system ("system/key3/2");
+	Key k2 = ks.lookup (system);
+	succeed_if (k2, "did not find key");
+	succeed_if (k2.getName () == "system/key3/2", "wrong keyname");
+
+	KeyLookup missing ("/key3/3");
+	succeed_if (!ks.lookup (missing), "Key does not exist");
+}
+
 TEST (ks, append)
 {
 	KeySet ks1;
@@ -0,0 +1,113 @@
+/**
+ * @file
+ *
+ * @brief Tests for the publication of KeySet snapshots
+ *
+ * @copyright BSD License (see doc/COPYING or http://www.libelektra.org)
+ */
+
+#include <kdbsnapshot.hpp>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace kdb;
+
+static KeySet pair (int value)
+{
+	std::string s = std::to_string (value);
+	return KeySet (5, *Key ("user/snapshot/a", KEY_VALUE, s.c_str (), KEY_END), *Key ("user/snapshot/b", KEY_VALUE, s.c_str (), KEY_END),
+		       *Key ("user/snapshot/b/c", KEY_VALUE, "c", KEY_END), KS_END);
+}
+
+TEST (snapshot, lookup)
+{
+	SnapshotPublisher publisher (pair (1));
+	SnapshotReader reader (publisher);
+
+	Snapshot const & s = reader.pin ();
+	EXPECT_EQ (s.version (), 0);
+	EXPECT_EQ (s.size (), 3);
+	ASSERT_NE (s.lookup ("user/snapshot/a"), nullptr);
+	EXPECT_STREQ (ckdb::keyString (s.lookup ("user/snapshot/a")), "1");
+	EXPECT_STREQ (ckdb::keyName (s.lookup (Key ("user/snapshot/b/c", KEY_END))), "user/snapshot/b/c");
+	EXPECT_EQ (s.lookup ("user/snapshot"), nullptr);
+	EXPECT_EQ (s.lookup ("user/snapshot/b/c/d"), nullptr);
+	EXPECT_EQ (s.lookup ("user/snapshot/0"), nullptr);
+	EXPECT_EQ (s.lookup ("user/snapshot/z"), nullptr);
+	EXPECT_EQ (s.lookup ("/snapshot/a"), nullptr);
+	EXPECT_STREQ (ckdb::keyName (s.at (2)), "user/snapshot/b/c");
+	EXPECT_EQ (s.at (3), nullptr);
+}
+
+TEST (snapshot, publish)
+{
+	KeySet ks = pair (1);
+	SnapshotPublisher publisher (ks);
+	SnapshotReader reader (publisher);
+	SnapshotReader other (publisher);
+
+	Snapshot const & first = reader.pin ();
+	Key k = ks.lookup ("user/snapshot/a");
+	k.setString ("changed");
+	EXPECT_STREQ (ckdb::keyString (first.lookup ("user/snapshot/a")), "1") << "publication did not copy";
+
+	publisher.publish (pair (2));
+	EXPECT_EQ (publisher.version (), 1);
+	// still pinned
+	EXPECT_STREQ (ckdb::keyString (first.lookup ("user/snapshot/a")), "1");
+
+	Snapshot const & second = other.pin ();
+	EXPECT_EQ (second.version (), 1);
+	EXPECT_STREQ (ckdb::keyString (second.lookup ("user/snapshot/a")), "2");
+
+	Snapshot const & again = reader.pin ();
+	EXPECT_EQ (&again, &second);
+	reader.unpin ();
+	other.unpin ();
+	publisher.publish (KeySet ());
+	EXPECT_EQ (reader.pin ().size (), 0);
+}
+
+TEST (snapshot, threads)
+{
+	SnapshotPublisher publisher (pair (0));
+	std::atomic<bool> done (false);
+	std::atomic<int> inconsistent (0);
+
+	std::vector<std::thread> readers;
+	for (int i = 0; i < 4; ++i)
+	{
+		readers.emplace_back ([&publisher, &done, &inconsistent] {
+			SnapshotReader reader (publisher);
+			uint64_t version = 0;
+			while (!done)
+			{
+				Snapshot const & s = reader.pin ();
+				if (s.version () < version ||
+				    strcmp (ckdb::keyString (s.lookup ("user/snapshot/a")), ckdb::keyString (s.lookup ("user/snapshot/b"))))
+				{
+					++inconsistent;
+				}
+				version = s.version ();
+			}
+		});
+	}
+
+	for (int i = 1; i <= 1000; ++i)
+	{
+		publisher.publish (pair (i));
+	}
+	done = true;
+	for (auto & t : readers)
+	{
+		t.join ();
+	}
+
+	EXPECT_EQ (inconsistent, 0);
+	EXPECT_EQ (publisher.version (), 1000);
+}
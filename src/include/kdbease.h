@@ -20,6 +20,21 @@ Key * elektraArrayGetNextKey (KeySet * arrayKeys);
 keyswitch_t keyCompare (const Key * key1, const Key * key2);
 keyswitch_t keyCompareMeta (const Key * key1, const Key * key2);
 
+typedef struct _ElektraLru ElektraLru;
+typedef void (*ElektraLruFree) (void * value);
+
+ElektraLru * elektraLruNew (size_t capacity, ElektraLruFree freeValue);
+void * elektraLruGet (ElektraLru * lru, const char * name);
+int elektraLruPut (ElektraLru * lru, const char * name, void * value);
+void elektraLruDel (ElektraLru * lru);
+
+typedef struct _ElektraGlobMatcher ElektraGlobMatcher;
+
+ElektraGlobMatcher * elektraGlobMatcherNew (void);
+ssize_t elektraGlobMatcherAdd (ElektraGlobMatcher * matcher, const char * pattern, int flags);
+const size_t * elektraGlobMatcherMatch (ElektraGlobMatcher * matcher, const char * name, size_t * size);
+void elektraGlobMatcherDel (ElektraGlobMatcher * matcher);
+
 #ifdef __cplusplus
 }
 }
@@ -18,12 +18,18 @@
 #include <kdbtypes.h>
 
 #include <limits.h>
+#include <time.h>
 
 /** The minimal allocation size of a keyset inclusive
 	NULL byte. ksGetAlloc() will return one less because
 	it says how much can actually be stored.*/
 #define KEYSET_SIZE 16
 
+/** The minimal size of a keyset for which ksLookup()
+	builds a hash index, smaller keysets are always
+	searched binary. */
+#define KEYSET_HASH_SIZE 64
+
 /** How many plugins can exist in an backend. */
 #define NR_OF_PLUGINS 10
 
@@ -39,6 +45,9 @@
 /** Trie optimization */
 #define APPROXIMATE_NR_OF_BACKENDS 16
 
+/** Size of the blocks a KeyArena allocates keys from */
+#define KEY_ARENA_BLOCK_SIZE 16384
+
 /**The maximum of how many characters an integer
   needs as decimal number.*/
 #define MAX_LEN_INT 31
@@ -132,12 +141,24 @@ typedef enum {
 			 to be changed. All attempts to change the value
 			 will lead to an error.
 			 Needed for meta keys*/
-	KEY_FLAG_RO_META = 1 << 3	/*!<
+	KEY_FLAG_RO_META = 1 << 3,	/*!<
 			 Read only flag for meta.
 			 Key meta is read only and not allowed
 			 to be changed. All attempts to change the value
 			 will lead to an error.
 			 Needed for meta keys.*/
+	KEY_FLAG_MMAP_KEY = 1 << 4,	/*!<
+			 Name points into a KeyRegion.
+			 It was not allocated with elektraMalloc()
+			 and will be copied before it gets changed.*/
+	KEY_FLAG_MMAP_DATA = 1 << 5,	/*!<
+			 Value points into a KeyRegion.
+			 It was not allocated with elektraMalloc()
+			 and will be copied before it gets changed.*/
+	KEY_FLAG_MMAP_STRUCT = 1 << 6	/*!<
+			 The key itself is allocated within a KeyRegion
+			 (see KeyArena). keyDel() drops its reference
+			 instead of freeing it.*/
 } keyflag_t;
 
 
@@ -150,11 +171,18 @@ typedef enum {
  * @ingroup backend
  */
 typedef enum {
-	KS_FLAG_SYNC = 1 /*!<
+	KS_FLAG_SYNC = 1, /*!<
 		 KeySet need sync.
 		 If keys were popped from the Keyset
 		 this flag will be set, so that the backend will sync
 		 the keys to database.*/
+	KS_FLAG_HASH = 1 << 1, /*!<
+		 Hash index is up to date.
+		 Will be cleared whenever keys are moved
+		 within the array of the KeySet.*/
+	KS_FLAG_CASCADING = 1 << 2 /*!<
+		 Cascading part of the hash index is up to date.
+		 Only set together with KS_FLAG_HASH.*/
 } ksflag_t;
 
 
@@ -227,6 +255,77 @@ struct _Key
 };
 
 
+/**
+ * A block of memory names and values of keys can point into
+ * without owning it, e.g. a file mapped by a storage plugin.
+ *
+ * Every name and value within the region is preceded by a size_t
+ * holding the distance from the region header to the name or value,
+ * so that the header can be found from the pointer alone.
+ *
+ * Every name or value pointing into the region (see KEY_FLAG_MMAP_KEY
+ * and KEY_FLAG_MMAP_DATA) holds a reference. The region is released
+ * when the last one is gone.
+ *
+ * @see elektraKeySetRegionName(), elektraKeySetRegionValue()
+ */
+typedef struct _KeyRegion
+{
+	void * base;  /**< Start of the memory block */
+	size_t size;  /**< Size of the memory block */
+	size_t refs;  /**< Number of names and values pointing into the block */
+	int mapped;   /**< 1 if the block must be released with munmap(), 0 for elektraFree() */
+} KeyRegion;
+
+
+/**
+ * Bump allocator for keys, their names and values.
+ *
+ * The arena hands out memory from blocks, every block is a KeyRegion
+ * allocated with elektraMalloc(). Every key, name and value within a
+ * block holds a reference, the arena holds one to its current block.
+ * So a block is freed at once as soon as the arena moved on and the
+ * last key in it is gone, no matter if the keys were deleted together
+ * with the KeySet they were created for or survived it.
+ *
+ * Several keysets can share an arena, see elektraKsSetArena().
+ *
+ * @see elektraKsArena(), elektraKeyArenaKeyNew()
+ */
+typedef struct _KeyArena
+{
+	KeyRegion * block; /**< Current block, 0 before the first allocation */
+	size_t used;	   /**< Bytes used in the current block */
+	size_t refs;	   /**< Number of keysets and other owners of the arena */
+	Key * scratch;	   /**< Key used to canonicalize names */
+} KeyArena;
+
+
+/**
+ * The private hash index of a KeySet.
+ *
+ * Maps the unescaped name of every key to its position in the
+ * array of the KeySet. It is built lazily within ksLookup() as soon
+ * as enough lookups were done to amortize its construction.
+ *
+ * After the first cascading lookup, it additionally maps every name
+ * without its namespace to the positions of the key in every
+ * namespace, so that a cascading lookup needs a single probe.
+ *
+ * Appending at the end of the KeySet updates the index, every other
+ * operation that moves keys within the array invalidates it.
+ *
+ * @see elektraKsHashLookup(), elektraKsHashLookupCascading()
+ */
+typedef struct _KeySetHash
+{
+	struct _KeySetHashSlot * slots;		     /**< The slots, 0 if the index is not built */
+	struct _KeySetCascadingSlot * cascading; /**< The slots of the cascading part, 0 if it is not built */
+	size_t alloc;				     /**< Number of slots of both parts, always a power of two */
+	size_t lookups;				     /**< Lookups done without valid index since last change */
+} KeySetHash;
+
+
 /**
  * The private KeySet structure.
  *
@@ -238,6 +337,9 @@ struct _Key
 typedef struct _KeySet KeySet;
  * @endcode
  *
+ * The array might be shared with other keysets (see ksDup()).
+ * Shared arrays must not be modified, call elektraKsUnshare() before.
+ *
  * @ingroup backend
  */
 struct _KeySet
@@ -254,6 +356,34 @@ struct _KeySet
 	 * Some control and internal flags.
 	 */
 	ksflag_t flags;
+
+	KeySetHash hash; /**< Lazily built hash index for exact lookups */
+
+
+	KeyArena * arena; /**< Arena for keys created for this keyset, see elektraKsArena() */
+};
+
+
+/**
+ * Number of namespaces a cascading name is looked up in.
+ */
+#define KEY_LOOKUP_NAMESPACES 5
+
+/**
+ * The private structure of a compiled lookup.
+ *
+ * Holds the canonical name passed to elektraKeyLookupNew() and, if it
+ * is cascading, the same name in every namespace in the order the
+ * cascading lookup tries them. The names are unescaped and hashed
+ * once, so that ksLookupCompiled() does not need to do it again.
+ *
+ * @see ksLookupCompiled()
+ */
+struct _KeyLookup
+{
+	struct _Key * names[KEY_LOOKUP_NAMESPACES + 1]; /**< The name, then the names in spec, proc, dir, user and system */
+	size_t hashes[KEY_LOOKUP_NAMESPACES + 1];	/**< Hashes of the names, see elektraKsHashName() */
+	size_t nrNames;					/**< 1 or, for cascading names, all of them */
 };
 
 
@@ -271,9 +401,53 @@ typedef enum {
 	PRESETCLEANUP,
 	PRECOMMIT,
 	POSTCOMMIT,
+	PREGETCACHE,
+	POSTGETCACHE,
+	PREGETNOTIFY,
+	POSTGETNOTIFY,
 	NR_GLOBAL_PLUGINS
 } GlobalpluginPositions;
 
+/**
+ * Statistics of calls to a plugin slot, see elektraStats().
+ */
+typedef struct _ElektraStatsSlot
+{
+	size_t calls;				/*!< How often the slot was called */
+	kdb_unsigned_long_long_t nanoseconds; /*!< Wall time spent in the calls */
+	size_t keys;				/*!< Sum of the sizes of the keysets after the calls */
+	size_t allocations;			/*!< Allocations done with elektraMalloc() and friends by the calls */
+} ElektraStatsSlot;
+
+/**
+ * The phases of backends, each having NR_OF_PLUGINS slots.
+ */
+typedef enum {
+	ELEKTRA_STATS_GET = 0,
+	ELEKTRA_STATS_SET,
+	ELEKTRA_STATS_ERROR,
+	ELEKTRA_STATS_PHASES
+} ElektraStatsPhase;
+
+/**
+ * Statistics of a backend, only allocated if enabled with elektraStatsEnable().
+ */
+typedef struct _BackendStats
+{
+	ElektraStatsSlot slots[ELEKTRA_STATS_PHASES][NR_OF_PLUGINS];
+	size_t bytes; /*!< Sum of the sizes of the files the storage plugin read */
+} BackendStats;
+
+/**
+ * Statistics of a handle, only allocated if enabled with elektraStatsEnable().
+ */
+typedef struct _KdbStats
+{
+	ElektraStatsSlot get;				 /*!< The calls of kdbGet() as a whole */
+	ElektraStatsSlot set;				 /*!< The calls of kdbSet() as a whole */
+	ElektraStatsSlot global[NR_GLOBAL_PLUGINS]; /*!< The calls of the global plugins */
+} KdbStats;
+
 /**
  * The access point to the key database.
  *
@@ -307,6 +481,19 @@ struct _KDB
 	Backend * initBackend; /*!< The init backend for bootstrapping.*/
 
 	Plugin * globalPlugins[NR_GLOBAL_PLUGINS];
+
+	size_t getThreads; /*!< Number of threads to run the get plugins of
+			different backends in parallel, see system/elektra/kdb/get/threads.
+			0 or 1 means that all backends are processed sequentially.*/
+
+	int openLazy; /*!< 1 if the plugins of mountpoints are opened by the first
+			kdbGet() or kdbSet() which needs them, see system/elektra/kdb/open/lazy.*/
+
+	ElektraNotificationCallback notificationCallback; /*!< Called by elektraNotificationPoll() with the changed mountpoints*/
+	void * notificationContext; /*!< Passed to notificationCallback*/
+
+	KdbStats * stats; /*!< Statistics of the calls of plugins, 0 if disabled,
+			see system/elektra/kdb/stats and elektraStatsEnable().*/
 };
 
 
@@ -358,6 +545,20 @@ struct _Backend
 	   More than three is not possible, because a backend
 	   can be only mounted in dir, system and user each once
 	   OR only in spec.*/
+
+	int getthreads; /*!< 0 if not yet known, 1 if the get plugins may run
+	   in parallel to other backends, -1 if one of them is marked with
+	   infos/status nothreads. */
+
+	KeySet * config; /*!< The configuration of a backend opened with
+	   elektraBackendOpenLazy() whose plugins are not yet opened.
+	   0 once elektraBackendMaterialise() was executed. */
+
+	KeySet * modules; /*!< The modules to open the plugins with,
+	   only needed as long as config is set. */
+
+	BackendStats * stats; /*!< Statistics of the calls of the plugins,
+	   0 if disabled. */
 };
 
 /**
@@ -404,14 +605,26 @@ struct _Plugin
  * fast. This is exactly what needs to be done when using kdbGet() and kdbSet()
  * in a hierarchy where backends are mounted - you need the backend mounted
  * closest to the parentKey.
+ *
+ * It is a radix tree over the segments of unescaped key names, so that
+ * lookups can directly compare the unescaped name of a key.
+ * Every node holds one or more segments, the children of a node are kept
+ * in one array ordered by their first segment.
  */
+typedef struct _TrieNode
+{
+	char * name;		     /*!< Unescaped name segments from the parent to this node, each null terminated */
+	size_t size;		     /*!< Size of the name */
+	Backend * value;	     /*!< The backend mounted here, 0 if none */
+	struct _TrieNode * children; /*!< The children, ordered by their first segment */
+	size_t nrChildren;	     /*!< Number of children */
+} TrieNode;
+
 struct _Trie
 {
-	struct _Trie * children[KDB_MAX_UCHAR]; /*!< The children building up the trie recursively */
-	char * text[KDB_MAX_UCHAR];		/*!< Text identifying this node */
-	size_t textlen[KDB_MAX_UCHAR];		/*!< Length of the text */
-	Backend * value[KDB_MAX_UCHAR];		/*!< Pointer to a backend */
-	Backend * empty_value;			/*!< Pointer to a backend for the empty string "" */
+	TrieNode root;	     /*!< The value of the root is the backend for the empty string "" */
+	Backend ** replaced; /*!< Backends inserted twice for the same name, only kept to be closed */
+	size_t nrReplaced;   /*!< Number of replaced backends */
 };
 
 typedef enum {
@@ -422,9 +635,14 @@ typedef enum {
 		 the keys to database.
 		 */
 
-	SPLIT_FLAG_CASCADING = 1 << 1 /*!< Do we need relative checks?
+	SPLIT_FLAG_CASCADING = 1 << 1, /*!< Do we need relative checks?
 			  Is this a cascading backend?
 			  */
+
+	SPLIT_FLAG_CACHED = 1 << 2 /*!< KeySet in Split was read from the cache.
+		 The plugins of the backend are not called, the
+		 flag replaces SPLIT_FLAG_SYNC while they would be.
+		 */
 } splitflag_t;
 
 
@@ -468,11 +686,44 @@ void elektraSplitUpdateFileName (Split * split, KDB * handle, Key * key);
 
 /* for kdbOpen() algorithm */
 void elektraSplitOpen (Split * split);
+int elektraSplitMaterialise (Split * split, Key * warningKey);
 
 /* for kdbGet() algorithm */
 int elektraSplitAppoint (Split * split, KDB * handle, KeySet * ks);
+int elektraSplitShareArena (Split * split);
 int elektraSplitGet (Split * split, Key * warningKey, KDB * handle);
 int elektraSplitMerge (Split * split, KeySet * dest);
+int elektraGetDoUpdateParallel (Split * split, Key * parentKey, int start, int end, size_t threads);
+void elektraCopyWarnings (Key * to, Key * from);
+
+/* for statistics of kdbGet() and kdbSet() */
+int elektraStatsCall (ElektraStatsSlot * slot, Plugin * plugin, kdbGetPtr function, KeySet * ks, Key * parentKey);
+int elektraStatsBackendCall (Backend * backend, ElektraStatsPhase phase, size_t slot, KeySet * ks, Key * parentKey);
+kdb_unsigned_long_long_t elektraStatsNow (void);
+void elektraStatsAdd (ElektraStatsSlot * slot, kdb_unsigned_long_long_t start, size_t allocations, KeySet * ks);
+void elektraCountAllocations (int enable);
+size_t elektraAllocations (void);
+
+/** Calls the get plugin in @p slot of @p backend, measured if statistics are enabled. */
+#define ELEKTRA_BACKEND_GET(backend, slot, ks, parentKey)                                                                                  \
+	((backend)->stats ? elektraStatsBackendCall ((backend), ELEKTRA_STATS_GET, (slot), (ks), (parentKey))                              \
+			  : (backend)->getplugins[slot]->kdbGet ((backend)->getplugins[slot], (ks), (parentKey)))
+
+/** Calls the set plugin in @p slot of @p backend, measured if statistics are enabled. */
+#define ELEKTRA_BACKEND_SET(backend, slot, ks, parentKey)                                                                                  \
+	((backend)->stats ? elektraStatsBackendCall ((backend), ELEKTRA_STATS_SET, (slot), (ks), (parentKey))                              \
+			  : (backend)->setplugins[slot]->kdbSet ((backend)->setplugins[slot], (ks), (parentKey)))
+
+/** Calls the error plugin in @p slot of @p backend, measured if statistics are enabled. */
+#define ELEKTRA_BACKEND_ERROR(backend, slot, ks, parentKey)                                                                                \
+	((backend)->stats ? elektraStatsBackendCall ((backend), ELEKTRA_STATS_ERROR, (slot), (ks), (parentKey))                            \
+			  : (backend)->errorplugins[slot]->kdbError ((backend)->errorplugins[slot], (ks), (parentKey)))
+
+/** Calls @p function of the global plugin at @p position, measured if statistics are enabled. */
+#define ELEKTRA_GLOBAL_CALL(handle, position, function, ks, parentKey)                                                                     \
+	((handle)->stats ? elektraStatsCall (&(handle)->stats->global[position], (handle)->globalPlugins[position],                       \
+					     (handle)->globalPlugins[position]->function, (ks), (parentKey))                                  \
+			 : (handle)->globalPlugins[position]->function ((handle)->globalPlugins[position], (ks), (parentKey)))
 
 /* for kdbSet() algorithm */
 int elektraSplitCheckSize (Split * split);
@@ -484,6 +735,9 @@ int elektraSplitUpdateSize (Split * split);
 
 /*Backend handling*/
 Backend * elektraBackendOpen (KeySet * elektra_config, KeySet * modules, Key * errorKey);
+Backend * elektraBackendOpenLazy (KeySet * elektra_config, KeySet * modules, Key * errorKey);
+int elektraBackendMaterialise (Backend * backend, Key * warningKey);
+char * elektraBackendSignature (Backend * backend);
 Backend * elektraBackendOpenMissing (Key * mountpoint);
 Backend * elektraBackendOpenDefault (KeySet * modules, const char * file, Key * errorKey);
 Backend * elektraBackendOpenModules (KeySet * modules, Key * errorKey);
@@ -507,6 +761,7 @@ Trie * elektraTrieOpen (KeySet * config, KeySet * modules, Key * errorKey);
 int elektraTrieClose (Trie * trie, Key * errorKey);
 Backend * elektraTrieLookup (Trie * trie, const Key * key);
 Trie * elektraTrieInsert (Trie * trie, const char * name, Backend * value);
+void elektraTrieLookupAll (Trie * trie, const KeySet * ks, Backend ** backends);
 
 /*Mounting handling */
 int elektraMountOpen (KDB * kdb, KeySet * config, KeySet * modules, Key * errorKey);
@@ -518,6 +773,18 @@ int elektraMountBackend (KDB * kdb, Backend * backend, Key * errorKey);
 
 Key * elektraMountGetMountpoint (KDB * handle, const Key * where);
 Backend * elektraMountGetBackend (KDB * handle, const Key * key);
+void elektraMountGetBackends (KDB * handle, const KeySet * ks, Backend ** backends);
+size_t elektraMountCountBackends (KDB * handle, size_t * materialised);
+
+/*Cache files of the user*/
+int elektraCacheAllowed (void);
+int elektraCacheDirectoryTrusted (const char * directory);
+int elektraCacheOpenTrusted (const char * file);
+
+/*Bootstrap cache handling*/
+char * elektraBootstrapCacheFile (void);
+int elektraBootstrapCacheRead (const char * cacheFile, KeySet * keys);
+int elektraBootstrapCacheWrite (const char * cacheFile, const char * bootstrapFile, KeySet * keys, time_t before);
 
 int keyInit (Key * key);
 void keyVInit (Key * key, const char * keyname, va_list ap);
@@ -536,8 +803,39 @@ Key * elektraKsPrev (KeySet * ks);
 Key * elektraKsPopAtCursor (KeySet * ks, cursor_t pos);
 
 int elektraKeyLock (Key * key, enum elektraLockOptions what);
+int elektraKeyUnshareMeta (Key * key);
 
 ssize_t ksSearchInternal (const KeySet * ks, const Key * toAppend);
+int elektraKsUnshare (KeySet * ks);
+
+/*Private helper for keys pointing into a KeyRegion*/
+KeyRegion * elektraKeyRegionOf (const void * blob);
+void elektraKeyRegionDecRef (KeyRegion * region);
+int elektraKeySetRegionName (Key * key, const char * name, size_t size, size_t usize);
+int elektraKeySetRegionValue (Key * key, const void * value, size_t size);
+int elektraKeyDetachName (Key * key);
+int elektraKeyDetachValue (Key * key);
+void elektraKeyFreeName (Key * key);
+void elektraKeyFreeValue (Key * key);
+
+/*Private helper for allocating keys in a KeyArena*/
+KeyArena * elektraKeyArenaNew (void);
+void elektraKeyArenaDel (KeyArena * arena);
+KeyArena * elektraKsArena (KeySet * ks);
+void elektraKsSetArena (KeySet * ks, KeyArena * arena);
+Key * elektraKeyArenaKeyNew (KeyArena * arena, const char * name);
+ssize_t elektraKeyArenaSetValue (KeyArena * arena, Key * key, const void * value, size_t size);
+ssize_t elektraKeyArenaSetMeta (KeyArena * arena, Key * key, const char * metaName, const char * newMetaString);
+
+/*Private helper for the hash index of keysets*/
+int elektraKsHashUsable (KeySet * ks);
+size_t elektraKsHashName (const Key * key);
+ssize_t elektraKsHashLookup (const KeySet * ks, const Key * key, size_t h);
+int elektraKsHashCascadingUsable (KeySet * ks);
+const size_t * elektraKsHashLookupCascading (const KeySet * ks, const Key * key, size_t h);
+void elektraKsHashInsert (KeySet * ks, size_t pos);
+void elektraKsHashInvalidate (KeySet * ks);
+void elektraKsHashClose (KeySet * ks);
 
 /*Used for internal memcpy/memmove*/
 ssize_t elektraMemcpy (Key ** array1, Key ** array2, size_t size);
@@ -66,6 +66,24 @@ KeySet * elektraKeyGetMetaKeySet (const Key * key);
 Key * ksPrev (KeySet * ks);
 Key * ksPopAtCursor (KeySet * ks, cursor_t c);
 
+KeySet * ksBelow (KeySet * ks, const Key * parent);
+ssize_t elektraKsAppendArray (KeySet * ks, Key ** keys, size_t size);
+
+typedef struct _KeyLookup KeyLookup;
+
+KeyLookup * elektraKeyLookupNew (const char * name);
+int elektraKeyLookupDel (KeyLookup * lookup);
+Key * ksLookupCompiled (KeySet * ks, const KeyLookup * lookup, option_t options);
+
+typedef void (*ElektraNotificationCallback) (KDB * handle, KeySet * changed, void * context);
+
+int elektraNotificationFd (KDB * handle);
+int elektraNotificationSetCallback (KDB * handle, ElektraNotificationCallback callback, void * context);
+int elektraNotificationPoll (KDB * handle, KeySet * changed);
+
+int elektraStatsEnable (KDB * handle, int enable);
+int elektraStats (KDB * handle, KeySet * stats);
+
 #ifdef __cplusplus
 }
 }
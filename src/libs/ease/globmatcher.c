@@ -0,0 +1,351 @@
+/**
+ * @file
+ *
+ * @brief Matching of key names against many glob patterns at once.
+ *
+ * @copyright BSD License (see doc/COPYING or http://www.libelektra.org)
+ */
+
+#include <kdbease.h>
+#include <kdbhelper.h>
+
+#include <fnmatch.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum {
+	SEGMENT_LITERAL, // compared with strcmp
+	SEGMENT_ANY,     // "*", matches every segment
+	SEGMENT_PREFIX,  // a literal followed by "*", e.g. "#*" for array entries
+	SEGMENT_GLOB,    // anything else containing '*' or '?'
+} SegmentType;
+
+typedef struct _ElektraGlobNode ElektraGlobNode;
+
+struct _ElektraGlobNode
+{
+	char * segment;
+	size_t length;
+	SegmentType type;
+
+	ElektraGlobNode ** literals; // sorted by segment
+	size_t literalsSize;
+	ElektraGlobNode ** wildcards; // all other types
+	size_t wildcardsSize;
+
+	size_t * patterns; // indices of the patterns ending in this node
+	size_t patternsSize;
+};
+
+typedef struct
+{
+	char * pattern;
+	int flags;
+	size_t index;
+} ElektraGlobFallback;
+
+struct _ElektraGlobMatcher
+{
+	ElektraGlobNode root;
+	size_t size;
+
+	ElektraGlobFallback * fallbacks; // patterns that cannot be split into segments
+	size_t fallbacksSize;
+
+	size_t * matches; // result of the last elektraGlobMatcherMatch()
+	size_t matchesSize;
+	size_t matchesAlloc;
+};
+
+static int elektraGlobAppend (void ** array, size_t * size, size_t elementSize)
+{
+	// grow in powers of two
+	if (*size == 0 || (*size & (*size - 1)) == 0)
+	{
+		if (elektraRealloc (array, (*size ? *size * 2 : 1) * elementSize) < 0) return -1;
+	}
+	++*size;
+	return 0;
+}
+
+/**
+ * @retval <0, 0, >0 like strcmp() for the segment of a node and the
+ *   first @p length characters of @p segment
+ */
+static int elektraGlobCompareSegment (const ElektraGlobNode * node, const char * segment, size_t length)
+{
+	int cmp = strncmp (node->segment, segment, length);
+	if (cmp) return cmp;
+	return node->length > length;
+}
+
+static ElektraGlobNode * elektraGlobFindLiteral (const ElektraGlobNode * node, const char * segment, size_t length, size_t * pos)
+{
+	size_t low = 0;
+	size_t high = node->literalsSize;
+	while (low < high)
+	{
+		size_t mid = low + (high - low) / 2;
+		int cmp = elektraGlobCompareSegment (node->literals[mid], segment, length);
+		if (cmp == 0) return node->literals[mid];
+		if (cmp < 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	if (pos) *pos = low;
+	return 0;
+}
+
+static SegmentType elektraGlobSegmentType (const char * segment, size_t length)
+{
+	size_t special = strcspn (segment, "*?");
+	if (special >= length) return SEGMENT_LITERAL;
+	if (special == length - 1 && segment[special] == '*') return special == 0 ? SEGMENT_ANY : SEGMENT_PREFIX;
+	return SEGMENT_GLOB;
+}
+
+static ElektraGlobNode * elektraGlobAddChild (ElektraGlobNode * node, const char * segment, size_t length)
+{
+	SegmentType type = elektraGlobSegmentType (segment, length);
+	size_t pos = 0;
+	if (type == SEGMENT_LITERAL)
+	{
+		ElektraGlobNode * found = elektraGlobFindLiteral (node, segment, length, &pos);
+		if (found) return found;
+	}
+	else
+	{
+		for (size_t i = 0; i < node->wildcardsSize; ++i)
+		{
+			ElektraGlobNode * cur = node->wildcards[i];
+			if (!elektraGlobCompareSegment (cur, segment, length)) return cur;
+		}
+	}
+
+	ElektraGlobNode * child = elektraCalloc (sizeof (ElektraGlobNode));
+	if (!child) return 0;
+	child->segment = elektraMalloc (length + 1);
+	if (!child->segment)
+	{
+		elektraFree (child);
+		return 0;
+	}
+	memcpy (child->segment, segment, length);
+	child->segment[length] = '\0';
+	child->length = length;
+	child->type = type;
+
+	if (type == SEGMENT_LITERAL)
+	{
+		if (elektraGlobAppend ((void **)&node->literals, &node->literalsSize, sizeof (ElektraGlobNode *)) < 0) goto error;
+		memmove (node->literals + pos + 1, node->literals + pos, (node->literalsSize - pos - 1) * sizeof (ElektraGlobNode *));
+		node->literals[pos] = child;
+	}
+	else
+	{
+		if (elektraGlobAppend ((void **)&node->wildcards, &node->wildcardsSize, sizeof (ElektraGlobNode *)) < 0) goto error;
+		node->wildcards[node->wildcardsSize - 1] = child;
+	}
+	return child;
+
+error:
+	elektraFree (child->segment);
+	elektraFree (child);
+	return 0;
+}
+
+static void elektraGlobDelNode (ElektraGlobNode * node)
+{
+	for (size_t i = 0; i < node->literalsSize; ++i)
+	{
+		elektraGlobDelNode (node->literals[i]);
+		elektraFree (node->literals[i]);
+	}
+	for (size_t i = 0; i < node->wildcardsSize; ++i)
+	{
+		elektraGlobDelNode (node->wildcards[i]);
+		elektraFree (node->wildcards[i]);
+	}
+	if (node->literals) elektraFree (node->literals);
+	if (node->wildcards) elektraFree (node->wildcards);
+	if (node->patterns) elektraFree (node->patterns);
+	if (node->segment) elektraFree (node->segment);
+}
+
+static int elektraGlobAddMatch (ElektraGlobMatcher * matcher, size_t index)
+{
+	if (matcher->matchesSize == matcher->matchesAlloc)
+	{
+		size_t alloc = matcher->matchesAlloc ? matcher->matchesAlloc * 2 : 16;
+		if (elektraRealloc ((void **)&matcher->matches, alloc * sizeof (size_t)) < 0) return -1;
+		matcher->matchesAlloc = alloc;
+	}
+	matcher->matches[matcher->matchesSize++] = index;
+	return 0;
+}
+
+static int elektraGlobMatchSegment (const ElektraGlobNode * node, const char * segment, size_t length)
+{
+	switch (node->type)
+	{
+	case SEGMENT_ANY:
+		return 1;
+	case SEGMENT_PREFIX:
+		return length >= node->length - 1 && !strncmp (node->segment, segment, node->length - 1);
+	case SEGMENT_GLOB:
+	{
+		char * copy = elektraMalloc (length + 1);
+		if (!copy) return 0;
+		memcpy (copy, segment, length);
+		copy[length] = '\0';
+		int match = !fnmatch (node->segment, copy, FNM_PATHNAME);
+		elektraFree (copy);
+		return match;
+	}
+	default:
+		return !elektraGlobCompareSegment (node, segment, length);
+	}
+}
+
+static int elektraGlobWalk (ElektraGlobMatcher * matcher, const ElektraGlobNode * node, const char * name);
+
+static int elektraGlobEnter (ElektraGlobMatcher * matcher, const ElektraGlobNode * child, const char * next)
+{
+	if (*next) return elektraGlobWalk (matcher, child, next + 1);
+
+	for (size_t i = 0; i < child->patternsSize; ++i)
+	{
+		if (elektraGlobAddMatch (matcher, child->patterns[i]) < 0) return -1;
+	}
+	return 0;
+}
+
+static int elektraGlobWalk (ElektraGlobMatcher * matcher, const ElektraGlobNode * node, const char * name)
+{
+	const char * next = strchr (name, '/');
+	if (!next) next = name + strlen (name);
+	size_t length = next - name;
+
+	const ElektraGlobNode * literal = elektraGlobFindLiteral (node, name, length, 0);
+	if (literal && elektraGlobEnter (matcher, literal, next) < 0) return -1;
+
+	for (size_t i = 0; i < node->wildcardsSize; ++i)
+	{
+		const ElektraGlobNode * child = node->wildcards[i];
+		if (elektraGlobMatchSegment (child, name, length) && elektraGlobEnter (matcher, child, next) < 0) return -1;
+	}
+	return 0;
+}
+
+static int elektraGlobCompareIndex (const void * a, const void * b)
+{
+	size_t first = *(const size_t *)a;
+	size_t second = *(const size_t *)b;
+	return first < second ? -1 : first > second;
+}
+
+/**
+ * @brief Create an empty matcher
+ *
+ * A matcher compiles many glob patterns into a trie of their path
+ * segments, so that a key name is compared to all patterns in one walk
+ * instead of calling fnmatch() for every pattern. Plugins like spec
+ * and glob use it to find the patterns that apply to a key.
+ *
+ * @return the new matcher or NULL on allocation errors
+ */
+ElektraGlobMatcher * elektraGlobMatcherNew (void)
+{
+	return elektraCalloc (sizeof (ElektraGlobMatcher));
+}
+
+/**
+ * @brief Add the pattern with the next index to @p matcher
+ *
+ * Names match the pattern iff fnmatch (pattern, name, flags) would
+ * return 0. Patterns for FNM_PATHNAME without '[' or '\\' are split at
+ * '/' into the trie, all others are compared with fnmatch().
+ *
+ * @return the index of the pattern, starting with 0, or -1 on errors
+ */
+ssize_t elektraGlobMatcherAdd (ElektraGlobMatcher * matcher, const char * pattern, int flags)
+{
+	if (!matcher || !pattern) return -1;
+
+	if (flags != FNM_PATHNAME || strpbrk (pattern, "[\\"))
+	{
+		char * copy = elektraStrDup (pattern);
+		if (!copy) return -1;
+		if (elektraGlobAppend ((void **)&matcher->fallbacks, &matcher->fallbacksSize, sizeof (ElektraGlobFallback)) < 0)
+		{
+			elektraFree (copy);
+			return -1;
+		}
+		ElektraGlobFallback * fallback = &matcher->fallbacks[matcher->fallbacksSize - 1];
+		fallback->pattern = copy;
+		fallback->flags = flags;
+		fallback->index = matcher->size;
+		return matcher->size++;
+	}
+
+	ElektraGlobNode * node = &matcher->root;
+	const char * segment = pattern;
+	while (node)
+	{
+		const char * next = strchr (segment, '/');
+		if (!next) next = segment + strlen (segment);
+		node = elektraGlobAddChild (node, segment, next - segment);
+		if (!*next) break;
+		segment = next + 1;
+	}
+	if (!node) return -1;
+
+	if (elektraGlobAppend ((void **)&node->patterns, &node->patternsSize, sizeof (size_t)) < 0) return -1;
+	node->patterns[node->patternsSize - 1] = matcher->size;
+	return matcher->size++;
+}
+
+/**
+ * @brief Find all patterns matching @p name
+ *
+ * @param size is set to the number of matching patterns
+ *
+ * @return the indices of the matching patterns in ascending order,
+ *   valid until the next call, or NULL if none matches or on errors
+ */
+const size_t * elektraGlobMatcherMatch (ElektraGlobMatcher * matcher, const char * name, size_t * size)
+{
+	if (size) *size = 0;
+	if (!matcher || !name) return 0;
+
+	matcher->matchesSize = 0;
+	if (elektraGlobWalk (matcher, &matcher->root, name) < 0) return 0;
+	for (size_t i = 0; i < matcher->fallbacksSize; ++i)
+	{
+		const ElektraGlobFallback * fallback = &matcher->fallbacks[i];
+		if (!fnmatch (fallback->pattern, name, fallback->flags) && elektraGlobAddMatch (matcher, fallback->index) < 0) return 0;
+	}
+	if (!matcher->matchesSize) return 0;
+
+	qsort (matcher->matches, matcher->matchesSize, sizeof (size_t), elektraGlobCompareIndex);
+	if (size) *size = matcher->matchesSize;
+	return matcher->matches;
+}
+
+/**
+ * @brief Free @p matcher and all its patterns
+ */
+void elektraGlobMatcherDel (ElektraGlobMatcher * matcher)
+{
+	if (!matcher) return;
+
+	elektraGlobDelNode (&matcher->root);
+	for (size_t i = 0; i < matcher->fallbacksSize; ++i)
+	{
+		elektraFree (matcher->fallbacks[i].pattern);
+	}
+	if (matcher->fallbacks) elektraFree (matcher->fallbacks);
+	if (matcher->matches) elektraFree (matcher->matches);
+	elektraFree (matcher);
+}
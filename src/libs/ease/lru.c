@@ -0,0 +1,202 @@
+/**
+ * @file
+ *
+ * @brief Least recently used cache for compiled checks of plugins.
+ *
+ * @copyright BSD License (see doc/COPYING or http://www.libelektra.org)
+ */
+
+#include <kdbease.h>
+#include <kdbhelper.h>
+
+#include <string.h>
+
+typedef struct _ElektraLruEntry ElektraLruEntry;
+
+struct _ElektraLruEntry
+{
+	char * name;
+	void * value;
+	size_t hash;
+	ElektraLruEntry * bucketNext; // next entry with the same bucket
+	ElektraLruEntry * newer;      // towards the most recently used entry
+	ElektraLruEntry * older;      // towards the least recently used entry
+};
+
+struct _ElektraLru
+{
+	size_t capacity;
+	size_t size;
+	size_t buckets; // a power of two
+	ElektraLruEntry ** table;
+	ElektraLruEntry * newest;
+	ElektraLruEntry * oldest;
+	ElektraLruFree freeValue;
+};
+
+static size_t elektraLruHash (const char * name)
+{
+	size_t hash = 5381;
+	for (const unsigned char * cur = (const unsigned char *)name; *cur; ++cur)
+	{
+		hash = hash * 33 ^ *cur;
+	}
+	return hash;
+}
+
+static void elektraLruUnlink (ElektraLru * lru, ElektraLruEntry * entry)
+{
+	if (entry->newer)
+		entry->newer->older = entry->older;
+	else
+		lru->newest = entry->older;
+	if (entry->older)
+		entry->older->newer = entry->newer;
+	else
+		lru->oldest = entry->newer;
+	entry->newer = entry->older = 0;
+}
+
+static void elektraLruLinkNewest (ElektraLru * lru, ElektraLruEntry * entry)
+{
+	entry->older = lru->newest;
+	entry->newer = 0;
+	if (lru->newest) lru->newest->newer = entry;
+	lru->newest = entry;
+	if (!lru->oldest) lru->oldest = entry;
+}
+
+static void elektraLruRemove (ElektraLru * lru, ElektraLruEntry * entry)
+{
+	ElektraLruEntry ** cur = &lru->table[entry->hash & (lru->buckets - 1)];
+	while (*cur != entry)
+	{
+		cur = &(*cur)->bucketNext;
+	}
+	*cur = entry->bucketNext;
+	elektraLruUnlink (lru, entry);
+	if (lru->freeValue) lru->freeValue (entry->value);
+	elektraFree (entry->name);
+	elektraFree (entry);
+	--lru->size;
+}
+
+/**
+ * @brief Create a cache of at most @p capacity values
+ *
+ * Plugins use it to keep what they compiled from metadata, e.g. a
+ * regex_t for the value of check/validation, across the calls of
+ * kdbSet() and for all keys with the same metadata. When the cache is
+ * full, the least recently used value is freed.
+ *
+ * @param capacity the maximum number of values
+ * @param freeValue frees a value when it is evicted or the cache is deleted
+ *
+ * @return the new cache or NULL if @p capacity is 0 or on allocation errors
+ */
+ElektraLru * elektraLruNew (size_t capacity, ElektraLruFree freeValue)
+{
+	if (!capacity) return 0;
+
+	ElektraLru * lru = elektraCalloc (sizeof (ElektraLru));
+	if (!lru) return 0;
+
+	lru->capacity = capacity;
+	lru->buckets = 1;
+	while (lru->buckets < capacity)
+	{
+		lru->buckets <<= 1;
+	}
+	lru->table = elektraCalloc (lru->buckets * sizeof (ElektraLruEntry *));
+	if (!lru->table)
+	{
+		elektraFree (lru);
+		return 0;
+	}
+	lru->freeValue = freeValue;
+	return lru;
+}
+
+/**
+ * @brief Get the value cached for @p name and mark it as recently used
+ *
+ * The value stays valid until the next elektraLruPut() or elektraLruDel().
+ *
+ * @return the value or NULL if @p name is not cached
+ */
+void * elektraLruGet (ElektraLru * lru, const char * name)
+{
+	if (!lru || !name) return 0;
+
+	size_t hash = elektraLruHash (name);
+	for (ElektraLruEntry * cur = lru->table[hash & (lru->buckets - 1)]; cur; cur = cur->bucketNext)
+	{
+		if (cur->hash == hash && !strcmp (cur->name, name))
+		{
+			elektraLruUnlink (lru, cur);
+			elektraLruLinkNewest (lru, cur);
+			return cur->value;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Cache @p value for @p name
+ *
+ * A value already cached for @p name is replaced. If the cache is
+ * full, the least recently used value is evicted.
+ *
+ * @param value is freed by the cache from now on, unless -1 is returned
+ *
+ * @retval 0 on success
+ * @retval -1 on null pointers or allocation errors, @p value is not owned by the cache then
+ */
+int elektraLruPut (ElektraLru * lru, const char * name, void * value)
+{
+	if (!lru || !name) return -1;
+
+	size_t hash = elektraLruHash (name);
+	for (ElektraLruEntry * cur = lru->table[hash & (lru->buckets - 1)]; cur; cur = cur->bucketNext)
+	{
+		if (cur->hash == hash && !strcmp (cur->name, name))
+		{
+			elektraLruRemove (lru, cur);
+			break;
+		}
+	}
+
+	ElektraLruEntry * entry = elektraCalloc (sizeof (ElektraLruEntry));
+	if (!entry) return -1;
+	entry->name = elektraStrDup (name);
+	if (!entry->name)
+	{
+		elektraFree (entry);
+		return -1;
+	}
+
+	if (lru->size == lru->capacity) elektraLruRemove (lru, lru->oldest);
+
+	entry->value = value;
+	entry->hash = hash;
+	entry->bucketNext = lru->table[hash & (lru->buckets - 1)];
+	lru->table[hash & (lru->buckets - 1)] = entry;
+	elektraLruLinkNewest (lru, entry);
+	++lru->size;
+	return 0;
+}
+
+/**
+ * @brief Free all values and the cache
+ */
+void elektraLruDel (ElektraLru * lru)
+{
+	if (!lru) return;
+
+	while (lru->oldest)
+	{
+		elektraLruRemove (lru, lru->oldest);
+	}
+	elektraFree (lru->table);
+	elektraFree (lru);
+}
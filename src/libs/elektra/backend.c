@@ -103,58 +103,30 @@ int elektraBackendSetMountpoint (Backend * backend, KeySet * elektraConfig, Key
 }
 
 
-/**Builds a backend out of the configuration supplied
- * from:
- *
-@verbatim
-system/elektra/mountpoints/<name>
-@endverbatim
- *
- * The root key must be like the above example. You do
- * not need to rewind the keyset. But every key must be
- * below the root key.
- *
- * The internal consistency will be checked in this
- * function. If necessary parts are missing, like
- * no plugins, they cant be loaded or similar 0
- * will be returned.
- *
- * ksCut() is perfectly suitable for cutting out the
- * configuration like needed.
+/**
+ * @internal
  *
- * @note The given KeySet will be deleted within the function,
- * don't use it afterwards.
+ * @brief Opens the plugins of a backend as given in its configuration.
  *
- * @param elektraConfig the configuration to work with.
- *        It is used to build up this backend.
+ * @param backend the backend to put the plugins into
+ * @param elektraConfig the configuration of the backend, root key first
  * @param modules used to load new modules or get references
  *        to existing one
+ * @param failure 1 if a failure occurred before, suppresses further warnings
  * @param errorKey the key where an error and warnings are added
  *
- * @return a pointer to a freshly allocated backend
- *         this could be the requested backend or a so called
- *         "missing backend".
- * @retval 0 if out of memory
- * @ingroup backend
+ * @retval 1 if the configuration is not consistent or plugins could not be opened
+ * @retval 0 on success
  */
-Backend * elektraBackendOpen (KeySet * elektraConfig, KeySet * modules, Key * errorKey)
+static int elektraBackendOpenPlugins (Backend * backend, KeySet * elektraConfig, KeySet * modules, int failure, Key * errorKey)
 {
 	Key * cur;
-	KeySet * referencePlugins = 0;
+	KeySet * referencePlugins = ksNew (0, KS_END);
 	KeySet * systemConfig = 0;
-	int failure = 0;
 
-	referencePlugins = ksNew (0, KS_END);
 	ksRewind (elektraConfig);
-
 	Key * root = ksNext (elektraConfig);
 
-	Backend * backend = elektraBackendAllocate ();
-	if (elektraBackendSetMountpoint (backend, elektraConfig, errorKey) == -1)
-	{ // warning already set
-		failure = 1;
-	}
-
 	while ((cur = ksNext (elektraConfig)) != 0)
 	{
 		if (keyRel (root, cur) == 1)
@@ -207,6 +179,88 @@ Backend * elektraBackendOpen (KeySet * elektraConfig, KeySet * modules, Key * er
 		}
 	}
 
+	ksDel (systemConfig);
+	ksDel (referencePlugins);
+
+	return failure;
+}
+
+/**
+ * @internal
+ *
+ * @brief Closes all plugins of a backend.
+ *
+ * @return the number of plugins which failed to close
+ */
+static int elektraBackendClosePlugins (Backend * backend, Key * errorKey)
+{
+	int errorOccurred = 0;
+
+	for (int i = 0; i < NR_OF_PLUGINS; ++i)
+	{
+		if (elektraPluginClose (backend->setplugins[i], errorKey) == -1) ++errorOccurred;
+		if (elektraPluginClose (backend->getplugins[i], errorKey) == -1) ++errorOccurred;
+		if (elektraPluginClose (backend->errorplugins[i], errorKey) == -1) ++errorOccurred;
+
+		backend->setplugins[i] = 0;
+		backend->getplugins[i] = 0;
+		backend->errorplugins[i] = 0;
+	}
+
+	return errorOccurred;
+}
+
+
+/**Builds a backend out of the configuration supplied
+ * from:
+ *
+@verbatim
+system/elektra/mountpoints/<name>
+@endverbatim
+ *
+ * The root key must be like the above example. You do
+ * not need to rewind the keyset. But every key must be
+ * below the root key.
+ *
+ * The internal consistency will be checked in this
+ * function. If necessary parts are missing, like
+ * no plugins, they cant be loaded or similar 0
+ * will be returned.
+ *
+ * ksCut() is perfectly suitable for cutting out the
+ * configuration like needed.
+ *
+ * @note The given KeySet will be deleted within the function,
+ * don't use it afterwards.
+ *
+ * @param elektraConfig the configuration to work with.
+ *        It is used to build up this backend.
+ * @param modules used to load new modules or get references
+ *        to existing one
+ * @param errorKey the key where an error and warnings are added
+ *
+ * @return a pointer to a freshly allocated backend
+ *         this could be the requested backend or a so called
+ *         "missing backend".
+ * @retval 0 if out of memory
+ * @see elektraBackendOpenLazy() to defer the opening of the plugins
+ * @ingroup backend
+ */
+Backend * elektraBackendOpen (KeySet * elektraConfig, KeySet * modules, Key * errorKey)
+{
+	int failure = 0;
+
+	ksRewind (elektraConfig);
+	ksNext (elektraConfig);
+
+	Backend * backend = elektraBackendAllocate ();
+	if (elektraBackendSetMountpoint (backend, elektraConfig, errorKey) == -1)
+	{ // warning already set
+		failure = 1;
+	}
+
+	failure = elektraBackendOpenPlugins (backend, elektraConfig, modules, failure, errorKey);
+
 	if (failure)
 	{
 		Backend * tmpBackend = elektraBackendOpenMissing (backend->mountpoint);
@@ -214,13 +268,156 @@ Backend * elektraBackendOpen (KeySet * elektraConfig, KeySet * modules, Key * er
 		backend = tmpBackend;
 	}
 
-	ksDel (systemConfig);
 	ksDel (elektraConfig);
-	ksDel (referencePlugins);
 
 	return backend;
 }
 
+/**
+ * Builds a backend like elektraBackendOpen(), but only
+ * sets its mountpoint.
+ *
+ * The configuration is kept within the backend, the plugins are
+ * opened by elektraBackendMaterialise() when the backend is
+ * needed the first time. Failures in the plugin configuration
+ * are therefore not reported here.
+ *
+ * @note The given KeySet will be owned by the backend,
+ * don't use it afterwards.
+ *
+ * @param elektraConfig the configuration to work with.
+ * @param modules used to load new modules later, must stay
+ *        valid as long as the backend is not materialised
+ * @param errorKey the key where warnings are added
+ *
+ * @return a pointer to a freshly allocated backend
+ *         or a "missing backend" if there is no mountpoint
+ * @retval 0 if out of memory
+ * @ingroup backend
+ */
+Backend * elektraBackendOpenLazy (KeySet * elektraConfig, KeySet * modules, Key * errorKey)
+{
+	ksRewind (elektraConfig);
+	ksNext (elektraConfig);
+
+	Backend * backend = elektraBackendAllocate ();
+	if (elektraBackendSetMountpoint (backend, elektraConfig, errorKey) == -1)
+	{ // warning already set
+		Backend * tmpBackend = elektraBackendOpenMissing (backend->mountpoint);
+		elektraBackendClose (backend, errorKey);
+		ksDel (elektraConfig);
+		return tmpBackend;
+	}
+
+	backend->config = elektraConfig;
+	backend->modules = modules;
+
+	return backend;
+}
+
+/**
+ * Opens the plugins of a backend built by elektraBackendOpenLazy().
+ *
+ * If the plugins cannot be opened, the backend is turned into
+ * a "missing backend" in place, so that all references to it
+ * (e.g. of cascading mountpoints) stay valid.
+ *
+ * The plugins are opened with a key named like the mountpoint,
+ * warnings and errors are added as warnings to @p warningKey.
+ *
+ * @param backend the backend to materialise
+ * @param warningKey the key where warnings are added
+ *
+ * @retval 1 if the plugins were opened
+ * @retval 0 if the backend was already materialised
+ * @retval -1 if the backend is missing now
+ * @ingroup backend
+ */
+int elektraBackendMaterialise (Backend * backend, Key * warningKey)
+{
+	if (!backend->config) return 0;
+
+	KeySet * elektraConfig = backend->config;
+	backend->config = 0;
+
+	Key * errorKey = keyNew ("", KEY_END);
+	elektraKeySetName (errorKey, keyName (backend->mountpoint), KEY_CASCADING_NAME | KEY_EMPTY_NAME);
+
+	int failure = elektraBackendOpenPlugins (backend, elektraConfig, backend->modules, 0, errorKey);
+
+	if (failure)
+	{
+		elektraBackendClosePlugins (backend, errorKey);
+
+		Plugin * plugin = elektraPluginMissing ();
+		if (plugin)
+		{
+			backend->getplugins[0] = plugin;
+			backend->setplugins[0] = plugin;
+			plugin->refcounter = 2;
+		}
+		keySetString (backend->mountpoint, "missing");
+	}
+
+	elektraCopyWarnings (warningKey, errorKey);
+	const Key * reason = keyGetMeta (errorKey, "error/reason");
+	if (reason)
+	{
+		ELEKTRA_ADD_WARNINGF (13, warningKey, "opening backend %s failed: %s", keyName (errorKey), keyString (reason));
+	}
+
+	keyDel (errorKey);
+	ksDel (elektraConfig);
+
+	return failure ? -1 : 1;
+}
+
+static unsigned long long elektraBackendHash (unsigned long long hash, const void * data, size_t size)
+{
+	const unsigned char * cur = data;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= cur[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+/**
+ * @internal
+ *
+ * @brief A signature of the plugins reading a backend.
+ *
+ * It is a hash (FNV-1a) of the names and the configuration of all
+ * get plugins and their positions. Two backends with the same
+ * signature read a file in the same way, so caches use it to tell
+ * apart backends which read the same file differently, e.g. after
+ * remounting a file with another storage plugin.
+ *
+ * @param backend a materialised backend
+ *
+ * @return the signature as 16 hexadecimal digits, to be freed with elektraFree()
+ */
+char * elektraBackendSignature (Backend * backend)
+{
+	unsigned long long hash = 0xcbf29ce484222325ULL;
+	for (size_t i = 0; i < NR_OF_PLUGINS; ++i)
+	{
+		Plugin * plugin = backend->getplugins[i];
+		if (!plugin) continue;
+
+		hash = elektraBackendHash (hash, &i, sizeof (i));
+		if (plugin->name) hash = elektraBackendHash (hash, plugin->name, strlen (plugin->name) + 1);
+		for (cursor_t c = 0; plugin->config && c < ksGetSize (plugin->config); ++c)
+		{
+			const Key * key = ksAtCursor (plugin->config, c);
+			hash = elektraBackendHash (hash, keyName (key), keyGetNameSize (key));
+			hash = elektraBackendHash (hash, keyValue (key), keyGetValueSize (key));
+		}
+	}
+	return elektraFormat ("%016llx", hash);
+}
+
 /**
  * Opens the internal backend that indicates that a backend
  * is missing at that place.
@@ -439,7 +636,6 @@ int elektraBackendUpdateSize (Backend * backend, Key * parent, int size)
 
 int elektraBackendClose (Backend * backend, Key * errorKey)
 {
-	int ret = 0;
 	int errorOccurred = 0;
 
 	if (!backend) return -1;
@@ -453,17 +649,8 @@ int elektraBackendClose (Backend * backend, Key * errorKey)
 	keySetName (errorKey, keyName (backend->mountpoint));
 	keyDel (backend->mountpoint);
 
-	for (int i = 0; i < NR_OF_PLUGINS; ++i)
-	{
-		ret = elektraPluginClose (backend->setplugins[i], errorKey);
-		if (ret == -1) ++errorOccurred;
-
-		ret = elektraPluginClose (backend->getplugins[i], errorKey);
-		if (ret == -1) ++errorOccurred;
-
-		ret = elektraPluginClose (backend->errorplugins[i], errorKey);
-		if (ret == -1) ++errorOccurred;
-	}
+	errorOccurred = elektraBackendClosePlugins (backend, errorKey);
+	ksDel (backend->config);
 	elektraFree (backend);
 
 	if (errorOccurred)
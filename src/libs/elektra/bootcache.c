@@ -0,0 +1,492 @@
+/**
+ * @file
+ *
+ * @brief Cache of the configuration read while bootstrapping.
+ *
+ * @copyright BSD License (see doc/COPYING or http://www.libelektra.org)
+ */
+
+#ifdef HAVE_KDBCONFIG_H
+#include "kdbconfig.h"
+#endif
+
+#ifdef HAVE_STDIO_H
+#include <stdio.h>
+#endif
+
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include <fcntl.h>
+
+#include "kdbinternal.h"
+
+
+#define ELEKTRA_BOOTSTRAP_CACHE_MAGIC "kdbboot1"
+#define ELEKTRA_BOOTSTRAP_CACHE_IDENTITY KDB_VERSION ":" KDB_DB_SYSTEM "/" KDB_DB_INIT
+
+#if defined(__APPLE__)
+#define elektraStatNanoSeconds(status) (status).st_mtimespec.tv_nsec
+#else
+#define elektraStatNanoSeconds(status) (status).st_mtim.tv_nsec
+#endif
+
+/**
+ * @internal
+ *
+ * The start of a cache file.
+ *
+ * It is followed by the identity of the installation, the name of
+ * the bootstrap file and then the keys, each as BootstrapCacheKey
+ * followed by its name, value and metadata.
+ */
+typedef struct
+{
+	char magic[8];
+	unsigned long long dev;
+	unsigned long long ino;
+	unsigned long long size;
+	long long sec;
+	long long nsec;
+	size_t identitySize;
+	size_t fileSize;
+	size_t nrKeys;
+} BootstrapCacheHeader;
+
+/**
+ * @internal
+ *
+ * A key or meta key within a cache file.
+ */
+typedef struct
+{
+	size_t nameSize;
+	size_t valueSize;
+	size_t nrMeta;
+} BootstrapCacheKey;
+
+typedef struct
+{
+	const char * pos;
+	const char * end;
+} BootstrapCacheReader;
+
+
+#ifdef HAVE_SYS_STAT_H
+
+static void elektraBootstrapCacheStat (BootstrapCacheHeader * header, const struct stat * buf)
+{
+	header->dev = buf->st_dev;
+	header->ino = buf->st_ino;
+	header->size = buf->st_size;
+	header->sec = buf->st_mtime;
+	header->nsec = elektraStatNanoSeconds (*buf);
+}
+
+/**
+ * @internal
+ *
+ * @brief Take size bytes from the cache file.
+ *
+ * @retval 0 if the file is too short
+ */
+static const char * elektraBootstrapCacheTake (BootstrapCacheReader * reader, size_t size)
+{
+	if ((size_t) (reader->end - reader->pos) < size) return 0;
+	const char * ret = reader->pos;
+	reader->pos += size;
+	return ret;
+}
+
+/**
+ * @internal
+ *
+ * @brief Take a name (null terminated) and a value from the cache file.
+ *
+ * @retval -1 if the file is too short or the name not terminated
+ */
+static int elektraBootstrapCacheTakeKey (BootstrapCacheReader * reader, BootstrapCacheKey * record, const char ** name,
+					 const char ** value)
+{
+	const char * cur = elektraBootstrapCacheTake (reader, sizeof (BootstrapCacheKey));
+	if (!cur) return -1;
+	memcpy (record, cur, sizeof (BootstrapCacheKey));
+
+	if (record->nameSize == 0) return -1;
+	*name = elektraBootstrapCacheTake (reader, record->nameSize);
+	*value = elektraBootstrapCacheTake (reader, record->valueSize);
+	if (!*name || !*value || (*name)[record->nameSize - 1] != '\0') return -1;
+	return 0;
+}
+
+static int elektraBootstrapCachePut (FILE * fp, const void * data, size_t size)
+{
+	return size == 0 || fwrite (data, size, 1, fp) == 1;
+}
+
+static int elektraBootstrapCachePutKey (FILE * fp, const char * name, const void * value, size_t valueSize, size_t nrMeta)
+{
+	BootstrapCacheKey record;
+	record.nameSize = strlen (name) + 1;
+	record.valueSize = value ? valueSize : 0;
+	record.nrMeta = nrMeta;
+
+	return elektraBootstrapCachePut (fp, &record, sizeof (record)) && elektraBootstrapCachePut (fp, name, record.nameSize) &&
+	       elektraBootstrapCachePut (fp, value, record.valueSize);
+}
+
+/**
+ * @internal
+ *
+ * @brief Only files and directories of the effective user,
+ *        which nobody else can write, are trusted.
+ */
+static int elektraCacheTrusted (const struct stat * buf)
+{
+	return buf->st_uid == geteuid () && !(buf->st_mode & (S_IWGRP | S_IWOTH));
+}
+
+/**
+ * @internal
+ *
+ * @brief Check the directory containing @p file with elektraCacheDirectoryTrusted().
+ */
+static int elektraCacheParentTrusted (const char * file)
+{
+	const char * slash = strrchr (file, '/');
+	if (!slash) return elektraCacheDirectoryTrusted (".");
+	if (slash == file) return elektraCacheDirectoryTrusted ("/");
+
+	char * directory = elektraStrDup (file);
+	directory[slash - file] = '\0';
+	int ret = elektraCacheDirectoryTrusted (directory);
+	elektraFree (directory);
+	return ret;
+}
+
+#endif
+
+/**
+ * @internal
+ *
+ * @brief Check if caches of the current user may be used.
+ *
+ * Caches are found below $XDG_CACHE_HOME or $HOME, which are
+ * inherited by set-user-ID and set-group-ID programs (and e.g.
+ * preserved by sudo). Such processes must not use them.
+ *
+ * @retval 1 if the real and effective user and group are the same
+ * @retval 0 otherwise
+ */
+int elektraCacheAllowed (void)
+{
+#ifdef HAVE_UNISTD_H
+	return geteuid () == getuid () && getegid () == getgid ();
+#else
+	return 0;
+#endif
+}
+
+/**
+ * @internal
+ *
+ * @brief Check if a cache directory can be trusted.
+ *
+ * The directory must not be a symbolic link, must belong to the
+ * effective user and must not be writable by group or others.
+ * Otherwise someone else could place cache files in it.
+ *
+ * @retval 1 if the directory can be trusted
+ * @retval 0 otherwise, also if it does not exist
+ */
+int elektraCacheDirectoryTrusted (const char * directory)
+{
+#ifdef HAVE_SYS_STAT_H
+	struct stat buf;
+	return lstat (directory, &buf) == 0 && S_ISDIR (buf.st_mode) && elektraCacheTrusted (&buf);
+#else
+	(void)directory;
+	return 0;
+#endif
+}
+
+/**
+ * @internal
+ *
+ * @brief Open a cache file for reading, if it can be trusted.
+ *
+ * Symbolic links are not followed. The opened file must be a regular
+ * file of the effective user, not writable by group or others, and
+ * its directory must be trusted by elektraCacheDirectoryTrusted().
+ *
+ * @return the file descriptor, to be closed by the caller
+ * @retval -1 if the file is missing or not trusted
+ */
+int elektraCacheOpenTrusted (const char * file)
+{
+#ifdef HAVE_SYS_STAT_H
+	struct stat buf;
+
+	if (!elektraCacheAllowed () || !elektraCacheParentTrusted (file)) return -1;
+
+	int fd = open (file, O_RDONLY | O_NOFOLLOW);
+	if (fd == -1) return -1;
+	if (fstat (fd, &buf) == -1 || !S_ISREG (buf.st_mode) || !elektraCacheTrusted (&buf))
+	{
+		close (fd);
+		return -1;
+	}
+	return fd;
+#else
+	(void)file;
+	return -1;
+#endif
+}
+
+/**
+ * @internal
+ *
+ * @brief The name of the cache file of the current user.
+ *
+ * The cache is below $XDG_CACHE_HOME or, if it is not set,
+ * below ~/.cache.
+ *
+ * No cache is used if the process runs with other privileges than
+ * its user, see elektraCacheAllowed().
+ *
+ * @return the file name, to be freed with elektraFree()
+ * @retval 0 if there is no place for the cache
+ */
+char * elektraBootstrapCacheFile (void)
+{
+	if (!elektraCacheAllowed ()) return 0;
+
+	const char * cache = getenv ("XDG_CACHE_HOME");
+	if (cache && cache[0] == '/') return elektraFormat ("%s/elektra/bootstrap.cache", cache);
+
+	const char * home = getenv ("HOME");
+	if (home && home[0] == '/') return elektraFormat ("%s/.cache/elektra/bootstrap.cache", home);
+
+	return 0;
+}
+
+/**
+ * @internal
+ *
+ * @brief Read the configuration of bootstrapping from the cache.
+ *
+ * The cache is only used if it was written by the same
+ * installation and the bootstrap file is unchanged, which is
+ * checked with a single stat() of it. The cache file is opened
+ * with elektraCacheOpenTrusted(), so it must belong to the user.
+ *
+ * @param cacheFile the name of the cache file
+ * @param [out] keys receives the keys of the cache, should be empty
+ *
+ * @retval 1 if the keys were read from the cache
+ * @retval 0 if the cache is missing, outdated or invalid,
+ *         keys is unchanged then
+ */
+int elektraBootstrapCacheRead (const char * cacheFile, KeySet * keys)
+{
+#ifdef HAVE_SYS_STAT_H
+	int ret = 0;
+	char * data = 0;
+	KeySet * read = 0;
+	BootstrapCacheHeader header;
+	BootstrapCacheHeader current;
+	struct stat buf;
+
+	int fd = elektraCacheOpenTrusted (cacheFile);
+	if (fd == -1) return 0;
+	FILE * fp = fdopen (fd, "rb");
+	if (!fp)
+	{
+		close (fd);
+		return 0;
+	}
+	if (fseek (fp, 0, SEEK_END) == -1) goto cleanup;
+	long size = ftell (fp);
+	if (size < (long)sizeof (BootstrapCacheHeader) || fseek (fp, 0, SEEK_SET) == -1) goto cleanup;
+	data = elektraMalloc (size);
+	if (!data || fread (data, size, 1, fp) != 1) goto cleanup;
+
+	BootstrapCacheReader reader = { data, data + size };
+	memcpy (&header, elektraBootstrapCacheTake (&reader, sizeof (header)), sizeof (header));
+	if (memcmp (header.magic, ELEKTRA_BOOTSTRAP_CACHE_MAGIC, sizeof (header.magic))) goto cleanup;
+
+	const char * identity = elektraBootstrapCacheTake (&reader, header.identitySize);
+	if (!identity || header.identitySize != sizeof (ELEKTRA_BOOTSTRAP_CACHE_IDENTITY) ||
+	    memcmp (identity, ELEKTRA_BOOTSTRAP_CACHE_IDENTITY, header.identitySize))
+	{
+		goto cleanup;
+	}
+
+	const char * file = elektraBootstrapCacheTake (&reader, header.fileSize);
+	if (!file || header.fileSize == 0 || file[header.fileSize - 1] != '\0') goto cleanup;
+	if (stat (file, &buf) == -1) goto cleanup;
+	elektraBootstrapCacheStat (&current, &buf);
+	if (header.dev != current.dev || header.ino != current.ino || header.size != current.size || header.sec != current.sec ||
+	    header.nsec != current.nsec)
+	{
+		goto cleanup;
+	}
+
+	read = ksNew (header.nrKeys, KS_END);
+	KeyArena * arena = elektraKsArena (read);
+	if (!arena) goto cleanup;
+
+	for (size_t i = 0; i < header.nrKeys; ++i)
+	{
+		BootstrapCacheKey record;
+		const char * name;
+		const char * value;
+		if (elektraBootstrapCacheTakeKey (&reader, &record, &name, &value) == -1) goto cleanup;
+
+		Key * key = elektraKeyArenaKeyNew (arena, name);
+		if (!key) goto cleanup;
+		ksAppendKey (read, key);
+		if (elektraKeyArenaSetValue (arena, key, record.valueSize ? value : 0, record.valueSize) == -1) goto cleanup;
+
+		for (size_t j = 0; j < record.nrMeta; ++j)
+		{
+			BootstrapCacheKey metaRecord;
+			if (elektraBootstrapCacheTakeKey (&reader, &metaRecord, &name, &value) == -1) goto cleanup;
+			if (metaRecord.valueSize == 0 || value[metaRecord.valueSize - 1] != '\0') goto cleanup;
+			if (elektraKeyArenaSetMeta (arena, key, name, value) == -1) goto cleanup;
+		}
+		keyClearSync (key);
+	}
+
+	if (reader.pos != reader.end) goto cleanup;
+
+	ksAppend (keys, read);
+	ret = 1;
+
+cleanup:
+	ksDel (read);
+	elektraFree (data);
+	fclose (fp);
+	return ret;
+#else
+	(void)cacheFile;
+	(void)keys;
+	return 0;
+#endif
+}
+
+/**
+ * @internal
+ *
+ * @brief Write the configuration of bootstrapping to the cache.
+ *
+ * The cache is written to a temporary file which replaces the
+ * cache atomically, so that concurrent kdbOpen() never see a
+ * partially written cache.
+ *
+ * Only a bootstrap file which was not modified since @p before is
+ * cached: otherwise it might have changed after the keys were read.
+ *
+ * @param cacheFile the name of the cache file, its directory is
+ *        created if missing
+ * @param bootstrapFile the file the keys were read from
+ * @param keys the keys read while bootstrapping
+ * @param before a point in time before the keys were read
+ *
+ * @retval 1 if the cache was written
+ * @retval 0 if the cache was not written
+ */
+int elektraBootstrapCacheWrite (const char * cacheFile, const char * bootstrapFile, KeySet * keys, time_t before)
+{
+#ifdef HAVE_SYS_STAT_H
+	BootstrapCacheHeader header;
+	struct stat buf;
+
+	if (!bootstrapFile || bootstrapFile[0] != '/') return 0;
+	if (stat (bootstrapFile, &buf) == -1 || buf.st_mtime >= before) return 0;
+
+	memset (&header, 0, sizeof (header));
+	memcpy (header.magic, ELEKTRA_BOOTSTRAP_CACHE_MAGIC, sizeof (header.magic));
+	elektraBootstrapCacheStat (&header, &buf);
+	header.identitySize = sizeof (ELEKTRA_BOOTSTRAP_CACHE_IDENTITY);
+	header.fileSize = strlen (bootstrapFile) + 1;
+	header.nrKeys = ksGetSize (keys);
+
+	char * dir = elektraStrDup (cacheFile);
+	char * slash = strrchr (dir, '/');
+	if (slash && slash != dir)
+	{
+		*slash = '\0';
+		mkdir (dir, 0700); // may already exist
+	}
+	elektraFree (dir);
+	if (!elektraCacheAllowed () || !elektraCacheParentTrusted (cacheFile)) return 0;
+
+	char * tmpFile = elektraFormat ("%s.XXXXXX", cacheFile);
+	int fd = mkstemp (tmpFile);
+	if (fd == -1)
+	{
+		elektraFree (tmpFile);
+		return 0;
+	}
+	FILE * fp = fdopen (fd, "wb");
+	if (!fp)
+	{
+		close (fd);
+		unlink (tmpFile);
+		elektraFree (tmpFile);
+		return 0;
+	}
+
+	int ok = elektraBootstrapCachePut (fp, &header, sizeof (header)) &&
+		 elektraBootstrapCachePut (fp, ELEKTRA_BOOTSTRAP_CACHE_IDENTITY, header.identitySize) &&
+		 elektraBootstrapCachePut (fp, bootstrapFile, header.fileSize);
+
+	for (size_t i = 0; ok && i < keys->size; ++i)
+	{
+		Key * key = keys->array[i];
+		const Key * meta;
+		size_t nrMeta = 0;
+
+		keyRewindMeta (key);
+		while (keyNextMeta (key))
+			++nrMeta;
+
+		ok = elektraBootstrapCachePutKey (fp, keyName (key), key->data.v, key->dataSize, nrMeta);
+
+		keyRewindMeta (key);
+		while (ok && (meta = keyNextMeta (key)) != 0)
+		{
+			ok = elektraBootstrapCachePutKey (fp, keyName (meta), keyString (meta), keyGetValueSize (meta), 0);
+		}
+	}
+
+	if (fclose (fp) != 0) ok = 0;
+	if (!ok || rename (tmpFile, cacheFile) == -1)
+	{
+		unlink (tmpFile);
+		ok = 0;
+	}
+	elektraFree (tmpFile);
+	return ok;
+#else
+	(void)cacheFile;
+	(void)bootstrapFile;
+	(void)keys;
+	(void)before;
+	return 0;
+#endif
+}
@@ -161,6 +161,38 @@ int elektraMemCaseCmp (const char * s1, const char * s2, size_t size)
 	return 0;
 }
 
+/** How many handles record statistics, allocations are only counted if not 0 */
+static int elektraAllocationCounting;
+
+/** The allocations of the current thread while counting */
+static __thread size_t elektraAllocationCount;
+
+/**
+ * @internal
+ *
+ * @brief Start or stop counting allocations for statistics.
+ *
+ * Calls nest, allocations are counted as long as there are
+ * more calls with @p enable 1 than with 0.
+ *
+ * @param enable 1 to start, 0 to stop counting
+ */
+void elektraCountAllocations (int enable)
+{
+	__sync_add_and_fetch (&elektraAllocationCounting, enable ? 1 : -1);
+}
+
+/**
+ * @internal
+ *
+ * @return how often elektraMalloc(), elektraCalloc() and elektraRealloc()
+ *         were called by the current thread while counting
+ */
+size_t elektraAllocations (void)
+{
+	return elektraAllocationCount;
+}
+
 /**Reallocate Storage in a save way.
  *
  *@code
@@ -184,6 +216,7 @@ if (elektraRealloc ((void **) & buffer, new_length) < 0) {
  */
 int elektraRealloc (void ** buffer, size_t size)
 {
+	if (elektraAllocationCounting) ++elektraAllocationCount;
 	void * ptr;
 	void * svr = *buffer;
 	ptr = realloc (*buffer, size);
@@ -221,6 +254,7 @@ if ((buffer = elektraMalloc (length)) == 0) {
  */
 void * elektraMalloc (size_t size)
 {
+	if (elektraAllocationCounting) ++elektraAllocationCount;
 	return malloc (size);
 }
 
@@ -233,6 +267,7 @@ void * elektraMalloc (size_t size)
  */
 void * elektraCalloc (size_t size)
 {
+	if (elektraAllocationCounting) ++elektraAllocationCount;
 	return calloc (1, size);
 }
 
@@ -146,6 +146,10 @@ void elektraRemoveMetaData (Key * key, const char * searchfor)
  * @brief Bootstrap, first phase with fallback
  * @internal
  *
+ * If the bootstrap file did not change since the last bootstrap
+ * of the user, the keys are read from the cache instead, see
+ * elektraBootstrapCacheRead(). The fallback is never cached.
+ *
  * @param handle already allocated, but without defaultBackend
  * @param [out] keys for bootstrapping
  * @param errorKey key to add errors too
@@ -157,8 +161,21 @@ void elektraRemoveMetaData (Key * key, const char * searchfor)
  */
 int elektraOpenBootstrap (KDB * handle, KeySet * keys, Key * errorKey)
 {
+	char * cacheFile = elektraBootstrapCacheFile ();
+	if (cacheFile && elektraBootstrapCacheRead (cacheFile, keys) == 1)
+	{
+		// bootstrap file unchanged, no need to open the default backend
+		elektraFree (cacheFile);
+		handle->split = elektraSplitNew ();
+		return 1;
+	}
+
 	handle->defaultBackend = elektraBackendOpenDefault (handle->modules, KDB_DB_INIT, errorKey);
-	if (!handle->defaultBackend) return -1;
+	if (!handle->defaultBackend)
+	{
+		elektraFree (cacheFile);
+		return -1;
+	}
 
 	handle->split = elektraSplitNew ();
 	elektraSplitAppend (handle->split, handle->defaultBackend, keyNew (KDB_SYSTEM_ELEKTRA, KEY_END), 2);
@@ -167,8 +184,15 @@ int elektraOpenBootstrap (KDB * handle, KeySet * keys, Key * errorKey)
 	keySetString (errorKey, "kdbOpen(): get");
 
 	int funret = 1;
+	time_t before = time (0);
 	int ret = kdbGet (handle, keys, errorKey);
 	int fallbackret = 0;
+	if (ret == 1 && cacheFile)
+	{
+		// kdbGet() sets the value to the file name of KDB_DB_INIT
+		elektraBootstrapCacheWrite (cacheFile, keyString (errorKey), keys, before);
+	}
+	elektraFree (cacheFile);
 	if (ret == 0 || ret == -1)
 	{
 		// could not get KDB_DB_INIT, try KDB_DB_FILE
@@ -295,6 +319,21 @@ KDB * kdbOpen (Key * errorKey)
 		break;
 	}
 
+	Key * threads = ksLookupByName (keys, KDB_SYSTEM_ELEKTRA "/kdb/get/threads", 0);
+	if (threads)
+	{
+		handle->getThreads = strtoul (keyString (threads), 0, 10);
+	}
+
+	Key * lazy = ksLookupByName (keys, KDB_SYSTEM_ELEKTRA "/kdb/open/lazy", 0);
+	if (lazy)
+	{
+		handle->openLazy = !strcmp (keyString (lazy), "1");
+	}
+
+	Key * stats = ksLookupByName (keys, KDB_SYSTEM_ELEKTRA "/kdb/stats", 0);
+	int statsEnabled = stats && !strcmp (keyString (stats), "1");
+
 	keySetString (errorKey, "kdbOpen(): mountGlobals");
 
 	if (elektraMountGlobals (handle, ksDup (keys), handle->modules, errorKey) == -1)
@@ -358,6 +397,8 @@ KDB * kdbOpen (Key * errorKey)
 		ELEKTRA_ADD_WARNING (92, errorKey, "Mounting modules did not work");
 	}
 
+	if (statsEnabled) elektraStatsEnable (handle, 1);
+
 	keySetName (errorKey, keyName (initialParent));
 	keySetString (errorKey, keyString (initialParent));
 	keyDel (initialParent);
@@ -398,6 +439,7 @@ int kdbClose (KDB * handle, Key * errorKey)
 
 	Key * initialParent = keyDup (errorKey);
 	int errnosave = errno;
+	elektraStatsEnable (handle, 0);
 	elektraSplitDel (handle->split);
 
 	elektraTrieClose (handle->trie, errorKey);
@@ -441,11 +483,18 @@ int kdbClose (KDB * handle, Key * errorKey)
  *
  * @brief Check if an update is needed at all
  *
+ * If a global plugin is mounted to `pregetnotify`, it is asked first
+ * if the resolved file of a backend changed since it was checked the
+ * last time. A backend untouched since then is skipped without calling
+ * its resolver. Otherwise the resolved file name is passed to the global
+ * plugin at `postgetnotify` after the resolver ran, so that it can watch
+ * the file.
+ *
  * @retval -1 an error occurred
  * @retval 0 no update needed
  * @retval number of plugins which need update
  */
-static int elektraGetCheckUpdateNeeded (Split * split, Key * parentKey)
+static int elektraGetCheckUpdateNeeded (KDB * handle, Split * split, Key * parentKey)
 {
 	int updateNeededOccurred = 0;
 	for (size_t i = 0; i < split->size; i++)
@@ -459,12 +508,24 @@ static int elektraGetCheckUpdateNeeded (Split * split, Key * parentKey)
 			ksRewind (split->keysets[i]);
 			keySetName (parentKey, keyName (split->parents[i]));
 			keySetString (parentKey, "");
-			ret = backend->getplugins[RESOLVER_PLUGIN]->kdbGet (backend->getplugins[RESOLVER_PLUGIN], split->keysets[i],
-									    parentKey);
+			if (handle->globalPlugins[PREGETNOTIFY] &&
+			    ELEKTRA_GLOBAL_CALL (handle, PREGETNOTIFY, kdbGet, split->keysets[i], parentKey) == 0)
+			{
+				// untouched since the resolver ran the last time, the
+				// notification plugin gave us the resolved filename
+				keySetString (split->parents[i], keyString (parentKey));
+				elektraBackendUpdateSize (backend, split->parents[i], 0);
+				continue;
+			}
+			ret = ELEKTRA_BACKEND_GET (backend, RESOLVER_PLUGIN, split->keysets[i], parentKey);
 			// store resolved filename
 			keySetString (split->parents[i], keyString (parentKey));
 			// no keys in that backend
 			elektraBackendUpdateSize (backend, split->parents[i], 0);
+			if (handle->globalPlugins[POSTGETNOTIFY] && ret != -1)
+			{
+				ELEKTRA_GLOBAL_CALL (handle, POSTGETNOTIFY, kdbSet, split->keysets[i], parentKey);
+			}
 		}
 		switch (ret)
 		{
@@ -514,7 +575,7 @@ static int elektraGetDoUpdate (Split * split, Key * parentKey)
 			int ret = 0;
 			if (backend->getplugins[p])
 			{
-				ret = backend->getplugins[p]->kdbGet (backend->getplugins[p], split->keysets[i], parentKey);
+				ret = ELEKTRA_BACKEND_GET (backend, p, split->keysets[i], parentKey);
 			}
 
 			if (ret == -1)
@@ -566,7 +627,7 @@ static int elektraGetDoUpdateWithGlobalHooks (KDB * handle, Split * split, KeySe
 				pgs_done = 1;
 				keySetName (parentKey, keyName (initialParent));
 				ksRewind (ks);
-				handle->globalPlugins[POSTGETSTORAGE]->kdbGet (handle->globalPlugins[POSTGETSTORAGE], ks, parentKey);
+				ELEKTRA_GLOBAL_CALL (handle, POSTGETSTORAGE, kdbGet, ks, parentKey);
 				keySetName (parentKey, keyName (split->parents[i]));
 			}
 			else if (!pgc_done && (p == (NR_OF_PLUGINS - 1)) && handle->globalPlugins[POSTGETCLEANUP])
@@ -574,7 +635,7 @@ static int elektraGetDoUpdateWithGlobalHooks (KDB * handle, Split * split, KeySe
 				pgc_done = 1;
 				keySetName (parentKey, keyName (initialParent));
 				ksRewind (ks);
-				handle->globalPlugins[POSTGETCLEANUP]->kdbGet (handle->globalPlugins[POSTGETCLEANUP], ks, parentKey);
+				ELEKTRA_GLOBAL_CALL (handle, POSTGETCLEANUP, kdbGet, ks, parentKey);
 				keySetName (parentKey, keyName (split->parents[i]));
 			}
 
@@ -582,7 +643,7 @@ static int elektraGetDoUpdateWithGlobalHooks (KDB * handle, Split * split, KeySe
 			{
 				if (p <= STORAGE_PLUGIN)
 				{
-					ret = backend->getplugins[p]->kdbGet (backend->getplugins[p], split->keysets[i], parentKey);
+					ret = ELEKTRA_BACKEND_GET (backend, p, split->keysets[i], parentKey);
 				}
 				else
 				{
@@ -591,7 +652,7 @@ static int elektraGetDoUpdateWithGlobalHooks (KDB * handle, Split * split, KeySe
 					keyAddName (cutKey, strchr (keyName (parentKey), '/'));
 					KeySet * cutKS = ksCut (ks, cutKey);
 					ksRewind (cutKS);
-					ret = backend->getplugins[p]->kdbGet (backend->getplugins[p], cutKS, parentKey);
+					ret = ELEKTRA_BACKEND_GET (backend, p, cutKS, parentKey);
 					ksAppend (ks, cutKS);
 					ksDel (cutKS);
 					keyDel (cutKey);
@@ -609,79 +670,91 @@ static int elektraGetDoUpdateWithGlobalHooks (KDB * handle, Split * split, KeySe
 	return 0;
 }
 /**
- * @brief Retrieve keys in an atomic and universal way.
- *
- * @pre The @p handle must be passed as returned from kdbOpen().
- *
- * @pre The @p returned KeySet must be a valid KeySet, e.g. constructed
- *     with ksNew().
- *
- * @pre The @p parentKey Key must be a valid Key, e.g. constructed with
- *     keyNew().
- *
- * If you pass NULL on any parameter kdbGet() will fail immediately without doing anything.
- *
- * The @p returned KeySet may already contain some keys, e.g. from previous
- * kdbGet() calls. The new retrieved keys will be appended using
- * ksAppendKey().
- *
- * If not done earlier kdbGet() will fully retrieve all keys under the @p parentKey
- * folder recursively (See Optimization below when it will not be done).
- *
- * @note kdbGet() might retrieve more keys then requested (that are not
- *     below parentKey). These keys must be passed to calls of kdbSet(),
- *     otherwise they will be lost. This stems from the fact that the
- *     user has the only copy of the whole configuration and backends
- *     only write configuration that was passed to them.
- *     For example, if you kdbGet() "system/mountpoint/interest"
- *     you will not only get all keys below system/mountpoint/interest,
- *     but also all keys below system/mountpoint (if system/mountpoint
- *     is a mountpoint as the name suggests, but
- *     system/mountpoint/interest is not a mountpoint).
- *     Make sure to not touch or remove keys outside the keys of interest,
- *     because others may need them!
- *
- * @par Example:
- * This example demonstrates the typical usecase within an application
- * (without error handling).
- *
- * @include kdbget.c
- *
- * When a backend fails kdbGet() will return -1 with all
- * error and warning information in the @p parentKey.
- * The parameter @p returned will not be changed.
- *
- * @par Optimization:
- * In the first run of kdbGet all requested (or more) keys are retrieved. On subsequent
- * calls only the keys are retrieved where something was changed
- * inside the key database. The other keys stay in the
- * KeySet returned as passed.
+ * @internal
+ * @brief Prepare @p parentKey for the cache plugins.
  *
- * It is your responsibility to save the original keyset if you
- * need it afterwards.
+ * The name and value (the resolved file name) are taken from the
+ * parent of the backend, the metadata cache/backend is set to
+ * elektraBackendSignature() of the backend.
+ */
+static void elektraGetCacheParent (Split * split, size_t i, Key * parentKey)
+{
+	keySetName (parentKey, keyName (split->parents[i]));
+	keySetString (parentKey, keyString (split->parents[i]));
+	char * signature = elektraBackendSignature (split->handles[i]);
+	keySetMeta (parentKey, "cache/backend", signature);
+	elektraFree (signature);
+}
+
+/**
+ * @internal
+ * @brief Read the keysets of backends needing an update from the cache.
  *
- * If you want to be sure to get a fresh keyset again, you need to open a
- * second handle to the key database using kdbOpen().
+ * The global plugin at PREGETCACHE gets every backend needing an
+ * update with its resolved file name as value of @p parentKey and
+ * the signature of its plugins in the metadata cache/backend.
+ * If it returns 1, it added the keys stored for this file. Then the
+ * backend is marked with SPLIT_FLAG_CACHED instead of SPLIT_FLAG_SYNC,
+ * so that its remaining plugins are not called.
  *
- * @param handle contains internal information of @link kdbOpen() opened @endlink key database
- * @param parentKey is used to add warnings and set an error
- *         information. Additionally, its name is a hint which keys
- *         should be retrieved (it is possible that more are retrieved, see Note above).
- *           - cascading keys (starting with /) will retrieve the same path in all namespaces
- *           - / will retrieve all keys
- * @param ks the (pre-initialized) KeySet returned with all keys found
- * 	will not be changed on error or if no update is required
- * @see ksLookup(), ksLookupByName() for powerful
- * 	lookups after the KeySet was retrieved
- * @see kdbOpen() which needs to be called before
- * @see kdbSet() to save the configuration afterwards and kdbClose() to
- * 	finish affairs with the key database.
- * @retval 1 if the keys were retrieved successfully
- * @retval 0 if there was no update - no changes are made to the keyset then
- * @retval -1 on failure - no changes are made to the keyset then
- * @ingroup kdb
+ * Errors of the cache are no errors of kdbGet(), the backend
+ * is updated as usual then.
  */
-int kdbGet (KDB * handle, KeySet * ks, Key * parentKey)
+static void elektraGetCacheLoad (KDB * handle, Split * split, Key * parentKey)
+{
+	if (!handle->globalPlugins[PREGETCACHE]) return;
+
+	const int bypassedSplits = 1;
+	for (size_t i = 0; i < split->size - bypassedSplits; i++)
+	{
+		if (!test_bit (split->syncbits[i], SPLIT_FLAG_SYNC)) continue;
+
+		elektraGetCacheParent (split, i, parentKey);
+		if (ELEKTRA_GLOBAL_CALL (handle, PREGETCACHE, kdbGet, split->keysets[i], parentKey) == 1)
+		{
+			clear_bit (split->syncbits[i], SPLIT_FLAG_SYNC);
+			set_bit (split->syncbits[i], SPLIT_FLAG_CACHED);
+		}
+	}
+	keySetMeta (parentKey, "cache/backend", 0);
+}
+
+/**
+ * @internal
+ * @brief Write the keysets read by backends to the cache.
+ *
+ * Passes every keyset updated by a backend to the global plugin
+ * at POSTGETCACHE, again with the resolved file name as value of
+ * @p parentKey and the signature of the backend as metadata.
+ * Keysets read from the cache are marked with SPLIT_FLAG_SYNC
+ * again, so that the rest of kdbGet() treats
+ * them like every other updated keyset.
+ */
+static void elektraGetCacheStore (KDB * handle, Split * split, Key * parentKey)
+{
+	const int bypassedSplits = 1;
+	for (size_t i = 0; i < split->size - bypassedSplits; i++)
+	{
+		if (test_bit (split->syncbits[i], SPLIT_FLAG_CACHED))
+		{
+			clear_bit (split->syncbits[i], SPLIT_FLAG_CACHED);
+			set_bit (split->syncbits[i], SPLIT_FLAG_SYNC);
+			continue;
+		}
+		if (!handle->globalPlugins[POSTGETCACHE] || !test_bit (split->syncbits[i], SPLIT_FLAG_SYNC)) continue;
+
+		elektraGetCacheParent (split, i, parentKey);
+		ksRewind (split->keysets[i]);
+		ELEKTRA_GLOBAL_CALL (handle, POSTGETCACHE, kdbSet, split->keysets[i], parentKey);
+	}
+	keySetMeta (parentKey, "cache/backend", 0);
+}
+
+/**
+ * @internal
+ * @brief kdbGet() without the statistics of the whole call
+ */
+static int elektraGet (KDB * handle, KeySet * ks, Key * parentKey)
 {
 	elektraNamespace ns = keyGetNamespace (parentKey);
 	if (ns == KEY_NS_NONE)
@@ -716,16 +789,17 @@ int kdbGet (KDB * handle, KeySet * ks, Key * parentKey)
 	}
 	if (handle->globalPlugins[PREGETSTORAGE])
 	{
-		handle->globalPlugins[PREGETSTORAGE]->kdbGet (handle->globalPlugins[PREGETSTORAGE], ks, parentKey);
+		ELEKTRA_GLOBAL_CALL (handle, PREGETSTORAGE, kdbGet, ks, parentKey);
 	}
 	if (elektraSplitBuildup (split, handle, parentKey) == -1)
 	{
 		ELEKTRA_SET_ERROR (38, parentKey, "error in elektraSplitBuildup");
 		goto error;
 	}
+	elektraSplitMaterialise (split, parentKey);
 
 	// Check if a update is needed at all
-	switch (elektraGetCheckUpdateNeeded (split, parentKey))
+	switch (elektraGetCheckUpdateNeeded (handle, split, parentKey))
 	{
 	case 0: // We don't need an update so let's do nothing
 		keySetName (parentKey, keyName (initialParent));
@@ -746,9 +820,21 @@ int kdbGet (KDB * handle, KeySet * ks, Key * parentKey)
 		goto error;
 	}
 
+	elektraGetCacheLoad (handle, split, parentKey);
+
+	// backends called one after the other can share an arena
+	if (handle->getThreads <= 1) elektraSplitShareArena (split);
+
 	if (handle->globalPlugins[POSTGETSTORAGE] || handle->globalPlugins[POSTGETCLEANUP])
 	{
-		if (elektraGetDoUpdateWithGlobalHooks (NULL, split, NULL, parentKey, initialParent, FIRST) == -1)
+		if (handle->getThreads > 1)
+		{
+			if (elektraGetDoUpdateParallel (split, parentKey, 1, STORAGE_PLUGIN + 1, handle->getThreads) == -1)
+			{
+				goto error;
+			}
+		}
+		else if (elektraGetDoUpdateWithGlobalHooks (NULL, split, NULL, parentKey, initialParent, FIRST) == -1)
 		{
 			goto error;
 		}
@@ -760,6 +846,8 @@ int kdbGet (KDB * handle, KeySet * ks, Key * parentKey)
 			ELEKTRA_ADD_WARNING (108, parentKey, keyName (ksCurrent (ks)));
 			// continue, because sizes are already updated
 		}
+		elektraGetCacheStore (handle, split, parentKey);
+		keySetName (parentKey, keyName (initialParent));
 		ksClear (ks);
 		elektraSplitMerge (split, ks);
 
@@ -773,7 +861,14 @@ int kdbGet (KDB * handle, KeySet * ks, Key * parentKey)
 
 		/* Now do the real updating,
 		   but not for bypassed keys in split->size-1 */
-		if (elektraGetDoUpdate (split, parentKey) == -1)
+		if (handle->getThreads > 1)
+		{
+			if (elektraGetDoUpdateParallel (split, parentKey, 1, NR_OF_PLUGINS, handle->getThreads) == -1)
+			{
+				goto error;
+			}
+		}
+		else if (elektraGetDoUpdate (split, parentKey) == -1)
 		{
 			goto error;
 		}
@@ -783,6 +878,7 @@ int kdbGet (KDB * handle, KeySet * ks, Key * parentKey)
 			ELEKTRA_ADD_WARNING (108, parentKey, keyName (ksCurrent (ks)));
 			// continue, because sizes are already updated
 		}
+		elektraGetCacheStore (handle, split, parentKey);
 		/* We are finished, now just merge everything to returned */
 		ksClear (ks);
 
@@ -803,7 +899,7 @@ error:
 	keySetName (parentKey, keyName (initialParent));
 	if (handle && handle->globalPlugins[POSTGETSTORAGE])
 	{
-		handle->globalPlugins[POSTGETSTORAGE]->kdbGet (handle->globalPlugins[POSTGETSTORAGE], ks, parentKey);
+		ELEKTRA_GLOBAL_CALL (handle, POSTGETSTORAGE, kdbGet, ks, parentKey);
 	}
 
 	keySetName (parentKey, keyName (initialParent));
@@ -814,6 +910,90 @@ error:
 	return -1;
 }
 
+/**
+ * @brief Retrieve keys in an atomic and universal way.
+ *
+ * @pre The @p handle must be passed as returned from kdbOpen().
+ *
+ * @pre The @p returned KeySet must be a valid KeySet, e.g. constructed
+ *     with ksNew().
+ *
+ * @pre The @p parentKey Key must be a valid Key, e.g. constructed with
+ *     keyNew().
+ *
+ * If you pass NULL on any parameter kdbGet() will fail immediately without doing anything.
+ *
+ * The @p returned KeySet may already contain some keys, e.g. from previous
+ * kdbGet() calls. The new retrieved keys will be appended using
+ * ksAppendKey().
+ *
+ * If not done earlier kdbGet() will fully retrieve all keys under the @p parentKey
+ * folder recursively (See Optimization below when it will not be done).
+ *
+ * @note kdbGet() might retrieve more keys then requested (that are not
+ *     below parentKey). These keys must be passed to calls of kdbSet(),
+ *     otherwise they will be lost. This stems from the fact that the
+ *     user has the only copy of the whole configuration and backends
+ *     only write configuration that was passed to them.
+ *     For example, if you kdbGet() "system/mountpoint/interest"
+ *     you will not only get all keys below system/mountpoint/interest,
+ *     but also all keys below system/mountpoint (if system/mountpoint
+ *     is a mountpoint as the name suggests, but
+ *     system/mountpoint/interest is not a mountpoint).
+ *     Make sure to not touch or remove keys outside the keys of interest,
+ *     because others may need them!
+ *
+ * @par Example:
+ * This example demonstrates the typical usecase within an application
+ * (without error handling).
+ *
+ * @include kdbget.c
+ *
+ * When a backend fails kdbGet() will return -1 with all
+ * error and warning information in the @p parentKey.
+ * The parameter @p returned will not be changed.
+ *
+ * @par Optimization:
+ * In the first run of kdbGet all requested (or more) keys are retrieved. On subsequent
+ * calls only the keys are retrieved where something was changed
+ * inside the key database. The other keys stay in the
+ * KeySet returned as passed.
+ *
+ * It is your responsibility to save the original keyset if you
+ * need it afterwards.
+ *
+ * If you want to be sure to get a fresh keyset again, you need to open a
+ * second handle to the key database using kdbOpen().
+ *
+ * @param handle contains internal information of @link kdbOpen() opened @endlink key database
+ * @param parentKey is used to add warnings and set an error
+ *         information. Additionally, its name is a hint which keys
+ *         should be retrieved (it is possible that more are retrieved, see Note above).
+ *           - cascading keys (starting with /) will retrieve the same path in all namespaces
+ *           - / will retrieve all keys
+ * @param ks the (pre-initialized) KeySet returned with all keys found
+ * 	will not be changed on error or if no update is required
+ * @see ksLookup(), ksLookupByName() for powerful
+ * 	lookups after the KeySet was retrieved
+ * @see kdbOpen() which needs to be called before
+ * @see kdbSet() to save the configuration afterwards and kdbClose() to
+ * 	finish affairs with the key database.
+ * @retval 1 if the keys were retrieved successfully
+ * @retval 0 if there was no update - no changes are made to the keyset then
+ * @retval -1 on failure - no changes are made to the keyset then
+ * @ingroup kdb
+ */
+int kdbGet (KDB * handle, KeySet * ks, Key * parentKey)
+{
+	if (!handle || !handle->stats) return elektraGet (handle, ks, parentKey);
+
+	size_t allocations = elektraAllocations ();
+	kdb_unsigned_long_long_t start = elektraStatsNow ();
+	int ret = elektraGet (handle, ks, parentKey);
+	elektraStatsAdd (&handle->stats->get, start, allocations, ks);
+	return ret;
+}
+
 /**
  * @internal
  * @brief Does all set steps but not commit
@@ -825,7 +1005,7 @@ error:
  * @retval -1 on error
  * @retval 0 on success
  */
-static int elektraSetPrepare (Split * split, Key * parentKey, Key ** errorKey, Plugin ** hooks)
+static int elektraSetPrepare (KDB * handle, Split * split, Key * parentKey, Key ** errorKey)
 {
 	int any_error = 0;
 	for (size_t i = 0; i < split->size; i++)
@@ -847,7 +1027,7 @@ static int elektraSetPrepare (Split * split, Key * parentKey, Key ** errorKey, P
 					keySetString (parentKey, "");
 				}
 				keySetName (parentKey, keyName (split->parents[i]));
-				ret = backend->setplugins[p]->kdbSet (backend->setplugins[p], split->keysets[i], parentKey);
+				ret = ELEKTRA_BACKEND_SET (backend, p, split->keysets[i], parentKey);
 
 #if VERBOSE && DEBUG
 				printf ("Prepare %s with keys %zd in plugin: %zu, split: %zu, ret: %d\n", keyName (parentKey),
@@ -870,19 +1050,19 @@ static int elektraSetPrepare (Split * split, Key * parentKey, Key ** errorKey, P
 
 			if (p == 0)
 			{
-				if (hooks[PRESETSTORAGE])
+				if (handle->globalPlugins[PRESETSTORAGE])
 				{
 					// the only place global presetstorage hooks can be executed
 					ksRewind (split->keysets[i]);
-					hooks[PRESETSTORAGE]->kdbSet (hooks[PRESETSTORAGE], split->keysets[i], parentKey);
+					ELEKTRA_GLOBAL_CALL (handle, PRESETSTORAGE, kdbSet, split->keysets[i], parentKey);
 				}
 			}
 			else if (p == (STORAGE_PLUGIN - 1))
 			{
-				if (hooks[PRESETCLEANUP])
+				if (handle->globalPlugins[PRESETCLEANUP])
 				{
 					ksRewind (split->keysets[i]);
-					hooks[PRESETCLEANUP]->kdbSet (hooks[PRESETCLEANUP], split->keysets[i], parentKey);
+					ELEKTRA_GLOBAL_CALL (handle, PRESETCLEANUP, kdbSet, split->keysets[i], parentKey);
 				}
 			}
 
@@ -933,7 +1113,7 @@ static void elektraSetCommit (Split * split, Key * parentKey)
 					keyString (parentKey));
 #endif
 				ksRewind (split->keysets[i]);
-				ret = backend->setplugins[p]->kdbSet (backend->setplugins[p], split->keysets[i], parentKey);
+				ret = ELEKTRA_BACKEND_SET (backend, p, split->keysets[i], parentKey);
 				if (p == COMMIT_PLUGIN)
 				{
 					// name of non-temp file
@@ -969,7 +1149,7 @@ static void elektraSetRollback (Split * split, Key * parentKey)
 			if (backend->errorplugins[p])
 			{
 				keySetName (parentKey, keyName (split->parents[i]));
-				ret = backend->errorplugins[p]->kdbError (backend->errorplugins[p], split->keysets[i], parentKey);
+				ret = ELEKTRA_BACKEND_ERROR (backend, p, split->keysets[i], parentKey);
 			}
 
 			if (ret == -1)
@@ -981,77 +1161,11 @@ static void elektraSetRollback (Split * split, Key * parentKey)
 }
 
 
-/** @brief Set keys in an atomic and universal way.
- *
- * @pre kdbGet() must be called before kdbSet():
- *    - initially (after kdbOpen())
- *    - after conflict errors in kdbSet().
- *
- * @pre The @p returned KeySet must be a valid KeySet, e.g. constructed
- *     with ksNew().
- *
- * @pre The @p parentKey Key must be a valid Key, e.g. constructed with
- *     keyNew().
- *
- * If you pass NULL on any parameter kdbSet() will fail immediately without doing anything.
- *
- * With @p parentKey you can give an hint which part of the given keyset
- * is of interest for you. Then you promise to only modify or
- * remove keys below this key. All others would be passed back
- * as they were retrieved by kdbGet().
- *
- * @par Errors
- * If some error occurs:
- * - kdbSet() will leave the KeySet's * internal cursor on the key that generated the error.
- * - Error information will be written into the meta data of
- *   the parent key.
- * - None of the keys are actually committed in this situation, i.e. no
- *   configuration file will be modified.
- *
- * In case of errors you should present the error message to the user and let the user decide what
- * to do. Possible solutions are:
- * - remove the problematic key and use kdbSet() again (for validation or type errors)
- * - change the value of the problematic key and use kdbSet() again (for validation errors)
- * - do a kdbGet() (for conflicts, i.e. error 30) and then
- *   - set the same keyset again (in favour of what was set by this user)
- *   - drop the old keyset (in favour of what was set from another application)
- *   - merge the original, your own and the other keyset
- * - export the configuration into a file (for unresolvable errors)
- * - repeat the same kdbSet might be of limited use if the user does
- *   not explicitly request it, because temporary
- *   errors are rare and its unlikely that they fix themselves
- *   (e.g. disc full, permission problems)
- *
- * @par Optimization
- * Each key is checked with keyNeedSync() before being actually committed.
- * If no key of a backend needs to be synced
- * any affairs to backends are omitted and 0 is returned.
- *
- * @snippet kdbset.c set
- *
- * showElektraErrorDialog() and doElektraMerge() need to be implemented
- * by the user of Elektra. For doElektraMerge a 3-way merge algorithm exists in
- * libelektra-tools.
- *
- * @param handle contains internal information of @link kdbOpen() opened @endlink key database
- * @param ks a KeySet which should contain changed keys, otherwise nothing is done
- * @param parentKey is used to add warnings and set an error
- *         information. Additionally, its name is an hint which keys
- *         should be committed (it is possible that more are changed).
- *           - cascading keys (starting with /) will set the path in all namespaces
- *           - / will commit all keys
- *           - meta-names will be rejected (error 104)
- *           - empty/invalid (error 105)
- * @retval 1 on success
- * @retval 0 if nothing had to be done, no changes in KDB
- * @retval -1 on failure, no changes in KDB
- * @see keyNeedSync()
- * @see ksCurrent() contains the error key
- * @see kdbOpen() and kdbGet() that must be called first
- * @see kdbClose() that must be called afterwards
- * @ingroup kdb
+/**
+ * @internal
+ * @brief kdbSet() without the statistics of the whole call
  */
-int kdbSet (KDB * handle, KeySet * ks, Key * parentKey)
+static int elektraSet (KDB * handle, KeySet * ks, Key * parentKey)
 {
 	elektraNamespace ns = keyGetNamespace (parentKey);
 	if (ns == KEY_NS_NONE)
@@ -1091,6 +1205,7 @@ int kdbSet (KDB * handle, KeySet * ks, Key * parentKey)
 		ELEKTRA_SET_ERROR (38, parentKey, "error in elektraSplitBuildup");
 		goto error;
 	}
+	elektraSplitMaterialise (split, parentKey);
 
 	// 1.) Search for syncbits
 	int syncstate = elektraSplitDivide (split, handle, ks);
@@ -1125,7 +1240,7 @@ int kdbSet (KDB * handle, KeySet * ks, Key * parentKey)
 
 	elektraSplitPrepare (split);
 
-	if (elektraSetPrepare (split, parentKey, &errorKey, handle->globalPlugins) == -1)
+	if (elektraSetPrepare (handle, split, parentKey, &errorKey) == -1)
 	{
 		goto error;
 	}
@@ -1133,7 +1248,7 @@ int kdbSet (KDB * handle, KeySet * ks, Key * parentKey)
 	keySetName (parentKey, keyName (initialParent));
 	if (handle->globalPlugins[PRECOMMIT])
 	{
-		handle->globalPlugins[PRECOMMIT]->kdbSet (handle->globalPlugins[PRECOMMIT], ks, parentKey);
+		ELEKTRA_GLOBAL_CALL (handle, PRECOMMIT, kdbSet, ks, parentKey);
 	}
 
 	elektraSetCommit (split, parentKey);
@@ -1143,7 +1258,7 @@ int kdbSet (KDB * handle, KeySet * ks, Key * parentKey)
 	keySetName (parentKey, keyName (initialParent));
 	if (handle->globalPlugins[POSTCOMMIT])
 	{
-		handle->globalPlugins[POSTCOMMIT]->kdbSet (handle->globalPlugins[POSTCOMMIT], ks, parentKey);
+		ELEKTRA_GLOBAL_CALL (handle, POSTCOMMIT, kdbSet, ks, parentKey);
 	}
 
 	for (size_t i = 0; i < ks->size; ++i)
@@ -1163,7 +1278,7 @@ error:
 	keySetName (parentKey, keyName (initialParent));
 	if (handle->globalPlugins[PREROLLBACK])
 	{
-		handle->globalPlugins[PREROLLBACK]->kdbError (handle->globalPlugins[PREROLLBACK], ks, parentKey);
+		ELEKTRA_GLOBAL_CALL (handle, PREROLLBACK, kdbError, ks, parentKey);
 	}
 
 	elektraSetRollback (split, parentKey);
@@ -1180,7 +1295,7 @@ error:
 	keySetName (parentKey, keyName (initialParent));
 	if (handle->globalPlugins[POSTROLLBACK])
 	{
-		handle->globalPlugins[POSTROLLBACK]->kdbError (handle->globalPlugins[POSTROLLBACK], ks, parentKey);
+		ELEKTRA_GLOBAL_CALL (handle, POSTROLLBACK, kdbError, ks, parentKey);
 	}
 
 	keySetName (parentKey, keyName (initialParent));
@@ -1190,6 +1305,87 @@ error:
 	return -1;
 }
 
+/** @brief Set keys in an atomic and universal way.
+ *
+ * @pre kdbGet() must be called before kdbSet():
+ *    - initially (after kdbOpen())
+ *    - after conflict errors in kdbSet().
+ *
+ * @pre The @p returned KeySet must be a valid KeySet, e.g. constructed
+ *     with ksNew().
+ *
+ * @pre The @p parentKey Key must be a valid Key, e.g. constructed with
+ *     keyNew().
+ *
+ * If you pass NULL on any parameter kdbSet() will fail immediately without doing anything.
+ *
+ * With @p parentKey you can give an hint which part of the given keyset
+ * is of interest for you. Then you promise to only modify or
+ * remove keys below this key. All others would be passed back
+ * as they were retrieved by kdbGet().
+ *
+ * @par Errors
+ * If some error occurs:
+ * - kdbSet() will leave the KeySet's * internal cursor on the key that generated the error.
+ * - Error information will be written into the meta data of
+ *   the parent key.
+ * - None of the keys are actually committed in this situation, i.e. no
+ *   configuration file will be modified.
+ *
+ * In case of errors you should present the error message to the user and let the user decide what
+ * to do. Possible solutions are:
+ * - remove the problematic key and use kdbSet() again (for validation or type errors)
+ * - change the value of the problematic key and use kdbSet() again (for validation errors)
+ * - do a kdbGet() (for conflicts, i.e. error 30) and then
+ *   - set the same keyset again (in favour of what was set by this user)
+ *   - drop the old keyset (in favour of what was set from another application)
+ *   - merge the original, your own and the other keyset
+ * - export the configuration into a file (for unresolvable errors)
+ * - repeat the same kdbSet might be of limited use if the user does
+ *   not explicitly request it, because temporary
+ *   errors are rare and its unlikely that they fix themselves
+ *   (e.g. disc full, permission problems)
+ *
+ * @par Optimization
+ * Each key is checked with keyNeedSync() before being actually committed.
+ * If no key of a backend needs to be synced
+ * any affairs to backends are omitted and 0 is returned.
+ *
+ * @snippet kdbset.c set
+ *
+ * showElektraErrorDialog() and doElektraMerge() need to be implemented
+ * by the user of Elektra. For doElektraMerge a 3-way merge algorithm exists in
+ * libelektra-tools.
+ *
+ * @param handle contains internal information of @link kdbOpen() opened @endlink key database
+ * @param ks a KeySet which should contain changed keys, otherwise nothing is done
+ * @param parentKey is used to add warnings and set an error
+ *         information. Additionally, its name is an hint which keys
+ *         should be committed (it is possible that more are changed).
+ *           - cascading keys (starting with /) will set the path in all namespaces
+ *           - / will commit all keys
+ *           - meta-names will be rejected (error 104)
+ *           - empty/invalid (error 105)
+ * @retval 1 on success
+ * @retval 0 if nothing had to be done, no changes in KDB
+ * @retval -1 on failure, no changes in KDB
+ * @see keyNeedSync()
+ * @see ksCurrent() contains the error key
+ * @see kdbOpen() and kdbGet() that must be called first
+ * @see kdbClose() that must be called afterwards
+ * @ingroup kdb
+ */
+int kdbSet (KDB * handle, KeySet * ks, Key * parentKey)
+{
+	if (!handle || !handle->stats) return elektraSet (handle, ks, parentKey);
+
+	size_t allocations = elektraAllocations ();
+	kdb_unsigned_long_long_t start = elektraStatsNow ();
+	int ret = elektraSet (handle, ks, parentKey);
+	elektraStatsAdd (&handle->stats->set, start, allocations, ks);
+	return ret;
+}
+
 /**
  * @}
  */
@@ -363,6 +363,7 @@ int keyCopy (Key * dest, const Key * source)
 	char * destKey = dest->key;
 	void * destData = dest->data.c;
 	KeySet * destMeta = dest->meta;
+	keyflag_t destFlags = dest->flags;
 
 	// duplicate dynamic properties
 	if (source->key)
@@ -404,10 +405,20 @@ int keyCopy (Key * dest, const Key * source)
 	dest->dataSize = source->dataSize;
 
 	// free old resources of destination
-	elektraFree (destKey);
-	elektraFree (destData);
+	if (destKey && test_bit (destFlags, KEY_FLAG_MMAP_KEY))
+		elektraKeyRegionDecRef (elektraKeyRegionOf (destKey));
+	else
+		elektraFree (destKey);
+	if (destData && test_bit (destFlags, KEY_FLAG_MMAP_DATA))
+		elektraKeyRegionDecRef (elektraKeyRegionOf (destData));
+	else
+		elektraFree (destData);
 	ksDel (destMeta);
 
+	// the copies are owned by dest
+	clear_bit (dest->flags, KEY_FLAG_MMAP_KEY);
+	clear_bit (dest->flags, KEY_FLAG_MMAP_DATA);
+
 	return 1;
 
 memerror:
@@ -460,8 +471,12 @@ int keyDel (Key * key)
 		return key->ksReference;
 	}
 
+	const int inRegion = test_bit (key->flags, KEY_FLAG_MMAP_STRUCT);
 	rc = keyClear (key);
-	elektraFree (key);
+	if (inRegion)
+		elektraKeyRegionDecRef (elektraKeyRegionOf (key));
+	else
+		elektraFree (key);
 
 	return rc;
 }
@@ -505,8 +520,9 @@ int keyClear (Key * key)
 	size_t ref = 0;
 
 	ref = key->ksReference;
-	if (key->key) elektraFree (key->key);
-	if (key->data.v) elektraFree (key->data.v);
+	const int inRegion = test_bit (key->flags, KEY_FLAG_MMAP_STRUCT);
+	elektraKeyFreeName (key);
+	elektraKeyFreeValue (key);
 	if (key->meta) ksDel (key->meta);
 
 	keyInit (key);
@@ -514,6 +530,7 @@ int keyClear (Key * key)
 
 	/* Set reference properties */
 	key->ksReference = ref;
+	if (inRegion) set_bit (key->flags, KEY_FLAG_MMAP_STRUCT);
 
 	return 0;
 }
@@ -616,6 +633,10 @@ ssize_t keyDecRef (Key * key)
  *
  * @note keyDup() will reset the references for dupped key.
  *
+ * @note KeySets duplicated with ksDup() share their array until
+ * one of them is modified, the shared array references the keys
+ * only once (see doc/decisions/keyset_cow.md).
+ *
  * For your own applications you can use
  * keyIncRef() and keyDecRef() for reference
  * counting, too.
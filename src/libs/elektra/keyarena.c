@@ -0,0 +1,310 @@
+/**
+ * @file
+ *
+ * @brief Bump allocation of keys, their names and values.
+ *
+ * @copyright BSD License (see doc/COPYING or http://www.libelektra.org)
+ */
+
+#ifdef HAVE_KDBCONFIG_H
+#include "kdbconfig.h"
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include "kdbinternal.h"
+
+
+#define ELEKTRA_ARENA_ALIGN(size) (((size) + sizeof (size_t) - 1) & ~(sizeof (size_t) - 1))
+#define ELEKTRA_ARENA_HEADER ELEKTRA_ARENA_ALIGN (sizeof (KeyRegion))
+
+
+/**
+ * @internal
+ *
+ * @brief Allocate a new block without any references.
+ */
+static KeyRegion * elektraKeyArenaBlock (size_t size)
+{
+	KeyRegion * block = elektraMalloc (size);
+	if (!block) return 0;
+
+	block->base = block;
+	block->size = size;
+	block->refs = 0;
+	block->mapped = 0;
+	return block;
+}
+
+/**
+ * @internal
+ *
+ * @brief Reserve memory within the arena.
+ *
+ * The memory is preceded by its distance to the block, as
+ * required for a KeyRegion. It does not hold a reference, the
+ * caller must take one before the next allocation.
+ *
+ * Blobs larger than a quarter of a block get a block of their own,
+ * so that they do not waste the rest of the current one.
+ *
+ * @param arena the arena to allocate from
+ * @param size the number of bytes needed
+ *
+ * @return the memory, aligned to size_t
+ * @retval 0 on memory error
+ */
+static void * elektraKeyArenaAlloc (KeyArena * arena, size_t size)
+{
+	const size_t needed = sizeof (size_t) + ELEKTRA_ARENA_ALIGN (size);
+	KeyRegion * block = arena->block;
+	size_t used;
+
+	if (needed > KEY_ARENA_BLOCK_SIZE / 4)
+	{
+		block = elektraKeyArenaBlock (ELEKTRA_ARENA_HEADER + needed);
+		if (!block) return 0;
+		used = ELEKTRA_ARENA_HEADER;
+	}
+	else
+	{
+		if (!block || arena->used + needed > block->size)
+		{
+			block = elektraKeyArenaBlock (KEY_ARENA_BLOCK_SIZE);
+			if (!block) return 0;
+			block->refs = 1;
+			if (arena->block) elektraKeyRegionDecRef (arena->block);
+			arena->block = block;
+			arena->used = ELEKTRA_ARENA_HEADER;
+		}
+		used = arena->used;
+		arena->used += needed;
+	}
+
+	const size_t distance = used + sizeof (size_t);
+	memcpy ((char *)block + used, &distance, sizeof (size_t));
+	return (char *)block + distance;
+}
+
+/**
+ * @internal
+ *
+ * @brief Create an empty arena.
+ *
+ * No memory for keys is allocated before the first key is created.
+ * The caller holds the only reference.
+ *
+ * @return the new arena
+ * @retval 0 on memory error
+ */
+KeyArena * elektraKeyArenaNew (void)
+{
+	KeyArena * arena = elektraCalloc (sizeof (KeyArena));
+	if (arena) arena->refs = 1;
+	return arena;
+}
+
+/**
+ * @internal
+ *
+ * @brief Drop a reference to an arena.
+ *
+ * The arena is deleted together with its last reference.
+ * Keys created by the arena stay valid, the blocks are freed
+ * together with the last key, name or value within them.
+ *
+ * @param arena the arena to delete
+ */
+void elektraKeyArenaDel (KeyArena * arena)
+{
+	if (!arena) return;
+	if (--arena->refs > 0) return;
+
+	if (arena->block) elektraKeyRegionDecRef (arena->block);
+	keyDel (arena->scratch);
+	elektraFree (arena);
+}
+
+/**
+ * @internal
+ *
+ * @brief The arena for keys that will be appended to a keyset.
+ *
+ * Storage plugins use it to create keys in kdbGet() with
+ * elektraKeyArenaKeyNew(). The arena is created on first use and
+ * deleted by ksClear() and ksDel().
+ *
+ * @param ks the keyset the keys are created for
+ *
+ * @return the arena of the keyset
+ * @retval 0 on memory error
+ */
+KeyArena * elektraKsArena (KeySet * ks)
+{
+	if (!ks->arena) ks->arena = elektraKeyArenaNew ();
+	return ks->arena;
+}
+
+/**
+ * @internal
+ *
+ * @brief Let a keyset use the given arena.
+ *
+ * Keysets which are filled one after the other can share an
+ * arena, so that each of them does not start a block of its own.
+ * The keyset takes a reference and drops the reference to its
+ * previous arena. An arena is not thread-safe, so keysets filled
+ * concurrently must not share it.
+ *
+ * @param ks the keyset the keys will be created for
+ * @param arena the arena to use, 0 to drop the current one
+ */
+void elektraKsSetArena (KeySet * ks, KeyArena * arena)
+{
+	if (arena) ++arena->refs;
+	elektraKeyArenaDel (ks->arena);
+	ks->arena = arena;
+}
+
+/**
+ * @internal
+ *
+ * @brief Create a key with its name within an arena.
+ *
+ * @param arena the arena to allocate from
+ * @param name the name of the key or 0 for a key without name
+ * @param options options for elektraKeySetName()
+ *
+ * @return the new key
+ * @retval 0 on memory error or if the name is invalid
+ */
+static Key * elektraKeyArenaNamedKey (KeyArena * arena, const char * name, option_t options)
+{
+	Key * key = elektraKeyArenaAlloc (arena, sizeof (Key));
+	if (!key) return 0;
+
+	keyInit (key);
+	++elektraKeyRegionOf (key)->refs;
+	set_bit (key->flags, KEY_FLAG_MMAP_STRUCT);
+	if (!name) return key;
+
+	// the name is canonicalized in a heap buffer that is reused
+	if (!arena->scratch && !(arena->scratch = keyNew (0))) goto error;
+	Key * scratch = arena->scratch;
+	if (elektraKeySetName (scratch, name, options) == -1) goto error;
+
+	const size_t size = scratch->keySize + scratch->keyUSize;
+	char * blob = elektraKeyArenaAlloc (arena, size);
+	if (!blob) goto error;
+	memcpy (blob, scratch->key, size);
+	elektraKeySetRegionName (key, blob, scratch->keySize, scratch->keyUSize);
+	return key;
+
+error:
+	keyDel (key);
+	return 0;
+}
+
+/**
+ * @internal
+ *
+ * @brief Create a key within an arena.
+ *
+ * The key, its name and, if set by elektraKeyArenaSetValue(), its
+ * value are bump allocated within the arena, otherwise the key is
+ * the same as one created by keyNew(). Changing the name or value
+ * copies it out of the arena, keyDel() releases the key.
+ *
+ * @param arena the arena to allocate from
+ * @param name the name of the key or 0 for a key without name
+ *
+ * @return the new key
+ * @retval 0 on memory error or if the name is invalid
+ */
+Key * elektraKeyArenaKeyNew (KeyArena * arena, const char * name)
+{
+	Key * key = elektraKeyArenaNamedKey (arena, name, 0);
+	if (!key || !name) return key;
+
+	// an owner given with the name is metadata
+	key->meta = arena->scratch->meta;
+	arena->scratch->meta = 0;
+	return key;
+}
+
+/**
+ * @internal
+ *
+ * @brief Set the value of a key within an arena.
+ *
+ * Behaves like keySetRaw(), but the value is allocated within
+ * the arena.
+ *
+ * @param arena the arena to allocate from
+ * @param key the key to set the value for
+ * @param value the value to copy
+ * @param size the size of the value (including the null byte for strings)
+ *
+ * @return the size of the value as keyGetValueSize()
+ * @retval -1 on memory error, null pointer or read only value
+ */
+ssize_t elektraKeyArenaSetValue (KeyArena * arena, Key * key, const void * value, size_t size)
+{
+	if (!key) return -1;
+	if (test_bit (key->flags, KEY_FLAG_RO_VALUE)) return -1;
+	if (!size || !value) return keySetRaw (key, 0, 0);
+
+	void * blob = elektraKeyArenaAlloc (arena, size);
+	if (!blob) return -1;
+	memcpy (blob, value, size);
+	elektraKeySetRegionValue (key, blob, size);
+	return keyGetValueSize (key);
+}
+
+/**
+ * @internal
+ *
+ * @brief Set metadata of a key within an arena.
+ *
+ * Behaves like keySetMeta(), but the meta key, its name and
+ * its value are allocated within the arena. The keyset holding
+ * the metadata of the key is still allocated with ksNew().
+ *
+ * @param arena the arena to allocate from
+ * @param key the key to set the metadata for
+ * @param metaName the name of the metadata
+ * @param newMetaString the value of the metadata, 0 to remove it
+ *
+ * @return the size of newMetaString as keySetMeta()
+ * @retval 0 if the metadata was removed
+ * @retval -1 on memory error, null pointer, read only metadata
+ *         or invalid name
+ */
+ssize_t elektraKeyArenaSetMeta (KeyArena * arena, Key * key, const char * metaName, const char * newMetaString)
+{
+	if (!key) return -1;
+	if (test_bit (key->flags, KEY_FLAG_RO_META)) return -1;
+	if (!metaName) return -1;
+	if (!newMetaString) return keySetMeta (key, metaName, 0);
+
+	const size_t metaStringSize = strlen (newMetaString) + 1;
+	Key * toSet = elektraKeyArenaNamedKey (arena, metaName, KEY_META_NAME | KEY_EMPTY_NAME);
+	if (!toSet) return -1;
+	if (elektraKeyArenaSetValue (arena, toSet, newMetaString, metaStringSize) == -1) goto error;
+	if (!key->meta && !(key->meta = ksNew (0, KS_END))) goto error;
+
+	set_bit (toSet->flags, KEY_FLAG_RO_NAME);
+	set_bit (toSet->flags, KEY_FLAG_RO_VALUE);
+	set_bit (toSet->flags, KEY_FLAG_RO_META);
+
+	// replaces metadata with the same name
+	if (ksAppendKey (key->meta, toSet) == -1) goto error;
+	key->flags |= KEY_FLAG_SYNC;
+	return metaStringSize;
+
+error:
+	keyDel (toSet);
+	return -1;
+}
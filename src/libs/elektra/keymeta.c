@@ -386,6 +386,63 @@ int keyCopyAllMeta (Key * dest, const Key * source)
 	return 0;
 }
 
+/**
+ * @internal
+ *
+ * Size of the buffer for the name of a search key for metadata,
+ * which holds the name and its unescaped form.
+ */
+#define ELEKTRA_META_SEARCH_SIZE 256
+
+/**
+ * @internal
+ *
+ * @brief Set up a key on the stack to search for metadata.
+ *
+ * Only simple names are handled: names without escape characters
+ * and without empty, `.` and `..` parts. Their canonical name is the
+ * name itself and their unescaped name only differs by having null
+ * bytes instead of slashes, so no allocation is needed.
+ *
+ * @param search the key to set up
+ * @param buffer receives both names, of size #ELEKTRA_META_SEARCH_SIZE
+ * @param metaName the name of the metadata
+ * @retval 1 if the key was set up
+ * @retval 0 if the name is not simple or too long, use
+ *         elektraKeySetName() then
+ */
+static int elektraMetaSearchKey (Key * search, char * buffer, const char * metaName)
+{
+	size_t size = strlen (metaName) + 1;
+	if (size * 2 > ELEKTRA_META_SEARCH_SIZE) return 0;
+
+	const char * part = metaName;
+	for (const char * cur = metaName;; ++cur)
+	{
+		if (*cur == '\\' || *cur == '%') return 0;
+		if (*cur != '/' && *cur != '\0') continue;
+
+		// check the part before
+		size_t partSize = cur - part;
+		if (partSize == 0) return 0;
+		if (part[0] == '.' && (partSize == 1 || (partSize == 2 && part[1] == '.'))) return 0;
+		if (*cur == '\0') break;
+		part = cur + 1;
+	}
+
+	memcpy (buffer, metaName, size);
+	for (size_t i = 0; i < size; ++i)
+	{
+		buffer[size + i] = metaName[i] == '/' ? '\0' : metaName[i];
+	}
+
+	keyInit (search);
+	search->key = buffer;
+	search->keySize = size;
+	search->keyUSize = size;
+	return 1;
+}
+
 /**Returns the Value of a Meta-Information given by name.
  *
  * This is a much more efficient version of keyGetMeta().
@@ -422,6 +479,13 @@ const Key * keyGetMeta (const Key * key, const char * metaName)
 	if (!metaName) return 0;
 	if (!key->meta) return 0;
 
+	struct _Key stackSearch;
+	char buffer[ELEKTRA_META_SEARCH_SIZE];
+	if (elektraMetaSearchKey (&stackSearch, buffer, metaName))
+	{
+		return ksLookup (key->meta, &stackSearch, 0);
+	}
+
 	search = keyNew (0);
 	elektraKeySetName (search, metaName, KEY_META_NAME | KEY_EMPTY_NAME);
 
@@ -475,16 +539,24 @@ ssize_t keySetMeta (Key * key, const char * metaName, const char * newMetaString
 	// optimization: we have nothing and want to remove something:
 	if (!key->meta && !newMetaString) return 0;
 
-	toSet = keyNew (0);
-	if (!toSet) return -1;
+	struct _Key stackSearch;
+	char buffer[ELEKTRA_META_SEARCH_SIZE];
+	Key * search = &stackSearch;
+	toSet = 0;
+	if (!elektraMetaSearchKey (&stackSearch, buffer, metaName))
+	{
+		toSet = keyNew (0);
+		if (!toSet) return -1;
 
-	elektraKeySetName (toSet, metaName, KEY_META_NAME | KEY_EMPTY_NAME);
+		elektraKeySetName (toSet, metaName, KEY_META_NAME | KEY_EMPTY_NAME);
+		search = toSet;
+	}
 
 	/*Lets have a look if the key is already inserted.*/
 	if (key->meta)
 	{
 		Key * ret;
-		ret = ksLookup (key->meta, toSet, KDB_O_POP);
+		ret = ksLookup (key->meta, search, KDB_O_POP);
 		if (ret)
 		{
 			/*It was already there, so lets drop that one*/
@@ -493,6 +565,14 @@ ssize_t keySetMeta (Key * key, const char * metaName, const char * newMetaString
 		}
 	}
 
+	if (newMetaString && !toSet)
+	{
+		toSet = keyNew (0);
+		if (!toSet) return -1;
+
+		elektraKeySetName (toSet, metaName, KEY_META_NAME | KEY_EMPTY_NAME);
+	}
+
 	if (newMetaString)
 	{
 		/*Add the meta information to the key*/
@@ -536,3 +616,40 @@ ssize_t keySetMeta (Key * key, const char * metaName, const char * newMetaString
 	key->flags |= KEY_FLAG_SYNC;
 	return metaStringSize;
 }
+
+/**
+ * @internal
+ *
+ * @brief Give the key its own copy of every meta key shared with other keys.
+ *
+ * keyCopyMeta(), keyCopyAllMeta() and keyDup() share meta keys
+ * between keys. Their reference counters are not thread-safe, so
+ * keys modified by different threads must not share meta keys.
+ *
+ * @param key the key whose metadata should be unshared
+ *
+ * @retval 0 on success
+ * @retval -1 on memory errors, the key keeps some shared meta keys then
+ */
+int elektraKeyUnshareMeta (Key * key)
+{
+	if (!key->meta) return 0;
+	if (elektraKsUnshare (key->meta) == -1) return -1;
+
+	KeySet * meta = key->meta;
+	for (size_t i = 0; i < meta->size; ++i)
+	{
+		if (meta->array[i]->ksReference < 2) continue;
+
+		Key * copy = keyDup (meta->array[i]);
+		if (!copy) return -1;
+
+		set_bit (copy->flags, KEY_FLAG_RO_NAME);
+		set_bit (copy->flags, KEY_FLAG_RO_VALUE);
+		set_bit (copy->flags, KEY_FLAG_RO_META);
+
+		// replaces the shared meta key at the same position
+		if (ksAppendKey (meta, copy) == -1) return -1;
+	}
+	return 0;
+}
@@ -422,8 +422,7 @@ static void elektraHandleUserName (Key * key, const char * newName)
 
 static void elektraRemoveKeyName (Key * key)
 {
-	if (key->key) elektraFree (key->key);
-	key->key = 0;
+	elektraKeyFreeName (key);
 	key->keySize = 0;
 	key->keyUSize = 0;
 }
@@ -844,6 +843,7 @@ ssize_t keyAddBaseName (Key * key, const char * baseName)
 	if (!baseName) return key->keySize;
 	if (test_bit (key->flags, KEY_FLAG_RO_NAME)) return -1;
 	if (!key->key) return -1;
+	if (elektraKeyDetachName (key) == -1) return -1;
 
 	char * escaped = elektraMalloc (strlen (baseName) * 2 + 2);
 	elektraEscapeKeyNamePart (baseName, escaped);
@@ -962,6 +962,7 @@ ssize_t keyAddName (Key * key, const char * newName)
 	size_t const nameSize = elektraStrLen (newName);
 	if (nameSize < 2) return 0;
 	if (!elektraValidateKeyName (newName, nameSize)) return -1;
+	if (elektraKeyDetachName (key) == -1) return -1;
 
 	const size_t origSize = key->keySize;
 	const size_t newSize = origSize + nameSize;
@@ -1060,6 +1061,7 @@ ssize_t keySetBaseName (Key * key, const char * baseName)
 	if (!key) return -1;
 	if (test_bit (key->flags, KEY_FLAG_RO_NAME)) return -1;
 	if (!key->key) return -1;
+	if (elektraKeyDetachName (key) == -1) return -1;
 
 	size_t size = 0;
 	char * searchBaseName = 0;
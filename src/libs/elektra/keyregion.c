@@ -0,0 +1,215 @@
+/**
+ * @file
+ *
+ * @brief Keys with names and values in memory they do not own.
+ *
+ * @copyright BSD License (see doc/COPYING or http://www.libelektra.org)
+ */
+
+#ifdef HAVE_KDBCONFIG_H
+#include "kdbconfig.h"
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
+#include "kdbinternal.h"
+
+
+/**
+ * @internal
+ *
+ * @brief Find the region a name or value points into.
+ *
+ * @param blob a name or value within a KeyRegion
+ * @return the header of the region
+ */
+KeyRegion * elektraKeyRegionOf (const void * blob)
+{
+	size_t distance;
+	memcpy (&distance, (const char *)blob - sizeof (size_t), sizeof (size_t));
+	return (KeyRegion *)((char *)blob - distance);
+}
+
+/**
+ * @internal
+ *
+ * @brief Drop a reference to a region, releasing it with the last one.
+ *
+ * @param region the region to release
+ */
+void elektraKeyRegionDecRef (KeyRegion * region)
+{
+	if (--region->refs > 0) return;
+
+#ifdef HAVE_SYS_MMAN_H
+	if (region->mapped)
+	{
+		munmap (region->base, region->size);
+		return;
+	}
+#endif
+	elektraFree (region->base);
+}
+
+/**
+ * @internal
+ *
+ * @brief Let the name of a key point into a region.
+ *
+ * The name must be laid out as in memory, i.e. the escaped name with
+ * @p size bytes is followed by the unescaped name with @p usize bytes,
+ * and it must be preceded by the distance to the region header.
+ *
+ * @pre the key is not in a keyset and has no owner
+ *
+ * @param key the key to set the name for
+ * @param name the name within the region
+ * @param size the size of the escaped name including the null byte
+ * @param usize the size of the unescaped name
+ *
+ * @retval 1 on success
+ * @retval -1 if the name is read only
+ */
+int elektraKeySetRegionName (Key * key, const char * name, size_t size, size_t usize)
+{
+	if (test_bit (key->flags, KEY_FLAG_RO_NAME)) return -1;
+
+	elektraKeyFreeName (key);
+	++elektraKeyRegionOf (name)->refs;
+
+	key->key = (char *)name;
+	key->keySize = size;
+	key->keyUSize = usize;
+	set_bit (key->flags, KEY_FLAG_MMAP_KEY);
+	set_bit (key->flags, KEY_FLAG_SYNC);
+	return 1;
+}
+
+/**
+ * @internal
+ *
+ * @brief Let the value of a key point into a region.
+ *
+ * The value must be preceded by the distance to the region header.
+ *
+ * @param key the key to set the value for
+ * @param value the value within the region
+ * @param size the size of the value (including the null byte for strings)
+ *
+ * @retval 1 on success
+ * @retval -1 if the value is read only
+ */
+int elektraKeySetRegionValue (Key * key, const void * value, size_t size)
+{
+	if (test_bit (key->flags, KEY_FLAG_RO_VALUE)) return -1;
+
+	elektraKeyFreeValue (key);
+	++elektraKeyRegionOf (value)->refs;
+
+	key->data.v = (void *)value;
+	key->dataSize = size;
+	set_bit (key->flags, KEY_FLAG_MMAP_DATA);
+	set_bit (key->flags, KEY_FLAG_SYNC);
+	return 1;
+}
+
+/**
+ * @internal
+ *
+ * @brief Copy the name of a key out of its region.
+ *
+ * Must be called before the name is modified in place or reallocated.
+ * Does nothing if the name is not within a region.
+ *
+ * @retval 0 on success
+ * @retval -1 on memory error (the key stays unchanged)
+ */
+int elektraKeyDetachName (Key * key)
+{
+	if (!test_bit (key->flags, KEY_FLAG_MMAP_KEY)) return 0;
+
+	char * name = elektraMalloc (key->keySize + key->keyUSize);
+	if (!name) return -1;
+	memcpy (name, key->key, key->keySize + key->keyUSize);
+
+	elektraKeyRegionDecRef (elektraKeyRegionOf (key->key));
+	clear_bit (key->flags, KEY_FLAG_MMAP_KEY);
+	key->key = name;
+	return 0;
+}
+
+/**
+ * @internal
+ *
+ * @brief Copy the value of a key out of its region.
+ *
+ * @see elektraKeyDetachName()
+ *
+ * @retval 0 on success
+ * @retval -1 on memory error (the key stays unchanged)
+ */
+int elektraKeyDetachValue (Key * key)
+{
+	if (!test_bit (key->flags, KEY_FLAG_MMAP_DATA)) return 0;
+
+	void * value = elektraMalloc (key->dataSize);
+	if (!value) return -1;
+	memcpy (value, key->data.v, key->dataSize);
+
+	elektraKeyRegionDecRef (elektraKeyRegionOf (key->data.v));
+	clear_bit (key->flags, KEY_FLAG_MMAP_DATA);
+	key->data.v = value;
+	return 0;
+}
+
+/**
+ * @internal
+ *
+ * @brief Free the name of a key, wherever it is.
+ *
+ * Sets the name to 0, but does not touch the sizes.
+ */
+void elektraKeyFreeName (Key * key)
+{
+	if (!key->key) return;
+
+	if (test_bit (key->flags, KEY_FLAG_MMAP_KEY))
+	{
+		elektraKeyRegionDecRef (elektraKeyRegionOf (key->key));
+		clear_bit (key->flags, KEY_FLAG_MMAP_KEY);
+	}
+	else
+	{
+		elektraFree (key->key);
+	}
+	key->key = 0;
+}
+
+/**
+ * @internal
+ *
+ * @brief Free the value of a key, wherever it is.
+ *
+ * Sets the value to 0, but does not touch the size.
+ */
+void elektraKeyFreeValue (Key * key)
+{
+	if (!key->data.v) return;
+
+	if (test_bit (key->flags, KEY_FLAG_MMAP_DATA))
+	{
+		elektraKeyRegionDecRef (elektraKeyRegionOf (key->data.v));
+		clear_bit (key->flags, KEY_FLAG_MMAP_DATA);
+	}
+	else
+	{
+		elektraFree (key->data.v);
+	}
+	key->data.v = 0;
+}
@@ -46,6 +46,98 @@
  * will be shared.
  */
 
+/**
+ * @internal
+ *
+ * Stored in front of the array of every keyset.
+ *
+ * The array is shared by keysets duplicated with ksDup() (see
+ * elektraKsUnshare()). The counter is allocated together with the array
+ * and only changed atomically, so keysets can be duplicated by several
+ * threads at once. The array references its keys once, no matter how
+ * many keysets use it.
+ */
+typedef union
+{
+	size_t refs; /**< Number of keysets using the array */
+	struct _Key * align;
+} KeySetArrayHeader;
+
+static KeySetArrayHeader * elektraKsArrayHeader (struct _Key ** array)
+{
+	return (KeySetArrayHeader *)array - 1;
+}
+
+/**
+ * @internal
+ *
+ * @brief Allocate the array of a keyset, used by this keyset only.
+ *
+ * @param alloc the number of keys (including the terminating null pointer)
+ * @return the array or 0 on memory error
+ */
+static struct _Key ** elektraKsArrayNew (size_t alloc)
+{
+	KeySetArrayHeader * header = elektraMalloc (sizeof (KeySetArrayHeader) + sizeof (struct _Key *) * alloc);
+	if (!header) return 0;
+	header->refs = 1;
+	return (struct _Key **)(header + 1);
+}
+
+/**
+ * @internal
+ *
+ * @brief Resize an array which is not shared.
+ *
+ * @retval 0 on success
+ * @retval -1 on memory error, @p array is unchanged then
+ */
+static int elektraKsArrayResize (struct _Key *** array, size_t alloc)
+{
+	void * header = elektraKsArrayHeader (*array);
+	if (elektraRealloc (&header, sizeof (KeySetArrayHeader) + sizeof (struct _Key *) * alloc) == -1) return -1;
+	*array = (struct _Key **)((KeySetArrayHeader *)header + 1);
+	return 0;
+}
+
+/**
+ * @internal
+ *
+ * @brief Free an array which is not shared.
+ *
+ * The keys are not touched, their references were handed over.
+ */
+static void elektraKsArrayRelease (struct _Key ** array)
+{
+	if (!array) return;
+	elektraFree (elektraKsArrayHeader (array));
+}
+
+/**
+ * @internal
+ *
+ * @brief Stop using an array, the last keyset using it frees it.
+ *
+ * The last keyset also drops the references of the array to its keys
+ * and keyDel()s them.
+ *
+ * @param array the array of the keyset
+ * @param size the number of keys in the array
+ */
+static void elektraKsArrayDel (struct _Key ** array, size_t size)
+{
+	if (!array) return;
+	KeySetArrayHeader * header = elektraKsArrayHeader (array);
+	if (__sync_sub_and_fetch (&header->refs, 1) != 0) return;
+
+	for (size_t i = 0; i < size; ++i)
+	{
+		keyDecRef (array[i]);
+		keyDel (array[i]);
+	}
+	elektraFree (header);
+}
+
 /**
  * @defgroup keyset KeySet
  * @brief Methods to manipulate KeySets.
@@ -183,7 +275,7 @@ KeySet * ksVNew (size_t alloc, va_list va)
 	else
 		keyset->alloc = alloc;
 
-	keyset->array = elektraMalloc (sizeof (struct _Key *) * keyset->alloc);
+	keyset->array = elektraKsArrayNew (keyset->alloc);
 	if (!keyset->array)
 	{
 		/*errno = KDB_ERR_NOMEM;*/
@@ -206,6 +298,61 @@ KeySet * ksVNew (size_t alloc, va_list va)
 	return keyset;
 }
 
+/**
+ * @internal
+ *
+ * @brief Let the keyset @p dest without array share the array of @p source.
+ *
+ * @p source is not modified, only the counter of its array.
+ * The keys are not touched, the array references them for all
+ * keysets sharing it.
+ */
+static void elektraKsShare (KeySet * dest, const KeySet * source)
+{
+	__sync_add_and_fetch (&elektraKsArrayHeader (source->array)->refs, 1);
+
+	dest->array = source->array;
+	dest->size = source->size;
+	dest->alloc = source->alloc;
+	if (dest->size) ksSetCursor (dest, dest->size - 1);
+}
+
+/**
+ * @internal
+ *
+ * @brief Give @p ks its own array before it gets modified.
+ *
+ * Keysets duplicated with ksDup() share their array until
+ * one of them is modified. Then the modified keyset gets a copy of the
+ * array, which references every key. The last keyset sharing the array
+ * just keeps it.
+ *
+ * Every function modifying the array must call it first.
+ *
+ * @param ks the keyset to be modified
+ * @retval 0 on success (also if the array was not shared)
+ * @retval -1 on memory error (the array stays shared)
+ */
+int elektraKsUnshare (KeySet * ks)
+{
+	if (!ks->array) return 0;
+	if (__sync_add_and_fetch (&elektraKsArrayHeader (ks->array)->refs, 0) == 1) return 0;
+
+	Key ** array = elektraKsArrayNew (ks->alloc);
+	if (!array) return -1;
+	elektraMemcpy (array, ks->array, ks->size);
+	array[ks->size] = 0;
+	for (size_t i = 0; i < ks->size; ++i)
+	{
+		keyIncRef (array[i]);
+	}
+
+	// the others may have stopped sharing meanwhile
+	elektraKsArrayDel (ks->array, ks->size);
+	ks->array = array;
+	return 0;
+}
+
 /**
  * Return a duplicate of a keyset.
  *
@@ -215,8 +362,17 @@ KeySet * ksVNew (size_t alloc, va_list va)
  * so you need to ksDel() the returned pointer.
  *
  * A flat copy is made, so the keys will not be duplicated,
- * but there reference counter is updated, so both keysets
- * need ksDel().
+ * both keysets need ksDel().
+ *
+ * Both keysets share the array of keys until one of them is
+ * modified (copy-on-write), so ksDup() takes constant time,
+ * independent of the size of the keyset. The shared array
+ * references the keys once for all keysets using it. Only the
+ * keyset which is modified first references every key again,
+ * when it gets its own array.
+ *
+ * @note Because of the shared array, ksDup() does not change
+ *       keyGetRef() of the keys, see doc/decisions/keyset_cow.md.
  *
  * @param source has to be an initialized source KeySet
  * @return a flat copy of source on success
@@ -227,9 +383,13 @@ KeySet * ksVNew (size_t alloc, va_list va)
 KeySet * ksDup (const KeySet * source)
 {
 	if (!source) return 0;
+	if (!source->array) return ksNew (source->alloc, KS_END);
 
-	KeySet * keyset = ksNew (source->alloc, KS_END);
-	ksAppend (keyset, source);
+	KeySet * keyset = elektraMalloc (sizeof (KeySet));
+	if (!keyset) return 0;
+	ksInit (keyset);
+
+	elektraKsShare (keyset, source);
 	return keyset;
 }
 
@@ -259,16 +419,29 @@ KeySet * ksDeepDup (const KeySet * source)
 	KeySet * keyset = 0;
 
 	keyset = ksNew (source->alloc, KS_END);
+	if (!keyset) return 0;
+
+	// the duplicates are in the same order, no search needed
 	for (i = 0; i < s; ++i)
 	{
 		Key * k = source->array[i];
 		Key * d = keyDup (k);
+		if (!d)
+		{
+			ksDel (keyset);
+			return 0;
+		}
 		if (!test_bit (k->flags, KEY_FLAG_SYNC))
 		{
 			keyClearSync (d);
 		}
-		ksAppendKey (keyset, d);
+		elektraKeyLock (d, KEY_LOCK_NAME);
+		keyIncRef (d);
+		keyset->array[i] = d;
+		keyset->size = i + 1;
 	}
+	keyset->array[keyset->size] = 0;
+	if (keyset->size > 0) ksSetCursor (keyset, keyset->size - 1);
 
 	return keyset;
 }
@@ -373,7 +546,7 @@ int ksClear (KeySet * ks)
 	ksClose (ks);
 	// ks->array empty now
 
-	if ((ks->array = elektraMalloc (sizeof (struct _Key *) * KEYSET_SIZE)) == 0)
+	if ((ks->array = elektraKsArrayNew (KEYSET_SIZE)) == 0)
 	{
 		/*errno = KDB_ERR_NOMEM;*/
 		ks->size = 0;
@@ -795,6 +968,7 @@ ssize_t ksAppendKey (KeySet * ks, Key * toAppend)
 		keyDel (toAppend);
 		return -1;
 	}
+	if (elektraKsUnshare (ks) == -1) return -1;
 
 	elektraKeyLock (toAppend, KEY_LOCK_NAME);
 
@@ -834,6 +1008,7 @@ ssize_t ksAppendKey (KeySet * ks, Key * toAppend)
 			ks->array[ks->size - 1] = toAppend;
 			ks->array[ks->size] = 0;
 			ksSetCursor (ks, ks->size - 1);
+			elektraKsHashInsert (ks, ks->size - 1);
 		}
 		else
 		{
@@ -845,9 +1020,121 @@ ssize_t ksAppendKey (KeySet * ks, Key * toAppend)
 			*/
 			ks->array[insertpos] = toAppend;
 			ksSetCursor (ks, insertpos);
+			elektraKsHashInsert (ks, insertpos);
+		}
+	}
+
+	return ks->size;
+}
+
+
+/**
+ * @internal
+ *
+ * Takes a key of another keyset into @p ks, the same way
+ * ksAppendKey() does.
+ */
+static void elektraKsTakeKey (Key * toAppend)
+{
+	elektraKeyLock (toAppend, KEY_LOCK_NAME);
+	keyIncRef (toAppend);
+}
+
+/**
+ * @internal
+ *
+ * Fast path of ksAppend() if all keys of @p toAppend sort after
+ * all keys of @p ks: the keys are copied at the end of the array.
+ *
+ * @param toAlloc the new allocation size of the array
+ */
+static ssize_t elektraKsAppendAfter (KeySet * ks, const KeySet * toAppend, size_t toAlloc)
+{
+	if (ksResize (ks, toAlloc - 1) == -1) return -1;
+
+	size_t oldSize = ks->size;
+	elektraMemcpy (ks->array + oldSize, toAppend->array, toAppend->size);
+	ks->size += toAppend->size;
+	ks->array[ks->size] = 0;
+
+	for (size_t i = oldSize; i < ks->size; ++i)
+	{
+		elektraKsTakeKey (ks->array[i]);
+		elektraKsHashInsert (ks, i);
+	}
+
+	ksSetCursor (ks, ks->size - 1);
+	return ks->size;
+}
+
+/**
+ * @internal
+ *
+ * Linear merge of the two sorted arrays for ksAppend().
+ *
+ * Keys of @p toAppend replace keys with the same name in @p ks.
+ * The cursor is set to the last inserted key of @p toAppend, like a
+ * ksAppendKey() of every key would do.
+ *
+ * @param toAlloc the new allocation size of the array
+ */
+static ssize_t elektraKsAppendMerge (KeySet * ks, const KeySet * toAppend, size_t toAlloc)
+{
+	Key ** merged = elektraKsArrayNew (toAlloc);
+	if (!merged) return -1;
+
+	size_t i = 0;
+	size_t j = 0;
+	size_t n = 0;
+	cursor_t cursor = ksGetCursor (ks);
+
+	while (i < ks->size && j < toAppend->size)
+	{
+		int cmp = keyCompareByNameOwner (&ks->array[i], &toAppend->array[j]);
+		if (cmp < 0)
+		{
+			merged[n++] = ks->array[i++];
+			continue;
+		}
+
+		if (cmp == 0)
+		{
+			Key * old = ks->array[i++];
+			if (old == toAppend->array[j])
+			{
+				/* same key again */
+				merged[n++] = toAppend->array[j++];
+				continue;
+			}
+			keyDecRef (old);
+			keyDel (old);
 		}
+
+		elektraKsTakeKey (toAppend->array[j]);
+		cursor = n;
+		merged[n++] = toAppend->array[j++];
+	}
+
+	while (i < ks->size)
+	{
+		merged[n++] = ks->array[i++];
 	}
 
+	while (j < toAppend->size)
+	{
+		elektraKsTakeKey (toAppend->array[j]);
+		cursor = n;
+		merged[n++] = toAppend->array[j++];
+	}
+	merged[n] = 0;
+
+	elektraKsArrayRelease (ks->array);
+	ks->array = merged;
+	ks->alloc = toAlloc;
+	ks->size = n;
+	elektraKsHashInvalidate (ks);
+
+	ksSetCursor (ks, cursor);
 	return ks->size;
 }
 
@@ -862,10 +1149,14 @@ ssize_t ksAppendKey (KeySet * ks, Key * toAppend)
  *
  * @copydetails doxygenFlatCopy
  *
+ * The keys are merged in linear time. If all keys of @p toAppend
+ * sort after the keys of @p ks, they are only copied to the end.
+ *
  * @post Sorted KeySet ks with all keys it had before and additionally
  *       the keys from toAppend
  * @return the size of the KeySet after transfer
  * @retval -1 on NULL pointers
+ * @retval -1 on memory error
  * @param ks the KeySet that will receive the keys
  * @param toAppend the KeySet that provides the keys that will be transferred
  * @see ksAppendKey()
@@ -879,18 +1170,119 @@ ssize_t ksAppend (KeySet * ks, const KeySet * toAppend)
 	if (!toAppend) return -1;
 
 	if (toAppend->size <= 0) return ks->size;
+	if (ks == toAppend) return ks->size;
+	if (elektraKsUnshare (ks) == -1) return -1;
 
 	/* Do only one resize in advance */
 	for (toAlloc = ks->alloc; ks->size + toAppend->size >= toAlloc; toAlloc *= 2)
 		;
-	ksResize (ks, toAlloc - 1);
 
-	/* TODO: here is lots of room for optimizations */
-	for (size_t i = 0; i < toAppend->size; ++i)
+	if (ks->size == 0 || keyCompareByNameOwner (&ks->array[ks->size - 1], &toAppend->array[0]) < 0)
 	{
-		ksAppendKey (ks, toAppend->array[i]);
+		return elektraKsAppendAfter (ks, toAppend, toAlloc);
 	}
-	return ks->size;
+
+	return elektraKsAppendMerge (ks, toAppend, toAlloc);
+}
+
+
+/**
+ * @internal
+ *
+ * A key together with its position in the array passed
+ * to elektraKsAppendArray(), to sort it stable.
+ */
+typedef struct
+{
+	Key * key;
+	size_t position;
+} KeyPosition;
+
+static int keyCompareByNamePosition (const void * p1, const void * p2)
+{
+	const KeyPosition * k1 = p1;
+	const KeyPosition * k2 = p2;
+	int ret = keyCompareByNameOwner (&k1->key, &k2->key);
+	if (ret) return ret;
+	return k1->position < k2->position ? -1 : k1->position > k2->position;
+}
+
+/**
+ * @brief Append many keys at once
+ *
+ * Has the same result as a ksAppendKey() of every key of @p keys in
+ * the given order, but the keys are sorted once and then merged with
+ * @p ks in linear time as ksAppend() does. So storage plugins can
+ * collect their keys in the order of the file and append them with a
+ * single call, instead of inserting each key in the middle of the
+ * keyset.
+ *
+ * Of several keys with the same name the last one is appended, the
+ * others are deleted like ksAppendKey() would do it. Keys without name
+ * are deleted, too.
+ *
+ * @param ks the keyset to append to
+ * @param keys the keys to append, the array is reordered
+ * @param size the number of keys in @p keys
+ *
+ * @return the size of @p ks afterwards
+ * @retval -1 on null pointers or memory errors
+ * @see ksAppend()
+ * @ingroup proposal
+ */
+ssize_t elektraKsAppendArray (KeySet * ks, Key ** keys, size_t size)
+{
+	if (!ks) return -1;
+	if (!size) return ks->size;
+	if (!keys) return -1;
+
+	KeyPosition * sorted = elektraMalloc (size * sizeof (KeyPosition));
+	if (!sorted) return -1;
+
+	size_t named = 0;
+	for (size_t i = 0; i < size; ++i)
+	{
+		if (!keys[i]) continue;
+		if (!keys[i]->key)
+		{
+			keyDel (keys[i]);
+			continue;
+		}
+		sorted[named].key = keys[i];
+		sorted[named].position = i;
+		++named;
+	}
+	qsort (sorted, named, sizeof (KeyPosition), keyCompareByNamePosition);
+
+	size_t n = 0;
+	for (size_t i = 0; i < named;)
+	{
+		// of keys with the same name only the last one stays
+		size_t last = i;
+		while (last + 1 < named && !keyCompareByNameOwner (&sorted[last].key, &sorted[last + 1].key))
+		{
+			++last;
+		}
+		for (size_t j = i; j < last; ++j)
+		{
+			int again = sorted[j].key == sorted[last].key;
+			for (size_t k = i; k < j && !again; ++k)
+			{
+				again = sorted[k].key == sorted[j].key;
+			}
+			if (!again) keyDel (sorted[j].key);
+		}
+		keys[n++] = sorted[last].key;
+		i = last + 1;
+	}
+	elektraFree (sorted);
+
+	KeySet toAppend;
+	memset (&toAppend, 0, sizeof (KeySet));
+	toAppend.array = keys;
+	toAppend.size = n;
+	toAppend.alloc = n;
+	return ksAppend (ks, &toAppend);
 }
 
 
@@ -918,13 +1310,175 @@ ssize_t ksCopyInternal (KeySet * ks, size_t to, size_t from)
 
 	if (length < 0) return -1;
 	if (ks->size < to) return -1;
+	if (elektraKsUnshare (ks) == -1) return -1;
 
 	ks->size += sizediff;
 	ret = elektraMemmove (ks->array + to, ks->array + from, length);
 	ks->array[ks->size] = 0;
+	elektraKsHashInvalidate (ks);
 	return ret;
 }
 
+/**
+ * @internal
+ *
+ * A part of the array of a keyset, from start to end (exclusive).
+ */
+typedef struct
+{
+	size_t start;
+	size_t end;
+} KeySetRange;
+
+/**
+ * @internal
+ *
+ * The most ranges elektraKsFindBelow() returns:
+ * cascading keys and one range per namespace.
+ */
+#define ELEKTRA_KS_BELOW_RANGES 6
+
+/**
+ * @internal
+ *
+ * @brief Find the keys whose unescaped name starts with @p prefix.
+ *
+ * The keys are sorted by their unescaped names, so all keys starting
+ * with the same prefix are next to each other. If the prefix is a
+ * whole unescaped name, these are the key with this name and the
+ * keys below it. Both boundaries are found with a binary search.
+ *
+ * @param ks the keyset to search in
+ * @param prefix the start of the unescaped names
+ * @param size the size of @p prefix
+ *
+ * @return the range of the keys, empty if there is none
+ */
+static KeySetRange elektraKsFindPrefix (const KeySet * ks, const char * prefix, size_t size)
+{
+	KeySetRange range;
+	size_t left = 0;
+	size_t right = ks->size;
+
+	// the first key not sorted before the prefix
+	while (left < right)
+	{
+		const size_t middle = left + (right - left) / 2;
+		const Key * key = ks->array[middle];
+		const size_t common = key->keyUSize < size ? key->keyUSize : size;
+		const int cmp = memcmp (key->key + key->keySize, prefix, common);
+		if (cmp < 0 || (cmp == 0 && key->keyUSize < size))
+			left = middle + 1;
+		else
+			right = middle;
+	}
+	range.start = left;
+
+	// the first key after it not starting with the prefix
+	right = ks->size;
+	while (left < right)
+	{
+		const size_t middle = left + (right - left) / 2;
+		const Key * key = ks->array[middle];
+		if (key->keyUSize >= size && !memcmp (key->key + key->keySize, prefix, size))
+			left = middle + 1;
+		else
+			right = middle;
+	}
+	range.end = left;
+	return range;
+}
+
+/**
+ * @internal
+ *
+ * @brief Find the keys ksCut() cuts for @p parent.
+ *
+ * A cascading parent stands for the same name in every namespace, so
+ * the keys below or same as it in every namespace and the cascading
+ * keys below it are found.
+ *
+ * Cascading keys are also below a key of a namespace if they are below
+ * its name without namespace (see keyIsBelowOrSame()). For a parent
+ * with a namespace only the first keys below or same as it that are
+ * next to each other are found, as ksCut() always did: the cascading
+ * keys if there are some, together with the keys of the namespace
+ * only if no other key is between them.
+ *
+ * @param ks the keyset to search in
+ * @param parent the key to search the keys below, must have a name
+ * @param [out] ranges receives up to ELEKTRA_KS_BELOW_RANGES
+ *        ranges of keys, sorted by their position
+ *
+ * @return the number of non-empty ranges
+ */
+static size_t elektraKsFindBelow (const KeySet * ks, const Key * parent, KeySetRange * ranges)
+{
+	static const char * namespaces[] = { "spec", "proc", "dir", "user", "system" };
+	const char * uname = parent->key + parent->keySize;
+	size_t usize = parent->keyUSize;
+	size_t nrRanges = 0;
+
+	if (!ks->size) return 0;
+
+	if (parent->key[0] != '/')
+	{
+		ranges[nrRanges++] = elektraKsFindPrefix (ks, uname, usize);
+
+		// the name without namespace starts with the null byte of the namespace
+		const size_t nsSize = strlen (uname);
+		uname += nsSize;
+		usize -= nsSize;
+	}
+	else
+	{
+		char name[ELEKTRA_MAX_NAMESPACE_SIZE + usize];
+		for (size_t i = 0; i < sizeof (namespaces) / sizeof (namespaces[0]); ++i)
+		{
+			const size_t nsSize = strlen (namespaces[i]);
+			memcpy (name, namespaces[i], nsSize);
+			memcpy (name + nsSize, uname, usize);
+			ranges[nrRanges++] = elektraKsFindPrefix (ks, name, nsSize + usize);
+		}
+	}
+
+	// cascading keys are sorted first, only the keys strictly below count
+	if (ks->array[0]->key[0] == '/')
+	{
+		KeySetRange range = elektraKsFindPrefix (ks, uname, usize);
+		while (range.start < range.end && ks->array[range.start]->keyUSize == usize)
+		{
+			++range.start;
+		}
+		ranges[nrRanges++] = range;
+	}
+
+	// sort the ranges by their position and drop the empty ones
+	size_t nonEmpty = 0;
+	for (size_t i = 0; i < nrRanges; ++i)
+	{
+		if (ranges[i].start == ranges[i].end) continue;
+		KeySetRange range = ranges[i];
+		size_t pos = nonEmpty++;
+		for (; pos > 0 && ranges[pos - 1].start > range.start; --pos)
+		{
+			ranges[pos] = ranges[pos - 1];
+		}
+		ranges[pos] = range;
+	}
+
+	if (parent->key[0] != '/')
+	{
+		size_t adjacent = nonEmpty ? 1 : 0;
+		while (adjacent < nonEmpty && ranges[adjacent].start == ranges[adjacent - 1].end)
+		{
+			++adjacent;
+		}
+		nonEmpty = adjacent;
+	}
+	return nonEmpty;
+}
+
 /**
  * Cuts out a keyset at the cutpoint.
  *
@@ -935,6 +1489,9 @@ ssize_t ksCopyInternal (KeySet * ks, size_t to, size_t from)
  * If @p cutpoint is not found an empty keyset is returned and @p ks
  * is not changed.
  *
+ * The keys to cut are found with a binary search, the time needed
+ * mostly depends on the number of keys moved.
+ *
  * The cursor will stay at the same key as it was before.
  * If the cursor was inside the region of cut (moved)
  * keys, the cursor will be set to the key before
@@ -984,156 +1541,131 @@ ssize_t ksCopyInternal (KeySet * ks, size_t to, size_t from)
  */
 KeySet * ksCut (KeySet * ks, const Key * cutpoint)
 {
-	KeySet * returned = 0;
-	size_t found = 0;
-	size_t it = 0;
+	KeySetRange ranges[ELEKTRA_KS_BELOW_RANGES];
 	size_t newsize = 0;
-	int set_cursor = 0;
 
 	if (!ks) return 0;
 	if (!cutpoint) return 0;
+	if (!cutpoint->key) return 0;
 
-	char * name = cutpoint->key;
-	if (!name) return 0;
-	// if (strcmp(name, "")) return 0;
-
-	if (name[0] == '/')
+	const size_t nrRanges = elektraKsFindBelow (ks, cutpoint, ranges);
+	for (size_t i = 0; i < nrRanges; ++i)
 	{
-		Key * key = (Key *)cutpoint;
-		size_t size = key->keySize;
-		size_t usize = key->keyUSize;
-		size_t length = strlen (name) + ELEKTRA_MAX_NAMESPACE_SIZE;
-		char newname[length * 2];
+		newsize += ranges[i].end - ranges[i].start;
+	}
+
+	// we found nothing
+	if (newsize == 0) return ksNew (0, KS_END);
 
-		KeySet * ret = ksNew (0, KS_END);
+	if (elektraKsUnshare (ks) == -1) return 0;
+	KeySet * returned = ksNew (newsize, KS_END);
+	if (!returned) return 0;
 
-		for (elektraNamespace ns = KEY_NS_FIRST; ns <= KEY_NS_LAST; ++ns)
+	// the cursor stays at its key or moves to the key before the cut keys
+	int set_cursor = 0;
+	if (ks->cursor && ks->current < ks->size)
+	{
+		size_t removed = 0;
+		size_t current = ks->current + 1;
+		for (size_t i = 0; i < nrRanges && ks->current >= ranges[i].start; ++i)
 		{
-			int validNS = 1;
-			switch (ns)
+			if (ks->current < ranges[i].end)
 			{
-			case KEY_NS_SPEC:
-				strncpy (newname + 2, "spec", 4);
-				strcpy (newname + 6, name);
-				key->key = newname + 2;
-				key->keySize = length - 2;
-				if (!strcmp (name, "/")) key->keySize = 5;
-				elektraFinalizeName (key);
-				break;
-			case KEY_NS_PROC:
-				strncpy (newname + 2, "proc", 4);
-				strcpy (newname + 6, name);
-				key->key = newname + 2;
-				key->keySize = length - 2;
-				if (!strcmp (name, "/")) key->keySize = 5;
-				elektraFinalizeName (key);
-				break;
-			case KEY_NS_DIR:
-				strncpy (newname + 3, "dir", 3);
-				strcpy (newname + 6, name);
-				key->key = newname + 3;
-				key->keySize = length - 3;
-				if (!strcmp (name, "/")) key->keySize = 4;
-				elektraFinalizeName (key);
+				// move to the key before the cut keys
+				current = ranges[i].start;
 				break;
-			case KEY_NS_USER:
-				strncpy (newname + 2, "user", 4);
-				strcpy (newname + 6, name);
-				key->key = newname + 2;
-				key->keySize = length - 2;
-				if (!strcmp (name, "/")) key->keySize = 5;
-				elektraFinalizeName (key);
-				break;
-			case KEY_NS_SYSTEM:
-				strncpy (newname, "system", 6);
-				strcpy (newname + 6, name);
-				key->key = newname;
-				key->keySize = length;
-				if (!strcmp (name, "/")) key->keySize = 7;
-				elektraFinalizeName (key);
-				break;
-			case KEY_NS_EMPTY:
-			case KEY_NS_NONE:
-			case KEY_NS_META:
-			case KEY_NS_CASCADING:
-				validNS = 0;
-			}
-			if (validNS)
-			{
-				KeySet * n = ksCut (ks, key);
-				ksAppend (ret, n);
-				ksDel (n);
 			}
+			removed += ranges[i].end - ranges[i].start;
 		}
 
-		// restore old cascading name
-		key->key = name;
-		key->keySize = size;
-		key->keyUSize = usize;
-		return ret;
-	}
-
-	// search the cutpoint
-	while (it < ks->size && keyIsBelowOrSame (cutpoint, ks->array[it]) == 0)
-	{
-		++it;
-	}
-
-	// we found nothing
-	if (it == ks->size) return ksNew (0, KS_END);
-
-	// we found the cutpoint
-	found = it;
-
-	// search the end of the keyset to cut
-	while (it < ks->size && keyIsBelowOrSame (cutpoint, ks->array[it]) == 1)
-	{
-		++it;
-	}
-
-	// correct cursor if cursor is in cutted keyset
-	if (ks->current >= found && ks->current < it)
-	{
-		if (found == 0)
+		// there is no key before
+		if (current == removed)
 		{
 			ksRewind (ks);
 		}
 		else
 		{
-			ks->current = found - 1;
+			ks->current = current - removed - 1;
 			set_cursor = 1;
 		}
 	}
+	else if (ks->cursor)
+	{
+		ksRewind (ks);
+	}
 
-	// correct the cursor for the keys after the cutted keyset
-	if (ks->current >= it)
+	size_t to = ranges[0].start;
+	for (size_t i = 0; i < nrRanges; ++i)
 	{
-		if (it >= ks->size)
-		{
-			ksRewind (ks);
-		}
-		else
-		{
-			ks->current = found + ks->current - it;
-			set_cursor = 1;
-		}
+		const size_t size = ranges[i].end - ranges[i].start;
+		const size_t until = i + 1 < nrRanges ? ranges[i + 1].start : ks->size;
+		elektraMemcpy (returned->array + returned->size, ks->array + ranges[i].start, size);
+		returned->size += size;
+		elektraMemmove (ks->array + to, ks->array + ranges[i].end, until - ranges[i].end);
+		to += until - ranges[i].end;
 	}
+	returned->array[returned->size] = 0;
+	ks->size = to;
+	ks->array[ks->size] = 0;
+	elektraKsHashInvalidate (ks);
 
-	newsize = it - found;
+	if (set_cursor) ks->cursor = ks->array[ks->current];
 
-	returned = ksNew (newsize, KS_END);
-	elektraMemcpy (returned->array, ks->array + found, newsize);
-	returned->size = newsize;
-	returned->array[returned->size] = 0;
+	return returned;
+}
+
+/**
+ * Returns the keys below a key, without modifying @p ks.
+ *
+ * The returned keyset contains the same keys as the one returned by
+ * ksCut() with @p parent as cutpoint, but @p ks keeps them. The keys
+ * are found with a binary search and not copied, only referenced by
+ * the returned keyset. If all keys of @p ks are below @p parent, the
+ * returned keyset shares the array of @p ks as by ksDup().
+ *
+ * @param ks the keyset to search in
+ * @param parent the key whose subtree should be returned,
+ *        the key itself is included if it is in @p ks
+ *
+ * @return a new keyset, which needs to deleted with ksDel()
+ * @retval 0 on null pointers, no key name or allocation problems
+ * @see ksCut() to remove the keys from @p ks
+ * @ingroup proposal
+ */
+KeySet * ksBelow (KeySet * ks, const Key * parent)
+{
+	KeySetRange ranges[ELEKTRA_KS_BELOW_RANGES];
+
+	if (!ks) return 0;
+	if (!parent) return 0;
+	if (!parent->key) return 0;
 
-	if (ksCopyInternal (ks, found, it) == -1)
+	const size_t nrRanges = elektraKsFindBelow (ks, parent, ranges);
+	if (nrRanges == 1 && ranges[0].start == 0 && ranges[0].end == ks->size)
 	{
-		ELEKTRA_ASSERT (0 && "ksCopyInternal returned an error inside ksCut");
+		KeySet * below = ksDup (ks);
+		if (below) ksRewind (below);
+		return below;
 	}
 
-	if (set_cursor) ks->cursor = ks->array[ks->current];
+	size_t size = 0;
+	for (size_t i = 0; i < nrRanges; ++i)
+	{
+		size += ranges[i].end - ranges[i].start;
+	}
 
-	return returned;
+	KeySet * below = ksNew (size, KS_END);
+	if (!below) return 0;
+	for (size_t i = 0; i < nrRanges; ++i)
+	{
+		for (size_t k = ranges[i].start; k < ranges[i].end; ++k)
+		{
+			keyIncRef (ks->array[k]);
+			below->array[below->size++] = ks->array[k];
+		}
+	}
+	below->array[below->size] = 0;
+	return below;
 }
 
 
@@ -1184,7 +1716,9 @@ Key * ksPop (KeySet * ks)
 	ks->flags |= KS_FLAG_SYNC;
 
 	if (ks->size <= 0) return 0;
+	if (elektraKsUnshare (ks) == -1) return 0;
 
+	elektraKsHashInvalidate (ks);
 	--ks->size;
 	if (ks->size + 1 < ks->alloc / 2) ksResize (ks, ks->alloc / 2 - 1);
 	ret = ks->array[ks->size];
@@ -1258,6 +1792,8 @@ Key * ksNext (KeySet * ks)
 	}
 
 	if (ks->cursor) ks->current++;
+	// views (see ksBelow()) have no null pointer after the last key
+	if (ks->current == ks->size) return ks->cursor = 0;
 	return ks->cursor = ks->array[ks->current];
 }
 
@@ -1425,7 +1961,7 @@ Key * ksAtCursor (KeySet * ks, cursor_t pos)
 {
 	if (!ks) return 0;
 	if (pos < 0) return 0;
-	if (ks->size < (size_t)pos) return 0;
+	if (ks->size <= (size_t)pos) return 0;
 	return ks->array[pos];
 }
 
@@ -1471,7 +2007,7 @@ int ksSetCursor (KeySet * ks, cursor_t cursor)
 		return 0;
 	}
 	ks->current = (size_t)cursor;
-	ks->cursor = ks->array[ks->current];
+	ks->cursor = ks->current < ks->size ? ks->array[ks->current] : 0;
 	return 1;
 }
 
@@ -1706,6 +2242,61 @@ finished:
 	return ret;
 }
 
+/**
+ * @internal
+ * @brief Helper for elektraLookupByCascading
+ *
+ * Lookup following the specification found for a cascading key.
+ */
+static Key * elektraLookupBySpecKey (KeySet * ks, Key * key, const Key * specKey, option_t options)
+{
+	Key * found = 0;
+	Key * dup = keyDup (specKey);
+	keySetBinary (dup, keyValue (key), keyGetValueSize (key));
+	elektraCopyCallbackMeta (dup, key);
+	found = elektraLookupBySpec (ks, dup, options);
+	elektraCopyCallbackMeta (key, dup);
+	keyDel (dup);
+	return found;
+}
+
+/**
+ * @internal
+ * @brief Helper for elektraLookupByCascading
+ *
+ * Picks the key of a cascading lookup from the positions found in
+ * the cascading part of the hash index, without the spec key.
+ *
+ * @param pos the positions from elektraKsHashLookupCascading()
+ */
+static Key * elektraLookupCascadingPositions (KeySet * ks, const size_t * pos, option_t options)
+{
+	size_t found = 0;
+	for (size_t i = 2; !found && i < KEY_LOOKUP_NAMESPACES + 1; ++i)
+	{
+		found = pos[i];
+	}
+	if (!found && !(options & KDB_O_NODEFAULT)) found = pos[0];
+	if (!found) return 0;
+
+	ksSetCursor (ks, found - 1);
+	return ks->array[found - 1];
+}
+
+/**
+ * @internal
+ * @brief Checks if a cascading lookup can use the cascading part of the hash index
+ *
+ * Lookups with options or callbacks which need the keys of every
+ * namespace to be searched one by one cannot use it.
+ */
+static int elektraLookupCascadingIndexUsable (KeySet * ks, Key * key, option_t options)
+{
+	if (options & (KDB_O_POP | KDB_O_NOALL | KDB_O_WITHOWNER | KDB_O_NOCASE)) return 0;
+	if (keyGetMeta (key, "callback")) return 0;
+	return elektraKsHashCascadingUsable (ks);
+}
+
 /**
  * @internal
  * @brief Helper for ksLookup
@@ -1720,6 +2311,19 @@ static Key * elektraLookupByCascading (KeySet * ks, Key * key, option_t options)
 	Key * found = 0;
 	Key * specKey = 0;
 
+	if (elektraLookupCascadingIndexUsable (ks, key, options))
+	{
+		// a single probe finds the keys in all namespaces
+		const size_t * pos = elektraKsHashLookupCascading (ks, key, elektraKsHashName (key));
+		if (!pos) return 0;
+		if (!(options & KDB_O_NOSPEC) && pos[1])
+		{
+			ksSetCursor (ks, pos[1] - 1);
+			return elektraLookupBySpecKey (ks, key, ks->array[pos[1] - 1], options);
+		}
+		return elektraLookupCascadingPositions (ks, pos, options);
+	}
+
 	if (!(options & KDB_O_NOSPEC))
 	{
 		strncpy (newname + 2, "spec", 4);
@@ -1743,13 +2347,7 @@ static Key * elektraLookupByCascading (KeySet * ks, Key * key, option_t options)
 		}
 
 		// we found a spec key, so we know what to do
-		specKey = keyDup (specKey);
-		keySetBinary (specKey, keyValue (key), keyGetValueSize (key));
-		elektraCopyCallbackMeta (specKey, key);
-		found = elektraLookupBySpec (ks, specKey, options);
-		elektraCopyCallbackMeta (key, specKey);
-		keyDel (specKey);
-		return found;
+		return elektraLookupBySpecKey (ks, key, specKey, options);
 	}
 
 	// default cascading:
@@ -1870,6 +2468,31 @@ static Key * elektraLookupBinarySearch (KeySet * ks, Key const * key, option_t o
 	return 0;
 }
 
+/**
+ * @internal
+ * @brief Lookup using the hash index of the keyset
+ *
+ * Same semantics as elektraLookupBinarySearch() without
+ * ::KDB_O_WITHOWNER and ::KDB_O_NOCASE.
+ *
+ * @param hash the hash of the name of @p key, see elektraKsHashName()
+ *
+ * @pre elektraKsHashUsable() returned 1
+ */
+static Key * elektraLookupHashSearch (KeySet * ks, Key const * key, size_t hash, option_t options)
+{
+	ssize_t pos = elektraKsHashLookup (ks, key, hash);
+	if (pos < 0) return 0;
+
+	if (options & KDB_O_POP)
+	{
+		return elektraKsPopAtCursor (ks, pos);
+	}
+
+	ksSetCursor (ks, pos);
+	return ks->array[pos];
+}
+
 /**
  * @brief Process Callback + maps to correct binary/hashmap search
  *
@@ -1883,7 +2506,12 @@ static Key * elektraLookupSearch (KeySet * ks, Key * key, option_t options)
 		void * v;
 	} conversation;
 
-	Key * found = elektraLookupBinarySearch (ks, key, options);
+	Key * found = 0;
+
+	if (!(options & (KDB_O_WITHOWNER | KDB_O_NOCASE)) && elektraKsHashUsable (ks))
+		found = elektraLookupHashSearch (ks, key, elektraKsHashName (key), options);
+	else
+		found = elektraLookupBinarySearch (ks, key, options);
 
 	Key * ret = found;
 
@@ -1923,6 +2551,13 @@ static Key * elektraLookupCreateKey (KeySet * ks, Key * key, ELEKTRA_UNUSED opti
  *
  * @snippet kdbget.c basic usage
  *
+ * @note If many lookups are done in a large keyset, a hash index
+ * is built, so that further lookups (without ::KDB_O_NOCASE and
+ * ::KDB_O_WITHOWNER) are done in constant time. This includes
+ * cascading lookups, which find the keys of all namespaces at once.
+ * Appending keys at the end keeps the index, other modifications
+ * invalidate it.
+ *
  * This is the way programs should get their configuration and
  * search after the values. It is guaranteed that more namespaces can be
  * added easily and that all values can be set by admin and user.
@@ -2132,6 +2767,166 @@ Key * ksLookupByName (KeySet * ks, const char * name, option_t options)
 	return found;
 }
 
+/**
+ * @brief Compile a name for repeated lookups with ksLookupCompiled().
+ *
+ * ksLookupByName() canonicalizes and unescapes the name on every call
+ * and, if it is cascading, builds its name in every namespace again.
+ * A compiled lookup does this once, so that a lookup with it neither
+ * allocates nor parses the name.
+ *
+ * @code
+KeyLookup * lookup = elektraKeyLookupNew ("/sw/tests/myapp/#0/current/key");
+for (;;)
+{
+	Key * key = ksLookupCompiled (myConfig, lookup, 0);
+	// ...
+}
+elektraKeyLookupDel (lookup);
+ * @endcode
+ *
+ * @param name the name to look up, as passed to ksLookupByName()
+ * @return the compiled lookup, to be freed with elektraKeyLookupDel()
+ * @retval 0 if the name is invalid or on memory error
+ * @see ksLookupCompiled()
+ */
+KeyLookup * elektraKeyLookupNew (const char * name)
+{
+	static const char * namespaces[KEY_LOOKUP_NAMESPACES] = { "spec", "proc", "dir", "user", "system" };
+
+	if (!name) return 0;
+
+	KeyLookup * lookup = elektraCalloc (sizeof (KeyLookup));
+	if (!lookup) return 0;
+
+	lookup->names[0] = keyNew (0, KEY_END);
+	lookup->nrNames = 1;
+	if (!lookup->names[0] || elektraKeySetName (lookup->names[0], name, KEY_META_NAME | KEY_CASCADING_NAME) == -1) goto error;
+
+	const char * canonical = keyName (lookup->names[0]);
+	if (canonical[0] == '/')
+	{
+		for (size_t i = 0; i < KEY_LOOKUP_NAMESPACES; ++i)
+		{
+			char * namespaceName = elektraFormat ("%s%s", namespaces[i], canonical);
+			lookup->names[lookup->nrNames] = keyNew (namespaceName, KEY_END);
+			elektraFree (namespaceName);
+			if (!lookup->names[lookup->nrNames]) goto error;
+			++lookup->nrNames;
+		}
+	}
+
+	for (size_t i = 0; i < lookup->nrNames; ++i)
+	{
+		// ksLookup() must not rename them in place
+		elektraKeyLock (lookup->names[i], KEY_LOCK_NAME);
+		lookup->hashes[i] = elektraKsHashName (lookup->names[i]);
+	}
+	return lookup;
+
+error:
+	elektraKeyLookupDel (lookup);
+	return 0;
+}
+
+/**
+ * @brief Free a lookup compiled with elektraKeyLookupNew().
+ *
+ * @param lookup the compiled lookup
+ * @retval 0 on success
+ * @retval -1 on NULL pointer
+ */
+int elektraKeyLookupDel (KeyLookup * lookup)
+{
+	if (!lookup) return -1;
+
+	for (size_t i = 0; i < lookup->nrNames; ++i)
+	{
+		keyDel (lookup->names[i]);
+	}
+	elektraFree (lookup);
+	return 0;
+}
+
+/**
+ * @internal
+ * @brief Exact search for a name of a compiled lookup
+ */
+static Key * elektraLookupCompiledSearch (KeySet * ks, const KeyLookup * lookup, size_t i, option_t options)
+{
+	if (elektraKsHashUsable (ks)) return elektraLookupHashSearch (ks, lookup->names[i], lookup->hashes[i], options);
+	return elektraLookupBinarySearch (ks, lookup->names[i], options);
+}
+
+/**
+ * @brief Look for a Key contained in @p ks with the name of a compiled lookup.
+ *
+ * Gives the same result as ksLookupByName() with the name passed to
+ * elektraKeyLookupNew(), but without allocations: the names to search
+ * for are already unescaped and hashed. Cascading names are found in
+ * all namespaces with a single probe of the hash index of the keyset,
+ * or, as long as it has none, searched in spec, proc, dir, user and
+ * system one after the other.
+ *
+ * Only if a spec key is found, or with the options ::KDB_O_NOALL,
+ * ::KDB_O_SPEC, ::KDB_O_CREATE, ::KDB_O_WITHOWNER and ::KDB_O_NOCASE
+ * (and ::KDB_O_POP for cascading names), ksLookup() is used
+ * instead, which allocates as before.
+ *
+ * @param ks where to look for
+ * @param lookup the name compiled with elektraKeyLookupNew()
+ * @param options some @p KDB_O_* option bits, see ksLookup(),
+ *        ::KDB_O_DEL is ignored
+ *
+ * @return pointer to the Key found, 0 otherwise
+ * @retval 0 on NULL pointers
+ * @see ksLookupByName()
+ */
+Key * ksLookupCompiled (KeySet * ks, const KeyLookup * lookup, option_t options)
+{
+	const option_t exact = KDB_O_POP | KDB_O_NOCASCADING | KDB_O_NOSPEC | KDB_O_NODEFAULT;
+
+	if (!ks) return 0;
+	if (!lookup) return 0;
+
+	if (!ks->size) return 0;
+
+	options &= ~KDB_O_DEL;
+	const int cascading = lookup->nrNames > 1 && !(options & KDB_O_NOCASCADING);
+	if ((options & ~exact) || (cascading && (options & KDB_O_POP)))
+	{
+		return ksLookup (ks, lookup->names[0], options);
+	}
+
+	if (!cascading) return elektraLookupCompiledSearch (ks, lookup, 0, options);
+
+	if (elektraKsHashCascadingUsable (ks))
+	{
+		const size_t * pos = elektraKsHashLookupCascading (ks, lookup->names[0], lookup->hashes[0]);
+		if (!pos) return 0;
+		if (!(options & KDB_O_NOSPEC) && pos[1]) return ksLookup (ks, lookup->names[0], options);
+		return elektraLookupCascadingPositions (ks, pos, options);
+	}
+
+	if (!(options & KDB_O_NOSPEC) && elektraLookupCompiledSearch (ks, lookup, 1, options))
+	{
+		// follow the specification
+		return ksLookup (ks, lookup->names[0], options);
+	}
+
+	Key * found = 0;
+	for (size_t i = 2; !found && i < lookup->nrNames; ++i)
+	{
+		found = elektraLookupCompiledSearch (ks, lookup, i, options);
+	}
+
+	if (!found && !(options & KDB_O_NODEFAULT))
+	{
+		found = elektraLookupCompiledSearch (ks, lookup, 0, options);
+	}
+	return found;
+}
+
 
 /*
  * Lookup for a Key contained in @p ks KeySet that matches @p value,
@@ -2299,6 +3094,7 @@ Key * ksLookupByBinary (KeySet * ks, const void * value, size_t size, option_t o
 int ksResize (KeySet * ks, size_t alloc)
 {
 	if (!ks) return -1;
+	if (elektraKsUnshare (ks) == -1) return -1;
 
 	alloc++; /* for ending null byte */
 	if (alloc == ks->alloc) return 1;
@@ -2315,7 +3111,7 @@ int ksResize (KeySet * ks, size_t alloc)
 	{ /* Not allocated up to now */
 		ks->alloc = alloc;
 		ks->size = 0;
-		ks->array = elektraMalloc (sizeof (struct _Key *) * ks->alloc);
+		ks->array = elektraKsArrayNew (ks->alloc);
 		if (!ks->array)
 		{
 			/*errno = KDB_ERR_NOMEM;*/
@@ -2330,12 +3126,12 @@ int ksResize (KeySet * ks, size_t alloc)
 	ks->alloc = alloc;
 
 
-	if (elektraRealloc ((void **)&ks->array, sizeof (struct _Key *) * ks->alloc) == -1)
+	if (elektraKsArrayResize (&ks->array, ks->alloc) == -1)
 	{
 #if DEBUG
 		fprintf (stderr, "Reallocation error\n");
 #endif
-		elektraFree (ks->array);
+		elektraKsArrayRelease (ks->array);
 		ks->array = 0;
 		/*errno = KDB_ERR_NOMEM;*/
 		return -1;
@@ -2382,6 +3178,13 @@ int ksInit (KeySet * ks)
 	ks->alloc = 0;
 	ks->flags = 0;
 
+	ks->hash.slots = 0;
+	ks->hash.cascading = 0;
+	ks->hash.alloc = 0;
+	ks->hash.lookups = 0;
+
+	ks->arena = 0;
+
 	ksRewind (ks);
 
 	return 1;
@@ -2398,21 +3201,18 @@ int ksInit (KeySet * ks)
  */
 int ksClose (KeySet * ks)
 {
-	Key * k;
-
+	elektraKsArrayDel (ks->array, ks->size);
 	ksRewind (ks);
-	while ((k = ksNext (ks)) != 0)
-	{
-		keyDecRef (k);
-		keyDel (k);
-	}
-
-	if (ks->array) elektraFree (ks->array);
 	ks->array = 0;
 	ks->alloc = 0;
 
 	ks->size = 0;
 
+	elektraKsHashClose (ks);
+
+	elektraKeyArenaDel (ks->arena);
+	ks->arena = 0;
+
 	return 0;
 }
 
@@ -0,0 +1,426 @@
+/**
+ * @file
+ *
+ * @brief Hash index for exact lookups in key sets.
+ *
+ * @copyright BSD License (see doc/COPYING or http://www.libelektra.org)
+ */
+
+#ifdef HAVE_KDBCONFIG_H
+#include "kdbconfig.h"
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include "kdbinternal.h"
+
+/**
+ * @internal
+ *
+ * A slot of the open addressing table.
+ *
+ * The position is stored one-based, so that zeroed
+ * slots are empty.
+ */
+struct _KeySetHashSlot
+{
+	size_t hash; /**< The hash of the unescaped name */
+	size_t pos;  /**< Position of the key in the array + 1 */
+};
+
+/**
+ * @internal
+ *
+ * A slot of the cascading part of the index.
+ *
+ * The positions are stored one-based as in _KeySetHashSlot, in the
+ * order of the names of a KeyLookup: the cascading key, then the
+ * keys in spec, proc, dir, user and system.
+ */
+struct _KeySetCascadingSlot
+{
+	size_t hash;				  /**< The hash of the unescaped name without namespace */
+	size_t pos[KEY_LOOKUP_NAMESPACES + 1]; /**< Positions of the keys in the array + 1 */
+};
+
+/**
+ * @internal
+ *
+ * FNV-1a over the unescaped name, the same bytes
+ * keyCompareByName() uses.
+ *
+ * @param key the key whose name should be hashed
+ * @return the hash to be passed to elektraKsHashLookup()
+ */
+size_t elektraKsHashName (const Key * key)
+{
+	const unsigned char * name = (const unsigned char *)key->key + key->keySize;
+	size_t hash = (size_t)14695981039346656037ULL;
+	for (size_t i = 0; i < key->keyUSize; ++i)
+	{
+		hash ^= name[i];
+		hash *= (size_t)1099511628211ULL;
+	}
+	return hash;
+}
+
+static int elektraKsHashEqual (const Key * key1, const Key * key2)
+{
+	return key1->keyUSize == key2->keyUSize && !memcmp (key1->key + key1->keySize, key2->key + key2->keySize, key1->keyUSize);
+}
+
+/**
+ * @internal
+ *
+ * Find the namespace of an unescaped name.
+ *
+ * @param [out] size the size of the namespace, the name without
+ *        namespace starts there
+ * @return the index of the namespace in _KeySetCascadingSlot::pos
+ * @retval -1 if the name is not in a namespace a cascading lookup searches
+ */
+static int elektraKsHashNamespace (const Key * key, size_t * size)
+{
+	static const char * namespaces[KEY_LOOKUP_NAMESPACES + 1] = { "", "spec", "proc", "dir", "user", "system" };
+	const char * name = key->key + key->keySize;
+
+	if (!key->keyUSize) return -1;
+	*size = strlen (name);
+	for (int i = 0; i < KEY_LOOKUP_NAMESPACES + 1; ++i)
+	{
+		if (!strcmp (name, namespaces[i])) return i;
+	}
+	return -1;
+}
+
+/**
+ * @internal
+ *
+ * Same as elektraKsHashName(), but without the namespace.
+ */
+static size_t elektraKsHashCascadingName (const Key * key, size_t size)
+{
+	const unsigned char * name = (const unsigned char *)key->key + key->keySize;
+	size_t hash = (size_t)14695981039346656037ULL;
+	for (size_t i = size; i < key->keyUSize; ++i)
+	{
+		hash ^= name[i];
+		hash *= (size_t)1099511628211ULL;
+	}
+	return hash;
+}
+
+/**
+ * @internal
+ *
+ * Compare a name without namespace with the name of a key
+ * without its namespace.
+ */
+static int elektraKsHashCascadingEqual (const char * name, size_t size, const Key * key)
+{
+	size_t keySize;
+	if (elektraKsHashNamespace (key, &keySize) == -1) return 0;
+	return key->keyUSize - keySize == size && !memcmp (name, key->key + key->keySize + keySize, size);
+}
+
+static struct _KeySetCascadingSlot * elektraKsHashCascadingFind (const KeySet * ks, const char * name, size_t size, size_t h)
+{
+	size_t mask = ks->hash.alloc - 1;
+	size_t i = h & mask;
+
+	while (1)
+	{
+		struct _KeySetCascadingSlot * slot = &ks->hash.cascading[i];
+		size_t any = 0;
+		for (size_t j = 0; !any && j < KEY_LOOKUP_NAMESPACES + 1; ++j)
+		{
+			any = slot->pos[j];
+		}
+		if (!any || (slot->hash == h && elektraKsHashCascadingEqual (name, size, ks->array[any - 1]))) return slot;
+		i = (i + 1) & mask;
+	}
+}
+
+static void elektraKsHashCascadingPut (KeySet * ks, size_t pos)
+{
+	size_t size;
+	const Key * key = ks->array[pos];
+	int ns = elektraKsHashNamespace (key, &size);
+	if (ns == -1) return;
+
+	size_t h = elektraKsHashCascadingName (key, size);
+	struct _KeySetCascadingSlot * slot = elektraKsHashCascadingFind (ks, key->key + key->keySize + size, key->keyUSize - size, h);
+	slot->hash = h;
+	slot->pos[ns] = pos + 1;
+}
+
+/**
+ * @internal
+ *
+ * Builds the cascading part of the index for all keys of @p ks.
+ *
+ * @pre the index was built for the current size of @p ks
+ *
+ * @retval 1 on success
+ * @retval 0 on memory error (the cascading part stays invalid)
+ */
+static int elektraKsHashBuildCascading (KeySet * ks)
+{
+	if (!ks->hash.cascading)
+	{
+		ks->hash.cascading = elektraCalloc (ks->hash.alloc * sizeof (struct _KeySetCascadingSlot));
+		if (!ks->hash.cascading) return 0;
+	}
+	else
+	{
+		memset (ks->hash.cascading, 0, ks->hash.alloc * sizeof (struct _KeySetCascadingSlot));
+	}
+
+	for (size_t i = 0; i < ks->size; ++i)
+	{
+		elektraKsHashCascadingPut (ks, i);
+	}
+	return 1;
+}
+
+static void elektraKsHashPut (KeySetHash * hash, size_t h, size_t pos)
+{
+	size_t mask = hash->alloc - 1;
+	size_t i = h & mask;
+	while (hash->slots[i].pos)
+	{
+		i = (i + 1) & mask;
+	}
+	hash->slots[i].hash = h;
+	hash->slots[i].pos = pos + 1;
+}
+
+/**
+ * @internal
+ *
+ * Builds the index for all keys of @p ks.
+ *
+ * The table is kept at most half full, the array of slots is reused
+ * if it is already large enough.
+ *
+ * @retval 1 on success
+ * @retval 0 on memory error (the index stays invalid)
+ */
+static int elektraKsHashBuild (KeySet * ks)
+{
+	size_t alloc = KEYSET_HASH_SIZE * 2;
+	while (alloc <= ks->size * 2)
+	{
+		alloc *= 2;
+	}
+
+	if (alloc > ks->hash.alloc || !ks->hash.slots)
+	{
+		if (ks->hash.slots) elektraFree (ks->hash.slots);
+		if (ks->hash.cascading) elektraFree (ks->hash.cascading);
+		ks->hash.cascading = 0;
+		ks->hash.slots = elektraCalloc (alloc * sizeof (struct _KeySetHashSlot));
+		if (!ks->hash.slots)
+		{
+			ks->hash.alloc = 0;
+			return 0;
+		}
+		ks->hash.alloc = alloc;
+	}
+	else
+	{
+		memset (ks->hash.slots, 0, ks->hash.alloc * sizeof (struct _KeySetHashSlot));
+	}
+
+	for (size_t i = 0; i < ks->size; ++i)
+	{
+		elektraKsHashPut (&ks->hash, elektraKsHashName (ks->array[i]), i);
+	}
+	return 1;
+}
+
+/**
+ * @internal
+ *
+ * Decides if the hash index should be used for a lookup in @p ks.
+ *
+ * Small keysets are always searched binary. For larger ones the
+ * index is only built when the binary searches done since it was
+ * invalidated (each roughly log2(size) comparisons) would have paid
+ * for building it. So keysets which are modified between every few
+ * lookups do not rebuild the index all the time.
+ *
+ * @param ks the keyset to search in
+ * @retval 1 if elektraKsHashLookup() can be used
+ * @retval 0 if a binary search should be done
+ */
+int elektraKsHashUsable (KeySet * ks)
+{
+	if (test_bit (ks->flags, KS_FLAG_HASH)) return 1;
+	if (ks->size < KEYSET_HASH_SIZE) return 0;
+
+	++ks->hash.lookups;
+	if (ks->hash.lookups * 16 < ks->size) return 0;
+
+	ks->hash.lookups = 0;
+	if (!elektraKsHashBuild (ks)) return 0;
+
+	set_bit (ks->flags, KS_FLAG_HASH);
+	return 1;
+}
+
+/**
+ * @internal
+ *
+ * Search for the key with the same name as @p key in the hash index.
+ *
+ * @pre elektraKsHashUsable() returned 1
+ *
+ * @param ks the keyset to search in
+ * @param key the key with the name to search for
+ * @param h the hash of the name, see elektraKsHashName()
+ * @return the position of the key in the array
+ * @retval -1 if no such key is in @p ks
+ */
+ssize_t elektraKsHashLookup (const KeySet * ks, const Key * key, size_t h)
+{
+	size_t mask = ks->hash.alloc - 1;
+	size_t i = h & mask;
+
+	while (ks->hash.slots[i].pos)
+	{
+		const struct _KeySetHashSlot * slot = &ks->hash.slots[i];
+		if (slot->hash == h && elektraKsHashEqual (key, ks->array[slot->pos - 1]))
+		{
+			return slot->pos - 1;
+		}
+		i = (i + 1) & mask;
+	}
+	return -1;
+}
+
+/**
+ * @internal
+ *
+ * Decides if the cascading part of the hash index should be used
+ * for a cascading lookup in @p ks.
+ *
+ * The decision is the same as with elektraKsHashUsable(), the
+ * cascading part is then built with the first cascading lookup.
+ *
+ * @param ks the keyset to search in
+ * @retval 1 if elektraKsHashLookupCascading() can be used
+ * @retval 0 if the namespaces should be searched one by one
+ */
+int elektraKsHashCascadingUsable (KeySet * ks)
+{
+	if (!elektraKsHashUsable (ks)) return 0;
+	if (test_bit (ks->flags, KS_FLAG_CASCADING)) return 1;
+
+	if (!elektraKsHashBuildCascading (ks)) return 0;
+
+	set_bit (ks->flags, KS_FLAG_CASCADING);
+	return 1;
+}
+
+/**
+ * @internal
+ *
+ * Search for the keys with the name of a cascading key in all
+ * namespaces in the cascading part of the hash index.
+ *
+ * @pre elektraKsHashCascadingUsable() returned 1
+ *
+ * @param ks the keyset to search in
+ * @param key the cascading key with the name to search for
+ * @param h the hash of the name, see elektraKsHashName()
+ * @return the positions + 1 of the cascading key and the keys in
+ *         spec, proc, dir, user and system, 0 for missing keys
+ * @retval 0 if no such key is in @p ks
+ */
+const size_t * elektraKsHashLookupCascading (const KeySet * ks, const Key * key, size_t h)
+{
+	const struct _KeySetCascadingSlot * slot = elektraKsHashCascadingFind (ks, key->key + key->keySize, key->keyUSize, h);
+	for (size_t j = 0; j < KEY_LOOKUP_NAMESPACES + 1; ++j)
+	{
+		if (slot->pos[j]) return slot->pos;
+	}
+	return 0;
+}
+
+/**
+ * @internal
+ *
+ * Update the index after a key was inserted at @p pos.
+ *
+ * Only appending at the end can be done incrementally (the
+ * index grows if needed), insertion anywhere else shifts the
+ * positions of following keys and invalidates the index.
+ *
+ * @param ks the keyset where the key was inserted
+ * @param pos the position of the new key
+ */
+void elektraKsHashInsert (KeySet * ks, size_t pos)
+{
+	if (!test_bit (ks->flags, KS_FLAG_HASH))
+	{
+		ks->hash.lookups = 0;
+		return;
+	}
+
+	if (pos != ks->size - 1)
+	{
+		elektraKsHashInvalidate (ks);
+		return;
+	}
+
+	if (ks->size * 2 > ks->hash.alloc)
+	{
+		// grow, the index was already worth to be built
+		if (!elektraKsHashBuild (ks) || (test_bit (ks->flags, KS_FLAG_CASCADING) && !elektraKsHashBuildCascading (ks)))
+		{
+			elektraKsHashInvalidate (ks);
+		}
+		return;
+	}
+
+	elektraKsHashPut (&ks->hash, elektraKsHashName (ks->array[pos]), pos);
+	if (test_bit (ks->flags, KS_FLAG_CASCADING)) elektraKsHashCascadingPut (ks, pos);
+}
+
+/**
+ * @internal
+ *
+ * Mark the index as outdated.
+ *
+ * The slots are kept so that a rebuild does not need to allocate.
+ *
+ * @param ks the keyset whose array was changed
+ */
+void elektraKsHashInvalidate (KeySet * ks)
+{
+	clear_bit (ks->flags, KS_FLAG_HASH);
+	clear_bit (ks->flags, KS_FLAG_CASCADING);
+	ks->hash.lookups = 0;
+}
+
+/**
+ * @internal
+ *
+ * Free the index.
+ *
+ * @param ks the keyset which gets closed
+ */
+void elektraKsHashClose (KeySet * ks)
+{
+	clear_bit (ks->flags, KS_FLAG_HASH);
+	clear_bit (ks->flags, KS_FLAG_CASCADING);
+	if (ks->hash.slots) elektraFree (ks->hash.slots);
+	if (ks->hash.cascading) elektraFree (ks->hash.cascading);
+	ks->hash.slots = 0;
+	ks->hash.cascading = 0;
+	ks->hash.alloc = 0;
+	ks->hash.lookups = 0;
+}
@@ -511,17 +511,26 @@ ssize_t keySetRaw (Key * key, const void * newBinary, size_t dataSize)
 
 	if (!dataSize || !newBinary)
 	{
-		if (key->data.v)
-		{
-			elektraFree (key->data.v);
-			key->data.v = 0;
-		}
+		elektraKeyFreeValue (key);
 		key->dataSize = 0;
 		set_bit (key->flags, KEY_FLAG_SYNC);
 		if (keyIsBinary (key)) return 0;
 		return 1;
 	}
 
+	if (test_bit (key->flags, KEY_FLAG_MMAP_DATA))
+	{
+		// copy on write, newBinary might point into the region
+		char * p = elektraMalloc (dataSize);
+		if (0 == p) return -1;
+		memcpy (p, newBinary, dataSize);
+		elektraKeyFreeValue (key);
+		key->data.v = p;
+		key->dataSize = dataSize;
+		set_bit (key->flags, KEY_FLAG_SYNC);
+		return keyGetValueSize (key);
+	}
+
 	key->dataSize = dataSize;
 	if (key->data.v)
 	{
@@ -40,6 +40,9 @@
  *
  * @note elektraMountDefault is not allowed to be executed before
  *
+ * If kdb->openLazy is set, the plugins of the backends are opened
+ * later, see elektraBackendOpenLazy().
+ *
  * @param kdb the handle to work with
  * @param modules the current list of loaded modules
  * @param config the configuration which should be used to build up the trie.
@@ -62,7 +65,8 @@ int elektraMountOpen (KDB * kdb, KeySet * config, KeySet * modules, Key * errorK
 		if (keyRel (root, cur) == 1)
 		{
 			KeySet * cut = ksCut (config, cur);
-			Backend * backend = elektraBackendOpen (cut, modules, errorKey);
+			Backend * backend = kdb->openLazy ? elektraBackendOpenLazy (cut, modules, errorKey) :
+							    elektraBackendOpen (cut, modules, errorKey);
 
 			if (!backend)
 			{
@@ -266,7 +270,9 @@ int elektraMountGlobals (KDB * kdb, KeySet * keys, KeySet * modules, Key * error
 		const char * pluginName = keyString (cur);
 		const char * globalPlacements[NR_GLOBAL_PLUGINS] = { "prerollback",    "postrollback",   "pregetstorage",
 								     "postgetstorage", "postgetcleanup", "presetstorage",
-								     "presetcleanup",  "precommit",      "postcommit" };
+								     "presetcleanup",  "precommit",      "postcommit",
+								     "pregetcache",    "postgetcache",   "pregetnotify",
+								     "postgetnotify" };
 
 
 		if (!strcmp (pluginName, ""))
@@ -595,3 +601,61 @@ Backend * elektraMountGetBackend (KDB * handle, const Key * key)
 	if (!ret) return handle->defaultBackend;
 	return ret;
 }
+
+
+/**
+ * Lookup the backend handles for all keys of a keyset.
+ *
+ * Same as elektraMountGetBackend() for every key, but faster
+ * for sorted keysets, see elektraTrieLookupAll().
+ *
+ * @param handle is the data structure, where the mounted directories are saved.
+ * @param ks the keys that should be looked up.
+ * @param backends an array of ksGetSize() elements, receives the
+ *        backend handle of every key
+ * @ingroup mount
+ */
+void elektraMountGetBackends (KDB * handle, const KeySet * ks, Backend ** backends)
+{
+	elektraTrieLookupAll (handle->trie, ks, backends);
+	for (size_t i = 0; i < ks->size; ++i)
+	{
+		if (!backends[i]) backends[i] = handle->defaultBackend;
+	}
+}
+
+
+/**
+ * Counts the backends mounted in a handle.
+ *
+ * Every backend is counted once, regardless in how many
+ * namespaces it is mounted. Backends opened with
+ * elektraBackendOpenLazy() only count as materialised after their
+ * plugins were opened by a kdbGet() or kdbSet() below them.
+ *
+ * @param handle is the data structure, where the mounted directories are saved.
+ * @param [out] materialised receives the number of backends with opened
+ *        plugins, if not 0
+ * @return the number of backends
+ * @ingroup mount
+ */
+size_t elektraMountCountBackends (KDB * handle, size_t * materialised)
+{
+	size_t count = 0;
+	size_t opened = 0;
+
+	for (size_t i = 0; i < handle->split->size; ++i)
+	{
+		Backend * backend = handle->split->handles[i];
+		size_t j = 0;
+		while (j < i && handle->split->handles[j] != backend)
+			++j;
+		if (j < i) continue; // already counted
+
+		++count;
+		if (!backend->config) ++opened;
+	}
+
+	if (materialised) *materialised = opened;
+	return count;
+}
@@ -0,0 +1,133 @@
+/**
+ * @file
+ *
+ * @brief Notification about changed configuration files.
+ *
+ * @copyright BSD License (see doc/COPYING or http://www.libelektra.org)
+ */
+
+#ifdef HAVE_KDBCONFIG_H
+#include "kdbconfig.h"
+#endif
+
+#include "kdbinternal.h"
+
+/**
+ * @internal
+ *
+ * @brief Get a function exported by the plugin at `pregetnotify`.
+ *
+ * @param name the name below exports/ in the contract of the plugin
+ *
+ * @return the function or 0 if it is not exported
+ */
+static void * elektraNotificationFunction (KDB * handle, const char * name)
+{
+	Plugin * plugin = handle->globalPlugins[PREGETNOTIFY];
+	if (!plugin) return 0;
+
+	Key * root = keyNew ("system/elektra/modules", KEY_END);
+	keyAddBaseName (root, plugin->name);
+	KeySet * contract = ksNew (0, KS_END);
+	plugin->kdbGet (plugin, contract, root);
+	keyAddBaseName (root, "exports");
+	keyAddBaseName (root, name);
+	Key * found = ksLookup (contract, root, 0);
+
+	void * function = 0;
+	if (!found || keyGetBinary (found, &function, sizeof (function)) != sizeof (function)) function = 0;
+
+	ksDel (contract);
+	keyDel (root);
+	return function;
+}
+
+/**
+ * @brief File descriptor which gets readable when configuration files change
+ *
+ * Needs a global plugin mounted to `pregetnotify` and `postgetnotify`,
+ * e.g. inotify. Only files of backends read by kdbGet() are watched.
+ * Applications can wait for the file descriptor in their main loop and
+ * call elektraNotificationPoll() or kdbGet() when it gets readable.
+ *
+ * @param handle the handle the files are read with
+ *
+ * @return the file descriptor
+ * @retval -1 if no notification is available
+ * @ingroup proposal
+ */
+int elektraNotificationFd (KDB * handle)
+{
+	if (!handle) return -1;
+
+	union {
+		int (*f) (Plugin *);
+		void * v;
+	} conversation;
+
+	conversation.v = elektraNotificationFunction (handle, "fd");
+	if (!conversation.v) return -1;
+	return conversation.f (handle->globalPlugins[PREGETNOTIFY]);
+}
+
+/**
+ * @brief Set the function to be called by elektraNotificationPoll()
+ *
+ * @param handle the handle the files are read with
+ * @param callback gets the changed mountpoints, 0 to remove it
+ * @param context passed to the callback
+ *
+ * @retval 0 on success
+ * @retval -1 if @p handle is a null pointer
+ * @ingroup proposal
+ */
+int elektraNotificationSetCallback (KDB * handle, ElektraNotificationCallback callback, void * context)
+{
+	if (!handle) return -1;
+
+	handle->notificationCallback = callback;
+	handle->notificationContext = context;
+	return 0;
+}
+
+/**
+ * @brief Collect the mountpoints changed since the last poll
+ *
+ * Every changed mountpoint is reported once, no matter how often its
+ * file was written. The keys are named after the mountpoints, their
+ * values are the resolved files. If there are changes, the callback
+ * of elektraNotificationSetCallback() is called with all of them.
+ *
+ * The poll does not block and does not read the configuration,
+ * kdbGet() afterwards only calls the resolvers of changed backends.
+ *
+ * @param handle the handle the files are read with
+ * @param changed where the changed mountpoints are appended,
+ *        may be 0 if only the callback should get them
+ *
+ * @return the number of changed mountpoints
+ * @retval -1 if no notification is available
+ * @ingroup proposal
+ */
+int elektraNotificationPoll (KDB * handle, KeySet * changed)
+{
+	if (!handle) return -1;
+
+	union {
+		int (*f) (Plugin *, KeySet *);
+		void * v;
+	} conversation;
+
+	conversation.v = elektraNotificationFunction (handle, "changed");
+	if (!conversation.v) return -1;
+
+	KeySet * mountpoints = ksNew (0, KS_END);
+	int ret = conversation.f (handle->globalPlugins[PREGETNOTIFY], mountpoints);
+	if (ret > 0 && handle->notificationCallback)
+	{
+		handle->notificationCallback (handle, mountpoints, handle->notificationContext);
+	}
+	if (changed) ksAppend (changed, mountpoints);
+	ksDel (mountpoints);
+	return ret;
+}
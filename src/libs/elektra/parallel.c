@@ -0,0 +1,353 @@
+/**
+ * @file
+ *
+ * @brief Parallel execution of the get plugins of different backends.
+ *
+ * @copyright BSD License (see doc/COPYING or http://www.libelektra.org)
+ */
+
+#ifdef HAVE_KDBCONFIG_H
+#include "kdbconfig.h"
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#include <kdbinternal.h>
+
+
+/**
+ * @internal
+ *
+ * All splits of one backend.
+ *
+ * Cascading backends are in several splits, but their
+ * plugins are shared, so they are always processed by
+ * the same thread in the order of the splits.
+ */
+typedef struct
+{
+	Backend * backend;
+	Key * parentKey; /*!< private parentKey for warnings and errors */
+	int ret;
+} GetTask;
+
+typedef struct
+{
+	Split * split;
+	GetTask * tasks;
+	size_t size;
+	size_t next; /*!< next task to be picked */
+	int start;
+	int end;
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_t mutex;
+#endif
+} GetPool;
+
+
+/**
+ * @internal
+ *
+ * @brief Check if all get plugins of a backend may be called in parallel
+ * to other backends.
+ *
+ * Plugins declare that they are not thread-safe with
+ * infos/status nothreads in their contract. The result is cached
+ * within the backend.
+ *
+ * @retval 1 if the backend can be processed by any thread
+ * @retval 0 if it must be processed by the calling thread
+ */
+static int elektraBackendGetThreadSafe (Backend * backend)
+{
+	if (backend->getthreads) return backend->getthreads == 1;
+
+	backend->getthreads = 1;
+	for (size_t p = 1; p < NR_OF_PLUGINS; ++p)
+	{
+		Plugin * plugin = backend->getplugins[p];
+		if (!plugin || !plugin->name) continue;
+
+		Key * contractKey = keyNew ("system/elektra/modules", KEY_END);
+		keyAddBaseName (contractKey, plugin->name);
+		KeySet * contract = ksNew (30, KS_END);
+		plugin->kdbGet (plugin, contract, contractKey);
+
+		keyAddName (contractKey, "infos/status");
+		Key * status = ksLookup (contract, contractKey, 0);
+		const char * tag = status ? strstr (keyString (status), "nothreads") : 0;
+		if (tag && (tag == keyString (status) || tag[-1] == ' ') && (tag[9] == ' ' || tag[9] == '\0'))
+		{
+			backend->getthreads = -1;
+		}
+
+		ksDel (contract);
+		keyDel (contractKey);
+		if (backend->getthreads == -1) break;
+	}
+	return backend->getthreads == 1;
+}
+
+static void elektraGetTaskRun (GetPool * pool, GetTask * task)
+{
+	const int bypassedSplits = 1;
+	Split * split = pool->split;
+	for (size_t i = 0; i < split->size - bypassedSplits; i++)
+	{
+		if (split->handles[i] != task->backend || !test_bit (split->syncbits[i], SPLIT_FLAG_SYNC))
+		{
+			continue;
+		}
+		ksRewind (split->keysets[i]);
+		keySetName (task->parentKey, keyName (split->parents[i]));
+		keySetString (task->parentKey, keyString (split->parents[i]));
+
+		for (int p = pool->start; p < pool->end; ++p)
+		{
+			int ret = 0;
+			if (task->backend->getplugins[p])
+			{
+				ret = ELEKTRA_BACKEND_GET (task->backend, p, split->keysets[i], task->parentKey);
+			}
+
+			if (ret == -1)
+			{
+				task->ret = -1;
+				return;
+			}
+		}
+	}
+}
+
+/**
+ * @internal
+ *
+ * Gives the keys of all splits to update their own metadata, so
+ * that the threads never change the reference counters of the same
+ * meta keys.
+ *
+ * @retval 0 on success
+ * @retval -1 on memory errors
+ */
+static int elektraGetPoolUnshareMeta (GetPool * pool)
+{
+	const int bypassedSplits = 1;
+	Split * split = pool->split;
+	for (size_t i = 0; i < split->size - bypassedSplits; i++)
+	{
+		if (!test_bit (split->syncbits[i], SPLIT_FLAG_SYNC)) continue;
+
+		KeySet * ks = split->keysets[i];
+		for (size_t k = 0; k < ks->size; ++k)
+		{
+			if (elektraKeyUnshareMeta (ks->array[k]) == -1) return -1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @internal
+ *
+ * Runs thread-safe tasks until none are left.
+ */
+static void * elektraGetWorker (void * data)
+{
+	GetPool * pool = data;
+	for (;;)
+	{
+		GetTask * task = 0;
+#ifdef HAVE_PTHREAD_H
+		pthread_mutex_lock (&pool->mutex);
+#endif
+		while (pool->next < pool->size && !task)
+		{
+			if (pool->tasks[pool->next].backend->getthreads == 1) task = &pool->tasks[pool->next];
+			++pool->next;
+		}
+#ifdef HAVE_PTHREAD_H
+		pthread_mutex_unlock (&pool->mutex);
+#endif
+		if (!task) return 0;
+		elektraGetTaskRun (pool, task);
+	}
+}
+
+/**
+ * @internal
+ *
+ * Appends all warnings of @p from to the warnings of @p to,
+ * renumbering them as ELEKTRA_ADD_WARNING would do.
+ */
+void elektraCopyWarnings (Key * to, Key * from)
+{
+	char name[] = "warnings/#00";
+	const size_t len = sizeof (name) - 1;
+	const Key * meta;
+
+	keyRewindMeta (from);
+	while ((meta = keyNextMeta (from)) != 0)
+	{
+		const char * metaName = keyName (meta);
+		if (strlen (metaName) < len || strncmp (metaName, "warnings/#", len - 2)) continue;
+
+		if (metaName[len] == '\0')
+		{
+			// a new warning starts, take the next free number
+			const Key * last = keyGetMeta (to, "warnings");
+			if (last)
+			{
+				name[10] = keyString (last)[0];
+				name[11] = keyString (last)[1];
+				name[11]++;
+				if (name[11] > '9')
+				{
+					name[11] = '0';
+					name[10]++;
+					if (name[10] > '9') name[10] = '0';
+				}
+			}
+			keySetMeta (to, "warnings", &name[10]);
+			keySetMeta (to, name, keyString (meta));
+		}
+		else if (metaName[len] == '/')
+		{
+			char * copyName = elektraFormat ("%s%s", name, &metaName[len]);
+			keySetMeta (to, copyName, keyString (meta));
+			elektraFree (copyName);
+		}
+	}
+}
+
+static void elektraGetCopyError (Key * to, Key * from)
+{
+	const Key * meta;
+
+	keyRewindMeta (from);
+	while ((meta = keyNextMeta (from)) != 0)
+	{
+		const char * metaName = keyName (meta);
+		if (!strncmp (metaName, "error", 5) && (metaName[5] == '\0' || metaName[5] == '/'))
+		{
+			keySetMeta (to, metaName, keyString (meta));
+		}
+	}
+}
+
+/**
+ * @internal
+ * @brief Do the real update in parallel.
+ *
+ * Runs the get plugins from @p start to (excluding) @p end of all
+ * splits which need sync, like elektraGetDoUpdate() in kdb.c does.
+ *
+ * The splits are grouped by their backend. Each group is processed by
+ * one of @p threads threads, so the keysets of the splits are never
+ * accessed concurrently. Backends with a plugin tagged as nothreads
+ * are processed by the calling thread only.
+ *
+ * Meta keys shared between keys of the splits are copied before the
+ * threads are started, because their reference counters are not
+ * thread-safe. If this fails, all backends are processed by the
+ * calling thread.
+ *
+ * Every backend gets its own parentKey, warnings are added to
+ * @p parentKey in the order of the splits afterwards. On errors only
+ * the warnings of the backends up to the first failing one and its
+ * error are added, so the result is independent of the scheduling.
+ *
+ * Without pthreads all backends are processed by the calling thread.
+ *
+ * @param split the splits to update
+ * @param parentKey to add warnings and errors to
+ * @param start the first plugin to call
+ * @param end one after the last plugin to call
+ * @param threads the maximum number of threads to use
+ *
+ * @retval -1 on error
+ * @retval 0 on success
+ */
+int elektraGetDoUpdateParallel (Split * split, Key * parentKey, int start, int end, size_t threads)
+{
+	const int bypassedSplits = 1;
+	GetPool pool;
+	pool.split = split;
+	pool.size = 0;
+	pool.next = 0;
+	pool.start = start;
+	pool.end = end;
+	pool.tasks = elektraCalloc (split->size * sizeof (GetTask));
+	if (!pool.tasks) return -1;
+
+	for (size_t i = 0; i < split->size - bypassedSplits; i++)
+	{
+		if (!test_bit (split->syncbits[i], SPLIT_FLAG_SYNC)) continue;
+
+		size_t t = 0;
+		while (t < pool.size && pool.tasks[t].backend != split->handles[i])
+		{
+			++t;
+		}
+		if (t < pool.size) continue;
+
+		pool.tasks[pool.size].backend = split->handles[i];
+		pool.tasks[pool.size].parentKey = keyNew (keyName (split->parents[i]), KEY_END);
+		elektraBackendGetThreadSafe (split->handles[i]);
+		++pool.size;
+	}
+
+#ifdef HAVE_PTHREAD_H
+	size_t nrThreads = threads < pool.size ? threads : pool.size;
+	if (nrThreads > 1 && elektraGetPoolUnshareMeta (&pool) == -1) nrThreads = 1;
+	pthread_t * workers = nrThreads > 1 ? elektraMalloc ((nrThreads - 1) * sizeof (pthread_t)) : 0;
+	size_t started = 0;
+
+	pthread_mutex_init (&pool.mutex, 0);
+	for (size_t w = 0; workers && w < nrThreads - 1; ++w)
+	{
+		if (pthread_create (&workers[w], 0, elektraGetWorker, &pool)) break;
+		++started;
+	}
+#else
+	(void)threads;
+#endif
+
+	// the calling thread takes care of everything not thread-safe
+	for (size_t t = 0; t < pool.size; ++t)
+	{
+		if (pool.tasks[t].backend->getthreads != 1) elektraGetTaskRun (&pool, &pool.tasks[t]);
+	}
+	elektraGetWorker (&pool);
+
+#ifdef HAVE_PTHREAD_H
+	for (size_t w = 0; w < started; ++w)
+	{
+		pthread_join (workers[w], 0);
+	}
+	pthread_mutex_destroy (&pool.mutex);
+	elektraFree (workers);
+#endif
+
+	int ret = 0;
+	for (size_t t = 0; t < pool.size; ++t)
+	{
+		if (ret == 0)
+		{
+			elektraCopyWarnings (parentKey, pool.tasks[t].parentKey);
+			if (pool.tasks[t].ret == -1)
+			{
+				elektraGetCopyError (parentKey, pool.tasks[t].parentKey);
+				ret = -1;
+			}
+		}
+		keyDel (pool.tasks[t].parentKey);
+	}
+	elektraFree (pool.tasks);
+	return ret;
+}
@@ -115,6 +115,7 @@ Key * elektraKsPopAtCursor (KeySet * ks, cursor_t pos)
 
 	size_t c = pos;
 	if (c >= ks->size) return 0;
+	if (elektraKsUnshare (ks) == -1) return 0;
 
 	if (c != ks->size - 1)
 	{
@@ -374,6 +374,33 @@ int elektraSplitBuildup (Split * split, KDB * kdb, Key * parentKey)
 }
 
 
+/**
+ * Opens the plugins of all lazily opened backends in the split.
+ *
+ * Backends which cannot be opened become missing backends,
+ * see elektraBackendMaterialise().
+ *
+ * @pre elektraSplitBuildup() need to be executed before.
+ *
+ * @param split the split with the backends needed
+ * @param warningKey the key where warnings are added
+ * @ingroup split
+ * @retval 1 if all backends could be opened
+ * @retval 0 if some backends are missing now
+ */
+int elektraSplitMaterialise (Split * split, Key * warningKey)
+{
+	int ret = 1;
+
+	for (size_t i = 0; i < split->size; ++i)
+	{
+		if (elektraBackendMaterialise (split->handles[i], warningKey) == -1) ret = 0;
+	}
+
+	return ret;
+}
+
+
 /**
  * Splits up the keysets and search for a sync bit in every key.
  *
@@ -400,13 +427,21 @@ int elektraSplitDivide (Split * split, KDB * handle, KeySet * ks)
 	int needsSync = 0;
 	Key * curKey = 0;
 	Backend * curHandle = 0;
+	Backend ** backends = elektraMalloc (ksGetSize (ks) * sizeof (Backend *));
+	size_t i = 0;
+
+	if (backends) elektraMountGetBackends (handle, ks, backends);
 
 	ksRewind (ks);
 	while ((curKey = ksNext (ks)) != 0)
 	{
 		// TODO: handle keys in wrong namespaces
-		curHandle = elektraMountGetBackend (handle, curKey);
-		if (!curHandle) return -1;
+		curHandle = backends ? backends[i++] : elektraMountGetBackend (handle, curKey);
+		if (!curHandle)
+		{
+			elektraFree (backends);
+			return -1;
+		}
 
 		curFound = elektraSplitSearchBackend (split, curHandle, curKey);
 
@@ -420,6 +455,7 @@ int elektraSplitDivide (Split * split, KDB * handle, KeySet * ks)
 		}
 	}
 
+	elektraFree (backends);
 	return needsSync;
 }
 
@@ -464,12 +500,20 @@ int elektraSplitAppoint (Split * split, KDB * handle, KeySet * ks)
 	Key * curKey = 0;
 	Backend * curHandle = 0;
 	ssize_t defFound = elektraSplitAppend (split, 0, 0, 0);
+	Backend ** backends = elektraMalloc (ksGetSize (ks) * sizeof (Backend *));
+	size_t i = 0;
+
+	if (backends) elektraMountGetBackends (handle, ks, backends);
 
 	ksRewind (ks);
 	while ((curKey = ksNext (ks)) != 0)
 	{
-		curHandle = elektraMountGetBackend (handle, curKey);
-		if (!curHandle) return -1;
+		curHandle = backends ? backends[i++] : elektraMountGetBackend (handle, curKey);
+		if (!curHandle)
+		{
+			elektraFree (backends);
+			return -1;
+		}
 
 		curFound = elektraSplitSearchBackend (split, curHandle, curKey);
 
@@ -483,6 +527,44 @@ int elektraSplitAppoint (Split * split, KDB * handle, KeySet * ks)
 		ksAppendKey (split->keysets[curFound], curKey);
 	}
 
+	elektraFree (backends);
+	return 1;
+}
+
+/**
+ * @brief Let the keysets of the backends share one arena.
+ *
+ * Most backends read only a few keys. With an arena per keyset
+ * every backend would start a block of its own, so the keysets
+ * which will be read by backends in kdbGet() share one instead.
+ * Keysets already read from the cache and the default split part
+ * keep their own arena.
+ *
+ * @pre elektraSplitAppoint() needs to be executed before.
+ * @pre the backends must not be called concurrently, because
+ *      the arena is not thread-safe.
+ *
+ * @param split the split object to work with
+ * @retval 1 on success
+ * @retval -1 on memory error, the keysets then use their own arena
+ * @ingroup split
+ */
+int elektraSplitShareArena (Split * split)
+{
+	/* Dont share with the default split part */
+	const int bypassedSplits = 1;
+
+	KeyArena * arena = elektraKeyArenaNew ();
+	if (!arena) return -1;
+
+	for (size_t i = 0; i < split->size - bypassedSplits; ++i)
+	{
+		if (!test_bit (split->syncbits[i], SPLIT_FLAG_SYNC)) continue;
+
+		elektraKsSetArena (split->keysets[i], arena);
+	}
+
+	elektraKeyArenaDel (arena);
 	return 1;
 }
 
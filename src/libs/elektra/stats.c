@@ -0,0 +1,287 @@
+/**
+ * @file
+ *
+ * @brief Statistics of the calls of plugins in kdbGet() and kdbSet().
+ *
+ * @copyright BSD License (see doc/COPYING or http://www.libelektra.org)
+ */
+
+#ifdef HAVE_KDBCONFIG_H
+#include "kdbconfig.h"
+#endif
+
+#ifdef HAVE_STDIO_H
+#include <stdio.h>
+#endif
+
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include "kdbinternal.h"
+
+static const char * elektraStatsGlobalNames[NR_GLOBAL_PLUGINS] = {
+	"prerollback", "postrollback", "pregetstorage", "postgetstorage", "postgetcleanup", "presetstorage", "presetcleanup",
+	"precommit",   "postcommit",   "pregetcache",   "postgetcache",   "pregetnotify",   "postgetnotify"
+};
+
+static const char * elektraStatsPhaseNames[ELEKTRA_STATS_PHASES] = { "get", "set", "error" };
+
+/**
+ * @internal
+ *
+ * @return a monotonic time in nanoseconds
+ */
+kdb_unsigned_long_long_t elektraStatsNow (void)
+{
+#ifdef HAVE_CLOCK_GETTIME
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return (kdb_unsigned_long_long_t)now.tv_sec * 1000000000 + now.tv_nsec;
+#else
+	struct timeval now;
+	gettimeofday (&now, 0);
+	return (kdb_unsigned_long_long_t)now.tv_sec * 1000000000 + now.tv_usec * 1000;
+#endif
+}
+
+/**
+ * @internal
+ *
+ * @brief Add a call which started at @p start to @p slot.
+ *
+ * @param start the result of elektraStatsNow() before the call
+ * @param allocations the result of elektraAllocations() before the call
+ * @param ks the keyset passed to the call
+ */
+void elektraStatsAdd (ElektraStatsSlot * slot, kdb_unsigned_long_long_t start, size_t allocations, KeySet * ks)
+{
+	slot->nanoseconds += elektraStatsNow () - start;
+	slot->allocations += elektraAllocations () - allocations;
+	slot->keys += ksGetSize (ks);
+	++slot->calls;
+}
+
+/**
+ * @internal
+ *
+ * @brief Call @p function of @p plugin and add the call to @p slot.
+ *
+ * kdbGetPtr, kdbSetPtr and kdbErrorPtr have the same signature,
+ * so this works for every phase.
+ *
+ * @return the return value of @p function
+ */
+int elektraStatsCall (ElektraStatsSlot * slot, Plugin * plugin, kdbGetPtr function, KeySet * ks, Key * parentKey)
+{
+	size_t allocations = elektraAllocations ();
+	kdb_unsigned_long_long_t start = elektraStatsNow ();
+	int ret = function (plugin, ks, parentKey);
+	elektraStatsAdd (slot, start, allocations, ks);
+	return ret;
+}
+
+/**
+ * @internal
+ *
+ * @brief Call the plugin in @p slot of @p phase of @p backend and measure it.
+ *
+ * Only used by ELEKTRA_BACKEND_GET and friends if the statistics of
+ * @p backend are enabled. After the storage plugin read a file, its
+ * size is added to the bytes of the backend.
+ *
+ * @return the return value of the plugin
+ */
+int elektraStatsBackendCall (Backend * backend, ElektraStatsPhase phase, size_t slot, KeySet * ks, Key * parentKey)
+{
+	ElektraStatsSlot * stats = &backend->stats->slots[phase][slot];
+	int ret;
+	switch (phase)
+	{
+	case ELEKTRA_STATS_GET:
+		ret = elektraStatsCall (stats, backend->getplugins[slot], backend->getplugins[slot]->kdbGet, ks, parentKey);
+		break;
+	case ELEKTRA_STATS_SET:
+		ret = elektraStatsCall (stats, backend->setplugins[slot], backend->setplugins[slot]->kdbSet, ks, parentKey);
+		break;
+	default:
+		ret = elektraStatsCall (stats, backend->errorplugins[slot], backend->errorplugins[slot]->kdbError, ks, parentKey);
+		break;
+	}
+
+	struct stat buf;
+	if (phase == ELEKTRA_STATS_GET && slot == STORAGE_PLUGIN && ret == 1 && stat (keyString (parentKey), &buf) == 0)
+	{
+		backend->stats->bytes += buf.st_size;
+	}
+	return ret;
+}
+
+/**
+ * @brief Enable, reset or disable statistics of kdbGet() and kdbSet()
+ *
+ * If enabled, the wall time, the number of calls, the sizes of the
+ * keysets and the allocations done with elektraMalloc() and friends
+ * are recorded for every plugin slot of every backend, every global
+ * plugin and kdbGet() and kdbSet() as a whole. Additionally the sizes
+ * of the files read by storage plugins are summed up per backend.
+ * Use elektraStats() to get them.
+ *
+ * If disabled, the only cost is a check of a pointer per call of a
+ * plugin and of elektraMalloc() and friends.
+ *
+ * Statistics are also enabled by kdbOpen() if the key
+ * system/elektra/kdb/stats is 1.
+ *
+ * @param handle the handle to record the calls of
+ * @param enable 1 to start from zero (again), 0 to disable
+ *
+ * @retval 0 on success
+ * @retval -1 on null pointers or allocation errors
+ * @ingroup proposal
+ */
+int elektraStatsEnable (KDB * handle, int enable)
+{
+	if (!handle) return -1;
+
+	if (handle->stats)
+	{
+		elektraFree (handle->stats);
+		handle->stats = 0;
+		elektraCountAllocations (0);
+	}
+
+	for (size_t i = 0; handle->split && i < handle->split->size; ++i)
+	{
+		Backend * backend = handle->split->handles[i];
+		if (!backend) continue;
+		elektraFree (backend->stats);
+		backend->stats = 0;
+	}
+
+	if (!enable) return 0;
+
+	handle->stats = elektraCalloc (sizeof (KdbStats));
+	if (!handle->stats) return -1;
+	elektraCountAllocations (1);
+
+	for (size_t i = 0; handle->split && i < handle->split->size; ++i)
+	{
+		Backend * backend = handle->split->handles[i];
+		if (!backend || backend->stats) continue; // cascading backends are in several splits
+		backend->stats = elektraCalloc (sizeof (BackendStats));
+		if (!backend->stats)
+		{
+			elektraStatsEnable (handle, 0);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static void elektraStatsAppendSlot (KeySet * stats, Key * where, const ElektraStatsSlot * slot, const char * plugin)
+{
+	char value[MAX_LEN_INT];
+	Key * key = keyDup (where);
+	if (plugin) keySetString (key, plugin);
+	ksAppendKey (stats, key);
+
+	const char * names[] = { "calls", "nanoseconds", "keys", "allocations" };
+	const kdb_unsigned_long_long_t values[] = { slot->calls, slot->nanoseconds, slot->keys, slot->allocations };
+	for (size_t i = 0; i < sizeof (names) / sizeof (names[0]); ++i)
+	{
+		key = keyDup (where);
+		keyAddBaseName (key, names[i]);
+		snprintf (value, sizeof (value), "%llu", (unsigned long long)values[i]);
+		keySetString (key, value);
+		ksAppendKey (stats, key);
+	}
+}
+
+/**
+ * @brief Get the statistics recorded since elektraStatsEnable()
+ *
+ * The keys appended to @p stats are:
+ * - `system/elektra/stats/get` and `system/elektra/stats/set` for
+ *   kdbGet() and kdbSet() as a whole
+ * - `system/elektra/stats/global/<position>` for the global plugins,
+ *   e.g. `system/elektra/stats/global/postgetstorage`
+ * - `system/elektra/stats/mountpoints/<mountpoint>/<phase>/#<slot>` for
+ *   the plugins of every backend, with `get`, `set` and `error` as phase
+ *   and the name of the plugin as value, e.g.
+ *   `system/elektra/stats/mountpoints/user\/tests/get/#5` for the
+ *   storage plugin of the backend mounted at user/tests
+ * - `system/elektra/stats/mountpoints/<mountpoint>/bytes` for the sizes
+ *   of the files read by the storage plugin
+ *
+ * Below every key but the last ones, `calls`, `nanoseconds`, `keys`
+ * and `allocations` contain the numbers of the calls, their wall time,
+ * the sum of the sizes of the keysets after the calls and the
+ * allocations done with elektraMalloc() and friends during the calls.
+ * Only slots and global plugins which were called are appended.
+ *
+ * To find which mountpoint slows down the start of an application,
+ * compare `nanoseconds` of the mountpoints after the first kdbGet().
+ *
+ * @param handle the handle the statistics were enabled for
+ * @param stats where the statistics are appended to
+ *
+ * @retval 0 on success
+ * @retval -1 on null pointers or if the statistics are disabled
+ * @ingroup proposal
+ */
+int elektraStats (KDB * handle, KeySet * stats)
+{
+	if (!handle || !stats || !handle->stats) return -1;
+
+	Key * where = keyNew (KDB_SYSTEM_ELEKTRA "/stats/get", KEY_END);
+	elektraStatsAppendSlot (stats, where, &handle->stats->get, 0);
+	keySetBaseName (where, "set");
+	elektraStatsAppendSlot (stats, where, &handle->stats->set, 0);
+
+	for (size_t i = 0; i < NR_GLOBAL_PLUGINS; ++i)
+	{
+		if (!handle->stats->global[i].calls) continue;
+		keySetName (where, KDB_SYSTEM_ELEKTRA "/stats/global");
+		keyAddBaseName (where, elektraStatsGlobalNames[i]);
+		elektraStatsAppendSlot (stats, where, &handle->stats->global[i], handle->globalPlugins[i]->name);
+	}
+
+	for (size_t i = 0; handle->split && i < handle->split->size; ++i)
+	{
+		Backend * backend = handle->split->handles[i];
+		size_t first = 0;
+		while (handle->split->handles[first] != backend)
+		{
+			++first;
+		}
+		if (first != i || !backend || !backend->stats) continue; // cascading backends are in several splits
+
+		Key * mountpoint = keyNew (KDB_SYSTEM_ELEKTRA "/stats/mountpoints", KEY_END);
+		keyAddBaseName (mountpoint, keyName (backend->mountpoint)[0] ? keyName (backend->mountpoint) : "default");
+
+		for (size_t phase = 0; phase < ELEKTRA_STATS_PHASES; ++phase)
+		{
+			Plugin ** plugins = phase == ELEKTRA_STATS_GET ? backend->getplugins :
+								      phase == ELEKTRA_STATS_SET ? backend->setplugins : backend->errorplugins;
+			for (size_t p = 0; p < NR_OF_PLUGINS; ++p)
+			{
+				if (!backend->stats->slots[phase][p].calls) continue;
+				char slot[ELEKTRA_MAX_ARRAY_SIZE];
+				elektraWriteArrayNumber (slot, p);
+				keySetName (where, keyName (mountpoint));
+				keyAddBaseName (where, elektraStatsPhaseNames[phase]);
+				keyAddBaseName (where, slot);
+				elektraStatsAppendSlot (stats, where, &backend->stats->slots[phase][p], plugins[p] ? plugins[p]->name : 0);
+			}
+		}
+
+		char bytes[MAX_LEN_INT];
+		snprintf (bytes, sizeof (bytes), "%zu", backend->stats->bytes);
+		keyAddBaseName (mountpoint, "bytes");
+		keySetString (mountpoint, bytes);
+		ksAppendKey (stats, mountpoint);
+	}
+
+	keyDel (where);
+	return 0;
+}
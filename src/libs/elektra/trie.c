@@ -32,8 +32,10 @@
 
 #include "kdbinternal.h"
 
-static char * elektraTrieStartsWith (const char * str, const char * substr);
-static Backend * elektraTriePrefixLookup (Trie * trie, const char * name);
+static TrieNode * elektraTrieFindChild (const TrieNode * node, const char * name, size_t * pos);
+static size_t elektraTrieCommon (const char * name, size_t size, const char * other, size_t otherSize);
+static Backend * elektraTrieWalk (const Trie * trie, const char * name, size_t size, size_t * stable);
+static void elektraTrieNodeClose (TrieNode * node, Key * errorKey);
 
 /**
  * @brief Internal Datastructure for mountpoints
@@ -44,6 +46,8 @@ static Backend * elektraTriePrefixLookup (Trie * trie, const char * name);
 /**
  * Lookups a backend inside the trie.
  *
+ * Does not allocate any memory.
+ *
  * @return the backend if found
  * @return 0 otherwise
  * @param trie the trie object to work with
@@ -52,23 +56,50 @@ static Backend * elektraTriePrefixLookup (Trie * trie, const char * name);
  */
 Backend * elektraTrieLookup (Trie * trie, const Key * key)
 {
-	char * where = 0;
-	Backend * ret = 0;
-	size_t len = 0;
+	size_t stable;
 
 	if (!key) return 0;
 	if (!trie) return 0;
 
-	len = keyGetNameSize (key) + 1;
-	if (len <= 1) return 0; // would crash otherwise
-	where = elektraMalloc (len);
-	strncpy (where, keyName (key), len);
-	where[len - 2] = '/';
+	return elektraTrieWalk (trie, keyUnescapedName (key), keyGetUnescapedNameSize (key), &stable);
+}
 
-	ret = elektraTriePrefixLookup (trie, where);
-	elektraFree (where);
+/**
+ * Lookups the backends of all keys of a keyset.
+ *
+ * Gives the same result as elektraTrieLookup() for every key, but
+ * only does a lookup when a key is not below the same part of the
+ * trie as the key before. In a sorted keyset, most keys next to each
+ * other are, so most keys are assigned by a single comparison.
+ *
+ * @param trie the trie object to work with
+ * @param ks the keys to look up
+ * @param backends an array of ksGetSize() elements,
+ *        receives the backend of every key (or 0)
+ * @ingroup trie
+ */
+void elektraTrieLookupAll (Trie * trie, const KeySet * ks, Backend ** backends)
+{
+	const char * previous = 0;
+	size_t stable = 0;
+	Backend * ret = 0;
 
-	return ret;
+	for (size_t i = 0; i < ks->size; ++i)
+	{
+		const char * name = keyUnescapedName (ks->array[i]);
+		const size_t size = keyGetUnescapedNameSize (ks->array[i]);
+
+		if (!trie)
+		{
+			ret = 0;
+		}
+		else if (!stable || size < stable || memcmp (name, previous, stable))
+		{
+			ret = elektraTrieWalk (trie, name, size, &stable);
+			previous = name;
+		}
+		backends[i] = ret;
+	}
 }
 
 /**
@@ -81,102 +112,122 @@ Backend * elektraTrieLookup (Trie * trie, const Key * key)
  */
 int elektraTrieClose (Trie * trie, Key * errorKey)
 {
-	size_t i;
 	if (trie == NULL) return 0;
-	for (i = 0; i < KDB_MAX_UCHAR; ++i)
-	{
-		if (trie->text[i] != NULL)
-		{
-			elektraTrieClose (trie->children[i], errorKey);
-			if (trie->value[i]) elektraBackendClose (trie->value[i], errorKey);
-			elektraFree (trie->text[i]);
-		}
-	}
-	if (trie->empty_value)
+
+	elektraTrieNodeClose (&trie->root, errorKey);
+	for (size_t i = 0; i < trie->nrReplaced; ++i)
 	{
-		elektraBackendClose (trie->empty_value, errorKey);
+		elektraBackendClose (trie->replaced[i], errorKey);
 	}
+	elektraFree (trie->replaced);
 	elektraFree (trie);
 	return 0;
 }
+
+/**
+ * Inserts a backend into the trie.
+ *
+ * A backend inserted for a name already in the trie replaces
+ * the previous one, which is nevertheless closed by
+ * elektraTrieClose().
+ *
+ * @pre name is a valid key name or empty
+ *
+ * @param trie the trie to insert into, 0 to create one
+ * @param name the name the backend is mounted to, "" for the root
+ * @param value the backend to insert
+ * @return the trie
+ * @ingroup trie
+ */
 Trie * elektraTrieInsert (Trie * trie, const char * name, Backend * value)
 {
-	char * p;
-	unsigned char idx;
-
-	if (name == 0)
-	{
-		name = "";
-	}
-	idx = (unsigned char)name[0];
-
 	if (trie == NULL)
 	{
 		trie = elektraCalloc (sizeof (Trie));
-
-		if (!strcmp ("", name))
-		{
-			trie->empty_value = value;
-			return trie;
-		}
-
-		trie->textlen[idx] = strlen (name);
-
-		trie->text[idx] = elektraStrDup (name);
-
-		trie->value[idx] = value;
-		return trie;
+		if (!trie) return 0;
 	}
 
-	if (!strcmp ("", name))
+	Key * key = 0;
+	TrieNode * node = &trie->root;
+	const char * uname = "";
+	size_t size = 0;
+
+	if (name && strcmp ("", name))
 	{
-		trie->empty_value = value;
-		return trie;
+		key = keyNew (name, KEY_END);
+		if (keyGetUnescapedNameSize (key) <= 0) goto cleanup;
+		uname = keyUnescapedName (key);
+		size = keyGetUnescapedNameSize (key);
 	}
 
-	if (trie->text[idx])
+	while (size > 0)
 	{
-		/* there exists an entry with the same first character */
-		if ((p = elektraTrieStartsWith (name, trie->text[idx])) == 0)
+		size_t pos;
+		TrieNode * child = elektraTrieFindChild (node, uname, &pos);
+
+		if (!child)
 		{
-			/* the name in the trie is part of the searched name --> continue search */
-			trie->children[idx] = elektraTrieInsert (trie->children[idx], name + trie->textlen[idx], value);
+			/* there doesn't exist an entry with the same first segment */
+			char * copy = elektraMalloc (size);
+			if (!copy) goto cleanup;
+			if (elektraRealloc ((void **)&node->children, (node->nrChildren + 1) * sizeof (TrieNode)) == -1)
+			{
+				elektraFree (copy);
+				goto cleanup;
+			}
+			memcpy (copy, uname, size);
+
+			child = &node->children[pos];
+			memmove (child + 1, child, (node->nrChildren - pos) * sizeof (TrieNode));
+			++node->nrChildren;
+
+			memset (child, 0, sizeof (TrieNode));
+			child->name = copy;
+			child->size = size;
+			node = child;
+			break;
 		}
-		else
-		{
-			/* name in trie doesn't match name --> split trie */
-			char * newname;
-			Trie * child;
-			unsigned char idx2;
-
-			newname = elektraStrDup (p);
-			*p = 0; /* shorten the old name in the trie */
-			trie->textlen[idx] = strlen (trie->text[idx]);
-
-			child = trie->children[idx];
-
-			/* insert the name given as a parameter into the new trie entry */
-			trie->children[idx] = elektraTrieInsert (NULL, name + (p - trie->text[idx]), value);
 
-			/* insert the split try into the new trie entry */
-
-			idx2 = (unsigned char)newname[0];
-			trie->children[idx]->text[idx2] = newname;
-			trie->children[idx]->textlen[idx2] = strlen (newname);
-			trie->children[idx]->value[idx2] = trie->value[idx];
-			trie->children[idx]->children[idx2] = child;
-
-			trie->value[idx] = 0;
+		const size_t common = elektraTrieCommon (child->name, child->size, uname, size);
+		if (common < child->size)
+		{
+			/* name in trie doesn't match name --> split node */
+			TrieNode * below = elektraMalloc (sizeof (TrieNode));
+			char * rest = elektraMalloc (child->size - common);
+			if (!below || !rest)
+			{
+				elektraFree (below);
+				elektraFree (rest);
+				goto cleanup;
+			}
+			memcpy (rest, child->name + common, child->size - common);
+
+			below->name = rest;
+			below->size = child->size - common;
+			below->value = child->value;
+			below->children = child->children;
+			below->nrChildren = child->nrChildren;
+
+			child->size = common;
+			child->value = 0;
+			child->children = below;
+			child->nrChildren = 1;
 		}
+
+		node = child;
+		uname += common;
+		size -= common;
 	}
-	else
+
+	if (node->value)
 	{
-		/* there doesn't exist an entry with the same first character */
-		trie->text[idx] = elektraStrDup (name);
-		trie->value[idx] = (void *)value;
-		trie->textlen[idx] = strlen (name);
+		if (elektraRealloc ((void **)&trie->replaced, (trie->nrReplaced + 1) * sizeof (Backend *)) == -1) goto cleanup;
+		trie->replaced[trie->nrReplaced++] = node->value;
 	}
+	node->value = value;
 
+cleanup:
+	keyDel (key);
 	return trie;
 }
 
@@ -185,88 +236,102 @@ Trie * elektraTrieInsert (Trie * trie, const char * name, Backend * value)
  * Private static declarations
  ******************/
 
-
-#if 0
-
-static Trie *delete_trie(Trie *trie, char *name, CloseMapper closemapper)
+/**
+ * Searches the child starting with the first segment of name.
+ *
+ * @param node the node to search in
+ * @param name the unescaped name, its first segment must be null terminated
+ * @param [out] pos where a child with this segment would be, if not 0
+ * @return the child or 0 if there is none
+ */
+static TrieNode * elektraTrieFindChild (const TrieNode * node, const char * name, size_t * pos)
 {
-	Trie *tr;
-	unsigned char idx;
-	if (trie==NULL) {
-		return NULL;
-	}
-
-	idx=(unsigned char) name[0];
+	size_t left = 0;
+	size_t right = node->nrChildren;
 
-	if (trie->text[idx]==NULL) {
-		return NULL;
+	while (left < right)
+	{
+		const size_t middle = left + (right - left) / 2;
+		const int cmp = strcmp (node->children[middle].name, name);
+		if (cmp == 0) return &node->children[middle];
+		if (cmp < 0)
+			left = middle + 1;
+		else
+			right = middle;
 	}
 
-	if (elektraTrieStartsWith(name,trie->text[idx])==0) {
-
-		tr=delete_trie(trie->children[idx],name+trie->textlen[idx],closemapper);
-
-		if (tr==NULL) {
-			/* child trie has been deleted */
-			trie->children[idx]=NULL;
-			elektraFree (trie->text[idx]);
-			closemapper(trie->value[idx]);
-			trie->text[idx]=NULL;
-		}
-
-		return trie;
-	}
-	return NULL;
+	if (pos) *pos = left;
+	return 0;
 }
 
-#endif
-
 /**
- * return NULL if string starts with substring, except for the terminating '\0',
- * otherwise return a pointer to the first mismatch in substr.
- *
- * Takes const char* arguments but return char* pointer to it.
- * (like e.g. strchr)
+ * @return the size of all segments two unescaped names start with
  */
-static char * elektraTrieStartsWith (const char * str, const char * substr)
+static size_t elektraTrieCommon (const char * name, size_t size, const char * other, size_t otherSize)
 {
-	size_t i = 0;
-	size_t sublen = strlen (substr);
+	size_t common = 0;
 
-	for (i = 0; i < sublen; i++)
+	for (size_t i = 0; i < size && i < otherSize && name[i] == other[i]; ++i)
 	{
-		if (substr[i] != str[i]) return (char *)substr + i;
+		if (name[i] == '\0') common = i + 1;
 	}
-	return 0;
+	return common;
 }
 
-static Backend * elektraTriePrefixLookup (Trie * trie, const char * name)
+/**
+ * Walks down the trie along an unescaped name.
+ *
+ * Additionally determines a prefix of the name, so that every
+ * name starting with it leads to the same backend.
+ *
+ * @param [out] stable size of this prefix, 0 if there is none
+ * @return the backend mounted closest to the name
+ */
+static Backend * elektraTrieWalk (const Trie * trie, const char * name, size_t size, size_t * stable)
 {
-	if (trie == NULL) return NULL;
-
-	unsigned char idx = (unsigned char)name[0];
-	const char * trieText = trie->text[idx];
+	const TrieNode * node = &trie->root;
+	Backend * ret = node->value;
+	size_t pos = 0;
 
-	if (trieText == NULL)
+	*stable = 0;
+	while (pos < size)
 	{
-		return trie->empty_value;
-	}
+		const TrieNode * child = elektraTrieFindChild (node, name + pos, 0);
+		if (!child)
+		{
+			*stable = pos + strlen (name + pos) + 1;
+			return ret;
+		}
 
-	void * ret = NULL;
-	if (elektraTrieStartsWith (name, trieText) == 0)
-	{
-		ret = elektraTriePrefixLookup (trie->children[idx], name + trie->textlen[idx]);
-	}
-	else
-	{
-		return trie->empty_value;
-	}
+		const size_t common = elektraTrieCommon (child->name, child->size, name + pos, size - pos);
+		if (common < child->size)
+		{
+			// names only stay here if they differ from the child in the same segment
+			if (common < size - pos) *stable = pos + common + strlen (name + pos + common) + 1;
+			return ret;
+		}
 
-	if (ret == NULL && trie->value[idx] == NULL)
-	{
-		return trie->empty_value;
+		pos += common;
+		node = child;
+		if (node->value) ret = node->value;
 	}
-	if (ret == NULL) return trie->value[idx];
 
+	// names below might belong to the children
+	if (!node->nrChildren) *stable = size;
 	return ret;
 }
+
+static void elektraTrieNodeClose (TrieNode * node, Key * errorKey)
+{
+	for (size_t i = 0; i < node->nrChildren; ++i)
+	{
+		elektraTrieNodeClose (&node->children[i], errorKey);
+	}
+	if (node->value) elektraBackendClose (node->value, errorKey);
+	elektraFree (node->children);
+	elektraFree (node->name);
+}
+
+/**
+ * @}
+ */
@@ -7,12 +7,15 @@
  *
  */
 
+#include <kdbgetenv.h>
 #include <kdbtimer.hpp>
 #include <keyset.hpp>
 
 #include <fstream>
 #include <iostream>
+#include <thread>
 #include <unistd.h>
+#include <vector>
 
 #include <dlfcn.h>
 #include <string.h>
@@ -28,6 +31,8 @@ long long iterations = 1000000LL; // elitebenchmark
 // not needed in benchmarks:
 long long iterations1 = iterations / 100;
 
+int nr_threads = 4;
+
 const int benchmarkIterations = 11; // is a good number to not need mean values for median
 
 const std::string filename = "check.txt";
@@ -174,6 +179,60 @@ __attribute__ ((noinline)) void benchmark_kslookup ()
 	std::cout << t;
 }
 
+typedef char * (*gfcn) (const char *);
+
+/**
+ * @brief Many threads call getenv at the same time
+ *
+ * Every thread does all iterations, so without contention the
+ * time is the same as for a single thread.
+ */
+void benchmark_threads (Timer & t, gfcn f)
+{
+	std::vector<std::thread> threads;
+	t.start ();
+	for (int i = 0; i < nr_threads; ++i)
+	{
+		threads.emplace_back ([f]() {
+			for (long long j = 0; j < iterations; ++j)
+			{
+				f ("HELLO");
+				__asm__("");
+			}
+		});
+	}
+	for (auto & thread : threads)
+	{
+		thread.join ();
+	}
+	t.stop ();
+	std::cout << t;
+	dump << t.name << std::endl;
+}
+
+__attribute__ ((noinline)) void benchmark_getenv_threads ()
+{
+	static Timer t ("elektra getenv threads");
+	benchmark_threads (t, getenv);
+}
+
+__attribute__ ((noinline)) void benchmark_getenv_override_threads ()
+{
+	static Timer t ("elektra getenv override threads");
+	benchmark_threads (t, [](const char *) { return getenv ("hello0_0_override"); });
+}
+
+__attribute__ ((noinline)) void benchmark_dl_next_getenv_threads ()
+{
+	static Timer t ("dl next getenv threads");
+	union Sym {
+		void * d;
+		gfcn f;
+	} sym;
+	sym.d = dlsym (RTLD_NEXT, "getenv");
+	benchmark_threads (t, sym.f);
+}
+
 void computer_info ()
 {
 	std::cout << std::endl;
@@ -196,12 +255,23 @@ void computer_info ()
 	std::cout << "sizeof(long) " << sizeof (long) << std::endl;
 	std::cout << "sizeof(long long) " << sizeof (long long) << std::endl;
 	std::cout << "iterations " << iterations << std::endl;
+	std::cout << "threads " << nr_threads << std::endl;
 	std::cout << "filename " << filename << std::endl;
 	std::cout << std::endl;
 }
 
 int main (int argc, char ** argv)
 {
+	if (argc >= 2)
+	{
+		iterations = atoll (argv[1]);
+		iterations1 = iterations / 100;
+	}
+	if (argc >= 3)
+	{
+		nr_threads = atoi (argv[2]);
+	}
+
 	computer_info ();
 
 	clearenv ();
@@ -212,11 +282,10 @@ int main (int argc, char ** argv)
 		setenv (x, x, 0);
 	}
 
-	if (argc == 2)
-	{
-		iterations = atoll (argv[1]);
-		iterations1 = iterations / 100;
-	}
+	ckdb::elektraLockMutex ();
+	if (ckdb::elektraConfig)
+		ckdb::ksAppendKey (ckdb::elektraConfig, ckdb::keyNew ("proc/env/override/hello0_0_override", KEY_VALUE, "override", KEY_END));
+	ckdb::elektraUnlockMutex ();
 
 	for (int i = 0; i < benchmarkIterations; ++i)
 	{
@@ -229,6 +298,10 @@ int main (int argc, char ** argv)
 
 		benchmark_kslookup ();
 
+		benchmark_getenv_threads ();
+		benchmark_getenv_override_threads ();
+		benchmark_dl_next_getenv_threads ();
+
 		// benchmark_hashmap();
 		// benchmark_hashmap_find();
 	}
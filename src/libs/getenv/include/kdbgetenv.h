@@ -51,6 +51,9 @@ void elektraLockMutex ();
 /**
  * @brief Unlock the internally used mutex
  *
+ * The last unlock of nested locks makes changes of elektraConfig
+ * visible to getenv(), which does not lock the mutex itself.
+ *
  * @see elektraLockMutex()
  */
 void elektraUnlockMutex ();
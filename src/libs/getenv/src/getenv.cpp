@@ -22,9 +22,12 @@
 #include <kdbcontext.hpp>
 
 #include <kdbhelper.h>
+#include <kdbproposal.h>
 
 #include <dlfcn.h>
 #include <libgen.h>
+#include <poll.h>
+#include <sched.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -38,10 +41,15 @@
 #include <sys/auxv.h>
 #endif
 
+#include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <iostream>
+#include <memory>
+#include <set>
 #include <sstream>
 #include <string>
+#include <vector>
 
 /* BSDI has this functionality, but its not defined */
 #if !defined(RTLD_NEXT)
@@ -135,9 +143,117 @@ union Fork {
 } ffork; // symbols for libc fork
 
 std::chrono::milliseconds elektraReloadTimeout;
-std::chrono::system_clock::time_point elektraReloadNext;
+std::atomic<std::chrono::system_clock::rep> elektraReloadNext; ///< time since epoch, also read without mutex
+int elektraReloadFd = -1;					///< readable if the configuration changed
 std::shared_ptr<ostream> elektraLog;
-bool elektraInGetEnv;
+thread_local bool elektraInGetEnv; ///< only the thread holding the mutex can be inside getenv
+
+/**
+ * @brief Immutable hash table from names of variables to values
+ *
+ * Open addressing with linear probing. The values are not owned by
+ * the table, see elektraIntern().
+ */
+class GetEnvTable
+{
+public:
+	static size_t hash (const char * name)
+	{
+		size_t h = 14695981039346656037ULL;
+		for (; *name; ++name)
+		{
+			h = (h ^ static_cast<unsigned char> (*name)) * 1099511628211ULL;
+		}
+		return h;
+	}
+
+	/**
+	 * @pre all entries are added before seal()
+	 * @param value must outlive the table, nullptr if getenv should return nullptr
+	 */
+	void add (std::string name, const char * value)
+	{
+		m_entries.push_back (Entry{ hash (name.c_str ()), std::move (name), value });
+	}
+
+	void seal ()
+	{
+		size_t size = 1;
+		while (size < m_entries.size () * 2)
+			size *= 2;
+		m_slots.assign (size, -1);
+		for (size_t i = 0; i < m_entries.size (); ++i)
+		{
+			size_t pos = m_entries[i].hash & (size - 1);
+			while (m_slots[pos] != -1)
+				pos = (pos + 1) & (size - 1);
+			m_slots[pos] = i;
+		}
+	}
+
+	/**
+	 * @brief Same result as elektraGetEnvKey()
+	 *
+	 * @retval true if the variable is configured, ret is its value then
+	 * @retval false if the next place should be tried
+	 */
+	bool lookup (const char * name, size_t h, char *& ret) const
+	{
+		size_t const mask = m_slots.size () - 1;
+		for (size_t pos = h & mask; m_slots[pos] != -1; pos = (pos + 1) & mask)
+		{
+			Entry const & e = m_entries[m_slots[pos]];
+			if (e.hash == h && e.name == name)
+			{
+				ret = const_cast<char *> (e.value);
+				return true;
+			}
+		}
+		return false;
+	}
+
+private:
+	struct Entry
+	{
+		size_t hash;
+		std::string name;
+		const char * value;
+	};
+
+	std::vector<Entry> m_entries;
+	std::vector<ssize_t> m_slots;
+};
+
+/**
+ * @brief Everything getenv needs without locking the mutex
+ *
+ * Contains the results of the lookups in /env/override and
+ * /env/fallback for every configured name, already evaluated in the
+ * current context. A new snapshot is published when the
+ * configuration was reloaded or changed while the mutex was locked.
+ */
+struct GetEnvSnapshot
+{
+	GetEnvTable override;
+	GetEnvTable fallback;
+	std::chrono::milliseconds reloadTimeout;
+	int reloadFd;
+};
+
+std::atomic<GetEnvSnapshot *> elektraSnapshot;
+
+/**
+ * @brief Snapshots pinned by elektraGetEnvFast() (hazard pointers)
+ *
+ * A reader without a free slot takes the slow path.
+ */
+std::atomic<GetEnvSnapshot *> elektraHazards[64];
+/// replaced snapshots which might still be pinned, needs the mutex
+std::vector<GetEnvSnapshot *> elektraRetired;
+/// values of all snapshots, so that returned values stay valid, needs the mutex
+std::set<std::string> elektraValues;
+int elektraLockDepth;	  ///< nesting of the recursive mutex, needs the mutex
+bool elektraSnapshotStale; ///< elektraConfig might have changed, needs the mutex
 KeySet * elektraDocu = ksNew (20,
 #include "readme_elektrify-getenv.c"
 			      KS_END);
@@ -150,24 +266,47 @@ int to_ (int c)
 
 pthread_mutex_t elektraGetEnvMutex = ELEKTRA_MUTEX_INIT;
 
+void elektraPublishSnapshot ();
+void elektraRetireSnapshot (GetEnvSnapshot * snapshot);
+void elektraReclaimSnapshots ();
 
-} // anonymous namespace
-
-
-extern "C" void elektraLockMutex ()
+/// Lock the mutex without assuming that elektraConfig will be changed
+void elektraLockInternal ()
 {
 #if ELEKTRA_GETENV_USE_LOCKS
 	pthread_mutex_lock (&elektraGetEnvMutex);
 #endif
+	++elektraLockDepth;
 }
 
-extern "C" void elektraUnlockMutex ()
+/// Unlock the mutex, the last unlock publishes changes of elektraConfig
+void elektraUnlockInternal ()
 {
+	if (--elektraLockDepth == 0 && elektraSnapshotStale)
+	{
+		elektraSnapshotStale = false;
+		elektraPublishSnapshot ();
+	}
 #if ELEKTRA_GETENV_USE_LOCKS
 	pthread_mutex_unlock (&elektraGetEnvMutex);
 #endif
 }
 
+} // anonymous namespace
+
+
+extern "C" void elektraLockMutex ()
+{
+	elektraLockInternal ();
+	// the caller might change elektraConfig
+	elektraSnapshotStale = true;
+}
+
+extern "C" void elektraUnlockMutex ()
+{
+	elektraUnlockInternal ();
+}
+
 
 void printVersion ()
 {
@@ -437,6 +576,7 @@ extern "C" void elektraOpen (int * argc, char ** argv)
 	elektraRepo = kdbOpen (elektraParentKey);
 	std::string name = keyName (elektraParentKey);
 	kdbGet (elektraRepo, elektraConfig, elektraParentKey);
+	elektraReloadFd = elektraNotificationFd (elektraRepo);
 	addLayers ();
 	applyOptions ();
 	elektraUnlockMutex ();
@@ -451,6 +591,15 @@ extern "C" void elektraClose ()
 		ksDel (elektraConfig);
 		keyDel (elektraParentKey);
 		elektraRepo = nullptr;
+		elektraReloadFd = -1;
+		elektraRetireSnapshot (nullptr);
+		// readers still pinning a snapshot might return values
+		while (!elektraRetired.empty ())
+		{
+			sched_yield ();
+			elektraReclaimSnapshots ();
+		}
+		elektraValues.clear ();
 	}
 	elektraUnlockMutex ();
 }
@@ -503,6 +652,12 @@ extern "C" pid_t fork ()
 		// reinitialize mutex in new process
 		// fixes deadlock in akonadictl
 		elektraGetEnvMutex = ELEKTRA_MUTEX_INIT;
+		elektraLockDepth = 0;
+		// readers of other threads are gone
+		for (auto & hazard : elektraHazards)
+		{
+			hazard.store (nullptr);
+		}
 	}
 	return ret;
 }
@@ -552,6 +707,192 @@ char * elektraGetEnvKey (std::string const & fullName, bool & finish)
 	return nullptr;
 }
 
+namespace
+{
+
+/**
+ * @brief Does the snapshot know the result of elektraGetEnvKey()?
+ *
+ * Only names which are a single part of a key name are collected,
+ * other names need the lookup of the key.
+ */
+bool elektraSnapshotCovers (const char * name)
+{
+	if (!name[0] || !strcmp (name, ".") || !strcmp (name, "..")) return false;
+	return !strpbrk (name, "/\\");
+}
+
+/**
+ * @brief Copy of the value of key which stays valid until elektraClose(), needs the mutex
+ *
+ * Every distinct value is only stored once, so republishing
+ * unchanged configuration does not need more memory.
+ */
+const char * elektraIntern (Key * key)
+{
+	if (keyIsBinary (key)) return nullptr;
+	return elektraValues.insert (keyString (key)).first->c_str ();
+}
+
+/// Delete retired snapshots no reader has pinned, needs the mutex
+void elektraReclaimSnapshots ()
+{
+	auto keep = elektraRetired.begin ();
+	for (auto snapshot : elektraRetired)
+	{
+		bool pinned = false;
+		for (auto & hazard : elektraHazards)
+		{
+			if (hazard.load () == snapshot) pinned = true;
+		}
+		if (pinned)
+		{
+			*keep++ = snapshot;
+		}
+		else
+		{
+			delete snapshot;
+		}
+	}
+	elektraRetired.erase (keep, elektraRetired.end ());
+}
+
+/// Replace the published snapshot, needs the mutex
+void elektraRetireSnapshot (GetEnvSnapshot * snapshot)
+{
+	GetEnvSnapshot * old = elektraSnapshot.exchange (snapshot);
+	if (old) elektraRetired.push_back (old);
+	elektraReclaimSnapshots ();
+}
+
+/**
+ * @brief Pin the published snapshot
+ *
+ * @param snapshot is set to the pinned snapshot
+ *
+ * @return the hazard pointer to be reset to nullptr after the last access of snapshot
+ * @retval nullptr if nothing could be pinned
+ */
+std::atomic<GetEnvSnapshot *> * elektraPinSnapshot (GetEnvSnapshot *& snapshot)
+{
+	snapshot = elektraSnapshot.load ();
+	if (!snapshot) return nullptr;
+
+	size_t const count = sizeof (elektraHazards) / sizeof (elektraHazards[0]);
+	// threads have different stacks, so they start in different slots
+	size_t const first = reinterpret_cast<uintptr_t> (&snapshot) >> 12;
+	for (size_t i = 0; i < count; ++i)
+	{
+		std::atomic<GetEnvSnapshot *> & hazard = elektraHazards[(first + i) % count];
+		GetEnvSnapshot * expected = nullptr;
+		if (!hazard.compare_exchange_strong (expected, snapshot)) continue;
+		// a retired snapshot might already be reclaimed
+		if (elektraSnapshot.load () == snapshot) return &hazard;
+		hazard.store (nullptr);
+		return nullptr;
+	}
+	return nullptr;
+}
+
+/**
+ * @brief Publish the lookups of all configured names, needs the mutex
+ */
+void elektraPublishSnapshot ()
+{
+	if (!elektraRepo || elektraLog)
+	{
+		// logging needs every getenv to take the slow path
+		elektraRetireSnapshot (nullptr);
+		return;
+	}
+
+	std::set<std::string> overrides;
+	std::set<std::string> fallbacks;
+	const std::string overridePrefix = "env/override/";
+	const std::string fallbackPrefix = "env/fallback/";
+	for (cursor_t i = 0; i < ksGetSize (elektraConfig); ++i)
+	{
+		const char * name = keyName (ksAtCursor (elektraConfig, i));
+		const char * rest = strchr (name, '/');
+		if (!rest) continue;
+		++rest;
+
+		if (!strncmp (rest, overridePrefix.c_str (), overridePrefix.size ()) &&
+		    elektraSnapshotCovers (rest + overridePrefix.size ()))
+		{
+			overrides.insert (rest + overridePrefix.size ());
+		}
+		else if (!strncmp (rest, fallbackPrefix.c_str (), fallbackPrefix.size ()) &&
+			 elektraSnapshotCovers (rest + fallbackPrefix.size ()))
+		{
+			fallbacks.insert (rest + fallbackPrefix.size ());
+		}
+	}
+
+	std::unique_ptr<GetEnvSnapshot> snapshot (new GetEnvSnapshot);
+	for (auto const & name : overrides)
+	{
+		Key * key = elektraLookupWithContext ("/env/override/" + name);
+		if (key) snapshot->override.add (name, elektraIntern (key));
+	}
+	for (auto const & name : fallbacks)
+	{
+		Key * key = elektraLookupWithContext ("/env/fallback/" + name);
+		if (key) snapshot->fallback.add (name, elektraIntern (key));
+	}
+	snapshot->override.seal ();
+	snapshot->fallback.seal ();
+	snapshot->reloadTimeout = elektraReloadTimeout;
+	snapshot->reloadFd = elektraReloadFd;
+
+	elektraRetireSnapshot (snapshot.release ());
+}
+
+/// Answer of elektraGetEnvFast() from a pinned snapshot
+bool elektraGetEnvSnapshot (GetEnvSnapshot const * snapshot, const char * name, gfcn origGetenv, char *& ret)
+{
+	if (snapshot->reloadTimeout > std::chrono::milliseconds::zero ())
+	{
+		if (snapshot->reloadFd != -1)
+		{
+			struct pollfd pfd = { snapshot->reloadFd, POLLIN, 0 };
+			if (poll (&pfd, 1, 0) > 0) return false;
+		}
+		if (std::chrono::system_clock::now ().time_since_epoch ().count () >= elektraReloadNext.load ())
+		{
+			return false;
+		}
+	}
+
+	size_t const h = GetEnvTable::hash (name);
+	if (snapshot->override.lookup (name, h, ret)) return true;
+
+	ret = (*origGetenv) (name);
+	if (ret) return true;
+
+	if (!snapshot->fallback.lookup (name, h, ret)) ret = nullptr;
+	return true;
+}
+
+/**
+ * @brief getenv without locking the mutex
+ *
+ * @retval true if the snapshot had the answer, it is in ret then
+ * @retval false if elektraGetEnv() needs to be called
+ */
+bool elektraGetEnvFast (const char * name, gfcn origGetenv, char *& ret)
+{
+	if (elektraInGetEnv || !origGetenv || !elektraSnapshotCovers (name)) return false;
+	GetEnvSnapshot * snapshot;
+	std::atomic<GetEnvSnapshot *> * hazard = elektraPinSnapshot (snapshot);
+	if (!hazard) return false;
+	bool const found = elektraGetEnvSnapshot (snapshot, name, origGetenv, ret);
+	hazard->store (nullptr);
+	return found;
+}
+
+} // anonymous namespace
+
 
 /**
  * @brief Uses Elektra to get from environment.
@@ -583,7 +924,16 @@ char * elektraGetEnv (const char * cname, gfcn origGetenv)
 		std::chrono::system_clock::time_point const now = std::chrono::system_clock::now ();
 
 		// are we now ready to reload?
-		if (now >= elektraReloadNext)
+		bool reload = now.time_since_epoch ().count () >= elektraReloadNext.load ();
+		if (!reload && elektraReloadFd != -1)
+		{
+			// notifications reload earlier, the timeout still covers
+			// backends which are not watched
+			struct pollfd pfd = { elektraReloadFd, POLLIN, 0 };
+			reload = poll (&pfd, 1, 0) > 0;
+		}
+
+		if (reload)
 		{
 			int ret = kdbGet (elektraRepo, elektraConfig, elektraParentKey);
 
@@ -593,10 +943,11 @@ char * elektraGetEnv (const char * cname, gfcn origGetenv)
 				elektraEnvContext.clearAllLayer ();
 				addLayers ();
 				applyOptions ();
+				elektraSnapshotStale = true;
 			}
 		}
 
-		elektraReloadNext = now + elektraReloadTimeout;
+		elektraReloadNext.store ((now + elektraReloadTimeout).time_since_epoch ().count ());
 	}
 
 	std::string name = cname;
@@ -671,35 +1022,41 @@ char * elektraBootstrapSecureGetEnv (const char * name)
 
 extern "C" char * getenv (const char * name) // throw ()
 {
-	elektraLockMutex ();
+	char * ret;
+	if (elektraGetEnvFast (name, sym.f, ret)) return ret;
+
+	elektraLockInternal ();
 	if (!sym.f || elektraInGetEnv)
 	{
-		char * ret = elektraBootstrapGetEnv (name);
-		elektraUnlockMutex ();
+		ret = elektraBootstrapGetEnv (name);
+		elektraUnlockInternal ();
 		return ret;
 	}
 
 	elektraInGetEnv = true;
-	char * ret = elektraGetEnv (name, sym.f);
+	ret = elektraGetEnv (name, sym.f);
 	elektraInGetEnv = false;
-	elektraUnlockMutex ();
+	elektraUnlockInternal ();
 	return ret;
 }
 
 extern "C" char * secure_getenv (const char * name) // throw ()
 {
-	elektraLockMutex ();
+	char * ret;
+	if (elektraGetEnvFast (name, ssym.f, ret)) return ret;
+
+	elektraLockInternal ();
 	if (!ssym.f || elektraInGetEnv)
 	{
-		char * ret = elektraBootstrapSecureGetEnv (name);
-		elektraUnlockMutex ();
+		ret = elektraBootstrapSecureGetEnv (name);
+		elektraUnlockInternal ();
 		return ret;
 	}
 
 	elektraInGetEnv = true;
-	char * ret = elektraGetEnv (name, ssym.f);
+	ret = elektraGetEnv (name, ssym.f);
 	elektraInGetEnv = false;
-	elektraUnlockMutex ();
+	elektraUnlockInternal ();
 	return ret;
 }
 }
@@ -10,6 +10,10 @@
 #include <gtest/gtest.h>
 #include <kdbgetenv.h>
 
+#include <atomic>
+#include <thread>
+#include <vector>
+
 TEST (GetEnv, NonExist)
 {
 	EXPECT_EQ (getenv ("du4Maiwi/does-not-exist"), static_cast<char *> (nullptr));
@@ -19,7 +23,9 @@ TEST (GetEnv, ExistOverride)
 {
 	using namespace ckdb;
 	elektraOpen (nullptr, nullptr);
+	elektraLockMutex ();
 	ksAppendKey (elektraConfig, keyNew ("user/env/override/does-exist", KEY_VALUE, "hello", KEY_END));
+	elektraUnlockMutex ();
 	ASSERT_NE (getenv ("does-exist"), static_cast<char *> (nullptr));
 	EXPECT_EQ (getenv ("does-exist"), std::string ("hello"));
 	elektraClose ();
@@ -39,7 +45,9 @@ TEST (GetEnv, ExistFallback)
 {
 	using namespace ckdb;
 	elektraOpen (nullptr, nullptr);
+	elektraLockMutex ();
 	ksAppendKey (elektraConfig, keyNew ("user/env/fallback/does-exist", KEY_VALUE, "hello", KEY_END));
+	elektraUnlockMutex ();
 	ASSERT_NE (getenv ("does-exist"), static_cast<char *> (nullptr));
 	EXPECT_EQ (getenv ("does-exist"), std::string ("hello"));
 	elektraClose ();
@@ -53,7 +61,9 @@ TEST (GetEnv, OpenClose)
 	elektraOpen (nullptr, nullptr);
 	// EXPECT_NE(elektraConfig, oldElektraConfig); // even its a new object, it might point to same address
 	EXPECT_EQ (getenv ("du4Maiwi/does-not-exist"), static_cast<char *> (nullptr));
+	elektraLockMutex ();
 	ksAppendKey (elektraConfig, keyNew ("user/env/override/does-exist", KEY_VALUE, "hello", KEY_END));
+	elektraUnlockMutex ();
 
 	ASSERT_NE (getenv ("does-exist"), static_cast<char *> (nullptr));
 	EXPECT_EQ (getenv ("does-exist"), std::string ("hello"));
@@ -61,6 +71,131 @@ TEST (GetEnv, OpenClose)
 	elektraClose ();
 }
 
+TEST (GetEnv, PublishOnUnlock)
+{
+	using namespace ckdb;
+	elektraOpen (nullptr, nullptr);
+	elektraLockMutex ();
+	elektraLockMutex ();
+	ksAppendKey (elektraConfig, keyNew ("user/env/override/is-published", KEY_VALUE, "hello", KEY_END));
+	elektraUnlockMutex ();
+	elektraUnlockMutex ();
+	ASSERT_NE (getenv ("is-published"), static_cast<char *> (nullptr));
+	EXPECT_EQ (getenv ("is-published"), std::string ("hello"));
+	elektraClose ();
+}
+
+TEST (GetEnv, Stable)
+{
+	using namespace ckdb;
+	elektraOpen (nullptr, nullptr);
+	elektraLockMutex ();
+	ksAppendKey (elektraConfig, keyNew ("user/env/override/does-exist", KEY_VALUE, "hello", KEY_END));
+	ksAppendKey (elektraConfig, keyNew ("user/env/override/binary", KEY_BINARY, KEY_END));
+	ksAppendKey (elektraConfig, keyNew ("user/env/fallback/binary", KEY_VALUE, "fallback", KEY_END));
+	elektraUnlockMutex ();
+	char * hello = getenv ("does-exist");
+	ASSERT_NE (hello, static_cast<char *> (nullptr));
+	EXPECT_EQ (getenv ("binary"), static_cast<char *> (nullptr)) << "binary override should hide the fallback";
+
+	elektraLockMutex ();
+	keySetString (ksLookupByName (elektraConfig, "user/env/override/does-exist", 0), "changed");
+	elektraUnlockMutex ();
+	EXPECT_EQ (getenv ("does-exist"), std::string ("changed"));
+	EXPECT_EQ (hello, std::string ("hello")) << "returned values should stay valid";
+	elektraClose ();
+}
+
+TEST (GetEnv, Layer)
+{
+	using namespace ckdb;
+	int argc = 2;
+	const char * cargv[] = { "name", "--elektra%layer%=layer", nullptr };
+	char ** argv = const_cast<char **> (cargv);
+	elektraOpen (&argc, argv);
+	elektraLockMutex ();
+	ksAppendKey (elektraConfig, keyNew ("user/env/override/layer/does-exist-too", KEY_VALUE, "correct", KEY_END));
+	ksAppendKey (elektraConfig, keyNew ("spec/env/override/does-exist", KEY_META, "context", "/env/override/%layer%/does-exist-too",
+					    KEY_END));
+	elektraUnlockMutex ();
+	ASSERT_NE (getenv ("does-exist"), static_cast<char *> (nullptr));
+	EXPECT_EQ (getenv ("does-exist"), std::string ("correct"));
+	elektraClose ();
+}
+
+TEST (GetEnv, Threads)
+{
+	using namespace ckdb;
+	elektraOpen (nullptr, nullptr);
+	setenv ("from-environ", "environ", 1);
+	elektraLockMutex ();
+	ksAppendKey (elektraConfig, keyNew ("user/env/override/does-exist", KEY_VALUE, "hello", KEY_END));
+	ksAppendKey (elektraConfig, keyNew ("user/env/fallback/from-environ", KEY_VALUE, "fallback", KEY_END));
+	elektraUnlockMutex ();
+
+	std::vector<std::thread> threads;
+	std::vector<int> errors (4);
+	for (size_t t = 0; t < errors.size (); ++t)
+	{
+		threads.emplace_back ([&errors, t]() {
+			for (int i = 0; i < 10000; ++i)
+			{
+				char * v = getenv ("does-exist");
+				if (!v || std::string (v) != "hello") ++errors[t];
+				v = getenv ("from-environ");
+				if (!v || std::string (v) != "environ") ++errors[t];
+				if (getenv ("du4Maiwi/does-not-exist")) ++errors[t];
+			}
+		});
+	}
+	for (int i = 0; i < 100; ++i)
+	{
+		elektraLockMutex ();
+		elektraUnlockMutex ();
+	}
+	for (auto & t : threads)
+	{
+		t.join ();
+	}
+	for (size_t t = 0; t < errors.size (); ++t)
+	{
+		EXPECT_EQ (errors[t], 0) << "thread " << t;
+	}
+	unsetenv ("from-environ");
+	elektraClose ();
+}
+
+TEST (GetEnv, CloseWhileReading)
+{
+	using namespace ckdb;
+	std::atomic<bool> done (false);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; ++t)
+	{
+		threads.emplace_back ([&done]() {
+			while (!done.load ())
+			{
+				// the value is not used, elektraClose() frees it
+				getenv ("does-exist");
+			}
+		});
+	}
+	for (int i = 0; i < 100; ++i)
+	{
+		elektraOpen (nullptr, nullptr);
+		elektraLockMutex ();
+		ksAppendKey (elektraConfig, keyNew ("user/env/override/does-exist", KEY_VALUE, "hello", KEY_END));
+		elektraUnlockMutex ();
+		EXPECT_EQ (getenv ("does-exist"), std::string ("hello"));
+		elektraClose ();
+	}
+	done.store (true);
+	for (auto & t : threads)
+	{
+		t.join ();
+	}
+}
+
 void elektraPrintConfig ()
 {
 	using namespace ckdb;
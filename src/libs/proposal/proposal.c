@@ -60,10 +60,7 @@ ssize_t keySetStringF (Key * key, const char * format, ...)
 		return -1;
 	}
 
-	if (key->data.c)
-	{
-		elektraFree (key->data.c);
-	}
+	elektraKeyFreeValue (key);
 
 	key->data.c = p;
 	key->dataSize = elektraStrLen (key->data.c);
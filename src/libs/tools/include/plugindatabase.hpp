@@ -71,6 +71,20 @@ public:
 	 */
 	virtual std::string lookupInfo (PluginSpec const & whichplugin, std::string const & which) const = 0;
 
+	/**
+	 * @brief lookup contract clauses of a plugin loaded without config
+	 *
+	 * Unlike lookupInfo(), implementations may answer from an index
+	 * instead of loading the plugin. lookupMetadata() and
+	 * lookupProvides() use this function for every plugin.
+	 *
+	 * @param plugin the name of the plugin
+	 * @param which about which clause in the contract?
+	 *
+	 * @return the clause of the contract
+	 */
+	virtual std::string lookupIndexedInfo (std::string const & plugin, std::string const & which) const;
+
 	/**
 	 * @brief get exported plugin symbol
 	 *
@@ -134,6 +148,16 @@ public:
 	func_t getSymbol (PluginSpec const & whichplugin, std::string const & which) const;
 	PluginSpec lookupMetadata (std::string const & which) const;
 	PluginSpec lookupProvides (std::string const & provides) const;
+
+	/**
+	 * @brief lookup contract clauses of a plugin loaded without config
+	 *
+	 * provides, metadata, placements, status and needs are answered
+	 * from an index, which is kept in the cache directory of the user
+	 * between processes. A plugin is only loaded if it is not in the
+	 * index yet or its shared library changed since.
+	 */
+	std::string lookupIndexedInfo (std::string const & plugin, std::string const & which) const;
 };
 
 /**
@@ -151,6 +175,7 @@ public:
 	std::vector<std::string> listAllPlugins () const;
 	PluginDatabase::Status status (PluginSpec const & whichplugin) const;
 	std::string lookupInfo (PluginSpec const & spec, std::string const & which) const;
+	std::string lookupIndexedInfo (std::string const & plugin, std::string const & which) const;
 	func_t getSymbol (PluginSpec const & whichplugin, std::string const & which) const;
 	void setCheckconfFunction (checkConfPtr const newCheckconf);
 
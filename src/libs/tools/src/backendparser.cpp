@@ -9,6 +9,7 @@
 
 #include <backendparser.hpp>
 
+#include <functional>
 #include <string>
 
 #include <keyset.hpp>
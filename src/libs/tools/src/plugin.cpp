@@ -203,6 +203,10 @@ void Plugin::check (vector<string> & warnings)
 		pp.push_back ("precommit");
 		pp.push_back ("commit");
 		pp.push_back ("postcommit");
+		pp.push_back ("pregetcache");
+		pp.push_back ("postgetcache");
+		pp.push_back ("pregetnotify");
+		pp.push_back ("postgetnotify");
 		std::string placements = infos["placements"];
 		istringstream is (placements);
 		std::string placement;
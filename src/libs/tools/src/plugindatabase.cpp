@@ -11,31 +11,257 @@
 
 #include <modules.hpp>
 
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <set>
+#include <sstream>
 
 #include <algorithm>
 #include <kdbconfig.h>
 
+#ifdef ELEKTRA_SHARED
+#include <dlfcn.h>
+#endif
+
 #ifdef HAVE_GLOB
 #include <glob.h>
 #endif
 
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
 namespace kdb
 {
 
 namespace tools
 {
 
+namespace
+{
+
+/// the clauses of the contract which are kept in the index
+const std::vector<std::string> indexedInfos = { "provides", "metadata", "placements", "status", "needs" };
+
+/**
+ * @brief The shared library a loaded plugin comes from
+ *
+ * The loader passes the bare library name to dlopen(), so the
+ * dynamic linker decides which file is used.
+ *
+ * @return the absolute file name or an empty string, e.g. for builtin plugins
+ */
+std::string pluginFile (PluginPtr & loaded ELEKTRA_UNUSED)
+{
+#ifdef ELEKTRA_SHARED
+	union {
+		void (*f) ();
+		void * v;
+	} symbol;
+	symbol.f = loaded->getSymbol ("get"); // every plugin exports get
+	Dl_info info;
+	if (dladdr (symbol.v, &info) && info.dli_fname && info.dli_fname[0] == '/')
+	{
+		return info.dli_fname;
+	}
+#endif
+	return "";
+}
+
+/**
+ * @brief Identifies the version of a plugin loaded from file
+ *
+ * @param plugin the name of the plugin
+ * @param file the shared library of the plugin as returned by pluginFile()
+ *
+ * @return the modification time, size and name of file or an empty
+ *         string if it cannot be validated or the dynamic linker
+ *         would now find another file in LD_LIBRARY_PATH
+ */
+std::string pluginStamp (std::string const & plugin ELEKTRA_UNUSED, std::string const & file)
+{
+	if (file.empty ()) return "";
+#if defined(ELEKTRA_SHARED) && defined(HAVE_SYS_STAT_H)
+	struct stat buf;
+	if (stat (file.c_str (), &buf) != 0) return "";
+
+	const char * path = getenv ("LD_LIBRARY_PATH");
+	std::istringstream dirs (path ? path : "");
+	std::string dir;
+	while (std::getline (dirs, dir, ':'))
+	{
+		if (dir.empty ()) continue;
+		struct stat first;
+		if (stat ((dir + "/libelektra-" + plugin + ".so").c_str (), &first) != 0) continue;
+		if (first.st_dev != buf.st_dev || first.st_ino != buf.st_ino) return "";
+		break;
+	}
+
+	return std::to_string (buf.st_mtime) + "." + std::to_string (buf.st_size) + ":" + file;
+#else
+	return "";
+#endif
+}
+
+/// @return the file of a stamp returned by pluginStamp()
+std::string stampFile (std::string const & stamp)
+{
+	size_t const colon = stamp.find (':');
+	return colon == std::string::npos ? "" : stamp.substr (colon + 1);
+}
+
+/**
+ * @return the file where the index is kept between processes
+ *         or an empty string if there is no cache directory
+ */
+std::string indexFile ()
+{
+	const char * cache = getenv ("XDG_CACHE_HOME");
+	if (cache && cache[0] == '/') return std::string (cache) + "/elektra/plugins";
+
+	const char * home = getenv ("HOME");
+	if (home && home[0] == '/') return std::string (home) + "/.cache/elektra/plugins";
+
+	return "";
+}
+}
+
 class ModulesPluginDatabase::Impl
 {
 public:
+	struct Entry
+	{
+		std::string stamp;
+		std::map<std::string, std::string> infos;
+		bool valid = false; ///< loaded or validated by this process
+	};
+
 	Impl ()
 	{
 	}
+
 	~Impl ()
 	{
+		try
+		{
+			write ();
+		}
+		catch (...)
+		{
+		} // the index is only a cache
 	}
+
+	/**
+	 * @brief Get a clause of the contract of a plugin loaded without config
+	 *
+	 * The first call reads the index of the last process. Plugins whose
+	 * shared library changed since then (or which are not in the index)
+	 * are loaded once for all clauses in indexedInfos. Every entry is
+	 * validated at most once per process, entries without a stamp (e.g.
+	 * of builtin plugins) are kept in memory only.
+	 */
+	std::string lookup (std::string const & plugin, std::string const & which)
+	{
+		if (!read) load ();
+
+		auto it = index.find (plugin);
+		if (it != index.end () && !it->second.valid && !it->second.stamp.empty () &&
+		    it->second.stamp == pluginStamp (plugin, stampFile (it->second.stamp)))
+		{
+			it->second.valid = true;
+		}
+		if (it == index.end () || !it->second.valid)
+		{
+			Entry entry;
+			PluginPtr loaded = modules.load (plugin);
+			entry.stamp = pluginStamp (plugin, pluginFile (loaded));
+			for (auto const & info : indexedInfos)
+			{
+				entry.infos[info] = loaded->lookupInfo (info);
+			}
+			entry.valid = true;
+			index[plugin] = entry;
+			it = index.find (plugin);
+			changed = true;
+		}
+		return it->second.infos[which];
+	}
+
 	Modules modules;
+
+private:
+	std::unordered_map<std::string, Entry> index;
+	bool read = false;
+	bool changed = false;
+
+	/// reads lines of: name, stamp and the clauses of indexedInfos, separated by tabs
+	void load ()
+	{
+		read = true;
+		std::string file = indexFile ();
+		if (file.empty ()) return;
+
+		std::ifstream in (file);
+		std::string line;
+		while (std::getline (in, line))
+		{
+			std::vector<std::string> fields;
+			size_t start = 0;
+			for (size_t tab = line.find ('\t'); tab != std::string::npos; tab = line.find ('\t', start))
+			{
+				fields.push_back (line.substr (start, tab - start));
+				start = tab + 1;
+			}
+			fields.push_back (line.substr (start));
+			if (fields.size () != 2 + indexedInfos.size () || fields[1].empty ()) continue; // ignore broken lines
+
+			Entry & entry = index[fields[0]];
+			entry.stamp = fields[1];
+			for (size_t i = 0; i < indexedInfos.size (); ++i)
+			{
+				entry.infos[indexedInfos[i]] = fields[2 + i];
+			}
+		}
+	}
+
+	void write ()
+	{
+		std::string file = indexFile ();
+		if (!changed || file.empty ()) return;
+
+		for (size_t slash = file.find ('/', 1); slash != std::string::npos; slash = file.find ('/', slash + 1))
+		{
+			mkdir (file.substr (0, slash).c_str (), 0700); // may already exist
+		}
+
+		// write a new file and rename it, so that other processes never read a partial index
+		std::string tmp = file + "." + std::to_string (getpid ());
+		{
+			std::ofstream out (tmp);
+			if (!out) return;
+			for (auto const & entry : index)
+			{
+				if (entry.second.stamp.empty ()) continue; // cannot be validated
+				std::string line = entry.first + "\t" + entry.second.stamp;
+				for (auto const & info : indexedInfos)
+				{
+					line += "\t" + entry.second.infos.at (info);
+				}
+				if (std::count (line.begin (), line.end (), '\t') != 1 + static_cast<long> (indexedInfos.size ()) ||
+				    line.find ('\n') != std::string::npos)
+				{
+					continue;
+				}
+				out << line << '\n';
+			}
+		}
+		if (std::rename (tmp.c_str (), file.c_str ()) != 0) std::remove (tmp.c_str ());
+	}
 };
 
 ModulesPluginDatabase::ModulesPluginDatabase () : impl (new ModulesPluginDatabase::Impl ())
@@ -99,15 +325,10 @@ namespace
 bool hasProvides (PluginDatabase const & pd, std::string which)
 {
 	std::vector<std::string> allPlugins = pd.listAllPlugins ();
-	std::map<int, PluginSpec> foundPlugins;
 
 	for (auto const & plugin : allPlugins)
 	{
-		std::istringstream ss (pd.lookupInfo (
-			PluginSpec (
-				plugin,
-				KeySet (5, *Key ("system/module", KEY_VALUE, "this plugin was loaded without a config", KEY_END), KS_END)),
-			"provides"));
+		std::istringstream ss (pd.lookupIndexedInfo (plugin, "provides"));
 		std::string provide;
 		while (ss >> provide)
 		{
@@ -144,6 +365,7 @@ const std::map<std::string, int> PluginDatabase::statusMap = {
    {"final",           50},
    {"global",           1},
    {"preview",        -50},
+   {"nothreads",     -100},
    {"memleak",       -250},
    {"experimental",  -500},
    {"difficult",     -500},
@@ -214,6 +436,24 @@ std::string ModulesPluginDatabase::lookupInfo (PluginSpec const & spec, std::str
 	return plugin->lookupInfo (which);
 }
 
+std::string PluginDatabase::lookupIndexedInfo (std::string const & plugin, std::string const & which) const
+{
+	// TODO remove /module hack
+	return lookupInfo (
+		PluginSpec (plugin,
+			    KeySet (5, *Key ("system/module", KEY_VALUE, "this plugin was loaded without a config", KEY_END), KS_END)),
+		which);
+}
+
+std::string ModulesPluginDatabase::lookupIndexedInfo (std::string const & plugin, std::string const & which) const
+{
+	if (std::find (indexedInfos.begin (), indexedInfos.end (), which) == indexedInfos.end ())
+	{
+		return PluginDatabase::lookupIndexedInfo (plugin, which);
+	}
+	return impl->lookup (plugin, which);
+}
+
 PluginDatabase::func_t ModulesPluginDatabase::getSymbol (PluginSpec const & spec, std::string const & which) const
 {
 	try
@@ -238,22 +478,13 @@ PluginSpec ModulesPluginDatabase::lookupMetadata (std::string const & which) con
 	{
 		try
 		{
-			// TODO remove /module hack
-			std::istringstream ss (
-				lookupInfo (PluginSpec (plugin, KeySet (5, *Key ("system/module", KEY_VALUE,
-										 "this plugin was loaded without a config", KEY_END),
-									KS_END)),
-					    "metadata"));
+			std::istringstream ss (lookupIndexedInfo (plugin, "metadata"));
 			std::string metadata;
 			while (ss >> metadata)
 			{
 				if (metadata == which)
 				{
-					int s = calculateStatus (lookupInfo (
-						PluginSpec (plugin, KeySet (5, *Key ("system/module", KEY_VALUE,
-										     "this plugin was loaded without a config", KEY_END),
-									    KS_END)),
-						"status"));
+					int s = calculateStatus (lookupIndexedInfo (plugin, "status"));
 					foundPlugins.insert (std::make_pair (s, PluginSpec (plugin)));
 					break;
 				}
@@ -295,21 +526,13 @@ PluginSpec ModulesPluginDatabase::lookupProvides (std::string const & which) con
 		try
 		{
 			// TODO: support for generic plugins with config
-			std::istringstream ss (
-				lookupInfo (PluginSpec (plugin, KeySet (5, *Key ("system/module", KEY_VALUE,
-										 "this plugin was loaded without a config", KEY_END),
-									KS_END)),
-					    "provides"));
+			std::istringstream ss (lookupIndexedInfo (plugin, "provides"));
 			std::string provide;
 			while (ss >> provide)
 			{
 				if (provide == which)
 				{
-					int s = calculateStatus (lookupInfo (
-						PluginSpec (plugin, KeySet (5, *Key ("system/module", KEY_VALUE,
-										     "this plugin was loaded without a config", KEY_END),
-									    KS_END)),
-						"status"));
+					int s = calculateStatus (lookupIndexedInfo (plugin, "status"));
 					foundPlugins.insert (std::make_pair (s, PluginSpec (plugin)));
 				}
 			}
@@ -372,6 +595,11 @@ std::string MockPluginDatabase::lookupInfo (PluginSpec const & spec, std::string
 	return "";
 }
 
+std::string MockPluginDatabase::lookupIndexedInfo (std::string const & plugin, std::string const & which) const
+{
+	return PluginDatabase::lookupIndexedInfo (plugin, which);
+}
+
 PluginDatabase::func_t MockPluginDatabase::getSymbol (PluginSpec const & spec ELEKTRA_UNUSED, std::string const & which) const
 {
 	if (which == "checkconf")
@@ -0,0 +1,183 @@
+/**
+ * @file
+ *
+ * @brief Tests for the plugin databases
+ *
+ * @copyright BSD License (see doc/COPYING or http://www.libelektra.org)
+ *
+ */
+
+#include <plugindatabase.hpp>
+
+#include <toolexcept.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace kdb;
+using namespace kdb::tools;
+
+namespace
+{
+PluginSpec withoutConfig (std::string const & plugin)
+{
+	return PluginSpec (plugin,
+			   KeySet (5, *Key ("system/module", KEY_VALUE, "this plugin was loaded without a config", KEY_END), KS_END));
+}
+
+/// Keeps the index of ModulesPluginDatabase out of the cache of the user
+class TempCache : public ::testing::Environment
+{
+public:
+	void SetUp () override
+	{
+		char dir[] = "/tmp/elektra-test-cache.XXXXXX";
+		ASSERT_NE (mkdtemp (dir), nullptr);
+		directory = dir;
+		setenv ("XDG_CACHE_HOME", dir, 1);
+	}
+
+	void TearDown () override
+	{
+		std::remove (indexFile ().c_str ());
+		rmdir ((directory + "/elektra").c_str ());
+		rmdir (directory.c_str ());
+	}
+
+	static std::string indexFile ()
+	{
+		return directory + "/elektra/plugins";
+	}
+
+	static std::string directory;
+};
+
+std::string TempCache::directory;
+
+::testing::Environment * const tempCache = ::testing::AddGlobalTestEnvironment (new TempCache);
+
+std::string readFile (std::string const & file)
+{
+	std::ifstream in (file);
+	std::stringstream content;
+	content << in.rdbuf ();
+	return content.str ();
+}
+}
+
+TEST (PluginDatabase, indexedInfoEqualsInfo)
+{
+	ModulesPluginDatabase mpd;
+	for (auto const & plugin : { "dump", "ini" })
+	{
+		for (auto const & which : { "provides", "metadata", "placements", "status", "needs", "author" })
+		{
+			EXPECT_EQ (mpd.lookupIndexedInfo (plugin, which), mpd.lookupInfo (withoutConfig (plugin), which))
+				<< "clause " << which << " of " << plugin << " differs";
+		}
+	}
+	// answered from the index the second time
+	EXPECT_EQ (mpd.lookupIndexedInfo ("dump", "provides"), "storage");
+}
+
+TEST (PluginDatabase, indexedInfoMissing)
+{
+	ModulesPluginDatabase mpd;
+	EXPECT_THROW (mpd.lookupIndexedInfo ("nonexistingplugin", "provides"), std::exception);
+	EXPECT_THROW (mpd.lookupIndexedInfo ("nonexistingplugin", "provides"), std::exception);
+}
+
+TEST (PluginDatabase, indexStampsLoadedFile)
+{
+	std::remove (TempCache::indexFile ().c_str ());
+	{
+		ModulesPluginDatabase mpd;
+		EXPECT_EQ (mpd.lookupIndexedInfo ("dump", "provides"), "storage");
+	}
+	std::string index = readFile (TempCache::indexFile ());
+	size_t const line = index.find ("dump\t");
+#ifdef ELEKTRA_SHARED
+	ASSERT_NE (line, std::string::npos) << "plugin loaded from a file is not in the index:\n" << index;
+#else
+	EXPECT_EQ (line, std::string::npos) << "builtin plugin cannot be validated but is in the index";
+	return;
+#endif
+
+	// the stamp ends with the file the dynamic linker loaded
+	size_t const tab = index.find ('\t', line + 5);
+	std::string const stamp = index.substr (line + 5, tab - line - 5);
+	ASSERT_NE (stamp.find (":/"), std::string::npos) << stamp;
+	EXPECT_EQ (access (stamp.substr (stamp.find (':') + 1).c_str (), R_OK), 0) << stamp;
+
+	// entries with a valid stamp are used
+	std::string edited = index;
+	edited.replace (tab + 1, sizeof ("storage") - 1, "edited"); // provides is the first clause
+	std::ofstream (TempCache::indexFile ()) << edited;
+	{
+		ModulesPluginDatabase mpd;
+		EXPECT_EQ (mpd.lookupIndexedInfo ("dump", "provides"), "edited");
+	}
+
+	// entries of another file are not
+	std::string other = edited;
+	other.replace (other.find (":/", line), 2, ":/nonexisting/");
+	std::ofstream (TempCache::indexFile ()) << other;
+	{
+		ModulesPluginDatabase mpd;
+		EXPECT_EQ (mpd.lookupIndexedInfo ("dump", "provides"), "storage");
+	}
+}
+
+#ifdef ELEKTRA_SHARED
+TEST (PluginDatabase, indexKeepsUnstampedEntriesInMemory)
+{
+	std::remove (TempCache::indexFile ().c_str ());
+
+	// another library found first in LD_LIBRARY_PATH cannot be stamped
+	std::string const dir = TempCache::directory + "/lib";
+	ASSERT_EQ (mkdir (dir.c_str (), 0700), 0);
+	std::ofstream (dir + "/libelektra-dump.so") << "not the loaded library";
+	const char * path = getenv ("LD_LIBRARY_PATH");
+	std::string const oldPath = path ? path : "";
+	setenv ("LD_LIBRARY_PATH", (dir + ":" + oldPath).c_str (), 1);
+	{
+		ModulesPluginDatabase mpd;
+		EXPECT_EQ (mpd.lookupIndexedInfo ("dump", "provides"), "storage");
+		EXPECT_EQ (mpd.lookupIndexedInfo ("dump", "placements"), mpd.lookupInfo (withoutConfig ("dump"), "placements"));
+	}
+	if (path)
+		setenv ("LD_LIBRARY_PATH", oldPath.c_str (), 1);
+	else
+		unsetenv ("LD_LIBRARY_PATH");
+	std::remove ((dir + "/libelektra-dump.so").c_str ());
+	rmdir (dir.c_str ());
+
+	EXPECT_EQ (readFile (TempCache::indexFile ()).find ("dump\t"), std::string::npos) << "unstamped entry written to the index";
+}
+#endif
+
+TEST (PluginDatabase, mockLookupProvides)
+{
+	MockPluginDatabase mpd;
+	mpd.data[PluginSpec ("a")]["provides"] = "storage";
+	mpd.data[PluginSpec ("a")]["status"] = "experimental";
+	mpd.data[PluginSpec ("b")]["provides"] = "storage";
+	mpd.data[PluginSpec ("b")]["status"] = "recommended";
+	mpd.data[PluginSpec ("c")]["metadata"] = "check/c";
+
+	EXPECT_EQ (mpd.lookupIndexedInfo ("b", "status"), "recommended");
+	EXPECT_EQ (mpd.lookupProvides ("storage").getName (), "b");
+	EXPECT_EQ (mpd.lookupMetadata ("check/c").getName (), "c");
+	EXPECT_EQ (mpd.status (PluginSpec ("storage")), PluginDatabase::provides);
+	EXPECT_THROW (mpd.lookupMetadata ("check/d"), NoPlugin);
+
+	// the mock is not indexed, changes are seen immediately
+	mpd.data[PluginSpec ("a")]["status"] = "default";
+	EXPECT_EQ (mpd.lookupProvides ("storage").getName (), "a");
+}
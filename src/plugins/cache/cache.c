@@ -0,0 +1,297 @@
+/**
+ * @file
+ *
+ * @brief Source for cache plugin
+ *
+ * @copyright BSD License (see doc/COPYING or http://www.libelektra.org)
+ *
+ */
+
+#include "cache.h"
+
+#include <kdbhelper.h>
+#include <kdbmodule.h>
+#include <kdbprivate.h>
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__APPLE__)
+#define elektraStatNanoSeconds(status) (status).st_mtimespec.tv_nsec
+#else
+#define elektraStatNanoSeconds(status) (status).st_mtim.tv_nsec
+#endif
+
+typedef struct
+{
+	KeySet * modules;
+	Plugin * storage; /**< mmapstorage, 0 if it could not be opened */
+	char * directory;
+	KeySet * pending; /**< cache files to write, below the names of the backends */
+} Cache;
+
+/**
+ * FNV-1a, the cache only needs a hash which is equal in every process.
+ */
+static uint64_t cacheHash (uint64_t hash, const void * data, size_t size)
+{
+	const unsigned char * cur = data;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= cur[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+static char * cacheDirectory (KeySet * config)
+{
+	Key * directory = ksLookupByName (config, "/directory", 0);
+	if (directory && keyString (directory)[0] == '/') return elektraStrDup (keyString (directory));
+
+	const char * cache = getenv ("XDG_CACHE_HOME");
+	if (cache && cache[0] == '/') return elektraFormat ("%s/elektra/cache", cache);
+
+	const char * home = getenv ("HOME");
+	if (home && home[0] == '/') return elektraFormat ("%s/.cache/elektra/cache", home);
+
+	return 0;
+}
+
+/**
+ * @brief Create a directory and its parents.
+ */
+static void cacheMakeDirectory (const char * directory)
+{
+	char * path = elektraStrDup (directory);
+	for (char * slash = strchr (path + 1, '/'); slash; slash = strchr (slash + 1, '/'))
+	{
+		*slash = '\0';
+		mkdir (path, 0700); // may already exist
+		*slash = '/';
+	}
+	mkdir (path, 0700);
+	elektraFree (path);
+}
+
+/**
+ * @brief The prefix of the cache files of a backend.
+ *
+ * It identifies the backend by the name of its parent key, its
+ * resolved file name and the signature of its plugins and their
+ * configuration, which kdbGet() passes as metadata cache/backend.
+ * So the same file mounted with other plugins has other cache files.
+ */
+static uint64_t cachePrefix (Key * parentKey)
+{
+	uint64_t hash = cacheHash (0xcbf29ce484222325ULL, keyName (parentKey), keyGetNameSize (parentKey));
+	hash = cacheHash (hash, keyString (parentKey), keyGetValueSize (parentKey));
+	const Key * backend = keyGetMeta (parentKey, "cache/backend");
+	if (backend) hash = cacheHash (hash, keyString (backend), keyGetValueSize (backend));
+	return hash;
+}
+
+/**
+ * @brief The cache file of a backend with the given file status.
+ *
+ * Every change of the file also changes the name of the cache
+ * file, so that a cache file is valid as long as it exists.
+ *
+ * @return the name of the cache file, to be freed with elektraFree()
+ */
+static char * cacheFileName (Cache * cache, Key * parentKey, const struct stat * buf)
+{
+	unsigned long long status[] = { buf->st_dev, buf->st_ino, buf->st_size, buf->st_mtime, elektraStatNanoSeconds (*buf) };
+	uint64_t signature = cacheHash (0xcbf29ce484222325ULL, status, sizeof (status));
+	return elektraFormat ("%s/%016llx-%016llx.mmap", cache->directory, (unsigned long long)cachePrefix (parentKey),
+			      (unsigned long long)signature);
+}
+
+/**
+ * @brief Remove the outdated cache files of a backend.
+ */
+static void cacheRemoveOutdated (Cache * cache, Key * parentKey, const char * current)
+{
+	DIR * dir = opendir (cache->directory);
+	if (!dir) return;
+
+	char prefix[20];
+	snprintf (prefix, sizeof (prefix), "%016llx-", (unsigned long long)cachePrefix (parentKey));
+	const char * base = strrchr (current, '/') + 1;
+
+	struct dirent * entry;
+	while ((entry = readdir (dir)) != 0)
+	{
+		if (strncmp (entry->d_name, prefix, strlen (prefix)) || !strcmp (entry->d_name, base)) continue;
+		char * file = elektraFormat ("%s/%s", cache->directory, entry->d_name);
+		unlink (file);
+		elektraFree (file);
+	}
+	closedir (dir);
+}
+
+int elektraCacheOpen (Plugin * handle, Key * errorKey)
+{
+	Cache * cache = elektraCalloc (sizeof (Cache));
+	if (!cache) return -1;
+
+	cache->modules = ksNew (0, KS_END);
+	cache->pending = ksNew (0, KS_END);
+	// processes with other privileges than their user must not use its cache
+	if (elektraCacheAllowed ()) cache->directory = cacheDirectory (elektraPluginGetConfig (handle));
+	elektraModulesInit (cache->modules, 0);
+	cache->storage = elektraPluginOpen ("mmapstorage", cache->modules, ksNew (0, KS_END), errorKey);
+	elektraPluginSetData (handle, cache);
+	return 1;
+}
+
+int elektraCacheClose (Plugin * handle, Key * errorKey)
+{
+	Cache * cache = elektraPluginGetData (handle);
+	if (!cache) return 1;
+
+	elektraPluginClose (cache->storage, errorKey);
+	elektraModulesClose (cache->modules, 0);
+	ksDel (cache->modules);
+	ksDel (cache->pending);
+	elektraFree (cache->directory);
+	elektraFree (cache);
+	elektraPluginSetData (handle, 0);
+	return 1;
+}
+
+/**
+ * @brief Read the keys of a backend from the cache.
+ *
+ * @param parentKey the parent of the backend, its value is the
+ *        resolved file name of the backend
+ *
+ * @retval 1 if the keys were added from the cache
+ * @retval 0 if the cache is missing or outdated, the cache file
+ *         is then remembered for elektraCacheSet()
+ */
+int elektraCacheGet (Plugin * handle, KeySet * returned, Key * parentKey)
+{
+	if (!strcmp (keyName (parentKey), "system/elektra/modules/cache"))
+	{
+		KeySet * contract =
+			ksNew (30, keyNew ("system/elektra/modules/cache", KEY_VALUE, "cache plugin waits for your orders", KEY_END),
+			       keyNew ("system/elektra/modules/cache/exports", KEY_END),
+			       keyNew ("system/elektra/modules/cache/exports/open", KEY_FUNC, elektraCacheOpen, KEY_END),
+			       keyNew ("system/elektra/modules/cache/exports/close", KEY_FUNC, elektraCacheClose, KEY_END),
+			       keyNew ("system/elektra/modules/cache/exports/get", KEY_FUNC, elektraCacheGet, KEY_END),
+			       keyNew ("system/elektra/modules/cache/exports/set", KEY_FUNC, elektraCacheSet, KEY_END),
+#include ELEKTRA_README (cache)
+			       keyNew ("system/elektra/modules/cache/infos/version", KEY_VALUE, PLUGINVERSION, KEY_END), KS_END);
+		ksAppend (returned, contract);
+		ksDel (contract);
+		return 1;
+	}
+
+	Cache * cache = elektraPluginGetData (handle);
+	if (!cache->storage || !cache->directory || keyString (parentKey)[0] != '/') return 0;
+
+	int errnosave = errno;
+	struct stat buf;
+	Key * pending = ksLookup (cache->pending, parentKey, KDB_O_POP);
+	keyDel (pending);
+	if (stat (keyString (parentKey), &buf) == -1)
+	{
+		errno = errnosave;
+		return 0;
+	}
+
+	char * file = cacheFileName (cache, parentKey, &buf);
+	Key * cacheKey = keyNew (keyName (parentKey), KEY_VALUE, file, KEY_END);
+	KeySet * read = ksNew (0, KS_END);
+	// only files nobody else could have written are read
+	int fd = elektraCacheOpenTrusted (file);
+	if (fd != -1) close (fd);
+	int ret = fd != -1 && cache->storage->kdbGet (cache->storage, read, cacheKey) == 1;
+	if (ret)
+	{
+		ksAppend (returned, read);
+	}
+	else if (buf.st_mtime < time (0))
+	{
+		// files modified within this second might change again without a new time stamp
+		ksAppendKey (cache->pending, keyNew (keyName (parentKey), KEY_VALUE, file, KEY_END));
+	}
+
+	ksDel (read);
+	keyDel (cacheKey);
+	elektraFree (file);
+	errno = errnosave;
+	return ret;
+}
+
+/**
+ * @brief Write the keys of a backend to the cache.
+ *
+ * Only keys of backends not found by elektraCacheGet() are written,
+ * and only if their file did not change since then.
+ *
+ * @retval 1 if the cache was written
+ * @retval 0 otherwise
+ */
+int elektraCacheSet (Plugin * handle, KeySet * returned, Key * parentKey)
+{
+	Cache * cache = elektraPluginGetData (handle);
+	Key * pending = ksLookup (cache->pending, parentKey, KDB_O_POP);
+	if (!pending) return 0;
+
+	int ret = 0;
+	int errnosave = errno;
+	struct stat buf;
+	char * file = 0;
+	char * tmpFile = 0;
+	Key * cacheKey = 0;
+
+	if (stat (keyString (parentKey), &buf) == -1) goto cleanup;
+	file = cacheFileName (cache, parentKey, &buf);
+	if (strcmp (file, keyString (pending))) goto cleanup;
+
+	cacheMakeDirectory (cache->directory);
+	if (!elektraCacheDirectoryTrusted (cache->directory)) goto cleanup;
+	tmpFile = elektraFormat ("%s.XXXXXX", file);
+	int fd = mkstemp (tmpFile);
+	if (fd == -1) goto cleanup;
+	close (fd);
+
+	cacheKey = keyNew (keyName (parentKey), KEY_VALUE, tmpFile, KEY_END);
+	if (cache->storage->kdbSet (cache->storage, returned, cacheKey) == 1 && rename (tmpFile, file) == 0)
+	{
+		cacheRemoveOutdated (cache, parentKey, file);
+		ret = 1;
+	}
+	else
+	{
+		unlink (tmpFile);
+	}
+
+cleanup:
+	keyDel (cacheKey);
+	elektraFree (tmpFile);
+	elektraFree (file);
+	keyDel (pending);
+	errno = errnosave;
+	return ret;
+}
+
+Plugin * ELEKTRA_PLUGIN_EXPORT (cache)
+{
+	// clang-format off
+	return elektraPluginExport ("cache",
+		ELEKTRA_PLUGIN_OPEN,	&elektraCacheOpen,
+		ELEKTRA_PLUGIN_CLOSE,	&elektraCacheClose,
+		ELEKTRA_PLUGIN_GET,	&elektraCacheGet,
+		ELEKTRA_PLUGIN_SET,	&elektraCacheSet,
+		ELEKTRA_PLUGIN_END);
+}
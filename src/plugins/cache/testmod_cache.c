@@ -0,0 +1,183 @@
+/**
+ * @file
+ *
+ * @brief Tests for cache plugin
+ *
+ * @copyright BSD License (see doc/COPYING or http://www.libelektra.org)
+ *
+ */
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include <kdbconfig.h>
+
+#include <tests_plugin.h>
+
+static KeySet * simpleSet (void)
+{
+	return ksNew (10, keyNew ("user/tests/cache", KEY_VALUE, "root", KEY_END),
+		      keyNew ("user/tests/cache/a", KEY_VALUE, "a value", KEY_META, "comment", "a comment", KEY_END),
+		      keyNew ("user/tests/cache/b", KEY_BINARY, KEY_SIZE, 3, KEY_VALUE, "\0\1\2", KEY_END), KS_END);
+}
+
+static void writeFile (const char * file, const char * content)
+{
+	FILE * fp = fopen (file, "w");
+	exit_if_fail (fp, "could not write file");
+	fputs (content, fp);
+	fclose (fp);
+
+	// recently modified files are not cached
+	struct utimbuf times = { 1000, 1000 };
+	utime (file, &times);
+}
+
+static int countFiles (const char * directory)
+{
+	int count = 0;
+	DIR * dir = opendir (directory);
+	if (!dir) return 0;
+	struct dirent * entry;
+	while ((entry = readdir (dir)) != 0)
+	{
+		if (entry->d_name[0] != '.') ++count;
+	}
+	closedir (dir);
+	return count;
+}
+
+static void removeFiles (const char * directory)
+{
+	DIR * dir = opendir (directory);
+	if (!dir) return;
+	struct dirent * entry;
+	while ((entry = readdir (dir)) != 0)
+	{
+		if (entry->d_name[0] == '.') continue;
+		char * file = elektraFormat ("%s/%s", directory, entry->d_name);
+		unlink (file);
+		elektraFree (file);
+	}
+	closedir (dir);
+	rmdir (directory);
+}
+
+static void test_cache ()
+{
+	printf ("test cache\n");
+
+	char * directory = elektraFormat ("%s/cache", tempHome);
+	char * file = elektraFormat ("%s/cache.ecf", tempHome);
+	writeFile (file, "config");
+
+	Key * parentKey = keyNew ("user/tests/cache", KEY_VALUE, file, KEY_END);
+	KeySet * conf = ksNew (1, keyNew ("system/directory", KEY_VALUE, directory, KEY_END), KS_END);
+	PLUGIN_OPEN ("cache");
+
+	KeySet * ks = simpleSet ();
+	KeySet * read = ksNew (0, KS_END);
+	succeed_if (plugin->kdbSet (plugin, ks, parentKey) == 0, "cache written without kdbGet");
+	succeed_if (plugin->kdbGet (plugin, read, parentKey) == 0, "empty cache read");
+	succeed_if (ksGetSize (read) == 0, "keys added from empty cache");
+	succeed_if (plugin->kdbSet (plugin, ks, parentKey) == 1, "could not write cache");
+	succeed_if (countFiles (directory) == 1, "cache file not written");
+	succeed_if (plugin->kdbSet (plugin, ks, parentKey) == 0, "cache written twice");
+
+	succeed_if (plugin->kdbGet (plugin, read, parentKey) == 1, "could not read cache");
+	compare_keyset (read, ks);
+	Key * binary = ksLookupByName (read, "user/tests/cache/b", 0);
+	exit_if_fail (binary, "binary key not found");
+	succeed_if (keyGetValueSize (binary) == 3 && !memcmp (keyValue (binary), "\0\1\2", 3), "wrong binary value");
+	succeed_if_same_string (keyString (keyGetMeta (ksLookupByName (read, "user/tests/cache/a", 0), "comment")), "a comment");
+	ksDel (read);
+
+	// the cache is per backend
+	Key * otherKey = keyNew ("system/tests/cache", KEY_VALUE, file, KEY_END);
+	read = ksNew (0, KS_END);
+	succeed_if (plugin->kdbGet (plugin, read, otherKey) == 0, "cache of other backend read");
+	keyDel (otherKey);
+
+	// and its plugins, e.g. after remounting the file with another storage
+	keySetMeta (parentKey, "cache/backend", "0123456789abcdef");
+	succeed_if (plugin->kdbGet (plugin, read, parentKey) == 0, "cache of other plugins read");
+	keySetMeta (parentKey, "cache/backend", 0);
+
+	// caches others can write are not read
+	chmod (directory, 0770);
+	succeed_if (plugin->kdbGet (plugin, read, parentKey) == 0, "cache in group writable directory read");
+	chmod (directory, 0700);
+	char * cacheFile = 0;
+	DIR * dir = opendir (directory);
+	struct dirent * entry;
+	while (dir && (entry = readdir (dir)) != 0)
+	{
+		if (entry->d_name[0] != '.') cacheFile = elektraFormat ("%s/%s", directory, entry->d_name);
+	}
+	if (dir) closedir (dir);
+	exit_if_fail (cacheFile, "cache file not found");
+	chmod (cacheFile, 0666);
+	succeed_if (plugin->kdbGet (plugin, read, parentKey) == 0, "world writable cache read");
+	chmod (cacheFile, 0600);
+	elektraFree (cacheFile);
+	succeed_if (ksGetSize (read) == 0, "keys added from untrusted cache");
+
+	// a modified file invalidates the cache
+	writeFile (file, "modified");
+	succeed_if (plugin->kdbGet (plugin, read, parentKey) == 0, "outdated cache read");
+	succeed_if (ksGetSize (read) == 0, "keys added from outdated cache");
+	ksAppendKey (ks, keyNew ("user/tests/cache/c", KEY_VALUE, "new", KEY_END));
+	succeed_if (plugin->kdbSet (plugin, ks, parentKey) == 1, "could not write cache");
+	succeed_if (countFiles (directory) == 1, "outdated cache file not removed");
+	succeed_if (plugin->kdbGet (plugin, read, parentKey) == 1, "could not read cache");
+	compare_keyset (read, ks);
+	ksDel (read);
+
+	// files modified while the backend reads them are not cached
+	read = ksNew (0, KS_END);
+	writeFile (file, "again");
+	succeed_if (plugin->kdbGet (plugin, read, parentKey) == 0, "outdated cache read");
+	writeFile (file, "and again");
+	succeed_if (plugin->kdbSet (plugin, ks, parentKey) == 0, "file modified during kdbGet cached");
+
+	// recently modified files are not cached
+	FILE * fp = fopen (file, "w");
+	fclose (fp);
+	succeed_if (plugin->kdbGet (plugin, read, parentKey) == 0, "outdated cache read");
+	succeed_if (plugin->kdbSet (plugin, ks, parentKey) == 0, "recently modified file cached");
+
+	// missing files are not cached
+	unlink (file);
+	succeed_if (plugin->kdbGet (plugin, read, parentKey) == 0, "cache of missing file read");
+	succeed_if (plugin->kdbSet (plugin, ks, parentKey) == 0, "missing file cached");
+	succeed_if (ksGetSize (read) == 0, "keys added for missing file");
+
+	ksDel (read);
+	ksDel (ks);
+	keyDel (parentKey);
+	removeFiles (directory);
+	elektraFree (file);
+	elektraFree (directory);
+
+	PLUGIN_CLOSE ();
+}
+
+
+int main (int argc, char ** argv)
+{
+	printf ("CACHE       TESTS\n");
+	printf ("=================\n\n");
+
+	init (argc, argv);
+
+	test_cache ();
+
+	printf ("\ntestmod_cache RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
+
+	return nbError;
+}
@@ -54,6 +54,23 @@ typedef enum {
 	NOEXPR = -3,
 } CondResult;
 
+/** the number of parsed conditions kept between calls of kdbGet() and kdbSet() */
+#define CONDITIONALS_CACHE_SIZE 64
+
+typedef struct
+{
+	regex_t conditionRegex;    // splits "(condition) ? (then) : (else)"
+	regex_t subConditionRegex; // finds the innermost "(...)"
+	ElektraLru * cache;	// condition strings to ParsedCondition
+} ConditionalsData;
+
+typedef struct
+{
+	char * condition;
+	char * thenexpr;
+	char * elseexpr; // NULL if there is no else branch
+} ParsedCondition;
+
 static int isValidSuffix (char * suffix, const Key * suffixList)
 {
 	if (!suffixList) return 0;
@@ -555,20 +572,10 @@ static const char * isAssign (Key * key, char * expr, Key * parentKey, KeySet *
 	}
 }
 
-static CondResult parseCondition (Key * key, const char * condition, const Key * suffixList, KeySet * ks, Key * parentKey)
+static CondResult parseCondition (const regex_t * regex, Key * key, const char * condition, const Key * suffixList, KeySet * ks,
+				  Key * parentKey)
 {
 	CondResult result = FALSE;
-	const char * regexString = "((\\(([^\\(\\)]*)\\)))";
-	regex_t regex;
-
-	if ((regcomp (&regex, regexString, REG_EXTENDED | REG_NEWLINE)))
-	{
-		ELEKTRA_SET_ERROR (87, parentKey, "Couldn't compile regex: most likely out of memory"); // the regex compiles so the only
-		// possible error would be out of
-		// memory
-		ksDel (ks);
-		return ERROR;
-	}
 
 	char * localCondition = strdup (condition);
 	int subMatches = 4;
@@ -576,7 +583,7 @@ static CondResult parseCondition (Key * key, const char * condition, const Key *
 	char * ptr = localCondition;
 	while (1)
 	{
-		int nomatch = regexec (&regex, ptr, subMatches, m, 0);
+		int nomatch = regexec (regex, ptr, subMatches, m, 0);
 		if (nomatch)
 		{
 			break;
@@ -602,94 +609,105 @@ static CondResult parseCondition (Key * key, const char * condition, const Key *
 		elektraFree (singleCondition);
 	}
 	elektraFree (localCondition);
-	regfree (&regex);
 	return result;
 }
 
 
-static CondResult parseConditionString (const Key * meta, const Key * suffixList, Key * parentKey, Key * key, KeySet * ks, Operation op)
+static char * copyMatch (const char * string, regmatch_t match)
 {
-	const char * conditionString = keyString (meta);
-	const char * regexString = "((\\(((.*)?)\\))[[:space:]]*\\?[[:space:]]*(\\(((.*)?)\\)))($|([[:space:]]*:[[:space:]]*(\\((.*)\\))))";
+	char * copy = elektraMalloc (match.rm_eo - match.rm_so + 1);
+	strncpy (copy, string + match.rm_so, match.rm_eo - match.rm_so);
+	copy[match.rm_eo - match.rm_so] = '\0';
+	return copy;
+}
+
+static void freeParsedCondition (void * value)
+{
+	ParsedCondition * parsed = value;
+	elektraFree (parsed->condition);
+	elektraFree (parsed->thenexpr);
+	if (parsed->elseexpr) elektraFree (parsed->elseexpr);
+	elektraFree (parsed);
+}
+
+/**
+ * @brief Split @p conditionString into condition, then and else or get the split from the cache
+ *
+ * Keys with the same condition (as in arrays) share one split.
+ *
+ * @return the split owned by the cache or NULL after setting an error
+ */
+static const ParsedCondition * getParsedCondition (ConditionalsData * data, const char * conditionString, Key * parentKey)
+{
+	ParsedCondition * parsed = elektraLruGet (data->cache, conditionString);
+	if (parsed) return parsed;
 
-	regex_t regex;
-	CondResult ret;
-	if ((ret = regcomp (&regex, regexString, REGEX_FLAGS_CONDITION)))
-	{
-		ELEKTRA_SET_ERROR (87, parentKey, "Couldn't compile regex: most likely out of memory"); // the regex compiles so the only
-		// possible error would be out of
-		// memory
-		ksDel (ks);
-		return ERROR;
-	}
 	int subMatches = 12;
 	regmatch_t m[subMatches];
-	char * ptr = (char *)conditionString;
-	int nomatch = regexec (&regex, ptr, subMatches, m, 0);
-	if (nomatch)
+	int nomatch = regexec (&data->conditionRegex, conditionString, subMatches, m, 0);
+	if (nomatch || m[2].rm_so == -1 || m[6].rm_so == -1)
 	{
 		ELEKTRA_SET_ERRORF (134, parentKey, "Invalid syntax: \"%s\". Check kdb info conditionals for additional information",
 				    conditionString);
-		regfree (&regex);
-		ksDel (ks);
-		return ERROR;
+		return NULL;
 	}
-	if (m[2].rm_so == -1 || m[6].rm_so == -1)
+
+	parsed = elektraCalloc (sizeof (ParsedCondition));
+	parsed->condition = copyMatch (conditionString, m[2]);
+	parsed->thenexpr = copyMatch (conditionString, m[5]);
+	if (m[10].rm_so != -1) parsed->elseexpr = copyMatch (conditionString, m[10]);
+
+	if (elektraLruPut (data->cache, conditionString, parsed) != 0)
 	{
-		ELEKTRA_SET_ERRORF (134, parentKey, "Invalid syntax: \"%s\". Check kdb info conditionals for additional information",
-				    conditionString);
-		regfree (&regex);
-		ksDel (ks);
-		return ERROR;
+		ELEKTRA_SET_ERROR (87, parentKey, "Out of memory");
+		freeParsedCondition (parsed);
+		return NULL;
 	}
-	char * condition = NULL;
-	char * thenexpr = NULL;
-	char * elseexpr = NULL;
-	int startPos;
-	int endPos;
-	startPos = m[2].rm_so + (ptr - conditionString);
-	endPos = m[2].rm_eo + (ptr - conditionString);
-	condition = elektraMalloc (endPos - startPos + 1);
-	strncpy (condition, conditionString + startPos, endPos - startPos);
-	condition[endPos - startPos] = '\0';
-
-	startPos = m[5].rm_so + (ptr - conditionString);
-	endPos = m[5].rm_eo + (ptr - conditionString);
-	thenexpr = elektraMalloc (endPos - startPos + 1);
-	strncpy (thenexpr, conditionString + startPos, endPos - startPos);
-	thenexpr[endPos - startPos] = '\0';
+	return parsed;
+}
 
-	if (m[10].rm_so != -1)
+/**
+ * @brief Assign the value of @p expr to @p key
+ *
+ * isAssign() modifies its argument, so it gets a copy of the cached expression.
+ */
+static CondResult assignExpr (Key * key, const char * expr, Key * parentKey, KeySet * ks)
+{
+	char * localExpr = strdup (expr);
+	const char * assign = isAssign (key, localExpr, parentKey, ks);
+	CondResult ret = ERROR;
+	if (assign != NULL)
 	{
-		startPos = m[10].rm_so + (ptr - conditionString);
-		endPos = m[10].rm_eo + (ptr - conditionString);
-		elseexpr = elektraMalloc (endPos - startPos + 1);
-		strncpy (elseexpr, conditionString + startPos, endPos - startPos);
-		elseexpr[endPos - startPos] = '\0';
+		keySetString (key, assign);
+		ret = TRUE;
 	}
+	elektraFree (localExpr);
+	return ret;
+}
 
+static CondResult parseConditionString (ConditionalsData * data, const Key * meta, const Key * suffixList, Key * parentKey, Key * key,
+					KeySet * ks, Operation op)
+{
+	const char * conditionString = keyString (meta);
+	const ParsedCondition * parsed = getParsedCondition (data, conditionString, parentKey);
+	if (!parsed) return ERROR;
 
-	ret = parseCondition (key, condition, suffixList, ks, parentKey);
+	const char * condition = parsed->condition;
+	const char * thenexpr = parsed->thenexpr;
+	const char * elseexpr = parsed->elseexpr;
+	const regex_t * regex = &data->subConditionRegex;
+	CondResult ret;
+
+	ret = parseCondition (regex, key, condition, suffixList, ks, parentKey);
 	if (ret == TRUE)
 	{
 		if (op == ASSIGN)
 		{
-			const char * assign = isAssign (key, thenexpr, parentKey, ks);
-			if (assign != NULL)
-			{
-				keySetString (key, assign);
-				ret = TRUE;
-				goto CleanUp;
-			}
-			else
-			{
-				ret = ERROR;
-				goto CleanUp;
-			}
+			ret = assignExpr (key, thenexpr, parentKey, ks);
 		}
 		else
 		{
-			ret = parseCondition (key, thenexpr, suffixList, ks, parentKey);
+			ret = parseCondition (regex, key, thenexpr, suffixList, ks, parentKey);
 			if (ret == FALSE)
 			{
 				ELEKTRA_SET_ERRORF (135, parentKey, "Validation of %s failed. (%s failed)", conditionString, thenexpr);
@@ -708,22 +726,11 @@ static CondResult parseConditionString (const Key * meta, const Key * suffixList
 		{
 			if (op == ASSIGN)
 			{
-				const char * assign = isAssign (key, elseexpr, parentKey, ks);
-				if (assign != NULL)
-				{
-					keySetString (key, assign);
-					ret = TRUE;
-					goto CleanUp;
-				}
-				else
-				{
-					ret = ERROR;
-					goto CleanUp;
-				}
+				ret = assignExpr (key, elseexpr, parentKey, ks);
 			}
 			else
 			{
-				ret = parseCondition (key, elseexpr, suffixList, ks, parentKey);
+				ret = parseCondition (regex, key, elseexpr, suffixList, ks, parentKey);
 				if (ret == FALSE)
 				{
 					ELEKTRA_SET_ERRORF (135, parentKey, "Validation of %s failed. (%s failed)", conditionString,
@@ -748,19 +755,17 @@ static CondResult parseConditionString (const Key * meta, const Key * suffixList
 				    condition);
 	}
 
-CleanUp:
-	elektraFree (condition);
-	elektraFree (thenexpr);
-	if (elseexpr) elektraFree (elseexpr);
-	regfree (&regex);
-	ksDel (ks);
 	return ret;
 }
 
-static CondResult evaluateKey (const Key * meta, const Key * suffixList, Key * parentKey, Key * key, KeySet * ks, Operation op)
+static CondResult evaluateKey (ConditionalsData * data, const Key * meta, const Key * suffixList, Key * parentKey, Key * key, KeySet * ks,
+			       Operation op)
 {
 	CondResult result;
-	result = parseConditionString (meta, suffixList, parentKey, key, ksDup (ks), op);
+	// the lookups move the cursor of the keyset the caller iterates
+	cursor_t cursor = ksGetCursor (ks);
+	result = parseConditionString (data, meta, suffixList, parentKey, key, ks, op);
+	ksSetCursor (ks, cursor);
 	if (result == ERROR)
 	{
 		return ERROR;
@@ -784,13 +789,64 @@ static CondResult evaluateKey (const Key * meta, const Key * suffixList, Key * p
 	return TRUE;
 }
 
-int elektraConditionalsGet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned ELEKTRA_UNUSED, Key * parentKey ELEKTRA_UNUSED)
+int elektraConditionalsOpen (Plugin * handle, Key * errorKey)
+{
+	ConditionalsData * data = elektraCalloc (sizeof (ConditionalsData));
+	if (!data)
+	{
+		ELEKTRA_SET_ERROR (87, errorKey, "Out of memory");
+		return -1;
+	}
+	// the regexes compile so the only possible error would be out of memory
+	if (regcomp (&data->conditionRegex,
+		     "((\\(((.*)?)\\))[[:space:]]*\\?[[:space:]]*(\\(((.*)?)\\)))($|([[:space:]]*:[[:space:]]*(\\((.*)\\))))",
+		     REGEX_FLAGS_CONDITION))
+	{
+		ELEKTRA_SET_ERROR (87, errorKey, "Couldn't compile regex: most likely out of memory");
+		elektraFree (data);
+		return -1;
+	}
+	if (regcomp (&data->subConditionRegex, "((\\(([^\\(\\)]*)\\)))", REG_EXTENDED | REG_NEWLINE))
+	{
+		ELEKTRA_SET_ERROR (87, errorKey, "Couldn't compile regex: most likely out of memory");
+		regfree (&data->conditionRegex);
+		elektraFree (data);
+		return -1;
+	}
+	data->cache = elektraLruNew (CONDITIONALS_CACHE_SIZE, freeParsedCondition);
+	if (!data->cache)
+	{
+		ELEKTRA_SET_ERROR (87, errorKey, "Out of memory");
+		regfree (&data->subConditionRegex);
+		regfree (&data->conditionRegex);
+		elektraFree (data);
+		return -1;
+	}
+	elektraPluginSetData (handle, data);
+	return 1;
+}
+
+int elektraConditionalsClose (Plugin * handle, Key * errorKey ELEKTRA_UNUSED)
+{
+	ConditionalsData * data = elektraPluginGetData (handle);
+	if (!data) return 1;
+	elektraLruDel (data->cache);
+	regfree (&data->subConditionRegex);
+	regfree (&data->conditionRegex);
+	elektraFree (data);
+	elektraPluginSetData (handle, 0);
+	return 1;
+}
+
+int elektraConditionalsGet (Plugin * handle, KeySet * returned ELEKTRA_UNUSED, Key * parentKey ELEKTRA_UNUSED)
 {
 	if (!strcmp (keyName (parentKey), "system/elektra/modules/conditionals"))
 	{
 		KeySet * contract = ksNew (
 			30, keyNew ("system/elektra/modules/conditionals", KEY_VALUE, "conditionals plugin waits for your orders", KEY_END),
 			keyNew ("system/elektra/modules/conditionals/exports", KEY_END),
+			keyNew ("system/elektra/modules/conditionals/exports/open", KEY_FUNC, elektraConditionalsOpen, KEY_END),
+			keyNew ("system/elektra/modules/conditionals/exports/close", KEY_FUNC, elektraConditionalsClose, KEY_END),
 			keyNew ("system/elektra/modules/conditionals/exports/get", KEY_FUNC, elektraConditionalsGet, KEY_END),
 			keyNew ("system/elektra/modules/conditionals/exports/set", KEY_FUNC, elektraConditionalsSet, KEY_END),
 #include ELEKTRA_README (conditionals)
@@ -800,6 +856,7 @@ int elektraConditionalsGet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned EL
 
 		return 1; /* success */
 	}
+	ConditionalsData * data = elektraPluginGetData (handle);
 	Key * cur;
 	ksRewind (returned);
 	CondResult ret = FALSE;
@@ -812,7 +869,7 @@ int elektraConditionalsGet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned EL
 		if (conditionMeta)
 		{
 			CondResult result;
-			result = evaluateKey (conditionMeta, suffixList, parentKey, cur, returned, CONDITION);
+			result = evaluateKey (data, conditionMeta, suffixList, parentKey, cur, returned, CONDITION);
 			if (result == NOEXPR)
 			{
 				ret |= TRUE;
@@ -824,7 +881,7 @@ int elektraConditionalsGet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned EL
 		}
 		if (assignMeta)
 		{
-			ret |= evaluateKey (assignMeta, suffixList, parentKey, cur, returned, ASSIGN);
+			ret |= evaluateKey (data, assignMeta, suffixList, parentKey, cur, returned, ASSIGN);
 		}
 	}
 	if (ret == TRUE) keySetMeta (parentKey, "error", 0);
@@ -832,8 +889,9 @@ int elektraConditionalsGet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned EL
 }
 
 
-int elektraConditionalsSet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned ELEKTRA_UNUSED, Key * parentKey ELEKTRA_UNUSED)
+int elektraConditionalsSet (Plugin * handle, KeySet * returned ELEKTRA_UNUSED, Key * parentKey ELEKTRA_UNUSED)
 {
+	ConditionalsData * data = elektraPluginGetData (handle);
 	Key * cur;
 	ksRewind (returned);
 	CondResult ret = FALSE;
@@ -846,7 +904,7 @@ int elektraConditionalsSet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned EL
 		if (conditionMeta)
 		{
 			CondResult result;
-			result = evaluateKey (conditionMeta, suffixList, parentKey, cur, returned, CONDITION);
+			result = evaluateKey (data, conditionMeta, suffixList, parentKey, cur, returned, CONDITION);
 			if (result == NOEXPR)
 			{
 				ret |= TRUE;
@@ -858,7 +916,7 @@ int elektraConditionalsSet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned EL
 		}
 		if (assignMeta)
 		{
-			ret |= evaluateKey (assignMeta, suffixList, parentKey, cur, returned, ASSIGN);
+			ret |= evaluateKey (data, assignMeta, suffixList, parentKey, cur, returned, ASSIGN);
 		}
 	}
 	if (ret == TRUE) keySetMeta (parentKey, "error", 0);
@@ -869,6 +927,8 @@ Plugin * ELEKTRA_PLUGIN_EXPORT (conditionals)
 {
 	// clang-format off
 	return elektraPluginExport ("conditionals",
+					ELEKTRA_PLUGIN_OPEN, &elektraConditionalsOpen,
+					ELEKTRA_PLUGIN_CLOSE, &elektraConditionalsClose,
 					ELEKTRA_PLUGIN_GET, &elektraConditionalsGet,
 					ELEKTRA_PLUGIN_SET, &elektraConditionalsSet,
 					ELEKTRA_PLUGIN_END);
@@ -56,7 +56,8 @@ static KeySet * nextPackage (FILE * fp, Key * parentKey)
 			if (data) *data = '\0';
 			++data;		     // skip :
 			++data;		     // skip whitespace
-			strtok (data, "\n"); // remove newline
+			char * newline = strchr (data, '\n');
+			if (newline) *newline = '\0'; // remove newline
 			if (!strcmp (section, "Package"))
 			{
 				baseKey = keyDup (parentKey);
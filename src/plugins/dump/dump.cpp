@@ -12,6 +12,7 @@
 using namespace ckdb;
 
 #include <kdberrors.h>
+#include <kdbprivate.h>
 
 
 namespace dump
@@ -120,21 +121,22 @@ int unserialise (std::istream & is, ckdb::Key * errorKey, ckdb::KeySet * ks)
 		}
 		else if (command == "keyNew")
 		{
-			cur = ckdb::keyNew (nullptr);
-
 			ss >> namesize;
 			ss >> valuesize;
 
 			if (namesize > namebuffer.size ()) namebuffer.resize (namesize + 1);
 			is.read (&namebuffer[0], namesize);
 			namebuffer[namesize] = 0;
-			ckdb::keySetName (cur, &namebuffer[0]);
+
+			// keys with invalid names are not created, as they could not be appended
+			ckdb::KeyArena * arena = ckdb::elektraKsArena (ks);
+			cur = arena ? ckdb::elektraKeyArenaKeyNew (arena, &namebuffer[0]) : nullptr;
 
 			if (valuesize > valuebuffer.size ()) valuebuffer.resize (valuesize + 1);
 			is.read (&valuebuffer[0], valuesize);
 			valuebuffer[valuesize] = 0;
 
-			ckdb::keySetRaw (cur, &valuebuffer[0], valuesize);
+			if (cur) ckdb::elektraKeyArenaSetValue (arena, cur, &valuebuffer[0], valuesize);
 			std::getline (is, line);
 		}
 		else if (command == "keyMeta")
@@ -150,7 +152,8 @@ int unserialise (std::istream & is, ckdb::Key * errorKey, ckdb::KeySet * ks)
 			is.read (&valuebuffer[0], valuesize);
 			valuebuffer[valuesize] = 0;
 
-			keySetMeta (cur, &namebuffer[0], &valuebuffer[0]);
+			ckdb::KeyArena * arena = ckdb::elektraKsArena (ks);
+			if (arena) ckdb::elektraKeyArenaSetMeta (arena, cur, &namebuffer[0], &valuebuffer[0]);
 			std::getline (is, line);
 		}
 		else if (command == "keyCopyMeta")
@@ -13,6 +13,8 @@
 #include "kdbconfig.h"
 #endif
 
+#include <kdbease.h>
+#include <kdberrors.h>
 #include <kdbhelper.h>
 
 int elektraGlobMatch (Key * key, const Key * match, int globFlags)
@@ -106,33 +108,65 @@ static KeySet * getGlobKeys (Key * parentKey, KeySet * keys, enum GlobDirection
 	return glob;
 }
 
-static void applyGlob (KeySet * returned, KeySet * glob)
+static int getFlags (const Key * match)
 {
+	const Key * flagKey = keyGetMeta (match, "flags");
+
+	if (flagKey)
+	{
+		char * end;
+		int flags = strtol (keyString (flagKey), &end, 10);
+		if (!*end)
+		{
+			return flags;
+		}
+	}
+
+	/* if no flags were provided, default to FNM_PATHNAME behaviour */
+	return FNM_PATHNAME;
+}
+
+static int applyGlob (KeySet * returned, KeySet * glob, Key * parentKey)
+{
+	size_t size = ksGetSize (glob);
+	if (!size) return 1;
+
+	/* match every key against all glob expressions at once */
+	ElektraGlobMatcher * matcher = elektraGlobMatcherNew ();
+	Key ** globKeys = elektraMalloc (size * sizeof (Key *));
+	Key * match;
+	size_t i = 0;
+	if (!matcher || !globKeys) goto error;
+	ksRewind (glob);
+	while ((match = ksNext (glob)) != 0)
+	{
+		/* the index of the expression must be the index of its glob key */
+		if (elektraGlobMatcherAdd (matcher, keyString (match), getFlags (match)) != (ssize_t)i) goto error;
+		globKeys[i++] = match;
+	}
+
 	Key * cur;
 	ksRewind (returned);
 	while ((cur = ksNext (returned)) != 0)
 	{
-		Key * match;
-		ksRewind (glob);
-		while ((match = ksNext (glob)) != 0)
+		size_t matchesSize;
+		const size_t * matches = elektraGlobMatcherMatch (matcher, keyName (cur), &matchesSize);
+		/* in the order of the glob keys, so later expressions override earlier ones */
+		for (i = 0; i < matchesSize; ++i)
 		{
-			const Key * flagKey = keyGetMeta (match, "flags");
-
-			if (flagKey)
-			{
-				char * end;
-				int flags = strtol (keyString (flagKey), &end, 10);
-				if (!*end)
-				{
-					elektraGlobMatch (cur, match, flags);
-					continue;
-				}
-			}
-
-			/* if no flags were provided, default to FNM_PATHNAME behaviour */
-			elektraGlobMatch (cur, match, FNM_PATHNAME);
+			keyCopyAllMeta (cur, globKeys[matches[i]]);
 		}
 	}
+
+	elektraFree (globKeys);
+	elektraGlobMatcherDel (matcher);
+	return 1;
+
+error:
+	ELEKTRA_SET_ERROR (87, parentKey, "Out of memory");
+	elektraFree (globKeys);
+	elektraGlobMatcherDel (matcher);
+	return -1;
 }
 
 int elektraGlobOpen (Plugin * handle ELEKTRA_UNUSED, Key * parentKey ELEKTRA_UNUSED)
@@ -171,11 +205,11 @@ int elektraGlobGet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned, Key * par
 	ksRewind (keys);
 
 	KeySet * glob = getGlobKeys (parentKey, keys, GET);
-	applyGlob (returned, glob);
+	int ret = applyGlob (returned, glob, parentKey);
 
 	ksDel (glob);
 
-	return 1; /* success */
+	return ret;
 }
 
 
@@ -185,11 +219,11 @@ int elektraGlobSet (Plugin * handle, KeySet * returned, Key * parentKey)
 	ksRewind (keys);
 
 	KeySet * glob = getGlobKeys (parentKey, keys, SET);
-	applyGlob (returned, glob);
+	int ret = applyGlob (returned, glob, parentKey);
 
 	ksDel (glob);
 
-	return 1; /* success */
+	return ret;
 }
 
 Plugin * ELEKTRA_PLUGIN_EXPORT (glob)
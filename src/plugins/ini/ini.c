@@ -14,6 +14,7 @@
 #include "ini.h"
 #include <ctype.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <inih.h>
 #include <kdbease.h>
 #include <kdberrors.h>
@@ -24,6 +25,7 @@
 #include <kdbproposal.h> //elektraKsToMemArray
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 
 char * keyNameGetOneLevel (const char *, size_t *);
@@ -50,7 +52,8 @@ typedef struct
 	short toMeta;
 	char * continuationString;
 	char delim;
-	char * lastOrder;
+	kdb_long_long_t lastOrder; /* number of the last order metadata, 0 before the first get or set */
+	kdb_long_long_t order;	   /* number of the order metadata given to the last section */
 	KeySet * oldKS;
 } IniPluginConfig;
 
@@ -115,9 +118,9 @@ static void keyAddUnescapedBasePath (Key * key, const char * path)
 		keyAddBaseName (key, path);
 		return;
 	}
+	char * buffer = *p ? elektraMalloc (strlen (p) + 1) : NULL;
 	while (*p)
 	{
-		char * buffer = elektraMalloc (size + 1);
 		strncpy (buffer, p, size);
 		buffer[size] = 0;
 		int ret = keyAddName (key, buffer);
@@ -130,38 +133,45 @@ static void keyAddUnescapedBasePath (Key * key, const char * path)
 			keySetName (key, tmp);
 			elektraFree (tmp);
 		}
-		elektraFree (buffer);
 		p = keyNameGetOneLevel (p + size, &size);
 	}
+	elektraFree (buffer);
 }
 
 static Key * createUnescapedKey (Key * key, const char * name)
 {
-	char * dupName = strdup (name);
-	keyAddUnescapedBasePath (key, dupName);
-	free (dupName);
+	keyAddUnescapedBasePath (key, name);
 	return key;
 }
 
-static void setOrderNumber (Key * parentKey, Key * key)
+/**
+ * @brief Start counting the order of the sections at the order of @p parentKey
+ *
+ * The order of the last get or set is continued, unless @p parentKey
+ * already has order metadata. Until finishOrderNumber(), the counter
+ * is only kept as number in @p config.
+ */
+static void startOrderNumber (IniPluginConfig * config, Key * parentKey)
+{
+	if (config->lastOrder && !keyGetMeta (parentKey, "order"))
+		config->order = config->lastOrder;
+	else
+		config->order = 1;
+}
+
+static void finishOrderNumber (IniPluginConfig * config, Key * parentKey)
 {
-	kdb_long_long_t order = 1;
-	const Key * orderKey = keyGetMeta (parentKey, "order");
-	if (orderKey != NULL)
-	{
-		char * ptr = (char *)keyString (orderKey);
-		++ptr; // skip #
-		while (*ptr == '_')
-		{
-			++ptr;
-		}
-		elektraReadArrayNumber (ptr, &order);
-	}
-	++order;
 	char buffer[ELEKTRA_MAX_ARRAY_SIZE];
-	elektraWriteArrayNumber (buffer, order);
-	keySetMeta (key, "order", buffer);
+	elektraWriteArrayNumber (buffer, config->order);
 	keySetMeta (parentKey, "order", buffer);
+	config->lastOrder = config->order;
+}
+
+static void setOrderNumber (IniPluginConfig * config, Key * key)
+{
+	char buffer[ELEKTRA_MAX_ARRAY_SIZE];
+	elektraWriteArrayNumber (buffer, ++config->order);
+	keySetMeta (key, "order", buffer);
 }
 static void setSubOrderNumber (Key * key, const char * oldOrder)
 {
@@ -216,7 +226,10 @@ static void setKeyOrderNumber (Key * sectionKey, Key * key)
 	elektraArrayIncName (newChild);
 	keySetMeta (sectionKey, "ini/key/last", keyBaseName (newChild));
 	keyDel (newChild);
-	keySetMeta (key, "order", keyString (keyGetMeta (sectionKey, "order")));
+	if (keyGetMeta (sectionKey, "order"))
+		keyCopyMeta (key, sectionKey, "order"); // share the metadata instead of formatting it again
+	else
+		keySetMeta (key, "order", keyString (keyGetMeta (sectionKey, "order")));
 }
 
 static int iniKeyToElektraArray (CallbackHandle * handle, Key * existingKey, Key * appendKey, const char * value)
@@ -249,7 +262,7 @@ static int iniKeyToElektraArray (CallbackHandle * handle, Key * existingKey, Key
 		char * origVal = strdup (keyString (existingKey));
 		keySetString (appendKey, "");
 		keySetMeta (appendKey, "ini/array", "#1");
-		setOrderNumber (handle->parentKey, appendKey);
+		setOrderNumber (handle->pluginConfig, appendKey);
 		keySetMeta (appendKey, "parent", 0);
 		ksAppendKey (handle->result, keyDup (appendKey));
 		keySetMeta (appendKey, "ini/arrayMember", "");
@@ -278,7 +291,7 @@ static int iniKeyToElektraArray (CallbackHandle * handle, Key * existingKey, Key
 }
 
 
-static void insertKeyIntoKeySet (Key * parentKey, Key * key, KeySet * ks)
+static void insertKeyIntoKeySet (IniPluginConfig * config, Key * parentKey, Key * key, KeySet * ks)
 {
 	cursor_t savedCursor = ksGetCursor (ks);
 	char * parent = findParent (parentKey, key, ksDup (ks));
@@ -306,7 +319,7 @@ static void insertKeyIntoKeySet (Key * parentKey, Key * key, KeySet * ks)
 		}
 		else
 		{
-			setOrderNumber (parentKey, key);
+			setOrderNumber (config, key);
 		}
 		ksAppend (ks, cutKS);
 		ksDel (cutKS);
@@ -432,7 +445,7 @@ static int iniKeyToElektraKey (void * vhandle, const char * section, const char
 		if (mergeSections)
 		{
 			keySetMeta (appendKey, "order", 0);
-			insertKeyIntoKeySet (handle->parentKey, appendKey, handle->result);
+			insertKeyIntoKeySet (handle->pluginConfig, handle->parentKey, appendKey, handle->result);
 		}
 		else
 		{
@@ -475,7 +488,7 @@ static int iniSectionToElektraKey (void * vhandle, const char * section)
 		keyDel (appendKey);
 		return 1;
 	}
-	setOrderNumber (handle->parentKey, appendKey);
+	setOrderNumber (handle->pluginConfig, appendKey);
 	keySetMeta (appendKey, "ini/key/last", "#0");
 	keySetBinary (appendKey, 0, 0);
 	flushCollectedComment (handle, appendKey);
@@ -497,7 +510,8 @@ int elektraIniOpen (Plugin * handle, Key * parentKey ELEKTRA_UNUSED)
 {
 	KeySet * config = elektraPluginGetConfig (handle);
 	IniPluginConfig * pluginConfig = elektraMalloc (sizeof (IniPluginConfig));
-	pluginConfig->lastOrder = NULL;
+	pluginConfig->lastOrder = 0;
+	pluginConfig->order = 0;
 	pluginConfig->BOM = 0;
 	Key * multilineKey = ksLookupByName (config, "/multiline", KDB_O_NONE);
 	Key * sectionHandlingKey = ksLookupByName (config, "/section", KDB_O_NONE);
@@ -571,7 +585,6 @@ int elektraIniClose (Plugin * handle, Key * parentKey ELEKTRA_UNUSED)
 {
 	IniPluginConfig * pluginConfig = (IniPluginConfig *)elektraPluginGetData (handle);
 	if (pluginConfig->oldKS) ksDel (pluginConfig->oldKS);
-	if (pluginConfig->lastOrder) elektraFree (pluginConfig->lastOrder);
 	elektraFree (pluginConfig->continuationString);
 	elektraFree (pluginConfig);
 	elektraPluginSetData (handle, 0);
@@ -667,8 +680,8 @@ int elektraIniGet (Plugin * handle, KeySet * returned, Key * parentKey)
 	}
 
 
-	FILE * fh = fopen (keyString (parentKey), "r");
-	if (!fh)
+	int fd = open (keyString (parentKey), O_RDONLY);
+	if (fd == -1)
 	{
 		ELEKTRA_SET_ERROR_GET (parentKey);
 		errno = errnosave;
@@ -692,19 +705,17 @@ int elektraIniGet (Plugin * handle, KeySet * returned, Key * parentKey)
 	iniConfig.supportMultiline = pluginConfig->supportMultiline;
 	iniConfig.delim = pluginConfig->delim;
 	pluginConfig->BOM = 0;
-	if (pluginConfig->lastOrder && !keyGetMeta (parentKey, "order"))
-		keySetMeta (parentKey, "order", pluginConfig->lastOrder);
-	else
-		keySetMeta (parentKey, "order", "#1");
+	startOrderNumber (pluginConfig, parentKey);
 	cbHandle.array = pluginConfig->array;
 	cbHandle.mergeSections = pluginConfig->mergeSections;
 	cbHandle.pluginConfig = pluginConfig;
 	cbHandle.toMeta = pluginConfig->toMeta;
-	int ret = ini_parse_file (fh, &iniConfig, &cbHandle);
+	int ret = ini_parse_mapped (fd, &iniConfig, &cbHandle);
+	finishOrderNumber (pluginConfig, parentKey);
 	ksRewind (cbHandle.result);
 	stripInternalData (cbHandle.parentKey, cbHandle.result);
 	setParents (cbHandle.result, cbHandle.parentKey);
-	fclose (fh);
+	close (fd);
 	errno = errnosave;
 	if (ret == 0)
 	{
@@ -735,8 +746,6 @@ int elektraIniGet (Plugin * handle, KeySet * returned, Key * parentKey)
 		ret = -1;
 	}
 	ksDel (cbHandle.result);
-	if (pluginConfig->lastOrder) elektraFree (pluginConfig->lastOrder);
-	pluginConfig->lastOrder = strdup (keyString (keyGetMeta (parentKey, "order")));
 	elektraPluginSetData (handle, pluginConfig);
 	return ret; /* success */
 }
@@ -876,7 +885,7 @@ void createGlobalRoot (Key * parentKey, KeySet * ks)
 	ksAppendKey (ks, appendKey);
 }
 
-void arrayHandler (Key * parentKey, Key * newKey, Key * cur, Key * sectionKey, KeySet * newKS)
+void arrayHandler (IniPluginConfig * config, Key * parentKey, Key * newKey, Key * cur, Key * sectionKey, KeySet * newKS)
 {
 	Key * arrayParentLookup = keyDup (newKey);
 	keySetBaseName (arrayParentLookup, 0);
@@ -930,7 +939,7 @@ void arrayHandler (Key * parentKey, Key * newKey, Key * cur, Key * sectionKey, K
 			keySetBinary (arrayParent, 0, 0);
 			keySetMeta (arrayParent, "ini/array", keyBaseName (cur));
 			ksAppendKey (newKS, arrayParent);
-			insertKeyIntoKeySet (parentKey, arrayParent, newKS);
+			insertKeyIntoKeySet (config, parentKey, arrayParent, newKS);
 			keySetMeta (arrayParent, "ini/key/last", 0);
 			keySetMeta (arrayParent, "ini/key/number", 0);
 		}
@@ -938,7 +947,7 @@ void arrayHandler (Key * parentKey, Key * newKey, Key * cur, Key * sectionKey, K
 		keySetMeta (arrayParent, "ini/array", keyBaseName (cur));
 		keyAddName (newKey, "..");
 		ksAppendKey (newKS, newKey);
-		insertKeyIntoKeySet (parentKey, newKey, newKS);
+		insertKeyIntoKeySet (config, parentKey, newKey, newKS);
 		keySetMeta (newKey, "binary", 0);
 		keySetString (newKey, keyString (cur));
 		keySetMeta (newKey, "ini/key/last", 0);
@@ -1000,7 +1009,7 @@ void insertIntoKS (Key * parentKey, Key * cur, KeySet * newKS, IniPluginConfig *
 		{
 			keySetBinary (sectionKey, 0, 0);
 			ksAppendKey (newKS, sectionKey);
-			insertKeyIntoKeySet (parentKey, sectionKey, newKS);
+			insertKeyIntoKeySet (pluginConfig, parentKey, sectionKey, newKS);
 		}
 		else
 		{
@@ -1015,12 +1024,12 @@ void insertIntoKS (Key * parentKey, Key * cur, KeySet * newKS, IniPluginConfig *
 	{
 		if ((elektraArrayValidateName (newKey) == 1) && pluginConfig->array)
 		{
-			arrayHandler (parentKey, newKey, cur, sectionKey, newKS);
+			arrayHandler (pluginConfig, parentKey, newKey, cur, sectionKey, newKS);
 		}
 		else
 		{
 			ksAppendKey (newKS, newKey);
-			insertKeyIntoKeySet (parentKey, newKey, newKS);
+			insertKeyIntoKeySet (pluginConfig, parentKey, newKey, newKS);
 		}
 	}
 	keyDel (appendKey);
@@ -1386,11 +1395,12 @@ static void stripInternalData (Key * parentKey ELEKTRA_UNUSED, KeySet * ks)
 			char * oldName = strdup (keyName (cur));
 			char * newName = elektraCalloc (elektraStrLen (keyName (cur)));
 			char * token = NULL;
-			token = strtok (oldName, "/");
+			char * saveptr = NULL;
+			token = strtok_r (oldName, "/", &saveptr);
 			strcat (newName, token);
 			while (token != NULL)
 			{
-				token = strtok (NULL, "/");
+				token = strtok_r (NULL, "/", &saveptr);
 				if (token == NULL) break;
 				if (!strcmp (token, INTERNAL_ROOT_SECTION)) continue;
 				strcat (newName, "/");
@@ -1479,10 +1489,7 @@ int elektraIniSet (Plugin * handle, KeySet * returned, Key * parentKey)
 	Key * root = keyDup (ksLookup (returned, parentKey, KDB_O_NONE));
 	Key * head = keyDup (ksHead (returned));
 	IniPluginConfig * pluginConfig = elektraPluginGetData (handle);
-	if (pluginConfig->lastOrder && !keyGetMeta (parentKey, "order"))
-		keySetMeta (parentKey, "order", pluginConfig->lastOrder);
-	else
-		keySetMeta (parentKey, "order", "#1");
+	startOrderNumber (pluginConfig, parentKey);
 	Key * cur;
 	KeySet * newKS = ksNew (0, KS_END);
 	ksRewind (returned);
@@ -1506,6 +1513,7 @@ int elektraIniSet (Plugin * handle, KeySet * returned, Key * parentKey)
 	ksClear (returned);
 	ksAppend (returned, newKS);
 	ksDel (newKS);
+	finishOrderNumber (pluginConfig, parentKey);
 	setParents (returned, parentKey);
 	stripInternalData (parentKey, returned);
 	if (pluginConfig->BOM == 1)
@@ -1532,8 +1540,6 @@ int elektraIniSet (Plugin * handle, KeySet * returned, Key * parentKey)
 
 	fclose (fh);
 	errno = errnosave;
-	if (pluginConfig->lastOrder) elektraFree (pluginConfig->lastOrder);
-	pluginConfig->lastOrder = strdup (keyString (keyGetMeta (parentKey, "order")));
 	elektraPluginSetData (handle, pluginConfig);
 
 
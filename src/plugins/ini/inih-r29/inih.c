@@ -13,6 +13,13 @@ http://code.google.com/p/inih/
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef MAP_POPULATE
+#define MAP_POPULATE 0
+#endif
 
 #if !INI_USE_STACK
 #include <stdlib.h>
@@ -56,11 +63,14 @@ static char * find_char_or_comment (const char * s, char c)
 	return (char *)s;
 }
 
-/* Version of strncpy that ensures dest (size bytes) is null-terminated. */
+/* Version of strncpy that ensures dest (size bytes) is null-terminated.
+   Unlike strncpy, the rest of dest is not filled with nulls, which would
+   clear the whole section or name buffer for every line. */
 static char * strncpy0 (char * dest, const char * src, size_t size)
 {
-	strncpy (dest, src, size);
-	dest[size - 1] = '\0';
+	size_t length = strnlen (src, size - 1);
+	memmove (dest, src, length);
+	dest[length] = '\0';
 	return dest;
 }
 
@@ -97,8 +107,75 @@ static int isComment (const char * line)
 	return 0;
 }
 
-/* See documentation in header file. */
-int ini_parse_file (FILE * file, const struct IniConfig * config, void * user)
+/* Source of the lines for ini_parse_lines(): either fgets() into a
+   buffer or the lines of a private mapping of the file, terminated in
+   place. */
+typedef struct
+{
+	FILE * file;
+	char * buffer;
+	char * next;	   /* start of the next line in the mapping */
+	char * end;	   /* end of the mapping */
+	char * terminator; /* where the current line was terminated */
+	char saved;	   /* the character overwritten by the terminator */
+	char * last;	   /* copy of the last line of the mapping */
+	int error;
+} IniReader;
+
+/* Return the next line including its newline, or NULL at the end.
+
+   Every line of the mapping but the last one is followed by the first
+   character of the next line, which is replaced by a null until the
+   next call. The last line is copied, because there might be no room
+   for the null behind it. Like with fgets(), the parser may look one or
+   two characters past the null, so the copy is padded. */
+static char * nextLine (IniReader * reader)
+{
+	if (reader->file) return fgets (reader->buffer, INI_MAX_LINE, reader->file);
+
+	if (reader->terminator)
+	{
+		*reader->terminator = reader->saved;
+		reader->terminator = NULL;
+	}
+	if (reader->next >= reader->end) return NULL;
+
+	char * line = reader->next;
+	size_t size = reader->end - line;
+	char * newline = memchr (line, '\n', size);
+	if (!newline || newline + 1 == reader->end)
+	{
+		reader->next = reader->end;
+		reader->last = calloc (size + 3, 1);
+		if (!reader->last)
+		{
+			reader->error = -2;
+			return NULL;
+		}
+		memcpy (reader->last, line, size);
+		return reader->last;
+	}
+	reader->next = newline + 1;
+	reader->terminator = reader->next;
+	reader->saved = *reader->terminator;
+	*reader->terminator = '\0';
+	return line;
+}
+
+/* Count the delimiters of a key line, but stop at 2 because only
+   whether there are none, one or more matters. */
+static unsigned int countDelim (const char * line, char delim)
+{
+	unsigned int assign = 0;
+	while (assign < 2 && (line = strchr (line, delim)) != NULL)
+	{
+		++assign;
+		++line;
+	}
+	return assign;
+}
+
+static int ini_parse_lines (IniReader * reader, const struct IniConfig * config, void * user)
 {
 	/* Uses a fair bit of stack (use heap instead if you need to) */
 	char * line;
@@ -114,15 +191,8 @@ int ini_parse_file (FILE * file, const struct IniConfig * config, void * user)
 	int lineno = 0;
 	int error = 0;
 
-	line = (char *)malloc (INI_MAX_LINE);
-
-	if (!line)
-	{
-		return -2;
-	}
-
 	/* Scan through file line by line */
-	while (fgets (line, INI_MAX_LINE, file) != NULL)
+	while ((line = nextLine (reader)) != NULL)
 	{
 		lineno++;
 
@@ -180,7 +250,7 @@ int ini_parse_file (FILE * file, const struct IniConfig * config, void * user)
 				if (*end == '\n')
 				{
 					strncpy0 (section, start, sizeof (section));
-					while (fgets (line, INI_MAX_LINE, file))
+					while ((line = nextLine (reader)))
 					{
 						end = line + (strlen (line) - 1);
 						while ((end > line) && *end != ']')
@@ -218,15 +288,7 @@ int ini_parse_file (FILE * file, const struct IniConfig * config, void * user)
 			// is a key
 
 			char * ptr = start;
-			unsigned int assign = 0;
-			while (*ptr)
-			{
-				if (*ptr == delim)
-				{
-					++assign;
-				}
-				++ptr;
-			}
+			unsigned int assign = countDelim (start, delim);
 
 			if (assign == 1)
 			{
@@ -248,7 +310,7 @@ int ini_parse_file (FILE * file, const struct IniConfig * config, void * user)
 					{
 						++name;
 						strncpy0 (prev_name, name, sizeof (prev_name));
-						while (fgets (line, INI_MAX_LINE, file))
+						while ((line = nextLine (reader)))
 						{
 							end = line + (strlen (line) - 1);
 							while (end > line && *end != '"')
@@ -313,7 +375,7 @@ int ini_parse_file (FILE * file, const struct IniConfig * config, void * user)
 					else
 					{
 						strncpy0 (prev_name, start, sizeof (prev_name));
-						while (fgets (line, INI_MAX_LINE, file))
+						while ((line = nextLine (reader)))
 						{
 							end = line + (strlen (line) - 1);
 							while (end > line && *end != '"')
@@ -462,7 +524,62 @@ int ini_parse_file (FILE * file, const struct IniConfig * config, void * user)
 #endif
 	}
 
-	free (line);
+	if (reader->error) return reader->error;
+	return error;
+}
+
+/* See documentation in header file. */
+int ini_parse_file (FILE * file, const struct IniConfig * config, void * user)
+{
+	IniReader reader = { 0 };
+	reader.file = file;
+	reader.buffer = (char *)malloc (INI_MAX_LINE);
+
+	if (!reader.buffer)
+	{
+		return -2;
+	}
+
+	int error = ini_parse_lines (&reader, config, user);
+	free (reader.buffer);
+	return error;
+}
+
+/* See documentation in header file. */
+int ini_parse_mapped (int fd, const struct IniConfig * config, void * user)
+{
+	struct stat buf;
+	if (fstat (fd, &buf) == -1) return -1;
+
+	if (!S_ISREG (buf.st_mode))
+	{
+		/* pipes and the like cannot be mapped */
+		int copy = dup (fd);
+		FILE * file = copy == -1 ? NULL : fdopen (copy, "r");
+		if (!file)
+		{
+			if (copy != -1) close (copy);
+			return -1;
+		}
+		int error = ini_parse_file (file, config, user);
+		fclose (file);
+		return error;
+	}
+	if (buf.st_size == 0) return 0;
+
+	/* private, so terminating the lines does not change the file,
+	   populated, so the pages are not faulted in one by one */
+	char * data = mmap (NULL, buf.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+	if (data == MAP_FAILED) return -1;
+
+	IniReader reader = { 0 };
+	reader.next = data;
+	reader.end = data + buf.st_size;
+
+	int error = ini_parse_lines (&reader, config, user);
+	if (reader.terminator) *reader.terminator = reader.saved;
+	munmap (data, buf.st_size);
+	free (reader.last);
 	return error;
 }
 
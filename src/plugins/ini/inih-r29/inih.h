@@ -53,6 +53,13 @@ int ini_parse (const char * filename, const struct IniConfig * config, void * us
    close the file when it's finished -- the caller must do that. */
 int ini_parse_file (FILE * file, const struct IniConfig * config, void * user);
 
+/* Same as ini_parse_file(), but takes a file descriptor of the file. The
+   file is mapped privately and its lines are terminated in place instead
+   of being copied one by one into a line buffer, so lines are not limited
+   by INI_MAX_LINE. Files which cannot be mapped, like pipes, are read with
+   ini_parse_file(). This doesn't close the file descriptor. */
+int ini_parse_mapped (int fd, const struct IniConfig * config, void * user);
+
 /* Nonzero to allow multi-line value parsing, in the style of Python's
    ConfigParser. If allowed, ini_parse() will call the handler with the same
    name for each subsequent line parsed. */
@@ -0,0 +1,281 @@
+/**
+ * @file
+ *
+ * @brief Source for inotify plugin
+ *
+ * @copyright BSD License (see doc/COPYING or http://www.libelektra.org)
+ *
+ */
+
+#include "inotify.h"
+
+#include <kdbhelper.h>
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#define INOTIFY_MASK                                                                                                                       \
+	(IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF)
+
+typedef struct
+{
+	char * name;		 /**< the parent key of the backend */
+	char * filename;	 /**< the resolved file, 0 if not watched yet */
+	int wd;			 /**< the watch of the directory of the file */
+	unsigned int armed : 1;  /**< the file was watched since the resolver ran */
+	unsigned int dirty : 1;  /**< the file might have changed since the resolver ran */
+	unsigned int changed : 1; /**< the file changed since elektraInotifyChanged() */
+} Watch;
+
+typedef struct
+{
+	int fd;
+	Watch * watches;
+	size_t size;
+	size_t alloc;
+	KeySet * index; /**< position in watches below the names of the backends */
+} Inotify;
+
+int elektraInotifyOpen (Plugin * handle, Key * errorKey ELEKTRA_UNUSED)
+{
+	Inotify * inotify = elektraCalloc (sizeof (Inotify));
+	if (!inotify) return -1;
+
+	int errnosave = errno;
+	inotify->fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+	errno = errnosave;
+	inotify->index = ksNew (0, KS_END);
+	elektraPluginSetData (handle, inotify);
+	return 1;
+}
+
+int elektraInotifyClose (Plugin * handle, Key * errorKey ELEKTRA_UNUSED)
+{
+	Inotify * inotify = elektraPluginGetData (handle);
+	if (!inotify) return 1;
+
+	if (inotify->fd != -1) close (inotify->fd);
+	for (size_t i = 0; i < inotify->size; ++i)
+	{
+		elektraFree (inotify->watches[i].name);
+		elektraFree (inotify->watches[i].filename);
+	}
+	elektraFree (inotify->watches);
+	ksDel (inotify->index);
+	elektraFree (inotify);
+	elektraPluginSetData (handle, 0);
+	return 1;
+}
+
+static Watch * inotifyFind (Inotify * inotify, Key * parentKey)
+{
+	Key * found = ksLookup (inotify->index, parentKey, 0);
+	if (!found) return 0;
+	return &inotify->watches[*(const size_t *)keyValue (found)];
+}
+
+static Watch * inotifyAdd (Inotify * inotify, Key * parentKey)
+{
+	if (inotify->size == inotify->alloc)
+	{
+		size_t alloc = inotify->alloc ? inotify->alloc * 2 : 16;
+		if (elektraRealloc ((void **)&inotify->watches, alloc * sizeof (Watch)) == -1) return 0;
+		inotify->alloc = alloc;
+	}
+
+	size_t pos = inotify->size++;
+	Watch * watch = &inotify->watches[pos];
+	memset (watch, 0, sizeof (Watch));
+	watch->name = elektraStrDup (keyName (parentKey));
+	watch->wd = -1;
+	ksAppendKey (inotify->index, keyNew (keyName (parentKey), KEY_CASCADING_NAME, KEY_BINARY, KEY_SIZE, sizeof (pos), KEY_VALUE, &pos, KEY_END));
+	return watch;
+}
+
+/**
+ * @brief Check if any backend still needs the watch wd.
+ *
+ * Files in the same directory share the watch of the directory.
+ */
+static int inotifyWatched (Inotify * inotify, int wd)
+{
+	for (size_t i = 0; i < inotify->size; ++i)
+	{
+		if (inotify->watches[i].wd == wd) return 1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Mark the watches of all events received so far.
+ */
+static void inotifyDrain (Inotify * inotify)
+{
+	char buffer[4096] __attribute__ ((aligned (__alignof__ (struct inotify_event))));
+	int errnosave = errno;
+	ssize_t len;
+	while ((len = read (inotify->fd, buffer, sizeof (buffer))) > 0)
+	{
+		const struct inotify_event * event;
+		for (char * cur = buffer; cur < buffer + len; cur += sizeof (struct inotify_event) + event->len)
+		{
+			event = (const struct inotify_event *)cur;
+			for (size_t i = 0; i < inotify->size; ++i)
+			{
+				Watch * watch = &inotify->watches[i];
+				if (!(event->mask & IN_Q_OVERFLOW))
+				{
+					if (!watch->filename || watch->wd != event->wd) continue;
+					// events of the directory itself have no name
+					if (event->len && strcmp (event->name, strrchr (watch->filename, '/') + 1)) continue;
+					if (event->mask & IN_IGNORED)
+					{
+						watch->wd = -1;
+						watch->armed = 0;
+					}
+				}
+				watch->dirty = 1;
+				watch->changed = 1;
+			}
+		}
+	}
+	errno = errnosave;
+}
+
+/**
+ * @brief Check if the file of a backend changed.
+ *
+ * @param parentKey the parent of the backend
+ *
+ * @retval 0 if the file is unchanged since the resolver ran the last
+ *         time, the value of @p parentKey is the resolved file then
+ * @retval 1 if the resolver needs to check the file
+ */
+int elektraInotifyGet (Plugin * handle, KeySet * returned, Key * parentKey)
+{
+	if (!strcmp (keyName (parentKey), "system/elektra/modules/inotify"))
+	{
+		KeySet * contract =
+			ksNew (30, keyNew ("system/elektra/modules/inotify", KEY_VALUE, "inotify plugin waits for your orders", KEY_END),
+			       keyNew ("system/elektra/modules/inotify/exports", KEY_END),
+			       keyNew ("system/elektra/modules/inotify/exports/open", KEY_FUNC, elektraInotifyOpen, KEY_END),
+			       keyNew ("system/elektra/modules/inotify/exports/close", KEY_FUNC, elektraInotifyClose, KEY_END),
+			       keyNew ("system/elektra/modules/inotify/exports/get", KEY_FUNC, elektraInotifyGet, KEY_END),
+			       keyNew ("system/elektra/modules/inotify/exports/set", KEY_FUNC, elektraInotifySet, KEY_END),
+			       keyNew ("system/elektra/modules/inotify/exports/fd", KEY_FUNC, elektraInotifyFd, KEY_END),
+			       keyNew ("system/elektra/modules/inotify/exports/changed", KEY_FUNC, elektraInotifyChanged, KEY_END),
+#include ELEKTRA_README (inotify)
+			       keyNew ("system/elektra/modules/inotify/infos/version", KEY_VALUE, PLUGINVERSION, KEY_END), KS_END);
+		ksAppend (returned, contract);
+		ksDel (contract);
+		return 1;
+	}
+
+	Inotify * inotify = elektraPluginGetData (handle);
+	if (inotify->fd == -1) return 1;
+
+	inotifyDrain (inotify);
+	Watch * watch = inotifyFind (inotify, parentKey);
+	if (!watch || !watch->armed || watch->dirty) return 1;
+
+	keySetString (parentKey, watch->filename);
+	return 0;
+}
+
+/**
+ * @brief Watch the file of a backend after its resolver ran.
+ *
+ * @param parentKey the parent of the backend, its value is the
+ *        resolved file name
+ *
+ * @retval 1 if the file is watched
+ * @retval 0 otherwise
+ */
+int elektraInotifySet (Plugin * handle, KeySet * returned ELEKTRA_UNUSED, Key * parentKey)
+{
+	Inotify * inotify = elektraPluginGetData (handle);
+	const char * filename = keyString (parentKey);
+	if (inotify->fd == -1 || filename[0] != '/') return 0;
+
+	Watch * watch = inotifyFind (inotify, parentKey);
+	if (!watch) watch = inotifyAdd (inotify, parentKey);
+	if (!watch) return 0;
+
+	if (watch->armed && !strcmp (watch->filename, filename))
+	{
+		// events after the resolver ran are still queued
+		watch->dirty = 0;
+		return 1;
+	}
+
+	elektraFree (watch->filename);
+	watch->filename = elektraStrDup (filename);
+	char * directory = elektraStrDup (filename);
+	char * slash = strrchr (directory, '/');
+	slash[slash == directory ? 1 : 0] = '\0';
+
+	int errnosave = errno;
+	int oldWd = watch->wd;
+	watch->wd = inotify_add_watch (inotify->fd, directory, INOTIFY_MASK);
+	if (oldWd != -1 && oldWd != watch->wd && !inotifyWatched (inotify, oldWd))
+	{
+		// the directory of the previous file is not needed anymore
+		inotify_rm_watch (inotify->fd, oldWd);
+	}
+	errno = errnosave;
+	elektraFree (directory);
+
+	// the file might have changed before the watch started
+	watch->armed = watch->wd != -1;
+	watch->dirty = 1;
+	return watch->armed;
+}
+
+/**
+ * @brief The file descriptor of inotify, readable on changes.
+ */
+int elektraInotifyFd (Plugin * handle)
+{
+	Inotify * inotify = elektraPluginGetData (handle);
+	return inotify->fd;
+}
+
+/**
+ * @brief Append the backends changed since the last call.
+ *
+ * @param changed gets a key per changed backend, named after it
+ *        and with the resolved file name as value
+ *
+ * @return the number of changed backends
+ */
+int elektraInotifyChanged (Plugin * handle, KeySet * changed)
+{
+	Inotify * inotify = elektraPluginGetData (handle);
+	if (inotify->fd == -1) return 0;
+
+	inotifyDrain (inotify);
+	int count = 0;
+	for (size_t i = 0; i < inotify->size; ++i)
+	{
+		Watch * watch = &inotify->watches[i];
+		if (!watch->changed) continue;
+		ksAppendKey (changed, keyNew (watch->name, KEY_CASCADING_NAME, KEY_VALUE, watch->filename, KEY_END));
+		watch->changed = 0;
+		++count;
+	}
+	return count;
+}
+
+Plugin * ELEKTRA_PLUGIN_EXPORT (inotify)
+{
+	// clang-format off
+	return elektraPluginExport ("inotify",
+		ELEKTRA_PLUGIN_OPEN,	&elektraInotifyOpen,
+		ELEKTRA_PLUGIN_CLOSE,	&elektraInotifyClose,
+		ELEKTRA_PLUGIN_GET,	&elektraInotifyGet,
+		ELEKTRA_PLUGIN_SET,	&elektraInotifySet,
+		ELEKTRA_PLUGIN_END);
+}
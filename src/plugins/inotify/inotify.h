@@ -0,0 +1,26 @@
+/**
+ * @file
+ *
+ * @brief Header for inotify plugin
+ *
+ * @copyright BSD License (see doc/COPYING or http://www.libelektra.org)
+ *
+ */
+
+#ifndef ELEKTRA_PLUGIN_INOTIFY_H
+#define ELEKTRA_PLUGIN_INOTIFY_H
+
+#include <kdbplugin.h>
+
+
+int elektraInotifyOpen (Plugin * handle, Key * errorKey);
+int elektraInotifyClose (Plugin * handle, Key * errorKey);
+int elektraInotifyGet (Plugin * handle, KeySet * ks, Key * parentKey);
+int elektraInotifySet (Plugin * handle, KeySet * ks, Key * parentKey);
+
+int elektraInotifyFd (Plugin * handle);
+int elektraInotifyChanged (Plugin * handle, KeySet * changed);
+
+Plugin * ELEKTRA_PLUGIN_EXPORT (inotify);
+
+#endif
@@ -0,0 +1,213 @@
+/**
+ * @file
+ *
+ * @brief Tests for inotify plugin
+ *
+ * @copyright BSD License (see doc/COPYING or http://www.libelektra.org)
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <kdbconfig.h>
+
+#include <tests_plugin.h>
+
+static void writeFile (const char * file, const char * content)
+{
+	FILE * fp = fopen (file, "w");
+	exit_if_fail (fp, "could not write file");
+	fputs (content, fp);
+	fclose (fp);
+}
+
+static int check (Plugin * plugin, Key * parentKey)
+{
+	keySetString (parentKey, "");
+	return plugin->kdbGet (plugin, 0, parentKey);
+}
+
+static int watch (Plugin * plugin, Key * parentKey, const char * file)
+{
+	keySetString (parentKey, file);
+	return plugin->kdbSet (plugin, 0, parentKey);
+}
+
+static int changed (Plugin * plugin, KeySet * ks)
+{
+	KeySet * contract = ksNew (0, KS_END);
+	Key * root = keyNew ("system/elektra/modules/inotify", KEY_END);
+	plugin->kdbGet (plugin, contract, root);
+	Key * found = ksLookupByName (contract, "system/elektra/modules/inotify/exports/changed", 0);
+	exit_if_fail (found, "changed not exported");
+
+	union {
+		int (*f) (Plugin *, KeySet *);
+		void * v;
+	} conversation;
+	succeed_if (keyGetBinary (found, &conversation.v, sizeof (conversation)) == sizeof (conversation), "could not get binary");
+
+	ksDel (contract);
+	keyDel (root);
+	return conversation.f (plugin, ks);
+}
+
+/// number of directories watched, see proc(5)
+static int watched (Plugin * plugin)
+{
+	KeySet * contract = ksNew (0, KS_END);
+	Key * root = keyNew ("system/elektra/modules/inotify", KEY_END);
+	plugin->kdbGet (plugin, contract, root);
+	Key * found = ksLookupByName (contract, "system/elektra/modules/inotify/exports/fd", 0);
+	exit_if_fail (found, "fd not exported");
+
+	union {
+		int (*f) (Plugin *);
+		void * v;
+	} conversation;
+	succeed_if (keyGetBinary (found, &conversation.v, sizeof (conversation)) == sizeof (conversation), "could not get binary");
+	ksDel (contract);
+	keyDel (root);
+
+	char * name = elektraFormat ("/proc/self/fdinfo/%d", conversation.f (plugin));
+	FILE * fp = fopen (name, "r");
+	elektraFree (name);
+	exit_if_fail (fp, "could not read fdinfo");
+	int count = 0;
+	char line[1024];
+	while (fgets (line, sizeof (line), fp))
+	{
+		if (!strncmp (line, "inotify wd:", 11)) ++count;
+	}
+	fclose (fp);
+	return count;
+}
+
+static void test_inotify ()
+{
+	printf ("test inotify\n");
+
+	char * file = elektraFormat ("%s/inotify.ecf", tempHome);
+	char * other = elektraFormat ("%s/other.ecf", tempHome);
+	char * temp = elektraFormat ("%s/inotify.ecf.tmp", tempHome);
+	writeFile (file, "config");
+
+	Key * parentKey = keyNew ("user/tests/inotify", KEY_END);
+	KeySet * conf = ksNew (0, KS_END);
+	PLUGIN_OPEN ("inotify");
+
+	succeed_if (check (plugin, parentKey) == 1, "unknown backend skipped");
+	succeed_if (watch (plugin, parentKey, file) == 1, "could not watch file");
+	succeed_if (check (plugin, parentKey) == 1, "file changed before watch skipped");
+	succeed_if (watch (plugin, parentKey, file) == 1, "could not watch file");
+	succeed_if (check (plugin, parentKey) == 0, "unchanged file not skipped");
+	succeed_if_same_string (keyString (parentKey), file);
+
+	// other files in the same directory
+	writeFile (other, "other");
+	succeed_if (check (plugin, parentKey) == 0, "unchanged file not skipped");
+
+	writeFile (file, "modified");
+	succeed_if (check (plugin, parentKey) == 1, "modified file skipped");
+	succeed_if (check (plugin, parentKey) == 1, "modified file skipped");
+
+	KeySet * ks = ksNew (0, KS_END);
+	succeed_if (changed (plugin, ks) == 1, "change not reported");
+	succeed_if (ksLookupByName (ks, "user/tests/inotify", 0), "changed backend not reported");
+	succeed_if (changed (plugin, ks) == 0, "change reported twice");
+	ksDel (ks);
+
+	succeed_if (watch (plugin, parentKey, file) == 1, "could not watch file");
+	succeed_if (check (plugin, parentKey) == 0, "unchanged file not skipped");
+
+	// commit of the resolver
+	writeFile (temp, "renamed");
+	rename (temp, file);
+	succeed_if (check (plugin, parentKey) == 1, "renamed file skipped");
+	succeed_if (watch (plugin, parentKey, file) == 1, "could not watch file");
+
+	// backends without watch
+	Key * missingKey = keyNew ("system/tests/inotify", KEY_END);
+	succeed_if (watch (plugin, missingKey, "/nonexisting/directory/file.ecf") == 0, "missing directory watched");
+	succeed_if (check (plugin, missingKey) == 1, "unwatched file skipped");
+	succeed_if (watch (plugin, missingKey, "relative.ecf") == 0, "relative file watched");
+	succeed_if (check (plugin, missingKey) == 1, "unwatched file skipped");
+	keyDel (missingKey);
+
+	succeed_if (check (plugin, parentKey) == 0, "unchanged file not skipped");
+	unlink (file);
+	succeed_if (check (plugin, parentKey) == 1, "removed file skipped");
+
+	unlink (other);
+	keyDel (parentKey);
+	elektraFree (temp);
+	elektraFree (other);
+	elektraFree (file);
+
+	PLUGIN_CLOSE ();
+}
+
+static void test_moved ()
+{
+	printf ("test moved file\n");
+
+	char * directory = elektraFormat ("%s/inotify", tempHome);
+	mkdir (directory, 0700);
+	char * file = elektraFormat ("%s/inotify.ecf", tempHome);
+	char * moved = elektraFormat ("%s/inotify.ecf", directory);
+	char * other = elektraFormat ("%s/other.ecf", tempHome);
+	writeFile (file, "config");
+	writeFile (moved, "config");
+	writeFile (other, "other");
+
+	Key * parentKey = keyNew ("user/tests/inotify", KEY_END);
+	Key * otherKey = keyNew ("system/tests/inotify", KEY_END);
+	KeySet * conf = ksNew (0, KS_END);
+	PLUGIN_OPEN ("inotify");
+
+	succeed_if (watch (plugin, parentKey, file) == 1, "could not watch file");
+	succeed_if (watch (plugin, otherKey, other) == 1, "could not watch file");
+	succeed_if (watched (plugin) == 1, "files of the same directory should share the watch");
+
+	succeed_if (watch (plugin, parentKey, moved) == 1, "could not watch moved file");
+	succeed_if (watched (plugin) == 2, "watch of other backend removed");
+	succeed_if (watch (plugin, otherKey, other) == 1, "could not watch file");
+	succeed_if (check (plugin, otherKey) == 0, "unchanged file not skipped");
+	writeFile (other, "modified");
+	succeed_if (check (plugin, otherKey) == 1, "modified file skipped");
+
+	succeed_if (watch (plugin, otherKey, moved) == 1, "could not watch moved file");
+	succeed_if (watched (plugin) == 1, "watch of previous directory not removed");
+
+	unlink (file);
+	unlink (moved);
+	unlink (other);
+	rmdir (directory);
+	keyDel (parentKey);
+	keyDel (otherKey);
+	elektraFree (other);
+	elektraFree (moved);
+	elektraFree (file);
+	elektraFree (directory);
+
+	PLUGIN_CLOSE ();
+}
+
+int main (int argc, char ** argv)
+{
+	printf ("INOTIFY     TESTS\n");
+	printf ("=================\n\n");
+
+	init (argc, argv);
+
+	test_inotify ();
+	test_moved ();
+
+	printf ("\ntestmod_inotify RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
+
+	return nbError;
+}
@@ -15,6 +15,7 @@
 #include "floathelper.h"
 #include "mathcheck.h"
 #include <ctype.h>
+#include <kdbease.h>
 #include <kdberrors.h>
 #include <math.h>
 #include <regex.h>
@@ -34,6 +35,79 @@ typedef struct
 	Operation op;
 } PNElem;
 
+/** the number of compiled expressions kept between calls of kdbSet() */
+#define MATHCHECK_CACHE_SIZE 64
+
+typedef struct
+{
+	Operation op;   // ADD, SUB, MUL, DIV or VAL
+	double value;   // the value of a literal
+	char * keyName; // the name of a referenced key, relative as written in check/math
+} MathToken;
+
+typedef struct
+{
+	MathToken * tokens;
+	size_t size;
+	Operation resultOp;
+	char invalidOp; // the first operation that is not supported, 0 if all are valid
+} MathExpression;
+
+typedef struct
+{
+	regex_t regex;
+	ElektraLru * cache; // check/math strings to MathExpression
+} MathcheckData;
+
+
+static void freeMathExpression (void * value)
+{
+	MathExpression * expression = value;
+	for (size_t i = 0; i < expression->size; ++i)
+	{
+		if (expression->tokens[i].keyName) elektraFree (expression->tokens[i].keyName);
+	}
+	elektraFree (expression->tokens);
+	elektraFree (expression);
+}
+
+int elektraMathcheckOpen (Plugin * handle, Key * errorKey)
+{
+	MathcheckData * data = elektraCalloc (sizeof (MathcheckData));
+	if (!data)
+	{
+		ELEKTRA_SET_ERROR (87, errorKey, "Out of memory");
+		return -1;
+	}
+	if (regcomp (&data->regex, "(((\\.|\\.\\.|@|\\/)([[:alnum:]]*/)*[[:alnum:]]+))|('[0-9]*[.,]{0,1}[0-9]*')|([-+:/<>=!{*])",
+		     REG_EXTENDED | REG_NEWLINE))
+	{
+		ELEKTRA_SET_ERROR (87, errorKey, "Couldn't compile regex: most likely out of memory");
+		elektraFree (data);
+		return -1;
+	}
+	data->cache = elektraLruNew (MATHCHECK_CACHE_SIZE, freeMathExpression);
+	if (!data->cache)
+	{
+		ELEKTRA_SET_ERROR (87, errorKey, "Out of memory");
+		regfree (&data->regex);
+		elektraFree (data);
+		return -1;
+	}
+	elektraPluginSetData (handle, data);
+	return 1;
+}
+
+int elektraMathcheckClose (Plugin * handle, Key * errorKey ELEKTRA_UNUSED)
+{
+	MathcheckData * data = elektraPluginGetData (handle);
+	if (!data) return 1;
+	elektraLruDel (data->cache);
+	regfree (&data->regex);
+	elektraFree (data);
+	elektraPluginSetData (handle, 0);
+	return 1;
+}
 
 int elektraMathcheckGet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned ELEKTRA_UNUSED, Key * parentKey)
 {
@@ -42,6 +116,8 @@ int elektraMathcheckGet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned ELEKT
 		KeySet * contract = ksNew (
 			30, keyNew ("system/elektra/modules/mathcheck", KEY_VALUE, "mathcheck plugin waits for your orders", KEY_END),
 			keyNew ("system/elektra/modules/mathcheck/exports", KEY_END),
+			keyNew ("system/elektra/modules/mathcheck/exports/open", KEY_FUNC, elektraMathcheckOpen, KEY_END),
+			keyNew ("system/elektra/modules/mathcheck/exports/close", KEY_FUNC, elektraMathcheckClose, KEY_END),
 			keyNew ("system/elektra/modules/mathcheck/exports/get", KEY_FUNC, elektraMathcheckGet, KEY_END),
 			keyNew ("system/elektra/modules/mathcheck/exports/set", KEY_FUNC, elektraMathcheckSet, KEY_END),
 #include ELEKTRA_README (mathcheck)
@@ -174,176 +250,187 @@ static PNElem doPrefixCalculation (PNElem * stack, PNElem * stackPtr)
 	result.value = stackPtr->value;
 	return result;
 }
-static PNElem parsePrefixString (const char * prefixString, Key * curKey, KeySet * ks, Key * parentKey)
+/**
+ * @brief Tokenize @p prefixString
+ *
+ * Literals are converted once, references to keys are kept by name
+ * and looked up for every key that is checked.
+ *
+ * @return the expression or NULL on allocation errors
+ */
+static MathExpression * compilePrefixString (const regex_t * regex, const char * prefixString)
 {
-	const char * regexString = "(((\\.|\\.\\.|@|\\/)([[:alnum:]]*/)*[[:alnum:]]+))|('[0-9]*[.,]{0,1}[0-9]*')|([-+:/<>=!{*])";
-	char * ptr = (char *)prefixString;
-	regex_t regex;
-	Key * key;
-
-	PNElem * stack = elektraMalloc (MIN_VALID_STACK * sizeof (PNElem));
+	MathExpression * expression = elektraCalloc (sizeof (MathExpression));
+	if (!expression) return NULL;
+	expression->resultOp = ERROR;
 
-	PNElem * stackPtr = stack;
-	PNElem result;
-	Operation resultOp = ERROR;
-	result.op = ERROR;
-	int ret;
-	if ((ret = regcomp (&regex, regexString, REG_EXTENDED | REG_NEWLINE)))
+	size_t alloc = MIN_VALID_STACK;
+	expression->tokens = elektraCalloc (alloc * sizeof (MathToken));
+	if (!expression->tokens)
 	{
-		ksDel (ks);
-		return result;
+		elektraFree (expression);
+		return NULL;
 	}
+
+	const char * ptr = prefixString;
 	regmatch_t match;
-	int nomatch;
-	int start;
-	int len;
-	char * searchKey = NULL;
-	while (1)
+	while (!expression->invalidOp && !regexec (regex, ptr, 1, &match, 0))
 	{
-		nomatch = regexec (&regex, ptr, 1, &match, 0);
-		if (nomatch)
+		int len = match.rm_eo - match.rm_so;
+		int start = match.rm_so + (ptr - prefixString);
+		ptr += match.rm_eo;
+
+		if (expression->size == alloc)
 		{
-			break;
+			alloc *= 2;
+			if (elektraRealloc ((void **)&expression->tokens, alloc * sizeof (MathToken)) < 0)
+			{
+				freeMathExpression (expression);
+				return NULL;
+			}
 		}
-		len = match.rm_eo - match.rm_so;
-		start = match.rm_so + (ptr - prefixString);
+		MathToken * token = &expression->tokens[expression->size];
+		token->keyName = NULL;
+		token->value = 0;
+
 		if (len == 1 && !isalpha (prefixString[start]))
 		{
 			switch (prefixString[start])
 			{
-
 			case '+':
-				stackPtr->op = ADD;
-				++stackPtr;
+				token->op = ADD;
+				++expression->size;
 				break;
 			case '-':
-				stackPtr->op = SUB;
-				++stackPtr;
+				token->op = SUB;
+				++expression->size;
 				break;
 			case '/':
-				stackPtr->op = DIV;
-				++stackPtr;
+				token->op = DIV;
+				++expression->size;
 				break;
 			case '*':
-				stackPtr->op = MUL;
-				++stackPtr;
+				token->op = MUL;
+				++expression->size;
 				break;
 			case ':':
-				resultOp = SET;
+				expression->resultOp = SET;
 				break;
 			case '=':
-				if (resultOp == LT)
-				{
-					resultOp = LE;
-				}
-				else if (resultOp == GT)
-				{
-					resultOp = GE;
-				}
-				else if (resultOp == ERROR)
-				{
-					resultOp = EQU;
-				}
-				else if (resultOp == EQU)
+				if (expression->resultOp == LT)
 				{
-					resultOp = EQU;
+					expression->resultOp = LE;
 				}
-				else if (resultOp == NOT)
+				else if (expression->resultOp == GT)
 				{
-					resultOp = NOT;
+					expression->resultOp = GE;
 				}
-				else if (resultOp == SET)
+				else if (expression->resultOp == ERROR)
 				{
-					resultOp = SET;
+					expression->resultOp = EQU;
 				}
 				break;
 			case '<':
-				resultOp = LT;
+				expression->resultOp = LT;
 				break;
 			case '>':
-				resultOp = GT;
+				expression->resultOp = GT;
 				break;
 			case '!':
-				resultOp = NOT;
+				expression->resultOp = NOT;
 				break;
 			default:
-				ELEKTRA_SET_ERRORF (122, parentKey, "%c isn't a valid operation", prefixString[start]);
-				regfree (&regex);
-				if (searchKey)
-				{
-					elektraFree (searchKey);
-				}
-				elektraFree (stack);
-				ksDel (ks);
-				return result;
+				expression->invalidOp = prefixString[start];
 				break;
 			}
+			continue;
+		}
+
+		token->op = VAL;
+		if (prefixString[start] == '\'' && prefixString[start + len - 1] == '\'')
+		{
+			char * literal = elektraMalloc (len + 1);
+			strncpy (literal, prefixString + start + 1, len - 2);
+			literal[len - 2] = '\0';
+			token->value = elektraEFtoF (literal);
+			elektraFree (literal);
 		}
 		else
 		{
-			stackPtr->op = ERROR;
-			stackPtr->value = 0;
-			char * subString = elektraMalloc (len + 1);
-			strncpy (subString, prefixString + start, len);
-			subString[len] = '\0';
-			if (subString[0] == '\'' && subString[len - 1] == '\'')
-			{
-				subString[len - 1] = '\0';
-				char * subPtr = (subString + 1);
-				stackPtr->value = elektraEFtoF (subPtr);
-				elektraFree (subString);
-			}
-			else
-			{
-				ksRewind (ks);
-				if (subString[0] == '@')
-				{
-					searchKey = realloc (searchKey, len + 2 + strlen (keyName (parentKey)));
-					strcpy (searchKey, keyName (parentKey));
-					strcat (searchKey, "/");
-					strcat (searchKey, subString + 2);
-				}
-				else if (subString[0] == '.')
-				{
-					searchKey = realloc (searchKey, len + 2 + strlen (keyName (curKey)));
-					strcpy (searchKey, keyName (curKey));
-					strcat (searchKey, "/");
-					strcat (searchKey, subString);
-				}
-				else
-				{
-					searchKey = realloc (searchKey, len + 1);
-					strcpy (searchKey, subString);
-				}
-				key = ksLookupByName (ks, searchKey, 0);
-				if (!key)
-				{
-					stackPtr->value = 0;
-					stackPtr->op = NA;
-				}
-				else
-				{
-					stackPtr->value = elektraEFtoF (keyString (key));
-				}
-				elektraFree (subString);
-			}
-			if (stackPtr->op != NA) stackPtr->op = VAL;
-			++stackPtr;
+			token->keyName = elektraMalloc (len + 1);
+			strncpy (token->keyName, prefixString + start, len);
+			token->keyName[len] = '\0';
+		}
+		++expression->size;
+	}
+	return expression;
+}
+
+static PNElem evalPrefixExpression (const MathExpression * expression, const char * prefixString, Key * curKey, KeySet * ks,
+				    Key * parentKey)
+{
+	PNElem result;
+	result.op = ERROR;
+	result.value = 0;
+
+	if (expression->invalidOp)
+	{
+		ELEKTRA_SET_ERRORF (122, parentKey, "%c isn't a valid operation", expression->invalidOp);
+		return result;
+	}
+	if (!expression->size)
+	{
+		ELEKTRA_SET_ERRORF (122, parentKey, "%s\n", prefixString);
+		return result;
+	}
+
+	PNElem * stack = elektraMalloc ((expression->size + 1) * sizeof (PNElem));
+	char * searchKey = NULL;
+	for (size_t i = 0; i < expression->size; ++i)
+	{
+		const MathToken * token = &expression->tokens[i];
+		stack[i].op = token->op;
+		stack[i].value = token->value;
+		if (!token->keyName) continue;
+
+		const char * subString = token->keyName;
+		size_t len = strlen (subString);
+		if (subString[0] == '@')
+		{
+			searchKey = realloc (searchKey, len + 2 + strlen (keyName (parentKey)));
+			strcpy (searchKey, keyName (parentKey));
+			strcat (searchKey, "/");
+			strcat (searchKey, subString + 2);
+		}
+		else if (subString[0] == '.')
+		{
+			searchKey = realloc (searchKey, len + 2 + strlen (keyName (curKey)));
+			strcpy (searchKey, keyName (curKey));
+			strcat (searchKey, "/");
+			strcat (searchKey, subString);
+		}
+		else
+		{
+			searchKey = realloc (searchKey, len + 1);
+			strcpy (searchKey, subString);
+		}
+		Key * key = ksLookupByName (ks, searchKey, 0);
+		if (!key)
+		{
+			stack[i].value = 0;
+			stack[i].op = NA;
+		}
+		else
+		{
+			stack[i].value = elektraEFtoF (keyString (key));
 		}
-		int offset = stackPtr - stack;
-		stack = realloc (stack, (offset + 1) * sizeof (PNElem));
-		stackPtr = stack;
-		stackPtr += offset;
-		ptr += match.rm_eo;
 	}
-	regfree (&regex);
 	elektraFree (searchKey);
-	ksDel (ks);
-	stackPtr->op = END;
-	result = doPrefixCalculation (stack, stackPtr);
+	stack[expression->size].op = END;
+	result = doPrefixCalculation (stack, stack + expression->size);
 	if (result.op != ERROR)
 	{
-		result.op = resultOp;
+		result.op = expression->resultOp;
 	}
 	else
 	{
@@ -353,8 +440,40 @@ static PNElem parsePrefixString (const char * prefixString, Key * curKey, KeySet
 	return result;
 }
 
-int elektraMathcheckSet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned, Key * parentKey)
+/**
+ * @brief Evaluate @p prefixString for @p curKey
+ *
+ * Keys with the same check/math (as in arrays) share one tokenized
+ * expression from the cache of the plugin.
+ */
+static PNElem parsePrefixString (MathcheckData * data, const char * prefixString, Key * curKey, KeySet * ks, Key * parentKey)
+{
+	PNElem result;
+	result.op = ERROR;
+	result.value = 0;
+
+	MathExpression * expression = elektraLruGet (data->cache, prefixString);
+	if (!expression)
+	{
+		expression = compilePrefixString (&data->regex, prefixString);
+		if (!expression || elektraLruPut (data->cache, prefixString, expression) != 0)
+		{
+			ELEKTRA_SET_ERROR (87, parentKey, "Out of memory");
+			if (expression) freeMathExpression (expression);
+			return result;
+		}
+	}
+
+	// the lookups move the cursor of the keyset the caller iterates
+	cursor_t cursor = ksGetCursor (ks);
+	result = evalPrefixExpression (expression, prefixString, curKey, ks, parentKey);
+	ksSetCursor (ks, cursor);
+	return result;
+}
+
+int elektraMathcheckSet (Plugin * handle, KeySet * returned, Key * parentKey)
 {
+	MathcheckData * data = elektraPluginGetData (handle);
 	Key * cur;
 	const Key * meta;
 	PNElem result;
@@ -363,7 +482,7 @@ int elektraMathcheckSet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned, Key
 		if (keyGetNamespace (cur) == KEY_NS_SPEC) continue;
 		meta = keyGetMeta (cur, "check/math");
 		if (!meta) continue;
-		result = parsePrefixString (keyString (meta), cur, ksDup (returned), parentKey);
+		result = parsePrefixString (data, keyString (meta), cur, returned, parentKey);
 		char val1[MAX_CHARS_DOUBLE];
 		char val2[MAX_CHARS_DOUBLE];
 		strncpy (val1, keyString (cur), sizeof (val1));
@@ -432,6 +551,8 @@ Plugin * ELEKTRA_PLUGIN_EXPORT (mathcheck)
 {
 	// clang-format off
 	return elektraPluginExport("mathcheck",
+			ELEKTRA_PLUGIN_OPEN,	&elektraMathcheckOpen,
+			ELEKTRA_PLUGIN_CLOSE,	&elektraMathcheckClose,
 			ELEKTRA_PLUGIN_GET,	&elektraMathcheckGet,
 			ELEKTRA_PLUGIN_SET,	&elektraMathcheckSet,
 			ELEKTRA_PLUGIN_END);
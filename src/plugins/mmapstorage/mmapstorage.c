@@ -0,0 +1,532 @@
+/**
+ * @file
+ *
+ * @brief Source for mmapstorage plugin
+ *
+ * @copyright BSD License (see doc/COPYING or http://www.libelektra.org)
+ *
+ */
+
+#include "mmapstorage.h"
+
+#include <kdberrors.h>
+#include <kdbhelper.h>
+#include <kdbprivate.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MMAP_MAGIC "kdbmmap"
+#define MMAP_VERSION 1
+#define MMAP_BYTE_ORDER 0x01020304
+
+/**
+ * The header at the start of every file.
+ *
+ * All offsets are relative to the start of the file.
+ */
+typedef struct
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t byteOrder;
+	uint32_t sizeOfSize;
+	uint32_t reserved;
+	size_t fileSize;
+	size_t keyCount;
+	size_t keyTable;
+	size_t metaCount;
+	size_t metaTable;
+	size_t metaRefCount;
+	size_t metaRefTable;
+	KeyRegion region; /**< zero in the file, filled in when mapped */
+} MmapHeader;
+
+/**
+ * A key or meta key within the key or meta table.
+ *
+ * The name contains the escaped name followed by the unescaped name,
+ * as they are in memory. A value of 0 means the key has no value.
+ */
+typedef struct
+{
+	size_t name;
+	size_t nameSize;
+	size_t unameSize;
+	size_t value;
+	size_t valueSize;
+	size_t metaStart; /**< first index in the meta reference table */
+	size_t metaCount;
+} MmapEntry;
+
+typedef struct
+{
+	char * data;
+	size_t size;
+	size_t alloc;
+} MmapBuffer;
+
+
+static int mmapReserve (MmapBuffer * buf, size_t size)
+{
+	if (buf->size + size <= buf->alloc) return 0;
+
+	size_t alloc = buf->alloc ? buf->alloc : 4096;
+	while (alloc < buf->size + size)
+	{
+		alloc *= 2;
+	}
+	if (elektraRealloc ((void **)&buf->data, alloc) == -1) return -1;
+	buf->alloc = alloc;
+	return 0;
+}
+
+static int mmapAlign (MmapBuffer * buf)
+{
+	size_t padding = (sizeof (size_t) - buf->size % sizeof (size_t)) % sizeof (size_t);
+	if (mmapReserve (buf, padding) == -1) return -1;
+	memset (buf->data + buf->size, 0, padding);
+	buf->size += padding;
+	return 0;
+}
+
+/**
+ * Appends a name or value, preceded by its distance to the region.
+ *
+ * @return the offset of the blob
+ * @retval 0 on memory error
+ */
+static size_t mmapAppendBlob (MmapBuffer * buf, const void * blob, size_t size)
+{
+	if (mmapAlign (buf) == -1 || mmapReserve (buf, sizeof (size_t) + size) == -1) return 0;
+
+	size_t offset = buf->size + sizeof (size_t);
+	size_t distance = offset - offsetof (MmapHeader, region);
+	memcpy (buf->data + buf->size, &distance, sizeof (size_t));
+	memcpy (buf->data + offset, blob, size);
+	buf->size = offset + size;
+	return offset;
+}
+
+static size_t mmapAppendTable (MmapBuffer * buf, const void * table, size_t size)
+{
+	if (mmapAlign (buf) == -1 || mmapReserve (buf, size) == -1) return 0;
+
+	size_t offset = buf->size;
+	if (size) memcpy (buf->data + offset, table, size);
+	buf->size += size;
+	return offset;
+}
+
+static int mmapAppendKey (MmapBuffer * buf, MmapEntry * entry, const Key * key)
+{
+	entry->nameSize = key->keySize;
+	entry->unameSize = key->keyUSize;
+	entry->name = mmapAppendBlob (buf, key->key, key->keySize + key->keyUSize);
+	if (!entry->name) return -1;
+
+	if (key->data.v && key->dataSize)
+	{
+		entry->valueSize = key->dataSize;
+		entry->value = mmapAppendBlob (buf, key->data.v, key->dataSize);
+		if (!entry->value) return -1;
+	}
+	return 0;
+}
+
+static size_t mmapHashMeta (const Key * meta)
+{
+	const unsigned char * data = (const unsigned char *)meta->key;
+	size_t hash = (size_t)14695981039346656037ULL;
+	for (size_t i = 0; i < meta->keySize; ++i)
+	{
+		hash ^= data[i];
+		hash *= (size_t)1099511628211ULL;
+	}
+	data = meta->data.v;
+	for (size_t i = 0; data && i < meta->dataSize; ++i)
+	{
+		hash ^= data[i];
+		hash *= (size_t)1099511628211ULL;
+	}
+	return hash;
+}
+
+static int mmapEqualMeta (const Key * meta1, const Key * meta2)
+{
+	if (meta1 == meta2) return 1;
+	if (meta1->keySize != meta2->keySize || strcmp (meta1->key, meta2->key)) return 0;
+	if (meta1->dataSize != meta2->dataSize) return 0;
+	return !meta1->dataSize || !memcmp (meta1->data.v, meta2->data.v, meta1->dataSize);
+}
+
+/**
+ * Lays out the whole file in @p buf.
+ *
+ * Meta keys with equal name and value are only stored once,
+ * they are found with an open addressing table.
+ *
+ * @retval 0 on success
+ * @retval -1 on memory error
+ */
+static int mmapSerialise (MmapBuffer * buf, KeySet * returned)
+{
+	const size_t keyCount = ksGetSize (returned);
+	size_t metaRefCount = 0;
+	for (size_t i = 0; i < keyCount; ++i)
+	{
+		if (returned->array[i]->meta) metaRefCount += ksGetSize (returned->array[i]->meta);
+	}
+
+	size_t hashSize = 16;
+	while (hashSize <= metaRefCount * 2)
+	{
+		hashSize *= 2;
+	}
+
+	MmapEntry * keys = elektraCalloc ((keyCount + 1) * sizeof (MmapEntry));
+	MmapEntry * metas = elektraCalloc ((metaRefCount + 1) * sizeof (MmapEntry));
+	const Key ** metaKeys = elektraCalloc ((metaRefCount + 1) * sizeof (Key *));
+	size_t * metaRefs = elektraCalloc ((metaRefCount + 1) * sizeof (size_t));
+	size_t * hash = elektraCalloc (hashSize * sizeof (size_t)); // meta index + 1
+	size_t metaCount = 0;
+	size_t ref = 0;
+	int ret = -1;
+
+	if (!keys || !metas || !metaKeys || !metaRefs || !hash) goto error;
+
+	if (mmapReserve (buf, sizeof (MmapHeader)) == -1) goto error;
+	memset (buf->data, 0, sizeof (MmapHeader));
+	buf->size = sizeof (MmapHeader);
+
+	for (size_t i = 0; i < keyCount; ++i)
+	{
+		const Key * key = returned->array[i];
+		if (mmapAppendKey (buf, &keys[i], key) == -1) goto error;
+
+		keys[i].metaStart = ref;
+		for (size_t m = 0; key->meta && m < (size_t)ksGetSize (key->meta); ++m)
+		{
+			const Key * meta = key->meta->array[m];
+			size_t h = mmapHashMeta (meta) & (hashSize - 1);
+			while (hash[h] && !mmapEqualMeta (metaKeys[hash[h] - 1], meta))
+			{
+				h = (h + 1) & (hashSize - 1);
+			}
+
+			if (!hash[h])
+			{
+				if (mmapAppendKey (buf, &metas[metaCount], meta) == -1) goto error;
+				metaKeys[metaCount] = meta;
+				hash[h] = ++metaCount;
+			}
+			metaRefs[ref++] = hash[h] - 1;
+		}
+		keys[i].metaCount = ref - keys[i].metaStart;
+	}
+
+	MmapHeader header;
+	memset (&header, 0, sizeof (MmapHeader));
+	memcpy (header.magic, MMAP_MAGIC, sizeof (header.magic));
+	header.version = MMAP_VERSION;
+	header.byteOrder = MMAP_BYTE_ORDER;
+	header.sizeOfSize = sizeof (size_t);
+	header.keyCount = keyCount;
+	header.metaCount = metaCount;
+	header.metaRefCount = metaRefCount;
+	if (!(header.keyTable = mmapAppendTable (buf, keys, keyCount * sizeof (MmapEntry)))) goto error;
+	if (!(header.metaTable = mmapAppendTable (buf, metas, metaCount * sizeof (MmapEntry)))) goto error;
+	if (!(header.metaRefTable = mmapAppendTable (buf, metaRefs, metaRefCount * sizeof (size_t)))) goto error;
+	header.fileSize = buf->size;
+	memcpy (buf->data, &header, sizeof (MmapHeader));
+	ret = 0;
+
+error:
+	elektraFree (keys);
+	elektraFree (metas);
+	elektraFree (metaKeys);
+	elektraFree (metaRefs);
+	elektraFree (hash);
+	return ret;
+}
+
+
+static int mmapCheckTable (const MmapHeader * header, size_t offset, size_t count, size_t size)
+{
+	return offset >= sizeof (MmapHeader) && offset % sizeof (size_t) == 0 && offset <= header->fileSize &&
+	       count <= (header->fileSize - offset) / size;
+}
+
+static int mmapCheckHeader (const MmapHeader * header, size_t fileSize)
+{
+	return !memcmp (header->magic, MMAP_MAGIC, sizeof (header->magic)) && header->version == MMAP_VERSION &&
+	       header->byteOrder == MMAP_BYTE_ORDER && header->sizeOfSize == sizeof (size_t) && header->fileSize == fileSize &&
+	       mmapCheckTable (header, header->keyTable, header->keyCount, sizeof (MmapEntry)) &&
+	       mmapCheckTable (header, header->metaTable, header->metaCount, sizeof (MmapEntry)) &&
+	       mmapCheckTable (header, header->metaRefTable, header->metaRefCount, sizeof (size_t));
+}
+
+/**
+ * Checks that a name or value is within the file and
+ * preceded by its distance to the region.
+ */
+static int mmapCheckBlob (const char * base, size_t fileSize, size_t offset, size_t size)
+{
+	if (offset < sizeof (MmapHeader) || offset % sizeof (size_t) || offset > fileSize || size > fileSize - offset) return 0;
+
+	size_t distance;
+	memcpy (&distance, base + offset - sizeof (size_t), sizeof (size_t));
+	return distance == offset - offsetof (MmapHeader, region);
+}
+
+static int mmapCheckEntry (const char * base, size_t fileSize, const MmapEntry * entry)
+{
+	if (!entry->nameSize || entry->unameSize > SIZE_MAX - entry->nameSize) return 0;
+	if (!mmapCheckBlob (base, fileSize, entry->name, entry->nameSize + entry->unameSize)) return 0;
+	if (base[entry->name + entry->nameSize - 1] != '\0') return 0;
+	if (!entry->value) return entry->valueSize == 0;
+	return entry->valueSize && mmapCheckBlob (base, fileSize, entry->value, entry->valueSize);
+}
+
+static Key * mmapKeyNew (KeyArena * arena, char * base, const MmapEntry * entry)
+{
+	Key * key = arena ? elektraKeyArenaKeyNew (arena, 0) : 0;
+	if (!key) return 0;
+
+	elektraKeySetRegionName (key, base + entry->name, entry->nameSize, entry->unameSize);
+	if (entry->value) elektraKeySetRegionValue (key, base + entry->value, entry->valueSize);
+	return key;
+}
+
+/**
+ * Creates the keys of a mapped file.
+ *
+ * The mapping is released when this function fails or no key
+ * points into it.
+ *
+ * @retval 1 on success
+ * @retval -1 on error
+ */
+static int mmapUnserialise (char * base, size_t fileSize, KeySet * returned, Key * parentKey)
+{
+	MmapHeader * header = (MmapHeader *)base;
+	if (!mmapCheckHeader (header, fileSize))
+	{
+		munmap (base, fileSize);
+		ELEKTRA_SET_ERRORF (147, parentKey, "%s has an incompatible or corrupt header", keyString (parentKey));
+		return -1;
+	}
+
+	// hold a reference while the keys are created
+	header->region.base = base;
+	header->region.size = fileSize;
+	header->region.refs = 1;
+	header->region.mapped = 1;
+
+	const MmapEntry * keys = (const MmapEntry *)(base + header->keyTable);
+	const MmapEntry * metas = (const MmapEntry *)(base + header->metaTable);
+	const size_t * metaRefs = (const size_t *)(base + header->metaRefTable);
+	Key ** metaKeys = elektraCalloc ((header->metaCount + 1) * sizeof (Key *));
+	KeySet * ks = ksNew (header->keyCount + 1, KS_END);
+	const char * reason = 0;
+	Key * prev = 0;
+
+	if (!metaKeys || !ks)
+	{
+		reason = "out of memory";
+		goto error;
+	}
+
+	// only the Key structures are allocated, in blocks
+	KeyArena * arena = elektraKsArena (returned);
+
+	for (size_t m = 0; m < header->metaCount; ++m)
+	{
+		const MmapEntry * entry = &metas[m];
+		if (!mmapCheckEntry (base, fileSize, entry) || (entry->value && base[entry->value + entry->valueSize - 1] != '\0'))
+		{
+			reason = "invalid metadata";
+			goto error;
+		}
+		if (!(metaKeys[m] = mmapKeyNew (arena, base, entry)))
+		{
+			reason = "out of memory";
+			goto error;
+		}
+		set_bit (metaKeys[m]->flags, KEY_FLAG_RO_NAME);
+		set_bit (metaKeys[m]->flags, KEY_FLAG_RO_VALUE);
+		set_bit (metaKeys[m]->flags, KEY_FLAG_RO_META);
+	}
+
+	for (size_t i = 0; i < header->keyCount; ++i)
+	{
+		const MmapEntry * entry = &keys[i];
+		if (!mmapCheckEntry (base, fileSize, entry) || entry->metaStart > header->metaRefCount ||
+		    entry->metaCount > header->metaRefCount - entry->metaStart)
+		{
+			reason = "invalid key";
+			goto error;
+		}
+
+		Key * key = mmapKeyNew (arena, base, entry);
+		if (!key || (entry->metaCount && !(key->meta = ksNew (entry->metaCount, KS_END))))
+		{
+			keyDel (key);
+			reason = "out of memory";
+			goto error;
+		}
+		ksAppendKey (ks, key);
+		for (size_t r = entry->metaStart; r < entry->metaStart + entry->metaCount; ++r)
+		{
+			if (metaRefs[r] >= header->metaCount)
+			{
+				reason = "invalid metadata reference";
+				goto error;
+			}
+			ksAppendKey (key->meta, metaKeys[metaRefs[r]]);
+		}
+
+		if ((size_t)ksGetSize (ks) != i + 1 || (prev && keyCmp (prev, key) >= 0))
+		{
+			reason = "keys are not sorted";
+			goto error;
+		}
+		if (!keyIsBinary (key) && entry->value && base[entry->value + entry->valueSize - 1] != '\0')
+		{
+			reason = "string value not terminated";
+			goto error;
+		}
+		prev = key;
+	}
+
+	// the keys stay valid after appending, no reference is held
+	for (size_t m = 0; m < header->metaCount; ++m)
+	{
+		keyDel (metaKeys[m]);
+	}
+	elektraFree (metaKeys);
+	ksAppend (returned, ks);
+	ksDel (ks);
+	elektraKeyRegionDecRef (&header->region);
+	return 1;
+
+error:
+	ELEKTRA_SET_ERRORF (147, parentKey, "%s: %s", keyString (parentKey), reason);
+	for (size_t m = 0; metaKeys && m < header->metaCount; ++m)
+	{
+		keyDel (metaKeys[m]);
+	}
+	elektraFree (metaKeys);
+	ksDel (ks);
+	elektraKeyRegionDecRef (&header->region);
+	return -1;
+}
+
+int elektraMmapstorageGet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned, Key * parentKey)
+{
+	if (!strcmp (keyName (parentKey), "system/elektra/modules/mmapstorage"))
+	{
+		KeySet * contract =
+			ksNew (30, keyNew ("system/elektra/modules/mmapstorage", KEY_VALUE, "mmapstorage plugin waits for your orders", KEY_END),
+			       keyNew ("system/elektra/modules/mmapstorage/exports", KEY_END),
+			       keyNew ("system/elektra/modules/mmapstorage/exports/get", KEY_FUNC, elektraMmapstorageGet, KEY_END),
+			       keyNew ("system/elektra/modules/mmapstorage/exports/set", KEY_FUNC, elektraMmapstorageSet, KEY_END),
+#include ELEKTRA_README (mmapstorage)
+			       keyNew ("system/elektra/modules/mmapstorage/infos/version", KEY_VALUE, PLUGINVERSION, KEY_END), KS_END);
+		ksAppend (returned, contract);
+		ksDel (contract);
+		return 1;
+	}
+
+	int errnosave = errno;
+	int fd = open (keyString (parentKey), O_RDONLY);
+	if (fd == -1)
+	{
+		ELEKTRA_SET_ERROR_GET (parentKey);
+		errno = errnosave;
+		return -1;
+	}
+
+	struct stat sb;
+	if (fstat (fd, &sb) == -1)
+	{
+		ELEKTRA_SET_ERROR_GET (parentKey);
+		close (fd);
+		errno = errnosave;
+		return -1;
+	}
+
+	if (sb.st_size == 0)
+	{
+		// nothing was stored yet
+		close (fd);
+		return 1;
+	}
+
+	if ((size_t)sb.st_size < sizeof (MmapHeader))
+	{
+		ELEKTRA_SET_ERRORF (147, parentKey, "%s is too small", keyString (parentKey));
+		close (fd);
+		return -1;
+	}
+
+	// private and writeable for the bookkeeping in the header
+	char * base = mmap (0, sb.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close (fd);
+	if (base == MAP_FAILED)
+	{
+		ELEKTRA_SET_ERROR_GET (parentKey);
+		errno = errnosave;
+		return -1;
+	}
+
+	return mmapUnserialise (base, sb.st_size, returned, parentKey);
+}
+
+int elektraMmapstorageSet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned, Key * parentKey)
+{
+	MmapBuffer buf = { 0, 0, 0 };
+	if (mmapSerialise (&buf, returned) == -1)
+	{
+		elektraFree (buf.data);
+		ELEKTRA_SET_ERROR (87, parentKey, "could not lay out mmapstorage file");
+		return -1;
+	}
+
+	int errnosave = errno;
+	FILE * fp = fopen (keyString (parentKey), "wb");
+	if (!fp)
+	{
+		elektraFree (buf.data);
+		ELEKTRA_SET_ERROR_SET (parentKey);
+		errno = errnosave;
+		return -1;
+	}
+
+	int ret = fwrite (buf.data, 1, buf.size, fp) == buf.size ? 1 : -1;
+	if (fclose (fp) != 0) ret = -1;
+	elektraFree (buf.data);
+
+	if (ret == -1)
+	{
+		ELEKTRA_SET_ERROR_SET (parentKey);
+		errno = errnosave;
+	}
+	return ret;
+}
+
+Plugin * ELEKTRA_PLUGIN_EXPORT (mmapstorage)
+{
+	// clang-format off
+	return elektraPluginExport ("mmapstorage",
+		ELEKTRA_PLUGIN_GET,	&elektraMmapstorageGet,
+		ELEKTRA_PLUGIN_SET,	&elektraMmapstorageSet,
+		ELEKTRA_PLUGIN_END);
+}
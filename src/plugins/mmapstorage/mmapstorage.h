@@ -0,0 +1,21 @@
+/**
+ * @file
+ *
+ * @brief Header for mmapstorage plugin
+ *
+ * @copyright BSD License (see doc/COPYING or http://www.libelektra.org)
+ *
+ */
+
+#ifndef ELEKTRA_PLUGIN_MMAPSTORAGE_H
+#define ELEKTRA_PLUGIN_MMAPSTORAGE_H
+
+#include <kdbplugin.h>
+
+
+int elektraMmapstorageGet (Plugin * handle, KeySet * ks, Key * parentKey);
+int elektraMmapstorageSet (Plugin * handle, KeySet * ks, Key * parentKey);
+
+Plugin * ELEKTRA_PLUGIN_EXPORT (mmapstorage);
+
+#endif
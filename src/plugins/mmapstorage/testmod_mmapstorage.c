@@ -0,0 +1,222 @@
+/**
+ * @file
+ *
+ * @brief Tests for mmapstorage plugin
+ *
+ * @copyright BSD License (see doc/COPYING or http://www.libelektra.org)
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <kdbconfig.h>
+
+#include <tests_plugin.h>
+
+static KeySet * simpleSet (void)
+{
+	return ksNew (10, keyNew ("user/tests/mmapstorage", KEY_VALUE, "root", KEY_END),
+		      keyNew ("user/tests/mmapstorage/a", KEY_VALUE, "a value", KEY_META, "comment", "shared", KEY_META, "order", "1",
+			      KEY_END),
+		      keyNew ("user/tests/mmapstorage/b", KEY_META, "comment", "shared", KEY_META, "order", "2", KEY_END),
+		      keyNew ("user/tests/mmapstorage/c\\/d", KEY_BINARY, KEY_SIZE, 4, KEY_VALUE, "\0\1\2\3", KEY_END),
+		      keyNew ("user/tests/mmapstorage/e", KEY_VALUE, "", KEY_META, "comment", "shared", KEY_END), KS_END);
+}
+
+static void test_roundtrip ()
+{
+	printf ("test roundtrip\n");
+
+	Key * parentKey = keyNew ("user/tests/mmapstorage", KEY_VALUE, elektraFilename (), KEY_END);
+	KeySet * conf = ksNew (0, KS_END);
+	PLUGIN_OPEN ("mmapstorage");
+
+	KeySet * ks = simpleSet ();
+	succeed_if (plugin->kdbSet (plugin, ks, parentKey) == 1, "call to kdbSet was not successful");
+
+	KeySet * read = ksNew (0, KS_END);
+	succeed_if (plugin->kdbGet (plugin, read, parentKey) == 1, "call to kdbGet was not successful");
+	compare_keyset (read, ks);
+
+	Key * key = ksLookupByName (read, "user/tests/mmapstorage/c\\/d", 0);
+	exit_if_fail (key, "key with escaped name not found");
+	succeed_if (keyIsBinary (key), "binary flag lost");
+	succeed_if (keyGetValueSize (key) == 4 && !memcmp (keyValue (key), "\0\1\2\3", 4), "wrong binary value");
+	succeed_if_same_string (keyBaseName (key), "c/d");
+
+	// metadata with the same content is stored once
+	succeed_if (keyGetMeta (ksLookupByName (read, "user/tests/mmapstorage/a", 0), "comment") ==
+			    keyGetMeta (ksLookupByName (read, "user/tests/mmapstorage/e", 0), "comment"),
+		    "equal meta keys are not shared");
+	succeed_if (keyGetMeta (ksLookupByName (read, "user/tests/mmapstorage/a", 0), "order") !=
+			    keyGetMeta (ksLookupByName (read, "user/tests/mmapstorage/b", 0), "order"),
+		    "different meta keys are shared");
+
+	ksDel (read);
+	ksDel (ks);
+	keyDel (parentKey);
+	PLUGIN_CLOSE ();
+}
+
+static void test_copyOnWrite ()
+{
+	printf ("test copy on write\n");
+
+	Key * parentKey = keyNew ("user/tests/mmapstorage", KEY_VALUE, elektraFilename (), KEY_END);
+	KeySet * conf = ksNew (0, KS_END);
+	PLUGIN_OPEN ("mmapstorage");
+
+	KeySet * ks = simpleSet ();
+	succeed_if (plugin->kdbSet (plugin, ks, parentKey) == 1, "call to kdbSet was not successful");
+	ksDel (ks);
+
+	ks = ksNew (0, KS_END);
+	succeed_if (plugin->kdbGet (plugin, ks, parentKey) == 1, "call to kdbGet was not successful");
+
+	Key * a = ksLookupByName (ks, "user/tests/mmapstorage/a", 0);
+	exit_if_fail (a, "key not found");
+	succeed_if (test_bit (a->flags, KEY_FLAG_MMAP_KEY), "name was copied");
+	succeed_if (test_bit (a->flags, KEY_FLAG_MMAP_DATA), "value was copied");
+
+	KeyRegion * region = elektraKeyRegionOf (a->key);
+	succeed_if (region == elektraKeyRegionOf (a->data.v), "name and value in different regions");
+	succeed_if (region->mapped == 1, "region not mapped");
+	size_t refs = region->refs;
+
+	succeed_if (keySetString (a, keyString (a)) == 8, "could not set value from region");
+	succeed_if (!test_bit (a->flags, KEY_FLAG_MMAP_DATA), "value still in region");
+	succeed_if_same_string (keyString (a), "a value");
+	succeed_if (region->refs == refs - 1, "reference of value not dropped");
+
+	Key * dup = keyDup (a);
+	succeed_if (!test_bit (dup->flags, KEY_FLAG_MMAP_KEY), "duplicated name in region");
+	keySetBaseName (dup, "x");
+	succeed_if_same_string (keyName (dup), "user/tests/mmapstorage/x");
+	keyDel (dup);
+
+	Key * b = keyDup (ksLookupByName (ks, "user/tests/mmapstorage/b", 0));
+	ksDel (ks);
+	ks = ksNew (0, KS_END);
+	succeed_if (plugin->kdbGet (plugin, ks, parentKey) == 1, "call to kdbGet was not successful");
+	Key * c = ksLookupByName (ks, "user/tests/mmapstorage/c\\/d", 0);
+	exit_if_fail (c, "key not found");
+	keyIncRef (c);
+	ksDel (ks);
+	keyDecRef (c);
+
+	// the mapping is kept for c alone
+	succeed_if_same_string (keyName (c), "user/tests/mmapstorage/c\\/d");
+	succeed_if (keyGetValueSize (c) == 4 && !memcmp (keyValue (c), "\0\1\2\3", 4), "wrong binary value");
+	succeed_if (keySetBinary (c, "\4\5", 2) == 2, "could not set binary value");
+	succeed_if (!test_bit (c->flags, KEY_FLAG_MMAP_DATA), "value still in region");
+	succeed_if (test_bit (c->flags, KEY_FLAG_MMAP_KEY), "name was copied");
+	succeed_if (keyGetValueSize (c) == 2 && !memcmp (keyValue (c), "\4\5", 2), "wrong binary value");
+	keyDel (c);
+
+	succeed_if_same_string (keyName (b), "user/tests/mmapstorage/b");
+	succeed_if_same_string (keyString (keyGetMeta (b, "order")), "2");
+	keyDel (b);
+
+	keyDel (parentKey);
+	PLUGIN_CLOSE ();
+}
+
+static void test_empty ()
+{
+	printf ("test empty\n");
+
+	Key * parentKey = keyNew ("user/tests/mmapstorage", KEY_VALUE, elektraFilename (), KEY_END);
+	KeySet * conf = ksNew (0, KS_END);
+	PLUGIN_OPEN ("mmapstorage");
+
+	KeySet * ks = ksNew (0, KS_END);
+	succeed_if (plugin->kdbSet (plugin, ks, parentKey) == 1, "call to kdbSet was not successful");
+	succeed_if (plugin->kdbGet (plugin, ks, parentKey) == 1, "call to kdbGet was not successful");
+	succeed_if (ksGetSize (ks) == 0, "keys read from empty keyset");
+
+	FILE * fp = fopen (keyString (parentKey), "w");
+	exit_if_fail (fp, "could not truncate file");
+	fclose (fp);
+	succeed_if (plugin->kdbGet (plugin, ks, parentKey) == 1, "empty file not accepted");
+	succeed_if (ksGetSize (ks) == 0, "keys read from empty file");
+
+	ksDel (ks);
+	keyDel (parentKey);
+	PLUGIN_CLOSE ();
+}
+
+static void test_corrupt ()
+{
+	printf ("test corrupt\n");
+
+	Key * parentKey = keyNew ("user/tests/mmapstorage", KEY_VALUE, elektraFilename (), KEY_END);
+	KeySet * conf = ksNew (0, KS_END);
+	PLUGIN_OPEN ("mmapstorage");
+
+	KeySet * ks = simpleSet ();
+	succeed_if (plugin->kdbSet (plugin, ks, parentKey) == 1, "call to kdbSet was not successful");
+	ksDel (ks);
+
+	FILE * fp = fopen (keyString (parentKey), "r+b");
+	exit_if_fail (fp, "could not open file");
+	fseek (fp, 0, SEEK_END);
+	long size = ftell (fp);
+
+	// flipping bytes anywhere must either be detected or
+	// still give valid keys
+	char * data = elektraMalloc (size);
+	fseek (fp, 0, SEEK_SET);
+	exit_if_fail (fread (data, 1, size, fp) == (size_t)size, "could not read file");
+	for (long i = 0; i < size; i += 7)
+	{
+		data[i] ^= 0x55;
+		fseek (fp, 0, SEEK_SET);
+		fwrite (data, 1, size, fp);
+		fflush (fp);
+		ks = ksNew (0, KS_END);
+		Key * corruptKey = keyDup (parentKey);
+		if (plugin->kdbGet (plugin, ks, corruptKey) == -1)
+		{
+			succeed_if (keyGetMeta (corruptKey, "error"), "no error on corrupt file");
+			succeed_if (ksGetSize (ks) == 0, "keys returned on error");
+		}
+		keyDel (corruptKey);
+		ksDel (ks);
+		data[i] ^= 0x55;
+	}
+
+	// truncated
+	fseek (fp, 0, SEEK_SET);
+	fwrite ("kdbmmap", 1, 8, fp);
+	fclose (fp);
+	exit_if_fail (truncate (keyString (parentKey), 40) == 0, "could not truncate file");
+	ks = ksNew (0, KS_END);
+	succeed_if (plugin->kdbGet (plugin, ks, parentKey) == -1, "truncated file accepted");
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "error/number")), "147");
+
+	elektraFree (data);
+	ksDel (ks);
+	keyDel (parentKey);
+	PLUGIN_CLOSE ();
+}
+
+
+int main (int argc, char ** argv)
+{
+	printf ("MMAPSTORAGE     TESTS\n");
+	printf ("=====================\n\n");
+
+	init (argc, argv);
+
+	test_roundtrip ();
+	test_copyOnWrite ();
+	test_empty ();
+	test_corrupt ();
+
+	printf ("\ntestmod_mmapstorage RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
+
+	return nbError;
+}
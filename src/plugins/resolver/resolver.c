@@ -25,6 +25,7 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <dirent.h>
@@ -47,16 +48,23 @@
 #endif
 
 #ifdef ELEKTRA_LOCK_MUTEX
-#if defined(PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP)
-static pthread_mutex_t elektraResolverMutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
-#elif defined(PTHREAD_RECURSIVE_MUTEX_INITIALIZER)
-static pthread_mutex_t elektraResolverMutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER;
-#else
-static pthread_mutex_t elektraResolverMutex;
-static pthread_mutex_t elektraResolverInitMutex = PTHREAD_MUTEX_INITIALIZER;
-static unsigned char elektraResolverMutexInitialized = 0;
-#define ELEKTRA_RESOLVER_RECURSIVE_MUTEX_INITIALIZATION
-#endif
+/**
+ * @brief A lock of a configuration file held by a thread.
+ *
+ * Only files which are currently written have an entry, so the
+ * table stays as small as the number of concurrent commits.
+ */
+struct _resolverLock
+{
+	char * filename;  ///< canonical path of the locked file
+	pthread_t owner;  ///< thread holding the lock
+	size_t depth;     ///< how often the owner locked the file
+	struct _resolverLock * next;
+};
+
+static pthread_mutex_t elektraResolverLockMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t elektraResolverLockReleased = PTHREAD_COND_INITIALIZER;
+static struct _resolverLock * elektraResolverLocks = 0;
 #endif
 
 static void resolverInit (resolverHandle * p, const char * path)
@@ -78,6 +86,9 @@ static void resolverInit (resolverHandle * p, const char * path)
 
 	p->uid = 0;
 	p->gid = 0;
+
+	p->lock = 0;
+	p->lockTimeout = 0;
 }
 
 static resolverHandle * elektraGetResolverHandle (Plugin * handle, Key * parentKey)
@@ -124,22 +135,53 @@ static void resolverClose (resolverHandles * p)
 	elektraFree (p);
 }
 
+#if defined(ELEKTRA_LOCK_FILE) || defined(ELEKTRA_LOCK_MUTEX)
+/**
+ * @brief Calculate the point in time when waiting for a lock gives up.
+ *
+ * @param deadline the absolute time (CLOCK_REALTIME) to be computed
+ * @param timeout in milliseconds
+ */
+static void elektraLockDeadline (struct timespec * deadline, int timeout)
+{
+	clock_gettime (CLOCK_REALTIME, deadline);
+	deadline->tv_sec += timeout / 1000;
+	deadline->tv_nsec += (long)(timeout % 1000) * 1000000;
+	if (deadline->tv_nsec >= 1000000000)
+	{
+		deadline->tv_sec += 1;
+		deadline->tv_nsec -= 1000000000;
+	}
+}
+#endif
+
+#ifdef ELEKTRA_LOCK_FILE
+static int elektraLockExpired (const struct timespec * deadline)
+{
+	struct timespec now;
+	clock_gettime (CLOCK_REALTIME, &now);
+	return now.tv_sec > deadline->tv_sec || (now.tv_sec == deadline->tv_sec && now.tv_nsec >= deadline->tv_nsec);
+}
+#endif
+
 /**
  * Locks file for exclusive read/write mode.
  *
  * This function will not block until all reader
- * and writer have left the file.
+ * and writer have left the file, unless a timeout is given.
  * -> conflict with other cooperative process detected,
  *    but we were later (and lost)
  *
  * @exception 27 set if locking failed, most likely a conflict
  *
  * @param fd is a valid filedescriptor
+ * @param timeout how many milliseconds to retry a lock held
+ *        by another process, 0 for an immediate conflict
  * @retval 0 on success
  * @retval -1 on failure
  * @ingroup backendhelper
  */
-static int elektraLockFile (int fd ELEKTRA_UNUSED, Key * parentKey ELEKTRA_UNUSED)
+static int elektraLockFile (int fd ELEKTRA_UNUSED, int timeout ELEKTRA_UNUSED, Key * parentKey ELEKTRA_UNUSED)
 {
 #ifdef ELEKTRA_LOCK_FILE
 	struct flock l;
@@ -147,7 +189,20 @@ static int elektraLockFile (int fd ELEKTRA_UNUSED, Key * parentKey ELEKTRA_UNUSE
 	l.l_start = 0;      /*Start at begin*/
 	l.l_whence = SEEK_SET;
 	l.l_len = 0; /*Do it with whole file*/
-	int ret = fcntl (fd, F_SETLK, &l);
+
+	struct timespec deadline;
+	if (timeout > 0) elektraLockDeadline (&deadline, timeout);
+
+	// fcntl cannot wait with a timeout, so poll with growing pauses
+	long pause = 1000000;
+	int ret;
+	while ((ret = fcntl (fd, F_SETLK, &l)) == -1 && (errno == EAGAIN || errno == EACCES) && timeout > 0 &&
+	       !elektraLockExpired (&deadline))
+	{
+		struct timespec duration = { 0, pause };
+		nanosleep (&duration, 0);
+		if (pause < 32000000) pause *= 2;
+	}
 
 	if (ret == -1)
 	{
@@ -203,29 +258,97 @@ static int elektraUnlockFile (int fd ELEKTRA_UNUSED, Key * parentKey ELEKTRA_UNU
 /**
  * @brief mutex lock for multithread-safety
  *
+ * Only threads writing the same file exclude each other, so that
+ * independent backends can be committed concurrently. The file is
+ * identified by its canonical path, which (unlike the inode) stays
+ * the same when the commit renames the temporary file.
+ *
+ * The same thread may lock a file several times.
+ *
+ * @param pk the handle of the file to lock, its lockTimeout gives
+ *        how many milliseconds to wait for other threads
+ *
  * @retval 0 on success
  * @retval -1 on error
  */
-static int elektraLockMutex (Key * parentKey ELEKTRA_UNUSED)
+static int elektraLockMutex (resolverHandle * pk ELEKTRA_UNUSED, Key * parentKey ELEKTRA_UNUSED)
 {
 #ifdef ELEKTRA_LOCK_MUTEX
-	int ret = pthread_mutex_trylock (&elektraResolverMutex);
-	if (ret != 0)
+	char * resolved = realpath (pk->filename, 0);
+	const char * filename = resolved ? resolved : pk->filename;
+	pthread_t self = pthread_self ();
+	struct timespec deadline;
+	int ret = 0;
+
+	pthread_mutex_lock (&elektraResolverLockMutex);
+	if (pk->lockTimeout > 0) elektraLockDeadline (&deadline, pk->lockTimeout);
+	for (;;)
 	{
-		if (errno == EBUSY       // for trylock
-		    || errno == EDEADLK) // for error checking mutex, if enabled
+		struct _resolverLock * lock = elektraResolverLocks;
+		while (lock && strcmp (lock->filename, filename) != 0)
 		{
-			ELEKTRA_SET_ERROR (ELEKTRA_ERROR_CONFLICT, parentKey,
-					   "conflict because other thread writes to configuration indicated by mutex lock");
+			lock = lock->next;
+		}
+
+		if (!lock)
+		{
+			lock = elektraMalloc (sizeof (struct _resolverLock));
+			char * lockFilename = elektraStrDup (filename);
+			if (!lock || !lockFilename)
+			{
+				elektraFree (lock);
+				elektraFree (lockFilename);
+				ret = -2;
+				break;
+			}
+			lock->filename = lockFilename;
+			lock->owner = self;
+			lock->depth = 1;
+			lock->next = elektraResolverLocks;
+			elektraResolverLocks = lock;
+			pk->lock = lock;
+			break;
+		}
+
+		if (pthread_equal (lock->owner, self))
+		{
+			++lock->depth;
+			pk->lock = lock;
+			break;
+		}
+
+		// spurious wakeups and locks of other files just search again
+		if (pk->lockTimeout <= 0 ||
+		    pthread_cond_timedwait (&elektraResolverLockReleased, &elektraResolverLockMutex, &deadline) == ETIMEDOUT)
+		{
+			ret = -1;
+			break;
+		}
+	}
+	pthread_mutex_unlock (&elektraResolverLockMutex);
+	free (resolved);
+
+	if (ret == -2)
+	{
+		ELEKTRA_SET_ERROR (87, parentKey, "Out of memory");
+		ret = -1;
+	}
+	else if (ret == -1)
+	{
+		if (pk->lockTimeout > 0)
+		{
+			ELEKTRA_SET_ERRORF (ELEKTRA_ERROR_CONFLICT, parentKey,
+					    "conflict because other thread writes to configuration file %s for more than %d ms",
+					    pk->filename, pk->lockTimeout);
 		}
 		else
 		{
 			ELEKTRA_SET_ERRORF (ELEKTRA_ERROR_CONFLICT, parentKey,
-					    "assuming conflict because of failed mutex lock with message: %s", strerror (errno));
+					    "conflict because other thread writes to configuration file %s indicated by mutex lock",
+					    pk->filename);
 		}
-		return -1;
 	}
-	return 0;
+	return ret;
 #else
 	return 0;
 #endif
@@ -234,18 +357,36 @@ static int elektraLockMutex (Key * parentKey ELEKTRA_UNUSED)
 /**
  * @brief mutex unlock for multithread-safety
  *
+ * Wakes up threads waiting for the file when its last lock is gone.
+ *
  * @retval 0 on success
  * @retval -1 on error
  */
-static int elektraUnlockMutex (Key * parentKey ELEKTRA_UNUSED)
+static int elektraUnlockMutex (resolverHandle * pk ELEKTRA_UNUSED, Key * parentKey ELEKTRA_UNUSED)
 {
 #ifdef ELEKTRA_LOCK_MUTEX
-	int ret = pthread_mutex_unlock (&elektraResolverMutex);
-	if (ret != 0)
+	struct _resolverLock * lock = pk->lock;
+	if (!lock)
 	{
-		ELEKTRA_ADD_WARNINGF (32, parentKey, "mutex unlock failed with message: %s", strerror (errno));
+		ELEKTRA_ADD_WARNINGF (32, parentKey, "mutex unlock failed because %s was not locked", pk->filename);
 		return -1;
 	}
+	pk->lock = 0;
+
+	pthread_mutex_lock (&elektraResolverLockMutex);
+	if (--lock->depth == 0)
+	{
+		struct _resolverLock ** cur = &elektraResolverLocks;
+		while (*cur != lock)
+		{
+			cur = &(*cur)->next;
+		}
+		*cur = lock->next;
+		elektraFree (lock->filename);
+		elektraFree (lock);
+		pthread_cond_broadcast (&elektraResolverLockReleased);
+	}
+	pthread_mutex_unlock (&elektraResolverLockMutex);
 	return 0;
 #else
 	return 0;
@@ -378,41 +519,16 @@ int ELEKTRA_PLUGIN_FUNCTION (resolver, open) (Plugin * handle, Key * errorKey)
 	resolverInit (&p->user, path);
 	resolverInit (&p->system, path);
 
-#if defined(ELEKTRA_RESOLVER_RECURSIVE_MUTEX_INITIALIZATION)
-	// PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP is available in glibc only
-	// so we use another mutex for the initialization of the recursive mutex,
-	// since this section must be thread safe.
-	pthread_mutex_lock (&elektraResolverInitMutex);
-	if (!elektraResolverMutexInitialized)
+	// optionally wait for other writers instead of an immediate conflict
+	Key * timeoutKey = ksLookupByName (resolverConfig, "/lock/timeout", 0);
+	if (timeoutKey)
 	{
-		pthread_mutexattr_t mutexAttr;
-		int mutexError;
-
-		if ((mutexError = pthread_mutexattr_init (&mutexAttr)) != 0)
-		{
-			ELEKTRA_SET_ERRORF (35, errorKey, "Could not initialize recursive mutex: pthread_mutexattr_init returned %d",
-					    mutexError);
-			pthread_mutex_unlock (&elektraResolverInitMutex);
-			return -1;
-		}
-		if ((mutexError = pthread_mutexattr_settype (&mutexAttr, PTHREAD_MUTEX_RECURSIVE)) != 0)
-		{
-			ELEKTRA_SET_ERRORF (35, errorKey, "Could not initialize recursive mutex: pthread_mutexattr_settype returned %d",
-					    mutexError);
-			pthread_mutex_unlock (&elektraResolverInitMutex);
-			return -1;
-		}
-		if ((mutexError = pthread_mutex_init (&elektraResolverMutex, &mutexAttr)) != 0)
-		{
-			ELEKTRA_SET_ERRORF (35, errorKey, "Could not initialize recursive mutex: pthread_mutex_init returned %d",
-					    mutexError);
-			pthread_mutex_unlock (&elektraResolverInitMutex);
-			return -1;
-		}
-		elektraResolverMutexInitialized = 1;
+		int timeout = atoi (keyString (timeoutKey));
+		p->spec.lockTimeout = timeout;
+		p->dir.lockTimeout = timeout;
+		p->user.lockTimeout = timeout;
+		p->system.lockTimeout = timeout;
 	}
-	pthread_mutex_unlock (&elektraResolverInitMutex);
-#endif
 
 	// system and spec files need to be world-readable, otherwise they are
 	// useless
@@ -803,7 +919,7 @@ static int elektraSetPrepare (resolverHandle * pk, Key * parentKey)
 		pk->removalNeeded = 1;
 	}
 
-	if (elektraLockMutex (parentKey) != 0)
+	if (elektraLockMutex (pk, parentKey) != 0)
 	{
 		elektraCloseFile (pk->fd, parentKey);
 		pk->fd = -1;
@@ -811,10 +927,10 @@ static int elektraSetPrepare (resolverHandle * pk, Key * parentKey)
 	}
 
 	// now we have a file, so lock immediately
-	if (elektraLockFile (pk->fd, parentKey) == -1)
+	if (elektraLockFile (pk->fd, pk->lockTimeout, parentKey) == -1)
 	{
 		elektraCloseFile (pk->fd, parentKey);
-		elektraUnlockMutex (parentKey);
+		elektraUnlockMutex (pk, parentKey);
 		pk->fd = -1;
 		return -1;
 	}
@@ -823,7 +939,7 @@ static int elektraSetPrepare (resolverHandle * pk, Key * parentKey)
 	{
 		elektraUnlockFile (pk->fd, parentKey);
 		elektraCloseFile (pk->fd, parentKey);
-		elektraUnlockMutex (parentKey);
+		elektraUnlockMutex (pk, parentKey);
 		pk->fd = -1;
 		return -1;
 	}
@@ -915,7 +1031,7 @@ static int elektraSetCommit (resolverHandle * pk, Key * parentKey)
 		ret = -1;
 	}
 
-	elektraLockFile (fd, parentKey);
+	elektraLockFile (fd, 0, parentKey);
 
 	if (rename (pk->tempfile, pk->filename) == -1)
 	{
@@ -979,7 +1095,7 @@ static int elektraSetCommit (resolverHandle * pk, Key * parentKey)
 	elektraCloseFile (pk->fd, parentKey);
 	elektraUnlockFile (fd, parentKey);
 	elektraCloseFile (fd, parentKey);
-	elektraUnlockMutex (parentKey);
+	elektraUnlockMutex (pk, parentKey);
 
 	return ret;
 }
@@ -1077,7 +1193,7 @@ int ELEKTRA_PLUGIN_FUNCTION (resolver, error) (Plugin * handle, KeySet * r ELEKT
 		{ // removal needed state (= resolver created file, but error)
 			elektraUnlinkFile (pk->filename, parentKey);
 		}
-		elektraUnlockMutex (parentKey);
+		elektraUnlockMutex (pk, parentKey);
 	}
 
 	// reset for next time
@@ -9,7 +9,7 @@
 #ifndef PLUGIN_RESOLVER_H
 #define PLUGIN_RESOLVER_H
 
-#define _GNU_SOURCE // needed for recursive mutex
+#define _GNU_SOURCE // needed for realpath and clock_gettime
 
 #include <sys/stat.h>
 
@@ -43,6 +43,9 @@ struct _resolverHandle
 
 	gid_t gid;
 	uid_t uid;
+
+	struct _resolverLock * lock; ///< the lock of the file held between prepare and commit
+	int lockTimeout;	     ///< milliseconds to wait for locks of other writers
 };
 
 typedef struct _resolverHandles resolverHandles;
@@ -11,6 +11,7 @@
 #include <kdbinternal.h>
 
 #include <langinfo.h>
+#include <pthread.h>
 
 #include "resolver.h"
 
@@ -262,6 +263,128 @@ static void check_xdg ()
 	}
 }
 
+static Plugin * openLocked (KeySet * modules, const char * file, const char * timeout)
+{
+	KeySet * conf = ksNew (2, keyNew ("user/path", KEY_VALUE, file, KEY_END), KS_END);
+	if (timeout) ksAppendKey (conf, keyNew ("user/lock/timeout", KEY_VALUE, timeout, KEY_END));
+	Plugin * plugin = elektraPluginOpen ("resolver", modules, conf, 0);
+	exit_if_fail (plugin, "could not load resolver plugin");
+	return plugin;
+}
+
+/**
+ * @brief Get and prepare, the temporary file is written as a storage would.
+ */
+static int prepareLocked (Plugin * plugin)
+{
+	KeySet * ks = ksNew (1, keyNew ("user/tests/resolver/key", KEY_VALUE, "value", KEY_END), KS_END);
+	Key * parentKey = keyNew ("user/tests/resolver", KEY_END);
+	plugin->kdbGet (plugin, ks, parentKey);
+	int ret = plugin->kdbSet (plugin, ks, parentKey);
+	if (ret == 1)
+	{
+		FILE * fp = fopen (keyString (parentKey), "w");
+		if (fp) fclose (fp);
+	}
+	keyDel (parentKey);
+	ksDel (ks);
+	return ret;
+}
+
+static void finishLocked (Plugin * plugin, int commit)
+{
+	KeySet * ks = ksNew (1, keyNew ("user/tests/resolver/key", KEY_VALUE, "value", KEY_END), KS_END);
+	Key * parentKey = keyNew ("user/tests/resolver", KEY_END);
+	if (commit)
+	{
+		plugin->kdbSet (plugin, ks, parentKey);
+	}
+	else
+	{
+		plugin->kdbError (plugin, ks, parentKey);
+	}
+	keyDel (parentKey);
+	ksDel (ks);
+}
+
+typedef struct
+{
+	KeySet * modules;
+	char * same;
+	char * other;
+	int ready[2]; ///< pipe, written before the waiting thread locks
+	int released; ///< the main thread released the lock
+	int otherRet;
+	int conflictRet;
+	int waitRet;
+	int waitReleased;
+} LockTest;
+
+static void * lockWriter (void * data)
+{
+	LockTest * test = data;
+
+	Plugin * other = openLocked (test->modules, test->other, 0);
+	test->otherRet = prepareLocked (other);
+	finishLocked (other, 1);
+	elektraPluginClose (other, 0);
+
+	Plugin * conflict = openLocked (test->modules, test->same, 0);
+	test->conflictRet = prepareLocked (conflict);
+	elektraPluginClose (conflict, 0);
+
+	Plugin * wait = openLocked (test->modules, test->same, "10000");
+	char c = 'r';
+	exit_if_fail (write (test->ready[1], &c, 1) == 1, "could not write to pipe");
+	test->waitRet = prepareLocked (wait);
+	// the mutex of the resolver orders this read after the release
+	test->waitReleased = test->released;
+	if (test->waitRet == 1) finishLocked (wait, 0);
+	elektraPluginClose (wait, 0);
+	return 0;
+}
+
+static void test_locks ()
+{
+	printf ("Lock files per thread\n");
+
+	LockTest test = { 0 };
+	test.modules = ksNew (0, KS_END);
+	elektraModulesInit (test.modules, 0);
+	test.same = elektraFormat ("%s/lock-same.ecf", tempHome);
+	test.other = elektraFormat ("%s/lock-other.ecf", tempHome);
+	FILE * fp = fopen (test.same, "w");
+	exit_if_fail (fp, "could not create file");
+	fclose (fp);
+
+	Plugin * plugin = openLocked (test.modules, test.same, 0);
+	succeed_if (prepareLocked (plugin) == 1, "could not prepare");
+
+	exit_if_fail (pipe (test.ready) == 0, "could not create pipe");
+	pthread_t thread;
+	exit_if_fail (pthread_create (&thread, 0, lockWriter, &test) == 0, "could not create thread");
+	char c;
+	exit_if_fail (read (test.ready[0], &c, 1) == 1, "could not read from pipe");
+	test.released = 1;
+	finishLocked (plugin, 0);
+	pthread_join (thread, 0);
+	close (test.ready[0]);
+	close (test.ready[1]);
+
+	succeed_if (test.otherRet == 1, "independent file not writable while other file is locked");
+	succeed_if (test.conflictRet == -1, "no conflict on locked file");
+	succeed_if (test.waitRet == 1, "did not wait for locked file");
+	succeed_if (test.waitReleased == 1, "locked file locked again before it was released");
+
+	elektraPluginClose (plugin, 0);
+	unlink (test.same);
+	unlink (test.other);
+	elektraFree (test.same);
+	elektraFree (test.other);
+	elektraModulesClose (test.modules, 0);
+	ksDel (test.modules);
+}
+
 
 int main (int argc, char ** argv)
 {
@@ -278,6 +401,7 @@ int main (int argc, char ** argv)
 	test_name ();
 	test_lockname ();
 	test_tempname ();
+	test_locks ();
 
 
 	printf ("\ntest_backendhelpers RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
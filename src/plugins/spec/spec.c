@@ -79,11 +79,6 @@ static char * keyNameToMatchingString (const Key * key)
 	return pattern;
 }
 
-static int matchPatternToKey (const char * pattern, const Key * key)
-{
-	return !fnmatch (pattern, (strchr (keyName (key), '/') + 1), FNM_PATHNAME);
-}
-
 static int isValidArrayKey (Key * key)
 {
 	Key * copy = keyDup (key);
@@ -164,15 +159,15 @@ static void validateArrayRange (Key * parent, long validCount, Key * specKey)
 	}
 }
 
-static void validateArray (KeySet * ks, Key * arrayKey, Key * specKey)
+static void validateArray (KeySet * ks, Key * arrayKey, Key * specKey, KeySet * dirty)
 {
 	Key * tmpArrayParent = keyDup (arrayKey);
 	keySetBaseName (tmpArrayParent, 0);
 	Key * arrayParent = ksLookup (ks, tmpArrayParent, KDB_O_NONE);
 	keyDel (tmpArrayParent);
 	if (arrayParent == NULL) return;
-	KeySet * ksCopy = ksDup (ks);
-	KeySet * subKeys = ksCut (ksCopy, arrayParent);
+	ksAppendKey (dirty, arrayParent);
+	KeySet * subKeys = ksBelow (ks, arrayParent);
 	Key * cur;
 	long validCount = 0;
 	while ((cur = ksNext (subKeys)) != NULL)
@@ -191,7 +186,11 @@ static void validateArray (KeySet * ks, Key * arrayKey, Key * specKey)
 				Key * toMark;
 				while ((toMark = ksNext (invalidCutKS)) != NULL)
 				{
-					if (strcmp (keyName (cur), keyName (toMark))) keySetMeta (toMark, "conflict/invalid", "");
+					if (strcmp (keyName (cur), keyName (toMark)))
+					{
+						keySetMeta (toMark, "conflict/invalid", "");
+						ksAppendKey (dirty, toMark);
+					}
 					elektraMetaArrayAdd (arrayParent, "conflict/invalid/hasmember", keyName (toMark));
 				}
 				ksDel (invalidCutKS);
@@ -199,10 +198,9 @@ static void validateArray (KeySet * ks, Key * arrayKey, Key * specKey)
 		}
 	}
 	ksDel (subKeys);
-	ksDel (ksCopy);
 	validateArrayRange (arrayParent, validCount, specKey);
 }
-static void validateWildcardSubs (KeySet * ks, Key * key, Key * specKey)
+static void validateWildcardSubs (KeySet * ks, Key * key, Key * specKey, KeySet * dirty)
 {
 	const Key * requiredMeta = keyGetMeta (specKey, "required");
 	if (!requiredMeta) return;
@@ -211,8 +209,7 @@ static void validateWildcardSubs (KeySet * ks, Key * key, Key * specKey)
 	Key * parent = ksLookup (ks, tmpParent, KDB_O_NONE);
 	keyDel (tmpParent);
 	if (parent == NULL) return;
-	KeySet * ksCopy = ksDup (ks);
-	KeySet * subKeys = ksCut (ksCopy, parent);
+	KeySet * subKeys = ksBelow (ks, parent);
 	Key * cur;
 	long subCount = 0;
 	while ((cur = ksNext (subKeys)) != NULL)
@@ -225,10 +222,10 @@ static void validateWildcardSubs (KeySet * ks, Key * key, Key * specKey)
 	{
 		snprintf (buffer, sizeof (buffer), "%ld", subCount);
 		keySetMeta (parent, "conflict/invalid/subcount", buffer);
+		ksAppendKey (dirty, parent);
 	}
 
 	ksDel (subKeys);
-	ksDel (ksCopy);
 }
 
 
@@ -583,6 +580,11 @@ static int handleErrors (Key * parentKey, KeySet * ks, Key * key, Key * specKey,
 	return ret;
 }
 
+static int isSpecOnlyMeta (const char * name)
+{
+	return !strcmp (name, "array") || !strcmp (name, "required") || !strncmp (name, "conflict/", 9) || !strcmp (name, "require");
+}
+
 static void removeMeta (Key * key, Key * specKey, Key * parentKey ELEKTRA_UNUSED)
 {
 	keyRewindMeta (specKey);
@@ -590,8 +592,7 @@ static void removeMeta (Key * key, Key * specKey, Key * parentKey ELEKTRA_UNUSED
 	{
 		const Key * meta = keyCurrentMeta (specKey);
 		const char * name = keyName (meta);
-		if (!(!strcmp (name, "array") || !strcmp (name, "required") || !strncmp (name, "conflict/", 9) ||
-		      !strcmp (name, "require")))
+		if (!isSpecOnlyMeta (name))
 		{
 			const Key * oldMeta;
 			if ((oldMeta = keyGetMeta (key, name)) != NULL)
@@ -604,13 +605,30 @@ static void removeMeta (Key * key, Key * specKey, Key * parentKey ELEKTRA_UNUSED
 
 static void copyMeta (Key * key, Key * specKey, Key * parentKey ELEKTRA_UNUSED)
 {
+	keyRewindMeta (key);
+	if (!keyNextMeta (key))
+	{
+		// share all metadata of the spec key if none needs to be left out
+		int specOnly = 0;
+		keyRewindMeta (specKey);
+		while (!specOnly && keyNextMeta (specKey) != NULL)
+		{
+			specOnly = isSpecOnlyMeta (keyName (keyCurrentMeta (specKey)));
+		}
+		if (!specOnly)
+		{
+			keyCopyAllMeta (key, specKey);
+			keySetMeta (key, "spec/internal/valid", 0);
+			return;
+		}
+	}
+
 	keyRewindMeta (specKey);
 	while (keyNextMeta (specKey) != NULL)
 	{
 		const Key * meta = keyCurrentMeta (specKey);
 		const char * name = keyName (meta);
-		if (!(!strcmp (name, "array") || !strcmp (name, "required") || !strncmp (name, "conflict/", 9) ||
-		      !strcmp (name, "require")))
+		if (!isSpecOnlyMeta (name))
 		{
 			const Key * oldMeta;
 			if ((oldMeta = keyGetMeta (key, name)) != NULL)
@@ -628,7 +646,8 @@ static void copyMeta (Key * key, Key * specKey, Key * parentKey ELEKTRA_UNUSED)
 			}
 			else
 			{
-				keySetMeta (key, name, keyString (meta));
+				// the metadata is immutable, so all keys can share it
+				keyCopyMeta (key, specKey, name);
 			}
 		}
 	}
@@ -649,19 +668,72 @@ static int hasRequired (Key * key, Key * specKey, KeySet * ks)
 	return 1;
 }
 
+static int hasConflictMeta (Key * key)
+{
+	keyRewindMeta (key);
+	while (keyNextMeta (key) != NULL)
+	{
+		if (!strncmp (keyName (keyCurrentMeta (key)), "conflict/", 9)) return 1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Append @p key to the keys matched by the spec keys from @p specIndex on
+ *
+ * For the spec key @p specIndex itself, which is currently applied,
+ * only keys after @p current are appended.
+ */
+static void addMatches (ElektraGlobMatcher * matcher, KeySet ** matches, size_t specIndex, Key * key, Key * current)
+{
+	const char * name = strchr (keyName (key), '/');
+	if (!name) return;
+	size_t size;
+	const size_t * indices = elektraGlobMatcherMatch (matcher, name + 1, &size);
+	for (size_t i = 0; i < size; ++i)
+	{
+		if (indices[i] < specIndex) continue;
+		if (indices[i] == specIndex && current && keyCmp (key, current) <= 0) continue;
+		ksAppendKey (matches[indices[i]], key);
+	}
+}
+
+/**
+ * @brief Index the keys that lookups added to @p returned
+ *
+ * Cascading lookups append keys for the default values of spec keys.
+ */
+static void addNewKeys (ElektraGlobMatcher * matcher, KeySet ** matches, size_t specIndex, Key * current, KeySet * returned,
+			KeySet * known)
+{
+	if (ksGetSize (returned) == ksGetSize (known)) return;
+	Key * cur;
+	ksRewind (returned);
+	while ((cur = ksNext (returned)) != NULL)
+	{
+		if (ksLookup (known, cur, KDB_O_NOCASCADING) == cur) continue;
+		ksAppendKey (known, cur);
+		addMatches (matcher, matches, specIndex, cur, current);
+	}
+}
+
 static int doGlobbing (Key * parentKey, KeySet * returned, KeySet * specKS, ConflictHandling * ch, Direction dir, int clean)
 {
 	Key * specKey;
-	ksRewind (specKS);
 	Key * cur;
 	int ret = 1;
-	while ((specKey = ksNext (specKS)) != NULL)
+
+	// match every key against all spec keys at once instead of calling fnmatch for every pair
+	size_t specSize = ksGetSize (specKS);
+	ElektraGlobMatcher * matcher = elektraGlobMatcherNew ();
+	KeySet ** matches = elektraCalloc ((specSize + 1) * sizeof (KeySet *));
+	if (!matcher || !matches) goto memerror;
+	ksRewind (specKS);
+	for (size_t i = 0; (specKey = ksNext (specKS)) != NULL; ++i)
 	{
-		int require = 0;
 		char * pattern;
 		if (keyGetMeta (specKey, "require"))
 		{
-			require = 1;
 			Key * matchKey = keyDup (specKey);
 			keySetBaseName (matchKey, 0);
 			pattern = keyNameToMatchingString (matchKey);
@@ -671,80 +743,136 @@ static int doGlobbing (Key * parentKey, KeySet * returned, KeySet * specKS, Conf
 		{
 			pattern = keyNameToMatchingString (specKey);
 		}
+		// the index of the pattern must be the index of its spec key
+		ssize_t index = pattern ? elektraGlobMatcherAdd (matcher, pattern, FNM_PATHNAME) : -1;
+		elektraFree (pattern);
+		if (index != (ssize_t)i || !(matches[i] = ksNew (0, KS_END))) goto memerror;
+	}
+
+	// conflicts are handled for all keys that may have conflict metadata
+	KeySet * dirty = ksNew (0, KS_END);
+	KeySet * known = ksNew (ksGetSize (returned), KS_END);
+	ksRewind (returned);
+	while ((cur = ksNext (returned)) != NULL)
+	{
+		ksAppendKey (known, cur);
+		addMatches (matcher, matches, 0, cur, 0);
+		if (hasConflictMeta (cur)) ksAppendKey (dirty, cur);
+	}
+
+	ksRewind (specKS);
+	for (size_t i = 0; (specKey = ksNext (specKS)) != NULL; ++i)
+	{
+		int require = keyGetMeta (specKey, "require") != NULL;
 		int found = 0;
-		ksRewind (returned);
-		while ((cur = ksNext (returned)) != NULL)
+		Key * appended = 0;
+		for (cursor_t c = 0; (cur = ksAtCursor (matches[i], c)) != NULL; ++c)
 		{
-			cursor_t cursor = ksGetCursor (returned);
-			if (matchPatternToKey (pattern, cur))
+			if (!clean)
 			{
-				if (!clean)
+				found = 1;
+				ksAppendKey (dirty, cur);
+				if (require)
 				{
-					found = 1;
-					if (require)
-					{
-						if (hasRequired (cur, specKey, returned)) copyMeta (cur, specKey, parentKey);
-					}
-					else if (keyGetMeta (cur, "conflict/invalid"))
-					{
-						copyMeta (cur, specKey, parentKey);
-					}
-					else if (keyGetMeta (cur, "spec/internal/valid"))
-					{
-						copyMeta (cur, specKey, parentKey);
-					}
-					else if (elektraArrayValidateName (cur) == 1)
-					{
-						validateArray (returned, cur, specKey);
-						copyMeta (cur, specKey, parentKey);
-					}
-					else if (!(strcmp (keyBaseName (specKey), "_")))
-					{
-						validateWildcardSubs (returned, cur, specKey);
-						copyMeta (cur, specKey, parentKey);
-					}
-					else
+					if (hasRequired (cur, specKey, returned)) copyMeta (cur, specKey, parentKey);
+				}
+				else if (keyGetMeta (cur, "conflict/invalid"))
+				{
+					copyMeta (cur, specKey, parentKey);
+				}
+				else if (keyGetMeta (cur, "spec/internal/valid"))
+				{
+					copyMeta (cur, specKey, parentKey);
+				}
+				else if (elektraArrayValidateName (cur) == 1)
+				{
+					validateArray (returned, cur, specKey, dirty);
+					copyMeta (cur, specKey, parentKey);
+				}
+				else if (!(strcmp (keyBaseName (specKey), "_")))
+				{
+					validateWildcardSubs (returned, cur, specKey, dirty);
+					copyMeta (cur, specKey, parentKey);
+				}
+				else
+				{
+					if (hasArray (cur))
 					{
-						if (hasArray (cur))
-						{
-							if (isValidArrayKey (cur))
-							{
-								copyMeta (cur, specKey, parentKey);
-							}
-						}
-						else
+						if (isValidArrayKey (cur))
 						{
 							copyMeta (cur, specKey, parentKey);
 						}
 					}
-				}
-				else
-				{
-					removeMeta (cur, specKey, parentKey);
+					else
+					{
+						copyMeta (cur, specKey, parentKey);
+					}
 				}
 			}
-			ksSetCursor (returned, cursor);
+			else
+			{
+				removeMeta (cur, specKey, parentKey);
+			}
+			addNewKeys (matcher, matches, i, cur, returned, known);
 		}
-		ksRewind (returned);
 		if (!found && dir == GET)
 		{
 			if (keyGetMeta (specKey, "assign/condition")) // hardcoded for now because only assign/conditional currently exists
 			{
 				Key * newKey = keyNew (strchr (keyName (specKey), '/'), KEY_CASCADING_NAME, KEY_END);
-				keySetMeta (newKey, "assign/condition", keyString (keyGetMeta (specKey, "assign/condition")));
-				ksAppendKey (returned, keyDup (newKey));
+				keyCopyMeta (newKey, specKey, "assign/condition");
+				appended = keyDup (newKey);
+				ksAppendKey (returned, appended);
+				ksAppendKey (known, appended);
+				addMatches (matcher, matches, i + 1, appended, 0);
 				keyDel (newKey);
 			}
 		}
-		while ((cur = ksNext (returned)) != NULL)
+
+		// keys without conflicts would return 0, only the last key of returned sets ret
+		// keys up to an appended key are handled with the next spec key
+		KeySet * postponed = ksNew (0, KS_END);
+		Key * handled = 0;
+		int result = 0;
+		ksRewind (dirty);
+		while ((cur = ksNext (dirty)) != NULL)
 		{
-			ret = handleErrors (parentKey, returned, cur, specKey, ch, dir);
+			if (appended && keyCmp (cur, appended) <= 0)
+			{
+				ksAppendKey (postponed, cur);
+				continue;
+			}
+			result = handleErrors (parentKey, returned, cur, specKey, ch, dir);
+			handled = cur;
 			keySetMeta (cur, "conflict/invalid", 0);
 		}
+		ksClear (dirty);
+		ksAppend (dirty, postponed);
+		ksDel (postponed);
+		addNewKeys (matcher, matches, i + 1, 0, returned, known);
+		Key * last = ksTail (returned);
+		if (last && (!appended || keyCmp (last, appended) > 0)) ret = last == handled ? result : 0;
+	}
 
-		elektraFree (pattern);
+	for (size_t i = 0; i < specSize; ++i)
+	{
+		ksDel (matches[i]);
 	}
+	elektraFree (matches);
+	ksDel (known);
+	ksDel (dirty);
+	elektraGlobMatcherDel (matcher);
 	return ret;
+
+memerror:
+	ELEKTRA_SET_ERROR (87, parentKey, "Out of memory");
+	for (size_t i = 0; matches && i < specSize; ++i)
+	{
+		ksDel (matches[i]);
+	}
+	elektraFree (matches);
+	elektraGlobMatcherDel (matcher);
+	return -1;
 }
 
 static void parseConfig (KeySet * config, ConflictHandling * ch)
@@ -15,6 +15,42 @@
 #include <tests_plugin.h>
 
 
+static void test_sharedMeta ()
+{
+	printf ("test shared meta\n");
+
+	Key * parentKey = keyNew ("user/tests/spec", KEY_END);
+	KeySet * conf = ksNew (0, KS_END);
+	PLUGIN_OPEN ("spec");
+
+	KeySet * ks = ksNew (10, keyNew ("spec/tests/spec/_", KEY_META, "check/type", "long", KEY_META, "description", "element", KEY_END),
+			     keyNew ("user/tests/spec/a", KEY_END), keyNew ("user/tests/spec/b", KEY_META, "description", "own", KEY_END),
+			     KS_END);
+	succeed_if (plugin->kdbGet (plugin, ks, parentKey) >= 0, "get failed");
+
+	Key * specKey = ksLookupByName (ks, "spec/tests/spec/_", 0);
+	Key * a = ksLookupByName (ks, "user/tests/spec/a", 0);
+	Key * b = ksLookupByName (ks, "user/tests/spec/b", 0);
+	exit_if_fail (specKey && a && b, "keys missing");
+
+	// all keys share the metadata of the spec key
+	succeed_if_same_string (keyString (keyGetMeta (a, "check/type")), "long");
+	succeed_if (keyGetMeta (a, "check/type") == keyGetMeta (specKey, "check/type"), "metadata not shared");
+	succeed_if (keyGetMeta (b, "check/type") == keyGetMeta (specKey, "check/type"), "metadata not shared");
+	succeed_if (keyGetMeta (a, "description") == keyGetMeta (specKey, "description"), "metadata not shared");
+
+	// but they can still be modified independently
+	keySetMeta (a, "check/type", "short");
+	succeed_if_same_string (keyString (keyGetMeta (a, "check/type")), "short");
+	succeed_if_same_string (keyString (keyGetMeta (specKey, "check/type")), "long");
+	succeed_if_same_string (keyString (keyGetMeta (b, "conflict/description")), "own");
+
+	ksDel (ks);
+	keyDel (parentKey);
+	PLUGIN_CLOSE ();
+}
+
+
 int main (int argc, char ** argv)
 {
 	printf ("SPEC     TESTS\n");
@@ -22,6 +58,8 @@ int main (int argc, char ** argv)
 
 	init (argc, argv);
 
+	test_sharedMeta ();
+
 	printf ("\ntestmod_spec RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
 
 	return nbError;
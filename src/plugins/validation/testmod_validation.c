@@ -246,6 +246,48 @@ void icase_test ()
 	PLUGIN_CLOSE ();
 }
 
+static void cache_test ()
+{
+	Key * parentKey = keyNew ("user/tests/validation", KEY_VALUE, "", KEY_END);
+	KeySet * conf = ksNew (0, KS_END);
+	PLUGIN_OPEN ("validation");
+
+	KeySet * ks = ksNew (0, KS_END);
+	char name[50];
+	char value[10];
+	char regex[10];
+	for (int i = 0; i < 200; ++i)
+	{
+		snprintf (name, sizeof (name), "user/tests/validation/array/#%d", i);
+		ksAppendKey (ks, keyNew (name, KEY_VALUE, "valid", KEY_META, "check/validation", "^[a-z]+$", KEY_END));
+	}
+	for (int i = 0; i < 100; ++i)
+	{
+		snprintf (name, sizeof (name), "user/tests/validation/other/#%d", i);
+		snprintf (value, sizeof (value), "%d", i);
+		snprintf (regex, sizeof (regex), "^%d$", i);
+		ksAppendKey (ks, keyNew (name, KEY_VALUE, value, KEY_META, "check/validation", regex, KEY_END));
+	}
+
+	// more regular expressions than cached ones and the second kdbSet reuses the cache
+	ksRewind (ks);
+	succeed_if (plugin->kdbSet (plugin, ks, parentKey) == 1, "kdbSet failed");
+	ksRewind (ks);
+	succeed_if (plugin->kdbSet (plugin, ks, parentKey) == 1, "kdbSet with cached regex failed");
+
+	keySetString (ksLookupByName (ks, "user/tests/validation/array/#100", 0), "Invalid");
+	ksRewind (ks);
+	succeed_if (plugin->kdbSet (plugin, ks, parentKey) == -1, "kdbSet with cached regex did not detect invalid key");
+
+	keySetMeta (ksLookupByName (ks, "user/tests/validation/array/#0", 0), "check/validation", "^[a-z+$");
+	ksRewind (ks);
+	succeed_if (plugin->kdbSet (plugin, ks, parentKey) == -1, "kdbSet did not detect invalid regex");
+
+	ksDel (ks);
+	keyDel (parentKey);
+	PLUGIN_CLOSE ();
+}
+
 
 int main (int argc, char ** argv)
 {
@@ -261,6 +303,7 @@ int main (int argc, char ** argv)
 	line_test ();
 	icase_test ();
 	invert_test ();
+	cache_test ();
 	printf ("\ntest_backendhelpers RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
 
 	return nbError;
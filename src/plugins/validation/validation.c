@@ -17,6 +17,84 @@
 
 #include "validation.h"
 
+#include <kdbease.h>
+
+/** the number of compiled regular expressions kept between calls of kdbSet() */
+#define ELEKTRA_VALIDATION_CACHE_SIZE 64
+
+static void freeRegex (void * value)
+{
+	regfree (value);
+	elektraFree (value);
+}
+
+int elektraValidationOpen (Plugin * handle, Key * errorKey ELEKTRA_UNUSED)
+{
+	ElektraLru * cache = elektraLruNew (ELEKTRA_VALIDATION_CACHE_SIZE, freeRegex);
+	if (!cache) return -1;
+	elektraPluginSetData (handle, cache);
+	return 1;
+}
+
+int elektraValidationClose (Plugin * handle, Key * errorKey ELEKTRA_UNUSED)
+{
+	elektraLruDel (elektraPluginGetData (handle));
+	elektraPluginSetData (handle, 0);
+	return 1;
+}
+
+/**
+ * @brief Compile @p regexString or get it from the cache of the plugin
+ *
+ * Keys with the same check/validation (as in arrays) share one
+ * compiled regular expression.
+ *
+ * @return the regular expression owned by the cache or NULL after setting an error
+ */
+static regex_t * getRegex (Plugin * handle, const char * regexString, int cflags, Key * parentKey)
+{
+	ElektraLru * cache = elektraPluginGetData (handle);
+	char * name = elektraFormat ("%d %s", cflags, regexString);
+	if (!name)
+	{
+		ELEKTRA_SET_ERROR (87, parentKey, "Out of memory");
+		return 0;
+	}
+	regex_t * regex = elektraLruGet (cache, name);
+	if (regex)
+	{
+		elektraFree (name);
+		return regex;
+	}
+
+	regex = elektraMalloc (sizeof (regex_t));
+	if (!regex)
+	{
+		ELEKTRA_SET_ERROR (87, parentKey, "Out of memory");
+		elektraFree (name);
+		return 0;
+	}
+	int ret = regcomp (regex, regexString, cflags);
+	if (ret != 0)
+	{
+		char buffer[1000];
+		regerror (ret, regex, buffer, 999);
+		ELEKTRA_SET_ERROR (41, parentKey, buffer);
+		freeRegex (regex);
+		elektraFree (name);
+		return 0;
+	}
+
+	if (elektraLruPut (cache, name, regex) != 0)
+	{
+		ELEKTRA_SET_ERROR (87, parentKey, "could not cache regular expression");
+		freeRegex (regex);
+		regex = 0;
+	}
+	elektraFree (name);
+	return regex;
+}
+
 int elektraValidationGet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned, Key * parentKey ELEKTRA_UNUSED)
 {
 	KeySet * n;
@@ -24,6 +102,8 @@ int elektraValidationGet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned, Key
 		  n = ksNew (30,
 			     keyNew ("system/elektra/modules/validation", KEY_VALUE, "validation plugin waits for your orders", KEY_END),
 			     keyNew ("system/elektra/modules/validation/exports", KEY_END),
+			     keyNew ("system/elektra/modules/validation/exports/open", KEY_FUNC, elektraValidationOpen, KEY_END),
+			     keyNew ("system/elektra/modules/validation/exports/close", KEY_FUNC, elektraValidationClose, KEY_END),
 			     keyNew ("system/elektra/modules/validation/exports/get", KEY_FUNC, elektraValidationGet, KEY_END),
 			     keyNew ("system/elektra/modules/validation/exports/set", KEY_FUNC, elektraValidationSet, KEY_END),
 			     keyNew ("system/elektra/modules/validation/exports/ksLookupRE", KEY_FUNC, ksLookupRE, KEY_END),
@@ -33,7 +113,7 @@ int elektraValidationGet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned, Key
 	return 1;
 }
 
-int elektraValidationSet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned, Key * parentKey)
+int elektraValidationSet (Plugin * handle, KeySet * returned, Key * parentKey)
 {
 	Key * cur = 0;
 
@@ -106,23 +186,16 @@ int elektraValidationSet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned, Key
 			regexString = (char *)keyString (regexMeta);
 		}
 
-		regex_t regex;
 		regmatch_t offsets;
-		int ret = regcomp (&regex, regexString, cflags);
+		regex_t * regex = getRegex (handle, regexString, cflags, parentKey);
+		if (freeString) elektraFree (regexString);
+		if (!regex) return -1;
 
-		if (ret != 0)
-		{
-			char buffer[1000];
-			regerror (ret, &regex, buffer, 999);
-			ELEKTRA_SET_ERROR (41, parentKey, buffer);
-			regfree (&regex);
-			if (freeString) elektraFree (regexString);
-			return -1;
-		}
+		int ret = 0;
 		int match = 0;
 		if (!wordValidation)
 		{
-			ret = regexec (&regex, keyString (cur), 1, &offsets, 0);
+			ret = regexec (regex, keyString (cur), 1, &offsets, 0);
 			if (ret == 0) match = 1;
 		}
 		else
@@ -132,7 +205,7 @@ int elektraValidationSet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned, Key
 			char * string = (char *)keyString (cur);
 			while ((token = strtok_r (string, " \t\n", &savePtr)) != NULL)
 			{
-				ret = regexec (&regex, token, 1, &offsets, 0);
+				ret = regexec (regex, token, 1, &offsets, 0);
 				if (ret == 0)
 				{
 					match = 1;
@@ -149,23 +222,17 @@ int elektraValidationSet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned, Key
 			if (msg)
 			{
 				ELEKTRA_SET_ERROR (42, parentKey, keyString (msg));
-				regfree (&regex);
-				if (freeString) elektraFree (regexString);
 				return -1;
 			}
 			else
 			{
 				char buffer[1000];
-				regerror (ret, &regex, buffer, 999);
+				regerror (ret, regex, buffer, 999);
 				ELEKTRA_SET_ERROR (42, parentKey, buffer);
-				regfree (&regex);
-				if (freeString) elektraFree (regexString);
 				return -1;
 			}
 		}
 
-		regfree (&regex);
-		if (freeString) elektraFree (regexString);
 	}
 
 	return 1; /* success */
@@ -175,6 +242,8 @@ Plugin * ELEKTRA_PLUGIN_EXPORT (validation)
 {
 	// clang-format off
 	return elektraPluginExport("validation",
+			ELEKTRA_PLUGIN_OPEN,	&elektraValidationOpen,
+			ELEKTRA_PLUGIN_CLOSE,	&elektraValidationClose,
 			ELEKTRA_PLUGIN_GET,	&elektraValidationGet,
 			ELEKTRA_PLUGIN_SET,	&elektraValidationSet,
 			ELEKTRA_PLUGIN_END);
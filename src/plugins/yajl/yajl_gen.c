@@ -9,6 +9,8 @@
 #include "yajl_gen.h"
 
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 
 /**
@@ -245,12 +247,18 @@ int elektraGenEmpty (yajl_gen g, KeySet * returned, Key * parentKey)
 	return did_something;
 }
 
+/**
+ * @brief Write the generated document with a single write()
+ *
+ * The generator already holds the whole document in one buffer,
+ * so it is written directly instead of going through stdio.
+ */
 int elektraGenWriteFile (yajl_gen g, Key * parentKey)
 {
 	int errnosave = errno;
-	FILE * fp = fopen (keyString (parentKey), "w");
+	int fd = open (keyString (parentKey), O_WRONLY | O_CREAT | O_TRUNC, 0666);
 
-	if (!fp)
+	if (fd == -1)
 	{
 		ELEKTRA_SET_ERROR_SET (parentKey);
 		errno = errnosave;
@@ -260,10 +268,30 @@ int elektraGenWriteFile (yajl_gen g, Key * parentKey)
 	const unsigned char * buf;
 	yajl_size_type len;
 	yajl_gen_get_buf (g, &buf, &len);
-	fwrite (buf, 1, len, fp);
+
+	while (len > 0)
+	{
+		ssize_t written = write (fd, buf, len);
+		if (written == -1)
+		{
+			if (errno == EINTR) continue;
+			ELEKTRA_SET_ERROR_SET (parentKey);
+			yajl_gen_clear (g);
+			close (fd);
+			errno = errnosave;
+			return -1;
+		}
+		buf += written;
+		len -= written;
+	}
 	yajl_gen_clear (g);
 
-	fclose (fp);
+	if (close (fd) == -1)
+	{
+		ELEKTRA_SET_ERROR_SET (parentKey);
+		errno = errnosave;
+		return -1;
+	}
 
 	errno = errnosave;
 	return 1; /* success */
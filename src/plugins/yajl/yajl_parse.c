@@ -9,60 +9,137 @@
 #include "yajl.h"
 
 #include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <kdbconfig.h>
 #include <kdbease.h>
 #include <kdberrors.h>
+#include <kdbprivate.h>
+#include <kdbproposal.h>
 #include <yajl/yajl_parse.h>
 
 
 /**
- @retval 0 if ksCurrent does not hold an array entry
- @retval 1 if the array entry will be used because its the first
- @retval 2 if a new array entry was created
- @retval -1 error in snprintf
+ * @brief A map or array the parser is in.
  */
-static int elektraYajlIncrementArrayEntry (KeySet * ks)
+typedef struct
 {
-	Key * current = ksCurrent (ks);
-	const char * baseName = keyBaseName (current);
+	size_t length;		/**< length of the name of the key of the map or array */
+	kdb_long_long_t next; /**< index of the next array element, -1 for maps */
+	int empty;		/**< no member or element was found so far */
+} YajlLevel;
 
-	if (baseName && *baseName == '#')
-	{
-		current = keyNew (keyName (current), KEY_END);
-		if (!strcmp (baseName, "###empty_array"))
-		{
-			// get rid of previous key
-			keyDel (ksLookup (ks, current, KDB_O_POP));
-			// we have a new array entry
-			keySetBaseName (current, 0);
-			keyAddName (current, "#0");
-			ksAppendKey (ks, current);
-			return 1;
-		}
-		else
-		{
-			// we are in an array
-			elektraArrayIncName (current);
-			ksAppendKey (ks, current);
-			return 2;
-		}
-	}
-	else
+/**
+ * @brief State of the parser, passed to all callbacks.
+ *
+ * The name of the current key is built in one buffer which is reused
+ * for all keys, the names of maps and arrays are prefixes of it.
+ * The keys are collected in the order of the file and appended to the
+ * keyset at once by elektraKsAppendArray().
+ */
+typedef struct
+{
+	KeyArena * arena; /**< the keys are allocated in the arena of the keyset */
+	Key ** keys;
+	size_t size;
+	size_t alloc;
+	Key * current; /**< the key the next value belongs to, if not in an array */
+
+	char * name; /**< name of the current key */
+	size_t length;
+	size_t nameAlloc;
+
+	YajlLevel * levels;
+	size_t depth;
+	size_t levelAlloc;
+
+	char * buffer; /**< null terminated copies of strings from yajl */
+	size_t bufferAlloc;
+} YajlParser;
+
+static int elektraYajlReserve (void ** buffer, size_t * alloc, size_t needed, size_t elementSize)
+{
+	if (needed <= *alloc) return 1;
+	size_t newAlloc = *alloc ? *alloc : 64;
+	while (newAlloc < needed)
 	{
-		// previous entry indicates this is not an array
-		return 0;
+		newAlloc *= 2;
 	}
+	if (elektraRealloc (buffer, newAlloc * elementSize) == -1) return 0;
+	*alloc = newAlloc;
+	return 1;
 }
 
-static int elektraYajlParseNull (void * ctx)
+/**
+ * @return a null terminated copy of a string passed by yajl
+ */
+static char * elektraYajlCopy (YajlParser * p, const unsigned char * stringVal, yajl_size_type stringLen)
+{
+	if (!elektraYajlReserve ((void **)&p->buffer, &p->bufferAlloc, stringLen + 1, 1)) return 0;
+	memcpy (p->buffer, stringVal, stringLen);
+	p->buffer[stringLen] = '\0';
+	return p->buffer;
+}
+
+/**
+ * @brief Replace the last part of the current name (after @p length)
+ *
+ * @param part already escaped part
+ */
+static int elektraYajlSetName (YajlParser * p, size_t length, const char * part)
+{
+	size_t size = strlen (part);
+	if (!elektraYajlReserve ((void **)&p->name, &p->nameAlloc, length + size + 2, 1)) return 0;
+	p->name[length] = '/';
+	memcpy (p->name + length + 1, part, size + 1);
+	p->length = length + size + 1;
+	return 1;
+}
+
+/**
+ * @brief Create a key with the current name
+ */
+static Key * elektraYajlAppend (YajlParser * p)
+{
+	if (!elektraYajlReserve ((void **)&p->keys, &p->alloc, p->size + 1, sizeof (Key *))) return 0;
+	Key * key = elektraKeyArenaKeyNew (p->arena, p->name);
+	if (!key) return 0;
+	p->keys[p->size++] = key;
+	return key;
+}
+
+/**
+ * @brief Get the key for the next value
+ *
+ * Within arrays, a new element is created. Otherwise, the key was
+ * created by elektraYajlParseMapKey() or is the parent key.
+ *
+ * @retval 0 on memory errors
+ */
+static Key * elektraYajlValueKey (YajlParser * p)
 {
-	KeySet * ks = (KeySet *)ctx;
-	elektraYajlIncrementArrayEntry (ks);
+	if (!p->depth) return p->current;
 
-	Key * current = ksCurrent (ks);
+	YajlLevel * level = &p->levels[p->depth - 1];
+	level->empty = 0;
+	if (level->next < 0) return p->current;
+
+	char part[ELEKTRA_MAX_ARRAY_SIZE];
+	elektraWriteArrayNumber (part, level->next++);
+	if (!elektraYajlSetName (p, level->length, part)) return 0;
+	return p->current = elektraYajlAppend (p);
+}
+
+static int elektraYajlParseNull (void * ctx)
+{
+	YajlParser * p = (YajlParser *)ctx;
+	Key * current = elektraYajlValueKey (p);
+	if (!current) return 0;
 
 	keySetBinary (current, NULL, 0);
 
@@ -75,18 +152,17 @@ static int elektraYajlParseNull (void * ctx)
 
 static int elektraYajlParseBoolean (void * ctx, int boolean)
 {
-	KeySet * ks = (KeySet *)ctx;
-	elektraYajlIncrementArrayEntry (ks);
-
-	Key * current = ksCurrent (ks);
+	YajlParser * p = (YajlParser *)ctx;
+	Key * current = elektraYajlValueKey (p);
+	if (!current) return 0;
 
 	if (boolean == 1)
 	{
-		keySetString (current, "true");
+		elektraKeyArenaSetValue (p->arena, current, "true", sizeof ("true"));
 	}
 	else
 	{
-		keySetString (current, "false");
+		elektraKeyArenaSetValue (p->arena, current, "false", sizeof ("false"));
 	}
 	keySetMeta (current, "type", "boolean");
 
@@ -99,149 +175,119 @@ static int elektraYajlParseBoolean (void * ctx, int boolean)
 
 static int elektraYajlParseNumber (void * ctx, const char * stringVal, yajl_size_type stringLen)
 {
-	KeySet * ks = (KeySet *)ctx;
-	elektraYajlIncrementArrayEntry (ks);
-
-	Key * current = ksCurrent (ks);
-
-	unsigned char delim = stringVal[stringLen];
-	char * stringValue = (char *)stringVal;
-	stringValue[stringLen] = '\0';
+	YajlParser * p = (YajlParser *)ctx;
+	Key * current = elektraYajlValueKey (p);
+	if (!current) return 0;
 
 #ifdef ELEKTRA_YAJL_VERBOSE
-	printf ("elektraYajlParseNumber %s %d\n", stringVal, stringLen);
+	printf ("elektraYajlParseNumber %.*s %d\n", (int)stringLen, stringVal, (int)stringLen);
 #endif
 
-	keySetString (current, stringVal);
+	char * stringValue = elektraYajlCopy (p, (const unsigned char *)stringVal, stringLen);
+	if (!stringValue) return 0;
+	elektraKeyArenaSetValue (p->arena, current, stringValue, stringLen + 1);
 	keySetMeta (current, "type", "double");
 
-	// restore old character in buffer
-	stringValue[stringLen] = delim;
-
 	return 1;
 }
 
 static int elektraYajlParseString (void * ctx, const unsigned char * stringVal, yajl_size_type stringLen)
 {
-	KeySet * ks = (KeySet *)ctx;
-	elektraYajlIncrementArrayEntry (ks);
-
-	Key * current = ksCurrent (ks);
-
-	unsigned char delim = stringVal[stringLen];
-	char * stringValue = (char *)stringVal;
-	stringValue[stringLen] = '\0';
+	YajlParser * p = (YajlParser *)ctx;
+	Key * current = elektraYajlValueKey (p);
+	if (!current) return 0;
 
 #ifdef ELEKTRA_YAJL_VERBOSE
-	printf ("elektraYajlParseString %s %d\n", stringVal, stringLen);
+	printf ("elektraYajlParseString %.*s %d\n", (int)stringLen, stringVal, (int)stringLen);
 #endif
 
-	keySetString (current, stringValue);
+	if (!stringLen)
+	{
+		keySetString (current, "");
+		return 1;
+	}
 
-	// restore old character in buffer
-	stringValue[stringLen] = delim;
+	char * stringValue = elektraYajlCopy (p, stringVal, stringLen);
+	if (!stringValue) return 0;
+	elektraKeyArenaSetValue (p->arena, current, stringValue, stringLen + 1);
 	return 1;
 }
 
 static int elektraYajlParseMapKey (void * ctx, const unsigned char * stringVal, yajl_size_type stringLen)
 {
-	KeySet * ks = (KeySet *)ctx;
-	elektraYajlIncrementArrayEntry (ks);
-
-	Key * currentKey = keyNew (keyName (ksCurrent (ks)), KEY_END);
-	keySetString (currentKey, 0);
+	YajlParser * p = (YajlParser *)ctx;
+	YajlLevel * level = &p->levels[p->depth - 1];
+	level->empty = 0;
 
-	unsigned char delim = stringVal[stringLen];
-	char * stringValue = (char *)stringVal;
-	stringValue[stringLen] = '\0';
+	char * stringValue = elektraYajlCopy (p, stringVal, stringLen);
+	if (!stringValue) return 0;
 
 #ifdef ELEKTRA_YAJL_VERBOSE
-	printf ("elektraYajlParseMapKey stringValue: %s currentKey: %s\n", stringValue, keyName (currentKey));
+	printf ("elektraYajlParseMapKey stringValue: %s\n", stringValue);
 #endif
-	if (currentKey && !strcmp (keyBaseName (currentKey), "___empty_map"))
-	{
-		// remove old key
-		keyDel (ksLookup (ks, currentKey, KDB_O_POP));
-		// now we know the name of the object
-		keySetBaseName (currentKey, stringValue);
-	}
-	else
-	{
-		// we entered a new pair (inside the previous object)
-		keySetBaseName (currentKey, stringValue);
-	}
-	ksAppendKey (ks, currentKey);
 
-	// restore old character in buffer
-	stringValue[stringLen] = delim;
+	// escaping may double the size of the name
+	if (!elektraYajlReserve ((void **)&p->name, &p->nameAlloc, level->length + 2 * stringLen + 3, 1)) return 0;
+	p->name[level->length] = '/';
+	elektraEscapeKeyNamePart (stringValue, p->name + level->length + 1);
+	p->length = level->length + 1 + strlen (p->name + level->length + 1);
 
-	return 1;
+	p->current = elektraYajlAppend (p);
+	return p->current != 0;
 }
 
-static int elektraYajlParseStartMap (void * ctx)
+static int elektraYajlParseStart (YajlParser * p, kdb_long_long_t next)
 {
-	KeySet * ks = (KeySet *)ctx;
-	elektraYajlIncrementArrayEntry (ks);
-
-	Key * currentKey = ksCurrent (ks);
-
-	Key * newKey = keyNew (keyName (currentKey), KEY_END);
-	// add a pseudo element for empty map
-	keyAddBaseName (newKey, "___empty_map");
-	ksAppendKey (ks, newKey);
-
-#ifdef ELEKTRA_YAJL_VERBOSE
-	printf ("elektraYajlParseStartMap with new key %s\n", keyName (newKey));
-#endif
+	if (!elektraYajlValueKey (p)) return 0;
+	if (!elektraYajlReserve ((void **)&p->levels, &p->levelAlloc, p->depth + 1, sizeof (YajlLevel))) return 0;
 
+	YajlLevel * level = &p->levels[p->depth++];
+	level->length = p->length;
+	level->next = next;
+	level->empty = 1;
 	return 1;
 }
 
-static int elektraYajlParseEnd (void * ctx)
+static int elektraYajlParseStartMap (void * ctx)
 {
-	KeySet * ks = (KeySet *)ctx;
-	Key * currentKey = ksCurrent (ks);
-
-	Key * lookupKey = keyNew (keyName (currentKey), KEY_END);
-	keySetBaseName (lookupKey, 0); // remove current baseName
-
-	// lets point current to the correct place
-	Key * foundKey = ksLookup (ks, lookupKey, 0);
-
 #ifdef ELEKTRA_YAJL_VERBOSE
-	if (foundKey)
-	{
-		printf ("elektraYajlParseEnd %s\n", keyName (foundKey));
-	}
-	else
-	{
-		printf ("elektraYajlParseEnd did not find key!\n");
-	}
-#else
-	(void)foundKey; // foundKey is not used, but lookup is needed
+	printf ("elektraYajlParseStartMap\n");
 #endif
 
-	keyDel (lookupKey);
-
-	return 1;
+	return elektraYajlParseStart ((YajlParser *)ctx, -1);
 }
 
 static int elektraYajlParseStartArray (void * ctx)
 {
-	KeySet * ks = (KeySet *)ctx;
-	elektraYajlIncrementArrayEntry (ks);
+#ifdef ELEKTRA_YAJL_VERBOSE
+	printf ("elektraYajlParseStartArray\n");
+#endif
 
-	Key * currentKey = ksCurrent (ks);
+	return elektraYajlParseStart ((YajlParser *)ctx, 0);
+}
 
-	Key * newKey = keyNew (keyName (currentKey), KEY_END);
-	// add a pseudo element for empty array
-	keyAddName (newKey, "###empty_array");
-	ksAppendKey (ks, newKey);
+/**
+ * @brief Leave a map or array
+ *
+ * Empty maps and arrays get a pseudo element ___empty_map or
+ * ###empty_array, so that they can be written again.
+ */
+static int elektraYajlParseEnd (void * ctx)
+{
+	YajlParser * p = (YajlParser *)ctx;
+	YajlLevel * level = &p->levels[--p->depth];
 
 #ifdef ELEKTRA_YAJL_VERBOSE
-	printf ("elektraYajlParseStartArray with new key %s\n", keyName (newKey));
+	printf ("elektraYajlParseEnd %.*s\n", (int)level->length, p->name);
 #endif
 
+	if (level->empty)
+	{
+		if (!elektraYajlSetName (p, level->length, level->next < 0 ? "___empty_map" : "###empty_array")) return 0;
+		if (!elektraYajlAppend (p)) return 0;
+	}
+	p->length = level->length;
+	p->name[p->length] = '\0';
 	return 1;
 }
 
@@ -285,6 +331,41 @@ static void elektraYajlParseSuppressEmpty (KeySet * returned, Key * parentKey)
 	}
 }
 
+/**
+ * @brief Read everything from fd, for files which cannot be mapped
+ *
+ * @param data set to the data read, to be freed with elektraFree()
+ * @param size set to the number of bytes read
+ *
+ * @retval 0 on success
+ * @retval -1 on errors, errno is set then
+ */
+static int elektraYajlReadAll (int fd, unsigned char ** data, size_t * size)
+{
+	size_t alloc = 0;
+	*data = 0;
+	*size = 0;
+	for (;;)
+	{
+		if (!elektraYajlReserve ((void **)data, &alloc, *size + 4096, 1))
+		{
+			errno = ENOMEM;
+			break;
+		}
+		ssize_t rd = read (fd, *data + *size, alloc - *size);
+		if (rd == 0) return 0;
+		if (rd == -1)
+		{
+			if (errno == EINTR) continue;
+			break;
+		}
+		*size += rd;
+	}
+	elektraFree (*data);
+	*data = 0;
+	return -1;
+}
+
 static inline KeySet * elektraGetModuleConfig ()
 {
 	return ksNew (30, keyNew ("system/elektra/modules/yajl", KEY_VALUE, "yajl plugin waits for your orders", KEY_END),
@@ -298,6 +379,18 @@ static inline KeySet * elektraGetModuleConfig ()
 		      keyNew ("system/elektra/modules/yajl/config/below", KEY_VALUE, "user", KEY_END), KS_END);
 }
 
+static void elektraYajlParserDel (YajlParser * p)
+{
+	for (size_t i = 0; i < p->size; ++i)
+	{
+		keyDel (p->keys[i]);
+	}
+	elektraFree (p->keys);
+	elektraFree (p->name);
+	elektraFree (p->levels);
+	elektraFree (p->buffer);
+}
+
 int elektraYajlGet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned, Key * parentKey)
 {
 	if (!strcmp (keyName (parentKey), "system/elektra/modules/yajl"))
@@ -320,76 +413,111 @@ int elektraYajlGet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned, Key * par
 				     elektraYajlParseStartArray,
 				     elektraYajlParseEnd };
 
-	ksAppendKey (returned, keyNew (keyName ((parentKey)), KEY_END));
+	int errnosave = errno;
+	int fd = open (keyString (parentKey), O_RDONLY);
+	struct stat buf;
+	if (fd == -1 || fstat (fd, &buf) == -1)
+	{
+		ELEKTRA_SET_ERROR_GET (parentKey);
+		if (fd != -1) close (fd);
+		errno = errnosave;
+		return -1;
+	}
+
+	// the whole file is parsed at once, streams like /dev/stdin are read first
+	int mapped = S_ISREG (buf.st_mode) && buf.st_size > 0;
+	size_t fileSize = mapped ? (size_t)buf.st_size : 0;
+	unsigned char * fileData = 0;
+	if (mapped && (fileData = mmap (NULL, fileSize, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED)
+	{
+		ELEKTRA_SET_ERROR (76, parentKey, keyString (parentKey));
+		close (fd);
+		errno = errnosave;
+		return -1;
+	}
+	if (!mapped && elektraYajlReadAll (fd, &fileData, &fileSize) == -1)
+	{
+		ELEKTRA_SET_ERROR_GET (parentKey);
+		close (fd);
+		errno = errnosave;
+		return -1;
+	}
+	close (fd);
+
+	YajlParser parser;
+	memset (&parser, 0, sizeof (YajlParser));
+	parser.arena = elektraKsArena (returned);
+	size_t length = keyGetNameSize (parentKey) - 1;
+	int ok = parser.arena && elektraYajlReserve ((void **)&parser.name, &parser.nameAlloc, length + 1, 1);
+	if (ok)
+	{
+		memcpy (parser.name, keyName (parentKey), length + 1);
+		parser.length = length;
+		ok = (parser.current = elektraYajlAppend (&parser)) != 0;
+	}
 
 #if YAJL_MAJOR == 1
 	yajl_parser_config cfg = { 1, 1 };
-	yajl_handle hand = yajl_alloc (&callbacks, &cfg, NULL, returned);
+	yajl_handle hand = yajl_alloc (&callbacks, &cfg, NULL, &parser);
 #else
-	yajl_handle hand = yajl_alloc (&callbacks, NULL, returned);
+	yajl_handle hand = yajl_alloc (&callbacks, NULL, &parser);
 	yajl_config (hand, yajl_allow_comments, 1);
 #endif
 
-	int errnosave = errno;
-	unsigned char fileData[65536];
-	int done = 0;
-	FILE * fileHandle = fopen (keyString (parentKey), "r");
-	if (!fileHandle)
+	yajl_status stat = yajl_status_ok;
+	if (ok && fileSize)
 	{
-		yajl_free (hand);
-		ELEKTRA_SET_ERROR_GET (parentKey);
-		errno = errnosave;
-		return -1;
+		stat = yajl_parse (hand, fileData, fileSize);
 	}
-
-	while (!done)
+#if YAJL_MAJOR == 1
+	if (stat == yajl_status_insufficient_data) stat = yajl_status_ok;
+#endif
+	if (ok && stat == yajl_status_ok)
 	{
-		yajl_size_type rd = fread ((void *)fileData, 1, sizeof (fileData) - 1, fileHandle);
-		if (rd == 0)
-		{
-			if (!feof (fileHandle))
-			{
-				ELEKTRA_SET_ERROR (76, parentKey, keyString (parentKey));
-				fclose (fileHandle);
-				yajl_free (hand);
-				return -1;
-			}
-			done = 1;
-		}
-		fileData[rd] = 0;
-
-		yajl_status stat;
-		if (done)
-		{
 #if YAJL_MAJOR == 1
-			stat = yajl_parse_complete (hand);
+		stat = yajl_parse_complete (hand);
 #else
-			stat = yajl_complete_parse (hand);
+		stat = yajl_complete_parse (hand);
 #endif
-		}
-		else
-		{
-			stat = yajl_parse (hand, fileData, rd);
-		}
-		int test_status = (stat != yajl_status_ok);
+	}
+	int test_status = (stat != yajl_status_ok);
 #if YAJL_MAJOR == 1
-		test_status = test_status && (stat != yajl_status_insufficient_data);
+	test_status = test_status && (stat != yajl_status_insufficient_data);
 #endif
-		if (test_status)
-		{
-			unsigned char * str = yajl_get_error (hand, 1, fileData, rd);
-			ELEKTRA_SET_ERROR (77, parentKey, (char *)str);
-			yajl_free_error (hand, str);
-			yajl_free (hand);
-			fclose (fileHandle);
 
-			return -1;
-		}
+	if (!ok)
+	{
+		ELEKTRA_SET_ERROR (87, parentKey, "could not allocate memory");
+	}
+	else if (test_status)
+	{
+		unsigned char * str = yajl_get_error (hand, 1, fileData, fileSize);
+		ELEKTRA_SET_ERROR (77, parentKey, (char *)str);
+		yajl_free_error (hand, str);
 	}
 
 	yajl_free (hand);
-	fclose (fileHandle);
+	if (mapped)
+	{
+		munmap (fileData, fileSize);
+	}
+	else
+	{
+		elektraFree (fileData);
+	}
+
+	if (!ok || test_status)
+	{
+		elektraYajlParserDel (&parser);
+		errno = errnosave;
+		return -1;
+	}
+
+	elektraKsAppendArray (returned, parser.keys, parser.size);
+	parser.size = 0;
+	elektraYajlParserDel (&parser);
 	elektraYajlParseSuppressEmpty (returned, parentKey);
 
+	errno = errnosave;
 	return 1; /* success */
 }
@@ -17,10 +17,24 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
+typedef struct
+{
+	pthread_barrier_t bar;
+	long commits;   ///< successful kdbSet() in throughput mode
+	long conflicts; ///< failed kdbSet() in throughput mode
+	long long ns;   ///< longest time a writer needed in throughput mode
+} Shared;
+
+Shared * shared;
 pthread_barrier_t * bar;
 
+int num_threads;
+int num_mountpoints;
+int num_commits;
+
 void * writer (void * pV_data ELEKTRA_UNUSED)
 {
 	Key * parent = keyNew ("user/test/race", KEY_END);
@@ -66,21 +80,94 @@ void * writer (void * pV_data ELEKTRA_UNUSED)
 	return 0;
 }
 
+static long long elapsed (const struct timespec * start)
+{
+	struct timespec end;
+	clock_gettime (CLOCK_MONOTONIC, &end);
+	return (end.tv_sec - start->tv_sec) * 1000000000LL + (end.tv_nsec - start->tv_nsec);
+}
+
+/**
+ * @brief Commit repeatedly to one of the mountpoints user/test/race/<n>
+ *
+ * Writers of different mountpoints should not conflict, so the
+ * throughput shows how well independent backends commit concurrently.
+ */
+void * throughput (void * pV_data)
+{
+	int writer = *(int *)pV_data;
+	char name[4096];
+	sprintf (name, "user/test/race/%d", writer % num_mountpoints);
+	Key * parent = keyNew (name, KEY_END);
+	KDB * h = kdbOpen (parent);
+	KeySet * ks = ksNew (20, KS_END);
+	long commits = 0;
+	long conflicts = 0;
+
+	kdbGet (h, ks, parent);
+	pthread_barrier_wait (bar);
+
+	struct timespec start;
+	clock_gettime (CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < num_commits; ++i)
+	{
+		sprintf (name, "%s/%d/%lu/%d", keyName (parent), getpid (), (unsigned long)pthread_self (), i);
+		ksAppendKey (ks, keyNew (name, KEY_VALUE, "a value", KEY_END));
+		if (kdbSet (h, ks, parent) == -1)
+		{
+			++conflicts;
+			kdbGet (h, ks, parent);
+		}
+		else
+		{
+			++commits;
+		}
+	}
+	long long ns = elapsed (&start);
+
+	__sync_fetch_and_add (&shared->commits, commits);
+	__sync_fetch_and_add (&shared->conflicts, conflicts);
+	long long longest = shared->ns;
+	while (ns > longest && !__sync_bool_compare_and_swap (&shared->ns, longest, ns))
+	{
+		longest = shared->ns;
+	}
+
+	ksDel (ks);
+	kdbClose (h, parent);
+	keyDel (parent);
+	return 0;
+}
+
 int main (int argc, char ** argv)
 {
-	if (argc != 4)
+	if (argc != 4 && argc != 6)
 	{
-		printf ("Usage %s <procs> <threads> <barriers>\n", argv[0]);
+		printf ("Usage %s <procs> <threads> <barriers> [<mountpoints> <commits>]\n", argv[0]);
 		printf ("This program tests race condition in Elektra\n");
 		printf ("If you set barriers procs*threads, all threads will\n");
 		printf ("start kdbSet() at roughly the same time\n");
+		printf ("\n");
+		printf ("With mountpoints and commits given, every thread commits\n");
+		printf ("that often to one of user/test/race/0 .. user/test/race/<mountpoints-1>\n");
+		printf ("(mount them to different files first) and the commit\n");
+		printf ("throughput is printed\n");
 		return 1;
 	}
 
 	// on error (0) is safe
 	int num_procs = atoi (argv[1]);
-	int num_threads = atoi (argv[2]);
+	num_threads = atoi (argv[2]);
 	int num_barriers = atoi (argv[3]);
+	if (argc == 6)
+	{
+		num_mountpoints = atoi (argv[4]);
+		num_commits = atoi (argv[5]);
+		if (num_mountpoints <= 0 || num_commits <= 0)
+		{
+			return 1;
+		}
+	}
 
 	if (num_barriers > num_procs * num_threads)
 	{
@@ -108,19 +195,21 @@ int main (int argc, char ** argv)
 		return 6;
 	}
 
-	if (ftruncate (shm_fd, sizeof (pthread_barrier_t)) != 0)
+	if (ftruncate (shm_fd, sizeof (Shared)) != 0)
 	{
 		return 7;
 	}
 
-	bar = mmap (NULL, sizeof (pthread_barrier_t), PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+	shared = mmap (NULL, sizeof (Shared), PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
 
-	if (bar == MAP_FAILED)
+	if (shared == MAP_FAILED)
 	{
 		shm_unlink (shm_name);
 		return 8;
 	}
 
+	bar = &shared->bar;
+
 	if (pthread_barrier_init (bar, &attr, num_barriers) != 0)
 	{
 		return 10;
@@ -146,11 +235,16 @@ int main (int argc, char ** argv)
 		{
 			// child
 			pthread_t * pwriter = elektraMalloc (num_threads * sizeof (pthread_t));
-			if (!pwriter) return 13;
-			for (i = 0; i < num_threads; i++)
-				if (pthread_create (&pwriter[i], NULL, writer, (void *)0) != 0) return 14;
-			for (i = 0; i < num_threads; i++)
-				pthread_join (pwriter[i], NULL);
+			int * writers = elektraMalloc (num_threads * sizeof (int));
+			if (!pwriter || !writers) return 13;
+			for (int t = 0; t < num_threads; t++)
+			{
+				writers[t] = i * num_threads + t;
+				if (pthread_create (&pwriter[t], NULL, num_commits ? throughput : writer, &writers[t]) != 0) return 14;
+			}
+			for (int t = 0; t < num_threads; t++)
+				pthread_join (pwriter[t], NULL);
+			elektraFree (writers);
 			elektraFree (pwriter);
 			return 0;
 		}
@@ -180,6 +274,12 @@ int main (int argc, char ** argv)
 		return 41;
 	}
 
+	if (num_commits && shared->ns > 0)
+	{
+		printf ("%ld commits and %ld conflicts on %d mountpoints in %.3f s: %.1f commits/s\n", shared->commits, shared->conflicts,
+			num_mountpoints, shared->ns / 1e9, shared->commits / (shared->ns / 1e9));
+	}
+
 	printf ("Test run finished\n");
 	return sumexitstatus;
 }
@@ -307,25 +307,24 @@ void output_backend (Backend * backend)
 	output_key (backend->mountpoint);
 }
 
-void output_trie (Trie * trie)
+static void output_trienode (TrieNode * node, int depth)
 {
-	int i;
-	for (i = 0; i < KDB_MAX_UCHAR; ++i)
+	if (node->value)
 	{
-		if (trie->value[i])
-		{
-			printf ("output_trie: %p, mp: %s %s [%d]\n", (void *)trie->value[i], keyName (trie->value[i]->mountpoint),
-				keyString (trie->value[i]->mountpoint), i);
-		}
-		if (trie->children[i]) output_trie (trie->children[i]);
+		printf ("output_trie: %p, mp: %s %s [%d]\n", (void *)node->value, keyName (node->value->mountpoint),
+			keyString (node->value->mountpoint), depth);
 	}
-	if (trie->empty_value)
+	for (size_t i = 0; i < node->nrChildren; ++i)
 	{
-		printf ("empty_value: %p, mp: %s %s\n", (void *)trie->empty_value, keyName (trie->empty_value->mountpoint),
-			keyString (trie->empty_value->mountpoint));
+		output_trienode (&node->children[i], depth + 1);
 	}
 }
 
+void output_trie (Trie * trie)
+{
+	output_trienode (&trie->root, 0);
+}
+
 void output_split (Split * split)
 {
 	printf ("Split - size: %zd, alloc: %zd\n", split->size, split->alloc);
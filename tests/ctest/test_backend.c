@@ -243,6 +243,122 @@ static void test_backref ()
 	ksDel (modules);
 }
 
+static void test_lazy ()
+{
+	printf ("Test lazy building of backend\n");
+
+	KeySet * modules = ksNew (0, KS_END);
+	elektraModulesInit (modules, 0);
+
+	Key * errorKey = keyNew (0);
+	Backend * backend = elektraBackendOpenLazy (set_simple (), modules, errorKey);
+	exit_if_fail (backend, "could not open backend");
+	succeed_if (backend->config, "config not kept");
+	succeed_if (!backend->getplugins[1] && !backend->setplugins[1] && !backend->errorplugins[1], "plugins opened");
+	succeed_if (ksLookupByName (modules, "system/elektra/modules/" KDB_DEFAULT_STORAGE, 0) == 0, "module loaded");
+	succeed_if_same_string (keyName (backend->mountpoint), "user/tests/backend/simple");
+	succeed_if_same_string (keyString (backend->mountpoint), "simple");
+
+	Key * warningKey = keyNew ("user/tests/backend", KEY_END);
+	succeed_if (elektraBackendMaterialise (backend, warningKey) == 1, "could not materialise backend");
+	succeed_if (!backend->config, "config still kept");
+	succeed_if_same_string (keyName (warningKey), "user/tests/backend");
+	succeed_if (!keyGetMeta (warningKey, "warnings"), "warnings found");
+	exit_if_fail (backend->getplugins[1] && backend->setplugins[1] && backend->errorplugins[1], "plugins not opened");
+	succeed_if (backend->getplugins[0] == 0, "there should be no plugin");
+
+	KeySet * test_config = set_pluginconf ();
+	compare_keyset (elektraPluginGetConfig (backend->getplugins[1]), test_config);
+	ksDel (test_config);
+
+	Plugin * plugin = backend->getplugins[1];
+	succeed_if (elektraBackendMaterialise (backend, warningKey) == 0, "materialised twice");
+	succeed_if (backend->getplugins[1] == plugin, "plugin reopened");
+
+	elektraBackendClose (backend, errorKey);
+
+	// backends which are never used, are closed without opening
+	backend = elektraBackendOpenLazy (set_simple (), modules, errorKey);
+	succeed_if (elektraBackendClose (backend, errorKey) == 0, "could not close backend");
+
+	keyDel (warningKey);
+	keyDel (errorKey);
+	elektraModulesClose (modules, 0);
+	ksDel (modules);
+}
+
+static void test_lazyMissing ()
+{
+	printf ("Test lazy building of missing backend\n");
+
+	KeySet * modules = ksNew (0, KS_END);
+	elektraModulesInit (modules, 0);
+
+	Key * errorKey = keyNew (0);
+	Backend * backend = elektraBackendOpenLazy (
+		ksNew (5, keyNew ("system/elektra/mountpoints/broken", KEY_END),
+		       keyNew ("system/elektra/mountpoints/broken/getplugins", KEY_END),
+		       keyNew ("system/elektra/mountpoints/broken/getplugins/#1not_existing_plugin", KEY_END),
+		       keyNew ("system/elektra/mountpoints/broken/mountpoint", KEY_VALUE, "user/tests/backend/broken", KEY_END),
+		       KS_END),
+		modules, errorKey);
+	exit_if_fail (backend, "could not open backend");
+	succeed_if (!keyGetMeta (errorKey, "warnings"), "warnings before the plugins are opened");
+	succeed_if_same_string (keyString (backend->mountpoint), "broken");
+
+	Key * warningKey = keyNew ("user/tests/backend", KEY_END);
+	succeed_if (elektraBackendMaterialise (backend, warningKey) == -1, "missing plugin not detected");
+	succeed_if (keyGetMeta (warningKey, "warnings"), "no warnings for missing plugin");
+	succeed_if (!keyGetMeta (warningKey, "error"), "error instead of warning");
+	succeed_if_same_string (keyName (warningKey), "user/tests/backend");
+	succeed_if_same_string (keyString (backend->mountpoint), "missing");
+	exit_if_fail (backend->getplugins[0], "no missing plugin");
+	succeed_if (backend->getplugins[0] == backend->setplugins[0], "missing plugin should be shared");
+
+	Key * parentKey = keyNew ("user/tests/backend/broken", KEY_END);
+	KeySet * ks = ksNew (0, KS_END);
+	succeed_if (backend->getplugins[0]->kdbGet (backend->getplugins[0], ks, parentKey) == -1, "missing plugin should fail");
+	ksDel (ks);
+	keyDel (parentKey);
+
+	elektraBackendClose (backend, errorKey);
+	keyDel (warningKey);
+	keyDel (errorKey);
+	elektraModulesClose (modules, 0);
+	ksDel (modules);
+}
+
+static void test_signature ()
+{
+	printf ("Test signature of backend\n");
+
+	KeySet * modules = ksNew (0, KS_END);
+	elektraModulesInit (modules, 0);
+
+	Backend * backend = elektraBackendOpen (set_simple (), modules, 0);
+	Backend * same = elektraBackendOpen (set_simple (), modules, 0);
+	KeySet * config = set_simple ();
+	keySetString (ksLookupByName (config, "system/elektra/mountpoints/simple/getplugins/#1" KDB_DEFAULT_STORAGE "/config/anything", 0),
+		      "other");
+	Backend * other = elektraBackendOpen (config, modules, 0);
+
+	char * signature = elektraBackendSignature (backend);
+	char * sameSignature = elektraBackendSignature (same);
+	char * otherSignature = elektraBackendSignature (other);
+	succeed_if (strlen (signature) == 16, "wrong size of signature");
+	succeed_if_same_string (signature, sameSignature);
+	succeed_if (strcmp (signature, otherSignature), "other plugin configuration has same signature");
+	elektraFree (signature);
+	elektraFree (sameSignature);
+	elektraFree (otherSignature);
+
+	elektraBackendClose (backend, 0);
+	elektraBackendClose (same, 0);
+	elektraBackendClose (other, 0);
+	elektraModulesClose (modules, 0);
+	ksDel (modules);
+}
+
 int main (int argc, char ** argv)
 {
 	printf ("  BACKEND   TESTS\n");
@@ -253,6 +369,9 @@ int main (int argc, char ** argv)
 	test_simple ();
 	test_default ();
 	test_backref ();
+	test_lazy ();
+	test_lazyMissing ();
+	test_signature ();
 
 	printf ("\ntest_backend RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
 
@@ -0,0 +1,223 @@
+/**
+ * @file
+ *
+ * @brief Tests for the cache of the bootstrap configuration.
+ *
+ * @copyright BSD License (see doc/COPYING or http://www.libelektra.org)
+ */
+
+#include <tests_internal.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+static KeySet * bootstrapSet (void)
+{
+	return ksNew (10, keyNew ("system/elektra/mountpoints", KEY_END), keyNew ("system/elektra/mountpoints/\\/tests", KEY_END),
+		      keyNew ("system/elektra/mountpoints/\\/tests/mountpoint", KEY_VALUE, "/tests", KEY_META, "comment", "cascading",
+			      KEY_END),
+		      keyNew ("system/elektra/mountpoints/\\/tests/getplugins/#0resolver", KEY_META, "order", "1", KEY_META, "info",
+			      "", KEY_END),
+		      keyNew ("system/elektra/binary", KEY_BINARY, KEY_SIZE, 3, KEY_VALUE, "\0\1\2", KEY_END),
+		      keyNew ("system/elektra/null", KEY_BINARY, KEY_END), KS_END);
+}
+
+static void writeBootstrap (const char * file, const char * content)
+{
+	FILE * fp = fopen (file, "w");
+	exit_if_fail (fp, "could not write bootstrap file");
+	fputs (content, fp);
+	fclose (fp);
+
+	// the file must not be modified after the keys were read
+	struct utimbuf times = { 1000, 1000 };
+	utime (file, &times);
+}
+
+static void test_roundtrip ()
+{
+	printf ("Test roundtrip of cache\n");
+
+	char * cacheFile = elektraFormat ("%s/.cache/elektra/bootstrap.cache", tempHome);
+	char * cacheDir = elektraFormat ("%s/.cache", tempHome);
+	char * elektraDir = elektraFormat ("%s/.cache/elektra", tempHome);
+	char * bootstrapFile = elektraFormat ("%s/elektra.ecf", tempHome);
+	mkdir (cacheDir, 0700);
+	writeBootstrap (bootstrapFile, "config");
+
+	KeySet * ks = bootstrapSet ();
+	succeed_if (elektraBootstrapCacheWrite (cacheFile, bootstrapFile, ks, time (0)) == 1, "could not write cache");
+
+	KeySet * read = ksNew (0, KS_END);
+	succeed_if (elektraBootstrapCacheRead (cacheFile, read) == 1, "could not read cache");
+	compare_keyset (read, ks);
+	succeed_if_same_string (keyString (keyGetMeta (ksLookupByName (read, "system/elektra/mountpoints/\\/tests/mountpoint", 0), "comment")),
+				"cascading");
+	Key * binary = ksLookupByName (read, "system/elektra/binary", 0);
+	exit_if_fail (binary, "binary key not found");
+	succeed_if (keyIsBinary (binary) && keyGetValueSize (binary) == 3 && !memcmp (keyValue (binary), "\0\1\2", 3), "wrong binary value");
+	Key * null = ksLookupByName (read, "system/elektra/null", 0);
+	exit_if_fail (null, "null key not found");
+	succeed_if (keyIsBinary (null) && keyValue (null) == 0, "null value not restored");
+	succeed_if (!keyNeedSync (binary), "key from cache needs sync");
+	ksDel (read);
+
+	// modifying the bootstrap file invalidates the cache
+	writeBootstrap (bootstrapFile, "changed");
+	read = ksNew (0, KS_END);
+	succeed_if (elektraBootstrapCacheRead (cacheFile, read) == 0, "outdated cache read");
+	succeed_if (ksGetSize (read) == 0, "keys of outdated cache added");
+
+	// a recently modified file is not cached
+	succeed_if (elektraBootstrapCacheWrite (cacheFile, bootstrapFile, ks, 1000) == 0, "modified file cached");
+	succeed_if (elektraBootstrapCacheRead (cacheFile, read) == 0, "outdated cache read");
+
+	succeed_if (elektraBootstrapCacheWrite (cacheFile, bootstrapFile, ks, time (0)) == 1, "could not write cache");
+	succeed_if (elektraBootstrapCacheRead (cacheFile, read) == 1, "could not read cache");
+	compare_keyset (read, ks);
+	ksDel (read);
+
+	unlink (bootstrapFile);
+	read = ksNew (0, KS_END);
+	succeed_if (elektraBootstrapCacheRead (cacheFile, read) == 0, "cache of removed file read");
+	ksDel (read);
+
+	succeed_if (elektraBootstrapCacheWrite (cacheFile, bootstrapFile, ks, time (0)) == 0, "cache of missing file written");
+	succeed_if (elektraBootstrapCacheWrite (cacheFile, "relative", ks, time (0)) == 0, "relative file name cached");
+
+	ksDel (ks);
+	unlink (cacheFile);
+	rmdir (elektraDir);
+	rmdir (cacheDir);
+	elektraFree (bootstrapFile);
+	elektraFree (elektraDir);
+	elektraFree (cacheDir);
+	elektraFree (cacheFile);
+}
+
+static void test_invalid ()
+{
+	printf ("Test invalid cache\n");
+
+	char * cacheFile = elektraFormat ("%s/bootstrap.cache", tempHome);
+	char * bootstrapFile = elektraFormat ("%s/elektra.ecf", tempHome);
+	writeBootstrap (bootstrapFile, "config");
+
+	KeySet * ks = bootstrapSet ();
+	succeed_if (elektraBootstrapCacheWrite (cacheFile, bootstrapFile, ks, time (0)) == 1, "could not write cache");
+
+	FILE * fp = fopen (cacheFile, "rb");
+	exit_if_fail (fp, "could not open cache");
+	fseek (fp, 0, SEEK_END);
+	long size = ftell (fp);
+	char * data = elektraMalloc (size);
+	fseek (fp, 0, SEEK_SET);
+	exit_if_fail (fread (data, size, 1, fp) == 1, "could not read cache");
+	fclose (fp);
+
+	// every truncation must be detected
+	for (long i = 0; i < size; ++i)
+	{
+		fp = fopen (cacheFile, "wb");
+		fwrite (data, i, 1, fp);
+		fclose (fp);
+
+		KeySet * read = ksNew (0, KS_END);
+		succeed_if (elektraBootstrapCacheRead (cacheFile, read) == 0, "truncated cache read");
+		succeed_if (ksGetSize (read) == 0, "keys of truncated cache added");
+		ksDel (read);
+	}
+
+	// trailing garbage
+	fp = fopen (cacheFile, "wb");
+	fwrite (data, size, 1, fp);
+	fputc ('x', fp);
+	fclose (fp);
+	KeySet * read = ksNew (0, KS_END);
+	succeed_if (elektraBootstrapCacheRead (cacheFile, read) == 0, "cache with garbage read");
+
+	// other magic
+	data[0] = 'x';
+	fp = fopen (cacheFile, "wb");
+	fwrite (data, size, 1, fp);
+	fclose (fp);
+	succeed_if (elektraBootstrapCacheRead (cacheFile, read) == 0, "cache with wrong magic read");
+	ksDel (read);
+
+	succeed_if (elektraBootstrapCacheRead ("/nonexisting/bootstrap.cache", ks) == 0, "missing cache read");
+
+	elektraFree (data);
+	ksDel (ks);
+	unlink (cacheFile);
+	unlink (bootstrapFile);
+	elektraFree (bootstrapFile);
+	elektraFree (cacheFile);
+}
+
+static void test_trust ()
+{
+	printf ("Test trust of cache\n");
+
+	char * cacheDir = elektraFormat ("%s/trust", tempHome);
+	char * cacheFile = elektraFormat ("%s/trust/bootstrap.cache", tempHome);
+	char * linkFile = elektraFormat ("%s/trust/link.cache", tempHome);
+	char * bootstrapFile = elektraFormat ("%s/elektra.ecf", tempHome);
+	mkdir (cacheDir, 0700);
+	writeBootstrap (bootstrapFile, "config");
+
+	KeySet * ks = bootstrapSet ();
+	succeed_if (elektraBootstrapCacheWrite (cacheFile, bootstrapFile, ks, time (0)) == 1, "could not write cache");
+	KeySet * read = ksNew (0, KS_END);
+	succeed_if (elektraBootstrapCacheRead (cacheFile, read) == 1, "could not read cache");
+	ksClear (read);
+
+	// files others can write are not read
+	chmod (cacheFile, 0620);
+	succeed_if (elektraBootstrapCacheRead (cacheFile, read) == 0, "group writable cache read");
+	chmod (cacheFile, 0602);
+	succeed_if (elektraBootstrapCacheRead (cacheFile, read) == 0, "world writable cache read");
+	chmod (cacheFile, 0600);
+
+	// neither are symbolic links
+	succeed_if (symlink (cacheFile, linkFile) == 0, "could not create link");
+	succeed_if (elektraBootstrapCacheRead (linkFile, read) == 0, "link to cache read");
+
+	// nor files in directories others can write
+	chmod (cacheDir, 0770);
+	succeed_if (elektraBootstrapCacheRead (cacheFile, read) == 0, "cache in group writable directory read");
+	succeed_if (elektraBootstrapCacheWrite (cacheFile, bootstrapFile, ks, time (0)) == 0, "cache in group writable directory written");
+	chmod (cacheDir, 0700);
+	succeed_if (elektraCacheDirectoryTrusted (cacheDir) == 1, "own directory not trusted");
+	succeed_if (elektraCacheDirectoryTrusted (linkFile) == 0, "link trusted as directory");
+	succeed_if (elektraBootstrapCacheRead (cacheFile, read) == 1, "could not read cache again");
+	succeed_if (ksGetSize (read) == ksGetSize (ks), "wrong number of keys read");
+
+	ksDel (read);
+	ksDel (ks);
+	unlink (linkFile);
+	unlink (cacheFile);
+	unlink (bootstrapFile);
+	rmdir (cacheDir);
+	elektraFree (bootstrapFile);
+	elektraFree (linkFile);
+	elektraFree (cacheFile);
+	elektraFree (cacheDir);
+}
+
+
+int main (int argc, char ** argv)
+{
+	printf ("BOOTSTRAP CACHE TESTS\n");
+	printf ("=====================\n\n");
+
+	init (argc, argv);
+
+	test_roundtrip ();
+	test_invalid ();
+	test_trust ();
+
+	printf ("\ntest_bootcache RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
+
+	return nbError;
+}
@@ -0,0 +1,119 @@
+/**
+ * @file
+ *
+ * @brief Tests for matching key names against many glob patterns.
+ *
+ * @copyright BSD License (see doc/COPYING or http://www.libelektra.org)
+ */
+
+#include <kdbease.h>
+
+#include <fnmatch.h>
+#include <stdlib.h>
+
+#include "tests.h"
+
+static void test_globMatcher ()
+{
+	printf ("Test glob matcher\n");
+
+	ElektraGlobMatcher * matcher = elektraGlobMatcherNew ();
+	exit_if_fail (matcher, "could not create matcher");
+
+	succeed_if (elektraGlobMatcherAdd (matcher, "user/tests/a", FNM_PATHNAME) == 0, "wrong index");
+	succeed_if (elektraGlobMatcherAdd (matcher, "user/tests/*", FNM_PATHNAME) == 1, "wrong index");
+	succeed_if (elektraGlobMatcherAdd (matcher, "user/tests/#*/x", FNM_PATHNAME) == 2, "wrong index");
+	succeed_if (elektraGlobMatcherAdd (matcher, "user/*/a", FNM_PATHNAME) == 3, "wrong index");
+	succeed_if (elektraGlobMatcherAdd (matcher, "user/tests/[ab]", FNM_PATHNAME) == 4, "wrong index");
+	succeed_if (elektraGlobMatcherAdd (matcher, "user/*", 0) == 5, "wrong index");
+	succeed_if (elektraGlobMatcherAdd (matcher, "user/tests/a", FNM_PATHNAME) == 6, "wrong index");
+
+	size_t size;
+	const size_t * matches = elektraGlobMatcherMatch (matcher, "user/tests/a", &size);
+	succeed_if (size == 6, "wrong number of matches");
+	if (size == 6)
+	{
+		succeed_if (matches[0] == 0 && matches[1] == 1 && matches[2] == 3, "wrong matches");
+		succeed_if (matches[3] == 4 && matches[4] == 5 && matches[5] == 6, "wrong matches");
+	}
+
+	matches = elektraGlobMatcherMatch (matcher, "user/tests/#_10/x", &size);
+	succeed_if (size == 2 && matches[0] == 2 && matches[1] == 5, "array pattern did not match");
+
+	matches = elektraGlobMatcherMatch (matcher, "user/tests/a/b", &size);
+	succeed_if (size == 1 && matches[0] == 5, "wildcard matched more than one segment");
+
+	matches = elektraGlobMatcherMatch (matcher, "system/tests/a", &size);
+	succeed_if (!matches && size == 0, "namespace ignored");
+
+	elektraGlobMatcherDel (matcher);
+	elektraGlobMatcherDel (0);
+}
+
+static void randomString (char * buffer, const char * const * parts, size_t partsSize)
+{
+	int depth = 1 + rand () % 4;
+	buffer[0] = '\0';
+	for (int i = 0; i < depth; ++i)
+	{
+		if (i) strcat (buffer, "/");
+		strcat (buffer, parts[rand () % partsSize]);
+	}
+}
+
+static void test_globMatcherFnmatch ()
+{
+	printf ("Test glob matcher against fnmatch\n");
+
+	const char * const patternParts[] = { "a", "b", "ab", "*", "#*", "a*", "?", "a?", "*b", "", "#", "[ab]", "\\\\" };
+	const char * const nameParts[] = { "a", "b", "ab", "abb", "#", "#0", "#_10", "", "ba", "\\\\" };
+	const size_t patternsSize = 200;
+	char patterns[200][64];
+
+	srand (1);
+	ElektraGlobMatcher * matcher = elektraGlobMatcherNew ();
+	for (size_t i = 0; i < patternsSize; ++i)
+	{
+		randomString (patterns[i], patternParts, sizeof (patternParts) / sizeof (patternParts[0]));
+		elektraGlobMatcherAdd (matcher, patterns[i], FNM_PATHNAME);
+	}
+
+	char name[64];
+	for (int n = 0; n < 500; ++n)
+	{
+		randomString (name, nameParts, sizeof (nameParts) / sizeof (nameParts[0]));
+		size_t size;
+		const size_t * matches = elektraGlobMatcherMatch (matcher, name, &size);
+		size_t pos = 0;
+		for (size_t i = 0; i < patternsSize; ++i)
+		{
+			int expected = !fnmatch (patterns[i], name, FNM_PATHNAME);
+			int actual = pos < size && matches[pos] == i;
+			if (actual) ++pos;
+			if (expected != actual)
+			{
+				printf ("pattern %s and name %s: fnmatch %d, matcher %d\n", patterns[i], name, expected, actual);
+			}
+			succeed_if (expected == actual, "matcher differs from fnmatch");
+		}
+		succeed_if (pos == size, "matches not in ascending order");
+	}
+
+	elektraGlobMatcherDel (matcher);
+}
+
+
+int main (int argc, char ** argv)
+{
+	printf ("GLOB MATCHER TESTS\n");
+	printf ("==================\n\n");
+
+	init (argc, argv);
+
+	test_globMatcher ();
+	test_globMatcherFnmatch ();
+
+	printf ("\ntest_globmatcher RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
+
+	return nbError;
+}
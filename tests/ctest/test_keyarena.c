@@ -0,0 +1,225 @@
+/**
+ * @file
+ *
+ * @brief Tests for keys allocated in a KeyArena.
+ *
+ * @copyright BSD License (see doc/COPYING or http://www.libelektra.org)
+ */
+
+#include <tests_internal.h>
+
+static void test_arenaKey ()
+{
+	printf ("Test key in arena\n");
+
+	KeySet * ks = ksNew (0, KS_END);
+	KeyArena * arena = elektraKsArena (ks);
+	exit_if_fail (arena, "could not create arena");
+	succeed_if (elektraKsArena (ks) == arena, "arena created twice");
+
+	Key * key = elektraKeyArenaKeyNew (arena, "user//arena/../key");
+	exit_if_fail (key, "could not create key");
+	succeed_if (elektraKeyArenaSetValue (arena, key, "value", sizeof ("value")) == sizeof ("value"), "could not set value");
+	succeed_if (test_bit (key->flags, KEY_FLAG_MMAP_STRUCT), "key not in arena");
+	succeed_if (test_bit (key->flags, KEY_FLAG_MMAP_KEY), "name not in arena");
+	succeed_if (test_bit (key->flags, KEY_FLAG_MMAP_DATA), "value not in arena");
+	succeed_if (test_bit (key->flags, KEY_FLAG_SYNC), "new key not marked for sync");
+
+	KeyRegion * block = elektraKeyRegionOf (key);
+	succeed_if (block == arena->block, "key not in current block");
+	succeed_if (elektraKeyRegionOf (key->key) == block && elektraKeyRegionOf (key->data.v) == block, "name or value in other block");
+	succeed_if (block->refs == 4, "arena, key, name and value should hold a reference");
+
+	succeed_if_same_string (keyName (key), "user/key");
+	succeed_if_same_string (keyBaseName (key), "key");
+	succeed_if_same_string (keyString (key), "value");
+	Key * cmp = keyNew ("user/key", KEY_END);
+	succeed_if (keyCmp (key, cmp) == 0, "wrong unescaped name");
+	keyDel (cmp);
+
+	Key * dup = keyDup (key);
+	succeed_if (!test_bit (dup->flags, KEY_FLAG_MMAP_STRUCT), "duplicate in arena");
+	keyDel (dup);
+
+	succeed_if (keySetString (key, "other") == 6, "could not set value");
+	succeed_if (block->refs == 3, "value still holds a reference");
+	keyClear (key);
+	succeed_if (test_bit (key->flags, KEY_FLAG_MMAP_STRUCT), "keyClear lost arena");
+	succeed_if (block->refs == 2, "name still holds a reference");
+
+	Key * empty = elektraKeyArenaKeyNew (arena, 0);
+	exit_if_fail (empty, "could not create key without name");
+	succeed_if (!keyName (empty)[0], "key without name has a name");
+	succeed_if (elektraKeyArenaSetValue (arena, empty, 0, 0) == 1, "could not set null value");
+	succeed_if (!test_bit (empty->flags, KEY_FLAG_MMAP_DATA) && !empty->data.v, "null value in arena");
+	keyDel (empty);
+
+	succeed_if (elektraKeyArenaKeyNew (arena, "invalid") == 0, "created key with invalid name");
+	succeed_if (block->refs == 2, "invalid key not released");
+
+	Key * owned = elektraKeyArenaKeyNew (arena, "user:hugo/owned");
+	exit_if_fail (owned, "could not create key with owner");
+	succeed_if_same_string (keyName (owned), "user/owned");
+	succeed_if_same_string (keyString (keyGetMeta (owned, "owner")), "hugo");
+	keyDel (owned);
+
+	keyDel (key);
+	succeed_if (block->refs == 1, "key not released");
+	ksDel (ks);
+}
+
+static void test_arenaLifetime ()
+{
+	printf ("Test lifetime of arena\n");
+
+	KeySet * ks = ksNew (0, KS_END);
+	KeyArena * arena = elektraKsArena (ks);
+	char name[64];
+	char value[KEY_ARENA_BLOCK_SIZE];
+	memset (value, 'x', sizeof (value) - 1);
+	value[sizeof (value) - 1] = 0;
+
+	for (int i = 0; i < 1000; ++i)
+	{
+		snprintf (name, sizeof (name), "user/tests/arena/%d", i);
+		Key * key = elektraKeyArenaKeyNew (arena, name);
+		exit_if_fail (key, "could not create key");
+		elektraKeyArenaSetValue (arena, key, name, strlen (name) + 1);
+		ksAppendKey (ks, key);
+	}
+	succeed_if (ksGetSize (ks) == 1000, "wrong number of keys");
+	succeed_if (elektraKeyRegionOf (ksHead (ks)) != elektraKeyRegionOf (ksTail (ks)), "all keys in one block");
+
+	// large values get their own block
+	Key * large = elektraKeyArenaKeyNew (arena, "user/tests/arena/large");
+	KeyRegion * block = arena->block;
+	succeed_if (elektraKeyArenaSetValue (arena, large, value, sizeof (value)) == sizeof (value), "could not set large value");
+	succeed_if (elektraKeyRegionOf (large->data.v) != block, "large value in current block");
+	succeed_if (arena->block == block, "large value replaced current block");
+	succeed_if (elektraKeyRegionOf (large->data.v)->refs == 1, "large value should hold the only reference");
+	ksAppendKey (ks, large);
+
+	// keys survive the keyset and the arena
+	Key * first = ksLookupByName (ks, "user/tests/arena/0", 0);
+	Key * last = ksLookupByName (ks, "user/tests/arena/999", 0);
+	exit_if_fail (first && last, "keys not found");
+	keyIncRef (first);
+	keyIncRef (last);
+	keyIncRef (large);
+	ksDel (ks);
+	keyDecRef (first);
+	keyDecRef (last);
+	keyDecRef (large);
+
+	succeed_if_same_string (keyName (first), "user/tests/arena/0");
+	succeed_if_same_string (keyString (first), "user/tests/arena/0");
+	succeed_if_same_string (keyString (last), "user/tests/arena/999");
+	succeed_if (keyGetValueSize (large) == sizeof (value), "wrong size of large value");
+	keyDel (first);
+	keyDel (last);
+	keyDel (large);
+
+	// ksClear deletes the arena, a new one is created afterwards
+	ks = ksNew (0, KS_END);
+	ksAppendKey (ks, elektraKeyArenaKeyNew (elektraKsArena (ks), "user/tests/arena"));
+	ksClear (ks);
+	succeed_if (!ks->arena, "ksClear did not delete arena");
+	ksAppendKey (ks, elektraKeyArenaKeyNew (elektraKsArena (ks), "user/tests/arena"));
+	succeed_if (ksGetSize (ks) == 1, "key not appended");
+	ksDel (ks);
+}
+
+static void test_arenaMeta ()
+{
+	printf ("Test metadata in arena\n");
+
+	KeySet * ks = ksNew (0, KS_END);
+	KeyArena * arena = elektraKsArena (ks);
+	Key * key = elektraKeyArenaKeyNew (arena, "user/tests/arena/meta");
+	exit_if_fail (key, "could not create key");
+	ksAppendKey (ks, key);
+
+	succeed_if (elektraKeyArenaSetMeta (arena, key, "comment/#0", "a comment") == sizeof ("a comment"), "could not set metadata");
+	const Key * meta = keyGetMeta (key, "comment/#0");
+	exit_if_fail (meta, "metadata not set");
+	succeed_if_same_string (keyName (meta), "comment/#0");
+	succeed_if_same_string (keyString (meta), "a comment");
+	succeed_if (test_bit (meta->flags, KEY_FLAG_MMAP_STRUCT), "meta key not in arena");
+	succeed_if (test_bit (meta->flags, KEY_FLAG_MMAP_KEY), "meta name not in arena");
+	succeed_if (test_bit (meta->flags, KEY_FLAG_MMAP_DATA), "meta value not in arena");
+	succeed_if (elektraKeyRegionOf (meta) == elektraKeyRegionOf (key), "metadata in other block");
+	succeed_if (test_bit (meta->flags, KEY_FLAG_RO_NAME), "meta name not read only");
+	succeed_if (test_bit (meta->flags, KEY_FLAG_RO_VALUE), "meta value not read only");
+	succeed_if (test_bit (meta->flags, KEY_FLAG_RO_META), "metadata of meta key not read only");
+
+	succeed_if (elektraKeyArenaSetMeta (arena, key, "comment/#0", "other") == sizeof ("other"), "could not replace metadata");
+	succeed_if (ksGetSize (key->meta) == 1, "metadata not replaced");
+	succeed_if_same_string (keyString (keyGetMeta (key, "comment/#0")), "other");
+
+	// meta keys are shared with other keys
+	Key * copy = keyNew ("user/tests/arena/copy", KEY_END);
+	succeed_if (keyCopyAllMeta (copy, key) == 1, "could not copy metadata");
+	succeed_if (elektraKeyArenaSetMeta (arena, key, "comment/#0", 0) == 0, "could not remove metadata");
+	succeed_if (!keyGetMeta (key, "comment/#0"), "metadata not removed");
+	succeed_if_same_string (keyString (keyGetMeta (copy, "comment/#0")), "other");
+
+	succeed_if (elektraKeyArenaSetMeta (arena, key, 0, "value") == -1, "set metadata without name");
+	succeed_if (elektraKeyArenaSetMeta (arena, 0, "name", "value") == -1, "set metadata of null key");
+	set_bit (key->flags, KEY_FLAG_RO_META);
+	succeed_if (elektraKeyArenaSetMeta (arena, key, "name", "value") == -1, "set read only metadata");
+
+	ksDel (ks);
+	succeed_if_same_string (keyString (keyGetMeta (copy, "comment/#0")), "other");
+	keyDel (copy);
+}
+
+static void test_arenaShared ()
+{
+	printf ("Test arena shared by keysets\n");
+
+	KeySet * ks1 = ksNew (0, KS_END);
+	KeySet * ks2 = ksNew (0, KS_END);
+	KeyArena * arena = elektraKeyArenaNew ();
+	exit_if_fail (arena, "could not create arena");
+
+	elektraKsSetArena (ks1, arena);
+	elektraKsSetArena (ks2, arena);
+	succeed_if (arena->refs == 3, "keysets should hold a reference");
+	elektraKeyArenaDel (arena);
+	succeed_if (elektraKsArena (ks1) == arena && elektraKsArena (ks2) == arena, "arena not shared");
+
+	Key * key1 = elektraKeyArenaKeyNew (elektraKsArena (ks1), "user/tests/arena/1");
+	Key * key2 = elektraKeyArenaKeyNew (elektraKsArena (ks2), "user/tests/arena/2");
+	exit_if_fail (key1 && key2, "could not create keys");
+	ksAppendKey (ks1, key1);
+	ksAppendKey (ks2, key2);
+	succeed_if (elektraKeyRegionOf (key1) == elektraKeyRegionOf (key2), "keys of shared arena in different blocks");
+
+	ksClear (ks1);
+	succeed_if (!ks1->arena, "ksClear did not drop arena");
+	succeed_if (arena->refs == 1, "ksClear did not release arena");
+	succeed_if (elektraKsArena (ks1) != arena, "cleared keyset still uses shared arena");
+
+	elektraKsSetArena (ks1, 0);
+	succeed_if (!ks1->arena, "arena not dropped");
+	ksDel (ks1);
+	ksDel (ks2);
+}
+
+
+int main (int argc, char ** argv)
+{
+	printf ("KEYARENA     TESTS\n");
+	printf ("==================\n\n");
+
+	init (argc, argv);
+
+	test_arenaKey ();
+	test_arenaLifetime ();
+	test_arenaMeta ();
+	test_arenaShared ();
+
+	printf ("\ntest_keyarena RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
+
+	return nbError;
+}
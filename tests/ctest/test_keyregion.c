@@ -0,0 +1,133 @@
+/**
+ * @file
+ *
+ * @brief Tests for keys with names and values in a KeyRegion.
+ *
+ * @copyright BSD License (see doc/COPYING or http://www.libelektra.org)
+ */
+
+#include <tests_internal.h>
+
+typedef struct
+{
+	KeyRegion region;
+	size_t nameUSize;
+	size_t nameDistance;
+	char name[32];
+	size_t valueDistance;
+	char value[8];
+} TestRegion;
+
+static TestRegion * newRegion (void)
+{
+	TestRegion * r = elektraCalloc (sizeof (TestRegion));
+	r->region.base = r;
+	r->nameDistance = offsetof (TestRegion, name);
+	r->valueDistance = offsetof (TestRegion, value);
+
+	Key * key = keyNew ("user/region", KEY_END);
+	memcpy (r->name, key->key, key->keySize + key->keyUSize);
+	r->region.size = sizeof (TestRegion);
+	r->nameUSize = key->keyUSize;
+	keyDel (key);
+	strcpy (r->value, "value");
+	return r;
+}
+
+static Key * regionKey (TestRegion * r)
+{
+	Key * key = keyNew (0);
+	succeed_if (elektraKeySetRegionName (key, r->name, sizeof ("user/region"), r->nameUSize) == 1, "could not set name");
+	succeed_if (elektraKeySetRegionValue (key, r->value, sizeof ("value")) == 1, "could not set value");
+	return key;
+}
+
+static void test_regionKey ()
+{
+	printf ("Test key in region\n");
+
+	TestRegion * r = newRegion ();
+	++r->region.refs; // keep region alive
+
+	Key * key = regionKey (r);
+	succeed_if (r->region.refs == 3, "name and value should hold a reference");
+	succeed_if (elektraKeyRegionOf (key->key) == &r->region, "wrong region of name");
+	succeed_if (elektraKeyRegionOf (key->data.v) == &r->region, "wrong region of value");
+	succeed_if_same_string (keyName (key), "user/region");
+	succeed_if_same_string (keyBaseName (key), "region");
+	succeed_if_same_string (keyString (key), "value");
+
+	Key * dup = keyDup (key);
+	succeed_if (!test_bit (dup->flags, KEY_FLAG_MMAP_KEY) && !test_bit (dup->flags, KEY_FLAG_MMAP_DATA), "duplicate in region");
+	succeed_if (r->region.refs == 3, "duplicate should not hold a reference");
+	succeed_if (keyCmp (dup, key) == 0, "duplicate has different name");
+
+	succeed_if (keySetString (key, "other") == 6, "could not set value");
+	succeed_if (r->region.refs == 2, "value still holds a reference");
+	succeed_if_same_string (r->value, "value");
+
+	succeed_if (keySetBaseName (key, "x") > 0, "could not set base name");
+	succeed_if (r->region.refs == 1, "name still holds a reference");
+	succeed_if_same_string (keyName (key), "user/x");
+	succeed_if_same_string (r->name, "user/region");
+
+	keyDel (key);
+	keyDel (dup);
+	succeed_if (r->region.refs == 1, "wrong number of references");
+	elektraFree (r);
+}
+
+static void test_regionRelease ()
+{
+	printf ("Test release of region\n");
+
+	// every way to get rid of name and value must drop references
+	TestRegion * r = newRegion ();
+	++r->region.refs;
+
+	Key * key = regionKey (r);
+	keyClear (key);
+	succeed_if (r->region.refs == 1, "keyClear did not release region");
+	keyDel (key);
+
+	key = regionKey (r);
+	keySetName (key, "user/other");
+	keySetBinary (key, 0, 0);
+	succeed_if (r->region.refs == 1, "keySetName or keySetBinary did not release region");
+	keyDel (key);
+
+	key = regionKey (r);
+	Key * source = keyNew ("user/source", KEY_VALUE, "source", KEY_END);
+	keyCopy (key, source);
+	succeed_if (r->region.refs == 1, "keyCopy did not release region");
+	succeed_if (!test_bit (key->flags, KEY_FLAG_MMAP_KEY) && !test_bit (key->flags, KEY_FLAG_MMAP_DATA), "flags not cleared");
+	succeed_if_same_string (keyName (key), "user/source");
+	keyDel (source);
+	keyDel (key);
+
+	KeySet * ks = ksNew (1, regionKey (r), KS_END);
+	succeed_if (r->region.refs == 3, "wrong number of references");
+	ksDel (ks);
+	succeed_if (r->region.refs == 1, "ksDel did not release region");
+
+	// the last reference frees the region
+	key = regionKey (r);
+	--r->region.refs;
+	keyDel (key);
+}
+
+
+int main (int argc, char ** argv)
+{
+	printf ("KEYREGION     TESTS\n");
+	printf ("===================\n\n");
+
+	init (argc, argv);
+
+	test_regionKey ();
+	test_regionRelease ();
+
+	printf ("\ntest_keyregion RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
+
+	return nbError;
+}
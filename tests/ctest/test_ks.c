@@ -8,6 +8,8 @@
 
 #include <tests_internal.h>
 
+#include <time.h>
+
 ssize_t ksCopyInternal (KeySet * ks, size_t to, size_t from);
 
 static void test_elektraRenameKeys ()
@@ -156,6 +158,465 @@ static void test_creatingLookup ()
 	ksDel (ks);
 }
 
+static void test_hashLookup ()
+{
+	printf ("test hash lookup\n");
+	char name[50];
+	KeySet * ks = ksNew (0, KS_END);
+	for (int i = 0; i < KEYSET_HASH_SIZE * 4; ++i)
+	{
+		snprintf (name, sizeof (name), "user/hash/%d", i * 2);
+		ksAppendKey (ks, keyNew (name, KEY_VALUE, name, KEY_END));
+	}
+
+	for (int i = 0; i < KEYSET_HASH_SIZE * 4; ++i)
+	{
+		snprintf (name, sizeof (name), "user/hash/%d", i * 2);
+		Key * found = ksLookupByName (ks, name, 0);
+		exit_if_fail (found, "did not find key");
+		succeed_if_same_string (keyName (found), name);
+		succeed_if (ksCurrent (ks) == found, "cursor not set to found key");
+	}
+	succeed_if (test_bit (ks->flags, KS_FLAG_HASH), "hash index was not built");
+	succeed_if (!ksLookupByName (ks, "user/hash/1", 0), "found key not in keyset");
+	succeed_if (!ksLookupByName (ks, "user/hash", 0), "found key not in keyset");
+
+	// append at end keeps index
+	ksAppendKey (ks, keyNew ("user/hash/zzz", KEY_END));
+	succeed_if (test_bit (ks->flags, KS_FLAG_HASH), "hash index invalidated by append at end");
+	succeed_if (ksLookupByName (ks, "user/hash/zzz", 0) == ksTail (ks), "did not find appended key");
+
+	// replacing keeps index
+	Key * replace = keyNew ("user/hash/10", KEY_VALUE, "replaced", KEY_END);
+	ksAppendKey (ks, replace);
+	succeed_if (test_bit (ks->flags, KS_FLAG_HASH), "hash index invalidated by replace");
+	succeed_if (ksLookupByName (ks, "user/hash/10", 0) == replace, "did not find replaced key");
+
+	// insertion in the middle invalidates index
+	ksAppendKey (ks, keyNew ("user/hash/1", KEY_END));
+	succeed_if (!test_bit (ks->flags, KS_FLAG_HASH), "hash index not invalidated by insert");
+	Key * found = ksLookupByName (ks, "user/hash/1", 0);
+	exit_if_fail (found, "did not find inserted key");
+	succeed_if_same_string (keyName (found), "user/hash/1");
+
+	// pop and cut invalidate index
+	for (int i = 0; i < KEYSET_HASH_SIZE * 4; ++i)
+	{
+		ksLookupByName (ks, "user/hash/2", 0);
+	}
+	succeed_if (test_bit (ks->flags, KS_FLAG_HASH), "hash index was not rebuilt");
+	keyDel (ksLookupByName (ks, "user/hash/2", KDB_O_POP));
+	succeed_if (!test_bit (ks->flags, KS_FLAG_HASH), "hash index not invalidated by pop");
+	succeed_if (!ksLookupByName (ks, "user/hash/2", 0), "found popped key");
+	found = ksLookupByName (ks, "user/hash/20", 0);
+	exit_if_fail (found, "did not find key after pop");
+	succeed_if_same_string (keyName (found), "user/hash/20");
+
+	for (int i = 0; i < KEYSET_HASH_SIZE * 4; ++i)
+	{
+		ksLookupByName (ks, "user/hash/4", 0);
+	}
+	Key * cutpoint = keyNew ("user/hash/4", KEY_END);
+	ksDel (ksCut (ks, cutpoint));
+	keyDel (cutpoint);
+	succeed_if (!ksLookupByName (ks, "user/hash/4", 0), "found cut key");
+	found = ksLookupByName (ks, "user/hash/40", 0);
+	exit_if_fail (found, "did not find key after cut");
+	succeed_if_same_string (keyName (found), "user/hash/40");
+
+	ksDel (ks);
+}
+
+static void test_mergeAppend ()
+{
+	printf ("test merge append\n");
+	Key * a = keyNew ("user/a", KEY_END);
+	Key * b = keyNew ("user/b", KEY_END);
+	Key * c = keyNew ("user/c", KEY_END);
+	Key * c2 = keyNew ("user/c", KEY_VALUE, "replaced", KEY_END);
+	Key * d = keyNew ("user/d", KEY_END);
+	Key * e = keyNew ("user/e", KEY_END);
+
+	KeySet * ks = ksNew (3, a, c, e, KS_END);
+	KeySet * other = ksNew (3, b, c2, d, KS_END);
+
+	succeed_if (ksAppend (ks, other) == 5, "wrong size after merge");
+	succeed_if (ks->array[0] == a, "a not on position 0");
+	succeed_if (ks->array[1] == b, "b not on position 1");
+	succeed_if (ks->array[2] == c2, "c was not replaced");
+	succeed_if (ks->array[3] == d, "d not on position 3");
+	succeed_if (ks->array[4] == e, "e not on position 4");
+	succeed_if (ks->array[5] == 0, "array not null terminated");
+	succeed_if (ksCurrent (ks) == d, "cursor not on last appended key");
+	succeed_if (keyGetRef (b) == 2, "reference of appended key not incremented");
+	succeed_if (keyGetRef (a) == 1, "reference of existing key changed");
+	succeed_if (keyGetRef (c2) == 2, "reference of replacing key not incremented");
+	succeed_if (test_bit (b->flags, KEY_FLAG_RO_NAME), "name of appended key not locked");
+
+	// append the same keys again
+	succeed_if (ksAppend (ks, other) == 5, "wrong size after appending same keys");
+	succeed_if (keyGetRef (b) == 2, "reference of same key incremented");
+	succeed_if (ksAppend (ks, ks) == 5, "wrong size after appending to itself");
+
+	ksDel (other);
+
+	// fast path: everything sorts after
+	other = ksNew (2, keyNew ("user/f", KEY_END), keyNew ("user/g", KEY_END), KS_END);
+	succeed_if (ksAppend (ks, other) == 7, "wrong size after append at end");
+	succeed_if_same_string (keyName (ks->array[5]), "user/f");
+	succeed_if_same_string (keyName (ks->array[6]), "user/g");
+	succeed_if (ks->array[7] == 0, "array not null terminated");
+	succeed_if (ksCurrent (ks) == ks->array[6], "cursor not on last appended key");
+	ksDel (other);
+
+	for (size_t i = 1; i < (size_t)ksGetSize (ks); ++i)
+	{
+		succeed_if (keyCmp (ks->array[i - 1], ks->array[i]) < 0, "keyset not sorted");
+	}
+
+	ksDel (ks);
+}
+
+static void test_sharedDup ()
+{
+	printf ("test shared dup\n");
+	Key * a = keyNew ("user/a", KEY_END);
+	Key * b = keyNew ("user/b", KEY_END);
+	Key * c = keyNew ("user/c", KEY_END);
+	KeySet * ks = ksNew (3, a, b, c, KS_END);
+
+	KeySet * dup = ksDup (ks);
+	succeed_if (dup->array == ks->array, "array not shared");
+	succeed_if (keyGetRef (a) == 1, "shared array should reference keys once");
+	succeed_if (ksCurrent (dup) == c, "cursor not on last key");
+
+	KeySet * dup2 = ksDup (dup);
+	succeed_if (dup2->array == ks->array && keyGetRef (a) == 1, "array not shared thrice");
+
+	// lookups and iteration do not unshare
+	succeed_if (ksLookupByName (dup, "user/b", 0) == b, "lookup in shared array failed");
+	ksRewind (dup);
+	succeed_if (ksNext (dup) == a && ksNext (ks) == a, "iteration of shared array failed");
+	succeed_if (dup->array == ks->array, "reading unshared the array");
+
+	// the first modification copies the array
+	Key * d = keyNew ("user/d", KEY_END);
+	succeed_if (ksAppendKey (dup, d) == 4, "could not append to shared keyset");
+	succeed_if (dup->array != ks->array, "array still shared after modification");
+	succeed_if (ksGetSize (ks) == 3 && ks->array[3] == 0, "original keyset changed");
+	succeed_if (dup2->array == ks->array, "other keysets do not share anymore");
+	succeed_if (keyGetRef (a) == 2, "copy should reference keys");
+
+	succeed_if (ksPop (dup2) == c, "could not pop from shared keyset");
+	succeed_if (ksGetSize (ks) == 3, "original keyset changed by pop");
+	succeed_if (keyGetRef (c) == 2, "reference of popped key wrong");
+	keyDel (c);
+
+	KeySet * dup3 = ksDup (ks);
+	KeySet * cut = ksCut (dup3, b);
+	succeed_if (ksGetSize (cut) == 1 && ksGetSize (dup3) == 2 && ksGetSize (ks) == 3, "cut changed original keyset");
+	succeed_if (keyGetRef (b) == 4, "reference of cut key wrong"); // ks, dup, dup2 and cut
+	ksDel (cut);
+
+	succeed_if (ksLookupByName (dup3, "user/c", KDB_O_POP) == c, "could not pop by lookup");
+	succeed_if (ksGetSize (ks) == 3, "original keyset changed by lookup pop");
+	keyDel (c);
+
+	// the keys survive as long as any keyset references them
+	ksDel (ks);
+	succeed_if_same_string (keyName (a), "user/a");
+	ksDel (dup);
+	ksDel (dup2);
+	succeed_if (keyGetRef (a) == 1, "reference of remaining keyset wrong");
+	ksDel (dup3);
+
+	ks = ksNew (0, KS_END);
+	dup = ksDup (ks);
+	succeed_if (dup->array == ks->array, "empty keyset not shared");
+	succeed_if (ksAppendKey (dup, keyNew ("user/a", KEY_END)) == 1, "could not append to shared empty keyset");
+	succeed_if (dup->array != ks->array && ksGetSize (ks) == 0, "original empty keyset changed");
+	ksDel (dup);
+	ksDel (ks);
+}
+
+static void test_dupCost ()
+{
+	printf ("test cost of dup\n");
+	const size_t sizes[] = { 10, 100000 };
+	clock_t spent[2];
+	char name[64];
+
+	for (size_t s = 0; s < 2; ++s)
+	{
+		KeySet * ks = ksNew (sizes[s], KS_END);
+		for (size_t i = 0; i < sizes[s]; ++i)
+		{
+			snprintf (name, sizeof (name), "user/tests/dup/%zu", i);
+			ksAppendKey (ks, keyNew (name, KEY_END));
+		}
+
+		clock_t start = clock ();
+		for (size_t i = 0; i < 10000; ++i)
+		{
+			ksDel (ksDup (ks));
+		}
+		spent[s] = clock () - start;
+
+		// neither the array nor the keys are touched
+		KeySet * dup = ksDup (ks);
+		succeed_if (dup->array == ks->array, "array not shared");
+		succeed_if (keyGetRef (ksHead (ks)) == 1 && keyGetRef (ksTail (ks)) == 1, "ksDup referenced keys");
+		ksDel (dup);
+		ksDel (ks);
+	}
+
+	// with a copy of the array the large keyset would take 10000 times longer
+	succeed_if (spent[1] < 10 * spent[0] + CLOCKS_PER_SEC / 10, "cost of ksDup grows with the size of the keyset");
+}
+
+static void test_cutRanges ()
+{
+	printf ("test cut ranges\n");
+	KeySet * ks = ksNew (20, keyNew ("/a", KEY_CASCADING_NAME, KEY_END), keyNew ("/a/b", KEY_CASCADING_NAME, KEY_END),
+			     keyNew ("/c", KEY_CASCADING_NAME, KEY_END), keyNew ("system/a", KEY_END), keyNew ("system/a/b", KEY_END),
+			     keyNew ("user/a", KEY_END), keyNew ("user/a/b", KEY_END), keyNew ("user/a/b/c", KEY_END),
+			     keyNew ("user/a\\/b", KEY_END), keyNew ("user/ab", KEY_END), keyNew ("user/b", KEY_END), KS_END);
+
+	// only the first keys below the cutpoint next to each other are cut,
+	// here the cascading ones
+	ksLookupByName (ks, "user/a/b", 0);
+	Key * cutpoint = keyNew ("user/a", KEY_END);
+	KeySet * cut = ksCut (ks, cutpoint);
+	succeed_if (ksGetSize (cut) == 1 && ksLookupByName (cut, "/a/b", 0), "cascading keys not cut first");
+	succeed_if_same_string (keyName (ksCurrent (ks)), "user/a/b");
+	succeed_if (ksGetSize (ks) == 10 && ks->array[10] == 0, "wrong size after cut");
+	ksDel (cut);
+
+	// the cursor moves to the key before the cut keys
+	cut = ksCut (ks, cutpoint);
+	KeySet * cmp = ksNew (5, keyNew ("user/a", KEY_END), keyNew ("user/a/b", KEY_END), keyNew ("user/a/b/c", KEY_END), KS_END);
+	compare_keyset (cut, cmp);
+	ksDel (cmp);
+	succeed_if_same_string (keyName (ksCurrent (ks)), "system/a/b");
+	succeed_if (ksGetSize (ks) == 7 && ks->array[7] == 0, "wrong size after cut");
+	succeed_if (ksLookupByName (ks, "user/a\\/b", 0) && ksLookupByName (ks, "user/ab", 0), "keys next to cutpoint cut");
+	ksDel (cut);
+	keyDel (cutpoint);
+
+	// the cursor stays at its key behind the cut keys
+	ksLookupByName (ks, "user/b", 0);
+	cutpoint = keyNew ("/a", KEY_CASCADING_NAME, KEY_END);
+	cut = ksCut (ks, cutpoint);
+	succeed_if (ksGetSize (cut) == 2 && ksLookupByName (cut, "system/a", 0) && ksLookupByName (cut, "system/a/b", 0),
+		    "wrong keys cut for cascading cutpoint");
+	succeed_if_same_string (keyName (ksCurrent (ks)), "user/b");
+	succeed_if (ksGetSize (ks) == 5 && ksLookupByName (ks, "/a", 0), "wrong keys left after cascading cut");
+	ksDel (cut);
+	keyDel (cutpoint);
+
+	// a cursor within the first keys is rewound
+	ksRewind (ks);
+	ksNext (ks);
+	cutpoint = keyNew ("user", KEY_END);
+	cut = ksCut (ks, cutpoint);
+	succeed_if (ksGetSize (cut) == 5 && ksGetSize (ks) == 0, "wrong keys cut for root"); // cascading keys are below and next to them
+	succeed_if (ksCurrent (ks) == 0, "cursor not rewound");
+	ksDel (cut);
+	keyDel (cutpoint);
+
+	ksDel (ks);
+}
+
+static void test_below ()
+{
+	printf ("test below\n");
+	Key * a = keyNew ("user/a", KEY_END);
+	Key * b = keyNew ("user/a/b", KEY_END);
+	KeySet * ks = ksNew (5, keyNew ("system/a", KEY_END), a, b, keyNew ("user/c", KEY_END), KS_END);
+
+	KeySet * below = ksBelow (ks, a);
+	exit_if_fail (below, "no keyset returned");
+	succeed_if (ksGetSize (below) == 2 && ksGetSize (ks) == 4, "wrong sizes");
+	succeed_if (below->array[2] == 0, "array not null terminated");
+	succeed_if (keyGetRef (a) == 2, "keys not referenced");
+	succeed_if (ksNext (below) == a && ksNext (below) == b && ksNext (below) == 0, "wrong iteration");
+	succeed_if (ksLookupByName (below, "user/a/b", 0) == b, "lookup in keys below failed");
+	succeed_if (ksLookupByName (below, "user/c", 0) == 0, "key outside of parent found");
+
+	ksAppendKey (below, keyNew ("user/a/c", KEY_END));
+	succeed_if (ksGetSize (below) == 3 && ksGetSize (ks) == 4, "append changed keyset");
+
+	// the keys stay when the keyset is gone
+	ksDel (ks);
+	succeed_if_same_string (keyName (ksHead (below)), "user/a");
+	succeed_if_same_string (keyName (ksTail (below)), "user/a/c");
+	ksDel (below);
+
+	// keys not next to each other
+	ks = ksNew (5, keyNew ("system/a", KEY_END), keyNew ("user/a", KEY_END), keyNew ("user/b", KEY_END), KS_END);
+	Key * parent = keyNew ("/a", KEY_CASCADING_NAME, KEY_END);
+	below = ksBelow (ks, parent);
+	succeed_if (ksGetSize (below) == 2 && below->array[2] == 0, "wrong keys for cascading parent");
+	succeed_if (keyGetRef (ksHead (below)) == 2, "keys not referenced");
+	ksDel (ks);
+	succeed_if_same_string (keyName (ksTail (below)), "user/a");
+	ksDel (below);
+	keyDel (parent);
+
+	// all keys below the parent
+	ks = ksNew (5, keyNew ("user/a", KEY_END), keyNew ("user/a/b", KEY_END), KS_END);
+	parent = keyNew ("user/a", KEY_END);
+	below = ksBelow (ks, parent);
+	succeed_if (ksGetSize (below) == 2 && below->array[2] == 0, "wrong keys for all below");
+	succeed_if (ksCurrent (below) == 0, "cursor not rewound");
+	ksDel (ks);
+	ksDel (below);
+	keyDel (parent);
+
+	ks = ksNew (0, KS_END);
+	parent = keyNew ("user/a", KEY_END);
+	below = ksBelow (ks, parent);
+	succeed_if (below && ksGetSize (below) == 0, "view of empty keyset not empty");
+	ksDel (below);
+	keyDel (parent);
+	ksDel (ks);
+}
+
+static void test_lookupCompiled ()
+{
+	printf ("test compiled lookup\n");
+
+	const char * names[] = { "user/tests/a",	 "/tests/a",	       "/tests/b",	   "/tests/c",		 "/tests/d",
+				 "/tests/missing", "system/tests/b",   "/tests//./a/../b", "user/tests/\\/esc", "/tests/\\/esc",
+				 "/tests/spec",	   "/tests/override", "/",		   "user",		 0 };
+	KeySet * ks = ksNew (20, keyNew ("system/tests/a", KEY_END), keyNew ("user/tests/a", KEY_END), keyNew ("system/tests/b", KEY_END),
+			     keyNew ("dir/tests/b", KEY_END), keyNew ("proc/tests/c", KEY_END), keyNew ("/tests/d", KEY_CASCADING_NAME, KEY_END),
+			     keyNew ("user/tests/\\/esc", KEY_END), keyNew ("spec/tests/spec", KEY_META, "default", "5", KEY_END),
+			     keyNew ("spec/tests/override", KEY_META, "override/#0", "/tests/a", KEY_END), keyNew ("user", KEY_END), KS_END);
+
+	for (const char ** name = names; *name; ++name)
+	{
+		KeyLookup * lookup = elektraKeyLookupNew (*name);
+		exit_if_fail (lookup, "could not compile name");
+		option_t options[] = { 0, KDB_O_NOCASCADING, KDB_O_NODEFAULT, KDB_O_NOSPEC };
+		for (size_t i = 0; i < sizeof (options) / sizeof (options[0]); ++i)
+		{
+			Key * expected = ksLookupByName (ks, *name, options[i]);
+			cursor_t cursor = ksGetCursor (ks);
+			ksRewind (ks);
+			succeed_if (ksLookupCompiled (ks, lookup, options[i]) == expected, "compiled lookup found other key");
+			if (expected) succeed_if (ksGetCursor (ks) == cursor, "cursor not set to found key");
+		}
+		elektraKeyLookupDel (lookup);
+	}
+
+	KeyLookup * lookup = elektraKeyLookupNew ("/tests/a");
+	succeed_if_same_string (keyName (ksLookupCompiled (ks, lookup, 0)), "user/tests/a");
+	Key * popped = ksLookupCompiled (ks, lookup, KDB_O_POP);
+	succeed_if_same_string (keyName (popped), "user/tests/a");
+	keyDel (popped);
+	succeed_if_same_string (keyName (ksLookupCompiled (ks, lookup, 0)), "system/tests/a");
+	succeed_if (ksLookupCompiled (ks, lookup, KDB_O_DEL), "lookup key deleted");
+	succeed_if (ksLookupCompiled (0, lookup, 0) == 0, "lookup in null keyset");
+	succeed_if (ksLookupCompiled (ks, 0, 0) == 0, "lookup of null");
+	elektraKeyLookupDel (lookup);
+
+	lookup = elektraKeyLookupNew ("user/tests/created");
+	Key * created = ksLookupCompiled (ks, lookup, KDB_O_CREATE);
+	succeed_if_same_string (keyName (created), "user/tests/created");
+	succeed_if (ksLookupCompiled (ks, lookup, 0) == created, "created key not found");
+	elektraKeyLookupDel (lookup);
+
+	succeed_if (elektraKeyLookupNew (0) == 0, "null compiled");
+	succeed_if (elektraKeyLookupDel (0) == -1, "null deleted");
+	ksDel (ks);
+
+	// lookups using the hash index
+	char name[50];
+	ks = ksNew (0, KS_END);
+	for (int i = 0; i < KEYSET_HASH_SIZE * 4; ++i)
+	{
+		snprintf (name, sizeof (name), "system/hash/%d", i);
+		ksAppendKey (ks, keyNew (name, KEY_END));
+	}
+	lookup = elektraKeyLookupNew ("/hash/7");
+	for (int i = 0; i < KEYSET_HASH_SIZE * 4; ++i)
+	{
+		succeed_if_same_string (keyName (ksLookupCompiled (ks, lookup, 0)), "system/hash/7");
+	}
+	succeed_if (test_bit (ks->flags, KS_FLAG_HASH), "hash index was not built");
+	ksAppendKey (ks, keyNew ("user/hash/7", KEY_END));
+	succeed_if_same_string (keyName (ksLookupCompiled (ks, lookup, 0)), "user/hash/7");
+	elektraKeyLookupDel (lookup);
+	ksDel (ks);
+}
+
+static void test_cascadingHashLookup ()
+{
+	printf ("test cascading hash lookup\n");
+
+	const char * namespaces[] = { "/", "system/", "user/", "dir/", "proc/" };
+	char name[50];
+	KeySet * ks = ksNew (0, KS_END);
+	for (int i = 0; i < KEYSET_HASH_SIZE * 4; ++i)
+	{
+		// key i is in the namespaces up to i % 5
+		for (int j = 0; j <= i % 5; ++j)
+		{
+			snprintf (name, sizeof (name), "%shash/%d", namespaces[j], i);
+			ksAppendKey (ks, keyNew (name, KEY_CASCADING_NAME, KEY_VALUE, namespaces[j], KEY_END));
+		}
+	}
+	ksAppendKey (ks, keyNew ("spec/hash/1", KEY_META, "namespace/#0", "system", KEY_END));
+	ksAppendKey (ks, keyNew ("spec/hash/5", KEY_META, "default", "default", KEY_END));
+	ksAppendKey (ks, keyNew ("spec/hash/7", KEY_META, "override/#0", "/hash/9", KEY_END));
+
+	for (int round = 0; round < 2; ++round)
+	{
+		for (int i = 0; i < KEYSET_HASH_SIZE * 4; ++i)
+		{
+			snprintf (name, sizeof (name), "/hash/%d", i);
+			const char * nospec = round && i == 0 ? "proc/" : namespaces[i % 5];
+			const char * expected = nospec;
+			if (i == 1) expected = "system/";
+			if (i == 7) expected = namespaces[9 % 5];
+			Key * found = ksLookupByName (ks, name, 0);
+			exit_if_fail (found, "did not find key");
+			succeed_if_same_string (keyString (found), expected);
+			succeed_if (ksCurrent (ks) == found, "cursor not set to found key");
+
+			found = ksLookupByName (ks, name, KDB_O_NODEFAULT);
+			succeed_if (!found == (nospec == namespaces[0]), "cascading key found without default");
+			found = ksLookupByName (ks, name, KDB_O_NOSPEC);
+			succeed_if_same_string (keyString (found), nospec);
+		}
+		succeed_if (test_bit (ks->flags, KS_FLAG_CASCADING), "cascading part of hash index was not built");
+		succeed_if (!ksLookupByName (ks, "/hash", 0), "found key not in keyset");
+		succeed_if (!ksLookupByName (ks, "/hash/1/below", 0), "found key not in keyset");
+
+		// appending at the end keeps the index
+		ksAppendKey (ks, keyNew ("user/zzz/0", KEY_VALUE, "user/", KEY_END));
+		succeed_if (test_bit (ks->flags, KS_FLAG_CASCADING), "cascading index invalidated by append at end");
+		succeed_if_same_string (keyString (ksLookupByName (ks, "/zzz/0", 0)), "user/");
+		keyDel (ksLookupByName (ks, "user/zzz/0", KDB_O_POP));
+
+		// insertion in the middle invalidates the index
+		ksAppendKey (ks, keyNew ("proc/hash/0", KEY_VALUE, "proc/", KEY_END));
+		ksAppendKey (ks, keyNew ("proc/hash/1", KEY_VALUE, "system/", KEY_END));
+		succeed_if (!test_bit (ks->flags, KS_FLAG_CASCADING), "cascading index not invalidated by insert");
+	}
+
+	KeyLookup * lookup = elektraKeyLookupNew ("/hash/3");
+	for (int i = 0; i < KEYSET_HASH_SIZE * 4; ++i)
+	{
+		succeed_if_same_string (keyString (ksLookupCompiled (ks, lookup, 0)), "dir/");
+	}
+	succeed_if (test_bit (ks->flags, KS_FLAG_CASCADING), "compiled lookup did not use the cascading index");
+	elektraKeyLookupDel (lookup);
+
+	ksDel (ks);
+}
+
 int main (int argc, char ** argv)
 {
 	printf ("KS         TESTS\n");
@@ -167,6 +628,14 @@ int main (int argc, char ** argv)
 	test_elektraEmptyKeys ();
 	test_cascadingLookup ();
 	test_creatingLookup ();
+	test_hashLookup ();
+	test_cascadingHashLookup ();
+	test_mergeAppend ();
+	test_sharedDup ();
+	test_dupCost ();
+	test_cutRanges ();
+	test_below ();
+	test_lookupCompiled ();
 
 	printf ("\ntest_ks RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
 
@@ -0,0 +1,109 @@
+/**
+ * @file
+ *
+ * @brief Tests for the least recently used cache of plugins.
+ *
+ * @copyright BSD License (see doc/COPYING or http://www.libelektra.org)
+ */
+
+#include <kdbease.h>
+#include <kdbhelper.h>
+
+#include "tests.h"
+
+static int freed;
+
+static void freeValue (void * value)
+{
+	++freed;
+	elektraFree (value);
+}
+
+static char * newValue (const char * value)
+{
+	return elektraStrDup (value);
+}
+
+static void test_lruGetPut ()
+{
+	printf ("Test get and put of lru cache\n");
+
+	succeed_if (!elektraLruNew (0, freeValue), "cache without capacity should not be created");
+
+	freed = 0;
+	ElektraLru * lru = elektraLruNew (4, freeValue);
+	exit_if_fail (lru, "could not create cache");
+
+	succeed_if (!elektraLruGet (lru, "a"), "empty cache returned a value");
+	succeed_if (elektraLruPut (lru, "a", newValue ("1")) == 0, "could not put");
+	succeed_if (elektraLruPut (lru, "b", newValue ("2")) == 0, "could not put");
+	succeed_if_same_string (elektraLruGet (lru, "a"), "1");
+	succeed_if_same_string (elektraLruGet (lru, "b"), "2");
+	succeed_if (!elektraLruGet (lru, "c"), "returned value for missing name");
+
+	succeed_if (elektraLruPut (lru, "a", newValue ("3")) == 0, "could not replace");
+	succeed_if (freed == 1, "replaced value not freed");
+	succeed_if_same_string (elektraLruGet (lru, "a"), "3");
+
+	succeed_if (elektraLruPut (0, "a", 0) == -1, "put to null cache should fail");
+	succeed_if (elektraLruPut (lru, 0, 0) == -1, "put with null name should fail");
+	succeed_if (!elektraLruGet (0, "a"), "get from null cache should fail");
+
+	elektraLruDel (lru);
+	succeed_if (freed == 3, "values not freed with the cache");
+	elektraLruDel (0);
+}
+
+static void test_lruEvict ()
+{
+	printf ("Test eviction of lru cache\n");
+
+	freed = 0;
+	ElektraLru * lru = elektraLruNew (3, freeValue);
+	exit_if_fail (lru, "could not create cache");
+
+	elektraLruPut (lru, "a", newValue ("1"));
+	elektraLruPut (lru, "b", newValue ("2"));
+	elektraLruPut (lru, "c", newValue ("3"));
+	succeed_if (elektraLruGet (lru, "a"), "a missing"); // b is least recently used now
+
+	elektraLruPut (lru, "d", newValue ("4"));
+	succeed_if (freed == 1, "full cache did not evict");
+	succeed_if (!elektraLruGet (lru, "b"), "least recently used value not evicted");
+	succeed_if_same_string (elektraLruGet (lru, "a"), "1");
+	succeed_if_same_string (elektraLruGet (lru, "c"), "3");
+	succeed_if_same_string (elektraLruGet (lru, "d"), "4");
+
+	elektraLruPut (lru, "e", newValue ("5"));
+	succeed_if (!elektraLruGet (lru, "a"), "least recently used value not evicted");
+
+	char name[20];
+	for (int i = 0; i < 1000; ++i)
+	{
+		snprintf (name, sizeof (name), "key%d", i);
+		succeed_if (elektraLruPut (lru, name, newValue (name)) == 0, "could not put");
+	}
+	succeed_if (freed == 1002, "cache did not stay at its capacity");
+	succeed_if_same_string (elektraLruGet (lru, "key997"), "key997");
+	succeed_if_same_string (elektraLruGet (lru, "key999"), "key999");
+	succeed_if (!elektraLruGet (lru, "key996"), "evicted value found");
+
+	elektraLruDel (lru);
+	succeed_if (freed == 1005, "values not freed with the cache");
+}
+
+
+int main (int argc, char ** argv)
+{
+	printf ("LRU          TESTS\n");
+	printf ("==================\n\n");
+
+	init (argc, argv);
+
+	test_lruGetPut ();
+	test_lruEvict ();
+
+	printf ("\ntest_lru RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
+
+	return nbError;
+}
@@ -514,6 +514,56 @@ static void test_top ()
 	ksDel (testCycleOrder3);
 	elektraFree (array);
 }
+static void test_metaNames ()
+{
+	printf ("test meta names\n");
+
+	char longName[300];
+	memset (longName, 'a', sizeof (longName) - 1);
+	longName[sizeof (longName) - 1] = '\0';
+	longName[100] = '/';
+
+	// every name is looked up with each other spelling of the same name
+	const char * names[][4] = { { "check/type", "check//type", "check/./type", "check/x/../type" },
+				    { "a\\/b", "a\\/b/", 0, 0 },
+				    { "a/b", "a/b/", "a/%/../b", 0 },
+				    { "#0", "#0/", 0, 0 },
+				    { "user/x", "user//x", 0, 0 },
+				    { "..a/.b", "..a/.b/", 0, 0 },
+				    { longName, 0, 0, 0 } };
+	const size_t nrNames = sizeof (names) / sizeof (names[0]);
+
+	Key * key = keyNew ("user/test", KEY_END);
+	for (size_t i = 0; i < nrNames; ++i)
+	{
+		char value[10];
+		snprintf (value, sizeof (value), "%zu", i);
+		succeed_if (keySetMeta (key, names[i][0], value) == (ssize_t)strlen (value) + 1, "could not set meta");
+	}
+
+	for (size_t i = 0; i < nrNames; ++i)
+	{
+		char value[10];
+		snprintf (value, sizeof (value), "%zu", i);
+		for (size_t j = 0; j < 4 && names[i][j]; ++j)
+		{
+			const Key * meta = keyGetMeta (key, names[i][j]);
+			exit_if_fail (meta, "meta not found");
+			succeed_if_same_string (keyString (meta), value);
+		}
+	}
+	succeed_if (!keyGetMeta (key, "check"), "found meta not set");
+	succeed_if (!keyGetMeta (key, "a"), "found meta not set");
+	succeed_if (!keyGetMeta (key, "a\\/b/c"), "found meta not set");
+
+	// removal with other spelling
+	succeed_if (keySetMeta (key, "check//type", 0) == 0, "could not remove meta");
+	succeed_if (!keyGetMeta (key, "check/type"), "removed meta found");
+	succeed_if (keySetMeta (key, "a/b/", "new") == 4, "could not replace meta");
+	succeed_if_same_string (keyString (keyGetMeta (key, "a/b")), "new");
+	keyDel (key);
+}
+
 int main (int argc, char ** argv)
 {
 	printf ("KEY META     TESTS\n");
@@ -530,6 +580,7 @@ int main (int argc, char ** argv)
 
 	test_metaArrayToKS ();
 	test_top ();
+	test_metaNames ();
 	printf ("\ntest_meta RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
 
 	return nbError;
@@ -1035,6 +1035,59 @@ static void test_modules ()
 	ksDel (modules);
 }
 
+static void test_lazy ()
+{
+	printf ("Test lazy mount\n");
+
+	KDB * kdb = kdb_new ();
+	kdb->openLazy = 1;
+	Key * errorKey = keyNew (0);
+	KeySet * modules = modules_config ();
+	KeySet * config = simple_config ();
+	ksAppendKey (config, keyNew ("system/elektra/mountpoints/other", KEY_END));
+	ksAppendKey (config, keyNew ("system/elektra/mountpoints/other/mountpoint", KEY_VALUE, "/tests/other", KEY_END));
+	succeed_if (elektraMountOpen (kdb, config, modules, errorKey) == 0, "could not open trie");
+	succeed_if (output_warnings (errorKey), "warnings found");
+	succeed_if (output_error (errorKey), "error found");
+
+	size_t materialised;
+	succeed_if (elektraMountCountBackends (kdb, &materialised) == 2, "cascading backend counted twice");
+	succeed_if (materialised == 0, "backends opened by mount");
+
+	Key * searchKey = keyNew ("user/tests/simple/below", KEY_END);
+	Backend * backend = elektraMountGetBackend (kdb, searchKey);
+	exit_if_fail (backend, "there should be a backend");
+	succeed_if (backend->config, "backend opened by lookup");
+
+	kdb->defaultBackend = b_new ("", "default");
+	Split * split = elektraSplitNew ();
+	elektraSplitBuildup (split, kdb, searchKey);
+	succeed_if (split->size == 1, "wrong size of split");
+	keySetName (errorKey, "user/tests");
+	succeed_if (elektraSplitMaterialise (split, errorKey) == 1, "could not materialise backends");
+	succeed_if (!backend->config, "backend not opened");
+	succeed_if_same_string (keyName (errorKey), "user/tests");
+	elektraSplitDel (split);
+
+	succeed_if (elektraMountCountBackends (kdb, &materialised) == 2, "wrong number of backends");
+	succeed_if (materialised == 1, "only the simple backend should be opened");
+
+	keySetName (searchKey, "/tests/other");
+	split = elektraSplitNew ();
+	elektraSplitBuildup (split, kdb, searchKey);
+	succeed_if (split->size == 3, "cascading backend not in dir, user and system");
+	elektraSplitMaterialise (split, errorKey);
+	elektraSplitDel (split);
+
+	succeed_if (elektraMountCountBackends (kdb, &materialised) == 2, "wrong number of backends");
+	succeed_if (materialised == 2, "all backends should be opened");
+
+	keyDel (searchKey);
+	kdb_del (kdb);
+	keyDel (errorKey);
+	ksDel (modules);
+}
+
 int main (int argc, char ** argv)
 {
 	printf ("MOUNT      TESTS\n");
@@ -1056,6 +1109,7 @@ int main (int argc, char ** argv)
 	test_init ();
 	test_rootInit ();
 	test_modules ();
+	test_lazy ();
 
 	printf ("\ntest_trie RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
 
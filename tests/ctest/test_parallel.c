@@ -0,0 +1,295 @@
+/**
+ * @file
+ *
+ * @brief Tests for running the get plugins of backends in parallel.
+ *
+ * @copyright BSD License (see doc/COPYING or http://www.libelektra.org)
+ */
+
+#include <kdberrors.h>
+#include <tests_internal.h>
+
+static int unsafeCalls;
+
+static int getContract (Plugin * plugin, KeySet * returned, Key * parentKey, const char * status)
+{
+	Key * root = keyNew ("system/elektra/modules", KEY_END);
+	keyAddBaseName (root, plugin->name);
+	if (strcmp (keyName (root), keyName (parentKey)))
+	{
+		keyDel (root);
+		return 0;
+	}
+	Key * infos = keyDup (root);
+	keyAddName (infos, "infos/status");
+	keySetString (infos, status);
+	ksAppendKey (returned, root);
+	ksAppendKey (returned, infos);
+	return 1;
+}
+
+static void appendKeys (KeySet * returned, Key * parentKey)
+{
+	char name[20];
+	for (int i = 0; i < 100; ++i)
+	{
+		snprintf (name, sizeof (name), "key%d", i);
+		Key * key = keyDup (parentKey);
+		keyAddBaseName (key, name);
+		ksAppendKey (returned, key);
+	}
+}
+
+static int safeGet (Plugin * plugin, KeySet * returned, Key * parentKey)
+{
+	if (getContract (plugin, returned, parentKey, "unittest")) return 1;
+	appendKeys (returned, parentKey);
+	ELEKTRA_ADD_WARNING (45, parentKey, keyName (parentKey));
+	return 1;
+}
+
+static int unsafeGet (Plugin * plugin, KeySet * returned, Key * parentKey)
+{
+	if (getContract (plugin, returned, parentKey, "unittest nothreads")) return 1;
+	++unsafeCalls;
+	appendKeys (returned, parentKey);
+	return 1;
+}
+
+static int errorGet (Plugin * plugin, KeySet * returned, Key * parentKey)
+{
+	if (getContract (plugin, returned, parentKey, "unittest")) return 1;
+	ELEKTRA_SET_ERROR (62, parentKey, keyName (parentKey));
+	return -1;
+}
+
+static int metaGet (Plugin * plugin, KeySet * returned, Key * parentKey)
+{
+	if (getContract (plugin, returned, parentKey, "unittest")) return 1;
+	Key * cur;
+	ksRewind (returned);
+	while ((cur = ksNext (returned)) != 0)
+	{
+		keySetMeta (cur, "type", "long");
+		keySetMeta (cur, "description", 0);
+	}
+	return 1;
+}
+
+static Backend * newBackend (const char * name, kdbGetPtr get)
+{
+	Backend * backend = elektraCalloc (sizeof (struct _Backend));
+	backend->getplugins[STORAGE_PLUGIN] = elektraPluginExport (name, ELEKTRA_PLUGIN_GET, get, ELEKTRA_PLUGIN_END);
+	backend->getplugins[STORAGE_PLUGIN]->refcounter = 1;
+	return backend;
+}
+
+static void delBackend (Backend * backend)
+{
+	elektraPluginClose (backend->getplugins[STORAGE_PLUGIN], 0);
+	elektraFree (backend);
+}
+
+static Split * newSplit (Backend ** backends, size_t size)
+{
+	Split * split = elektraSplitNew ();
+	char name[40];
+	for (size_t i = 0; i < size; ++i)
+	{
+		snprintf (name, sizeof (name), "user/tests/parallel/b%02zu", i);
+		elektraSplitAppend (split, backends[i], keyNew (name, KEY_VALUE, "file", KEY_END), SPLIT_FLAG_SYNC);
+	}
+	// the bypass split, never processed
+	elektraSplitAppend (split, 0, keyNew ("/", KEY_CASCADING_NAME, KEY_END), 0);
+	return split;
+}
+
+static void test_parallelGet ()
+{
+	printf ("Test parallel get\n");
+
+	Backend * backends[8];
+	for (size_t i = 0; i < 8; ++i)
+	{
+		backends[i] = newBackend ("safe", safeGet);
+	}
+	Split * split = newSplit (backends, 8);
+	clear_bit (split->syncbits[3], SPLIT_FLAG_SYNC);
+
+	Key * parentKey = keyNew ("user/tests/parallel", KEY_END);
+	succeed_if (elektraGetDoUpdateParallel (split, parentKey, 1, NR_OF_PLUGINS, 4) == 0, "parallel update failed");
+
+	for (size_t i = 0; i < 8; ++i)
+	{
+		succeed_if (ksGetSize (split->keysets[i]) == (i == 3 ? 0 : 100), "wrong number of keys");
+		succeed_if (backends[i]->getthreads == (i == 3 ? 0 : 1), "thread-safety should only be checked for synced backends");
+	}
+
+	// warnings are in the order of the splits
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "warnings")), "06");
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "warnings/#00/reason")), "user/tests/parallel/b00");
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "warnings/#02/reason")), "user/tests/parallel/b02");
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "warnings/#03/reason")), "user/tests/parallel/b04");
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "warnings/#06/reason")), "user/tests/parallel/b07");
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "warnings/#06/number")), "45");
+	succeed_if (!keyGetMeta (parentKey, "error"), "no error should be set");
+
+	keyDel (parentKey);
+	elektraSplitDel (split);
+	for (size_t i = 0; i < 8; ++i)
+	{
+		delBackend (backends[i]);
+	}
+}
+
+static void test_parallelSharedBackend ()
+{
+	printf ("Test parallel get with backend in several splits\n");
+
+	Backend * backends[4];
+	backends[0] = newBackend ("safe", safeGet);
+	backends[1] = newBackend ("unsafe", unsafeGet);
+	backends[2] = backends[0];
+	backends[3] = backends[1];
+	Split * split = newSplit (backends, 4);
+
+	unsafeCalls = 0;
+	Key * parentKey = keyNew ("user/tests/parallel", KEY_END);
+	succeed_if (elektraGetDoUpdateParallel (split, parentKey, 1, NR_OF_PLUGINS, 4) == 0, "parallel update failed");
+
+	for (size_t i = 0; i < 4; ++i)
+	{
+		succeed_if (ksGetSize (split->keysets[i]) == 100, "wrong number of keys");
+	}
+	succeed_if (unsafeCalls == 2, "unsafe plugin not called for both splits");
+	succeed_if (backends[0]->getthreads == 1, "backend should be thread-safe");
+	succeed_if (backends[1]->getthreads == -1, "nothreads not detected");
+
+	// warnings of a backend stay together
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "warnings")), "01");
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "warnings/#00/reason")), "user/tests/parallel/b00");
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "warnings/#01/reason")), "user/tests/parallel/b02");
+
+	keyDel (parentKey);
+	elektraSplitDel (split);
+	delBackend (backends[0]);
+	delBackend (backends[1]);
+}
+
+static void test_parallelError ()
+{
+	printf ("Test parallel get with error\n");
+
+	Backend * backends[6];
+	for (size_t i = 0; i < 6; ++i)
+	{
+		backends[i] = newBackend ("safe", i == 2 || i == 4 ? errorGet : safeGet);
+	}
+	Split * split = newSplit (backends, 6);
+
+	Key * parentKey = keyNew ("user/tests/parallel", KEY_END);
+	ELEKTRA_ADD_WARNING (45, parentKey, "before");
+	succeed_if (elektraGetDoUpdateParallel (split, parentKey, 1, NR_OF_PLUGINS, 3) == -1, "error not reported");
+
+	// only warnings up to the first error
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "warnings")), "02");
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "warnings/#00/reason")), "before");
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "warnings/#01/reason")), "user/tests/parallel/b00");
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "warnings/#02/reason")), "user/tests/parallel/b01");
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "error/number")), "62");
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "error/reason")), "user/tests/parallel/b02");
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "error/mountpoint")), "user/tests/parallel/b02");
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "error/configfile")), "file");
+
+	keyDel (parentKey);
+	elektraSplitDel (split);
+	for (size_t i = 0; i < 6; ++i)
+	{
+		delBackend (backends[i]);
+	}
+}
+
+static void test_parallelSharedMeta ()
+{
+	printf ("Test parallel get with shared metadata\n");
+
+	Key * shared = keyNew ("user/tests/parallel/shared", KEY_META, "type", "string", KEY_META, "description", "shared",
+			       KEY_META, "check/range", "1-10", KEY_END);
+
+	Backend * backends[8];
+	for (size_t i = 0; i < 8; ++i)
+	{
+		backends[i] = newBackend ("safe", metaGet);
+	}
+	Split * split = newSplit (backends, 8);
+
+	char name[40];
+	for (size_t i = 0; i < 8; ++i)
+	{
+		for (int k = 0; k < 100; ++k)
+		{
+			snprintf (name, sizeof (name), "%s/key%d", keyName (split->parents[i]), k);
+			Key * key;
+			if (i % 2)
+			{
+				// shares the array of the metadata, too
+				key = keyDup (shared);
+				keySetName (key, name);
+			}
+			else
+			{
+				key = keyNew (name, KEY_END);
+				keyCopyAllMeta (key, shared);
+			}
+			ksAppendKey (split->keysets[i], key);
+		}
+	}
+
+	Key * parentKey = keyNew ("user/tests/parallel", KEY_END);
+	succeed_if (elektraGetDoUpdateParallel (split, parentKey, 1, NR_OF_PLUGINS, 4) == 0, "parallel update failed");
+
+	for (size_t i = 0; i < 8; ++i)
+	{
+		Key * cur;
+		ksRewind (split->keysets[i]);
+		while ((cur = ksNext (split->keysets[i])) != 0)
+		{
+			succeed_if_same_string (keyString (keyGetMeta (cur, "type")), "long");
+			succeed_if (!keyGetMeta (cur, "description"), "description should be removed");
+			succeed_if_same_string (keyString (keyGetMeta (cur, "check/range")), "1-10");
+			succeed_if (keyGetMeta (cur, "check/range") != keyGetMeta (shared, "check/range"), "meta key still shared");
+		}
+	}
+
+	// the metadata of the original key is untouched
+	succeed_if_same_string (keyString (keyGetMeta (shared, "type")), "string");
+	succeed_if_same_string (keyString (keyGetMeta (shared, "description")), "shared");
+	succeed_if (keyGetRef (keyGetMeta (shared, "type")) == 1, "meta key should only be referenced by the original");
+	succeed_if (keyGetRef (keyGetMeta (shared, "check/range")) == 1, "meta key should only be referenced by the original");
+
+	keyDel (parentKey);
+	elektraSplitDel (split);
+	for (size_t i = 0; i < 8; ++i)
+	{
+		delBackend (backends[i]);
+	}
+	keyDel (shared);
+}
+
+
+int main (int argc, char ** argv)
+{
+	printf ("PARALLEL     TESTS\n");
+	printf ("==================\n\n");
+
+	init (argc, argv);
+
+	test_parallelGet ();
+	test_parallelSharedBackend ();
+	test_parallelError ();
+	test_parallelSharedMeta ();
+
+	printf ("\ntest_parallel RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
+
+	return nbError;
+}
@@ -54,6 +54,31 @@ static void test_ksToArray ()
 	ksDel (ks);
 }
 
+static void test_ksAppendArray ()
+{
+	printf ("Test elektraKsAppendArray\n");
+
+	KeySet * ks = ksNew (5, keyNew ("user/b", KEY_VALUE, "old", KEY_END), keyNew ("user/d", KEY_END), KS_END);
+	Key * same = keyNew ("user/c", KEY_END);
+	Key * keys[] = { keyNew ("user/e", KEY_END),	     keyNew ("user/b", KEY_VALUE, "first", KEY_END), same,
+			 keyNew ("user/a", KEY_END),	     keyNew ("user/b", KEY_VALUE, "last", KEY_END),   same,
+			 keyNew (0) };
+
+	succeed_if (elektraKsAppendArray (ks, keys, sizeof (keys) / sizeof (keys[0])) == 5, "wrong size");
+	succeed_if_same_string (keyName (ksAtCursor (ks, 0)), "user/a");
+	succeed_if_same_string (keyName (ksAtCursor (ks, 1)), "user/b");
+	succeed_if_same_string (keyString (ksAtCursor (ks, 1)), "last");
+	succeed_if (ksAtCursor (ks, 2) == same, "key appended twice should stay");
+	succeed_if_same_string (keyName (ksAtCursor (ks, 3)), "user/d");
+	succeed_if_same_string (keyName (ksAtCursor (ks, 4)), "user/e");
+
+	succeed_if (elektraKsAppendArray (ks, 0, 0) == 5, "nothing to append");
+	succeed_if (elektraKsAppendArray (ks, 0, 1) == -1, "null pointer");
+	succeed_if (elektraKsAppendArray (0, keys, 0) == -1, "null pointer");
+
+	ksDel (ks);
+}
+
 int main (int argc, char ** argv)
 {
 	printf ("KEY PROPOSAL TESTS\n");
@@ -63,6 +88,7 @@ int main (int argc, char ** argv)
 
 	test_ksPopAtCursor ();
 	test_ksToArray ();
+	test_ksAppendArray ();
 
 	printf ("\ntest_proposal RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
 }
@@ -738,6 +738,41 @@ static void test_realworld ()
 	keyDel (parent);
 }
 
+static void test_sharedArena ()
+{
+	printf ("Test arena shared by split keysets\n");
+
+	Split * split = elektraSplitNew ();
+	elektraSplitAppend (split, 0, keyNew ("user/tests/a", KEY_END), SPLIT_FLAG_SYNC);
+	elektraSplitAppend (split, 0, keyNew ("user/tests/cached", KEY_END), SPLIT_FLAG_CACHED);
+	elektraSplitAppend (split, 0, keyNew ("user/tests/b", KEY_END), SPLIT_FLAG_SYNC);
+	elektraSplitAppend (split, 0, keyNew ("user", KEY_END), SPLIT_FLAG_SYNC); // default split part
+
+	succeed_if (elektraSplitShareArena (split) == 1, "could not share arena");
+	KeyArena * arena = split->keysets[0]->arena;
+	exit_if_fail (arena, "no arena for updated keyset");
+	succeed_if (split->keysets[2]->arena == arena, "updated keysets do not share arena");
+	succeed_if (!split->keysets[1]->arena, "cached keyset got shared arena");
+	succeed_if (!split->keysets[3]->arena, "default split part got shared arena");
+	succeed_if (arena->refs == 2, "only the keysets should hold a reference");
+
+	Key * a = elektraKeyArenaKeyNew (elektraKsArena (split->keysets[0]), "user/tests/a/key");
+	Key * b = elektraKeyArenaKeyNew (elektraKsArena (split->keysets[2]), "user/tests/b/key");
+	exit_if_fail (a && b, "could not create keys");
+	ksAppendKey (split->keysets[0], a);
+	ksAppendKey (split->keysets[2], b);
+	succeed_if (elektraKeyRegionOf (a) == elektraKeyRegionOf (b), "keys of backends in different blocks");
+
+	KeySet * ks = ksNew (0, KS_END);
+	succeed_if (elektraSplitMerge (split, ks) == 1, "could not merge together keysets");
+	elektraSplitDel (split);
+
+	succeed_if (ksGetSize (ks) == 2, "wrong number of keys");
+	succeed_if_same_string (keyName (ksLookupByName (ks, "user/tests/a/key", 0)), "user/tests/a/key");
+	succeed_if_same_string (keyName (ksLookupByName (ks, "user/tests/b/key", 0)), "user/tests/b/key");
+	ksDel (ks);
+}
+
 
 int main (int argc, char ** argv)
 {
@@ -754,6 +789,7 @@ int main (int argc, char ** argv)
 	test_triesizes ();
 	test_merge ();
 	test_realworld ();
+	test_sharedArena ();
 
 
 	printf ("\ntest_splitget RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
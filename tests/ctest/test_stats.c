@@ -0,0 +1,170 @@
+/**
+ * @file
+ *
+ * @brief Tests for the statistics of the calls of plugins.
+ *
+ * @copyright BSD License (see doc/COPYING or http://www.libelektra.org)
+ */
+
+#include <tests_internal.h>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+static char file[] = "/tmp/elektra-test-stats-XXXXXX";
+
+static int storageGet (Plugin * plugin ELEKTRA_UNUSED, KeySet * returned, Key * parentKey)
+{
+	char name[20];
+	for (int i = 0; i < 100; ++i)
+	{
+		snprintf (name, sizeof (name), "key%d", i);
+		Key * key = keyDup (parentKey);
+		keyAddBaseName (key, name);
+		ksAppendKey (returned, key);
+	}
+	return 1;
+}
+
+static int globalGet (Plugin * plugin ELEKTRA_UNUSED, KeySet * returned ELEKTRA_UNUSED, Key * parentKey ELEKTRA_UNUSED)
+{
+	return 1;
+}
+
+static Backend * newBackend (const char * mountpoint)
+{
+	Backend * backend = elektraCalloc (sizeof (struct _Backend));
+	backend->mountpoint = keyNew (mountpoint, KEY_END);
+	backend->getplugins[STORAGE_PLUGIN] = elektraPluginExport ("storage", ELEKTRA_PLUGIN_GET, storageGet, ELEKTRA_PLUGIN_END);
+	backend->getplugins[STORAGE_PLUGIN]->refcounter = 1;
+	return backend;
+}
+
+static void delBackend (Backend * backend)
+{
+	elektraPluginClose (backend->getplugins[STORAGE_PLUGIN], 0);
+	keyDel (backend->mountpoint);
+	elektraFree (backend);
+}
+
+static Split * newSplit (Backend ** backends, size_t size, int bypass)
+{
+	Split * split = elektraSplitNew ();
+	for (size_t i = 0; i < size; ++i)
+	{
+		elektraSplitAppend (split, backends[i], keyNew (keyName (backends[i]->mountpoint), KEY_VALUE, file, KEY_END),
+				    SPLIT_FLAG_SYNC);
+	}
+	if (bypass) elektraSplitAppend (split, 0, keyNew ("/", KEY_CASCADING_NAME, KEY_END), 0);
+	return split;
+}
+
+static const char * statsValue (KeySet * stats, const char * name)
+{
+	Key * found = ksLookupByName (stats, name, 0);
+	return found ? keyString (found) : "(missing)";
+}
+
+static void test_stats ()
+{
+	printf ("Test statistics of plugins\n");
+
+	Backend * backends[3];
+	backends[0] = newBackend ("user/tests/stats/b0");
+	backends[1] = newBackend ("user/tests/stats/b1");
+	backends[2] = backends[0]; // cascading backends are in several splits
+
+	KDB * handle = elektraCalloc (sizeof (struct _KDB));
+	handle->split = newSplit (backends, 2, 0);
+	handle->globalPlugins[POSTGETSTORAGE] = elektraPluginExport ("global", ELEKTRA_PLUGIN_GET, globalGet, ELEKTRA_PLUGIN_END);
+
+	KeySet * stats = ksNew (0, KS_END);
+	succeed_if (elektraStats (handle, stats) == -1, "statistics should be disabled");
+	succeed_if (elektraStatsEnable (handle, 1) == 0, "could not enable statistics");
+	succeed_if (backends[0]->stats && backends[1]->stats, "statistics of backends not allocated");
+
+	Split * split = newSplit (backends, 3, 1);
+	Key * parentKey = keyNew ("user/tests/stats", KEY_END);
+	succeed_if (elektraGetDoUpdateParallel (split, parentKey, 1, NR_OF_PLUGINS, 1) == 0, "update failed");
+	ELEKTRA_GLOBAL_CALL (handle, POSTGETSTORAGE, kdbGet, split->keysets[0], parentKey);
+
+	succeed_if (elektraStats (handle, stats) == 0, "could not get statistics");
+	succeed_if_same_string (statsValue (stats, "system/elektra/stats/get/calls"), "0");
+	succeed_if_same_string (statsValue (stats, "system/elektra/stats/global/postgetstorage"), "global");
+	succeed_if_same_string (statsValue (stats, "system/elektra/stats/global/postgetstorage/calls"), "1");
+	succeed_if_same_string (statsValue (stats, "system/elektra/stats/global/postgetstorage/keys"), "100");
+	succeed_if (!ksLookupByName (stats, "system/elektra/stats/global/pregetstorage", 0), "global plugin was not called");
+
+	succeed_if_same_string (statsValue (stats, "system/elektra/stats/mountpoints/user\\/tests\\/stats\\/b0/get/#5"), "storage");
+	succeed_if_same_string (statsValue (stats, "system/elektra/stats/mountpoints/user\\/tests\\/stats\\/b0/get/#5/calls"), "2");
+	succeed_if_same_string (statsValue (stats, "system/elektra/stats/mountpoints/user\\/tests\\/stats\\/b0/get/#5/keys"), "200");
+	succeed_if_same_string (statsValue (stats, "system/elektra/stats/mountpoints/user\\/tests\\/stats\\/b0/bytes"), "20");
+	succeed_if_same_string (statsValue (stats, "system/elektra/stats/mountpoints/user\\/tests\\/stats\\/b1/get/#5/calls"), "1");
+	succeed_if_same_string (statsValue (stats, "system/elektra/stats/mountpoints/user\\/tests\\/stats\\/b1/bytes"), "10");
+	succeed_if (strcmp (statsValue (stats, "system/elektra/stats/mountpoints/user\\/tests\\/stats\\/b1/get/#5/allocations"), "0"),
+		    "allocations not counted");
+	succeed_if (!ksLookupByName (stats, "system/elektra/stats/mountpoints/user\\/tests\\/stats\\/b1/get/#0", 0),
+		    "empty slot should not be reported");
+
+	// enabling again starts from zero
+	succeed_if (elektraStatsEnable (handle, 1) == 0, "could not reset statistics");
+	ksClear (stats);
+	succeed_if (elektraStats (handle, stats) == 0, "could not get statistics");
+	succeed_if_same_string (statsValue (stats, "system/elektra/stats/mountpoints/user\\/tests\\/stats\\/b0/bytes"), "0");
+	succeed_if (!ksLookupByName (stats, "system/elektra/stats/mountpoints/user\\/tests\\/stats\\/b0/get/#5", 0),
+		    "statistics not reset");
+
+	succeed_if (elektraStatsEnable (handle, 0) == 0, "could not disable statistics");
+	succeed_if (!handle->stats && !backends[0]->stats && !backends[1]->stats, "statistics not freed");
+	succeed_if (elektraStats (handle, stats) == -1, "statistics should be disabled");
+
+	ksDel (stats);
+	keyDel (parentKey);
+	elektraSplitDel (split);
+	elektraSplitDel (handle->split);
+	elektraPluginClose (handle->globalPlugins[POSTGETSTORAGE], 0);
+	elektraFree (handle);
+	delBackend (backends[0]);
+	delBackend (backends[1]);
+}
+
+static void test_statsAllocations ()
+{
+	printf ("Test counting of allocations\n");
+
+	size_t before = elektraAllocations ();
+	elektraFree (elektraMalloc (1));
+	succeed_if (elektraAllocations () == before, "allocations counted without statistics");
+
+	elektraCountAllocations (1);
+	elektraFree (elektraMalloc (1));
+	elektraFree (elektraCalloc (1));
+	succeed_if (elektraAllocations () == before + 2, "allocations not counted");
+	elektraCountAllocations (0);
+
+	elektraFree (elektraMalloc (1));
+	succeed_if (elektraAllocations () == before + 2, "allocations counted after disabling");
+}
+
+
+int main (int argc, char ** argv)
+{
+	printf ("STATS        TESTS\n");
+	printf ("==================\n\n");
+
+	init (argc, argv);
+
+	int fd = mkstemp (file);
+	exit_if_fail (fd != -1, "could not create temporary file");
+	exit_if_fail (write (fd, "0123456789", 10) == 10, "could not write temporary file");
+	close (fd);
+
+	test_stats ();
+	test_statsAllocations ();
+
+	unlink (file);
+
+	printf ("\ntest_stats RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
+
+	return nbError;
+}
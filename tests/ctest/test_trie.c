@@ -91,20 +91,20 @@ static void test_simple ()
 	keyDel (searchKey);
 }
 
-static void collect_mountpoints (Trie * trie, KeySet * mountpoints)
+static void collect_nodes (TrieNode * node, KeySet * mountpoints)
 {
-	int i;
-	for (i = 0; i < KDB_MAX_UCHAR; ++i)
-	{
-		if (trie->value[i]) ksAppendKey (mountpoints, ((Backend *)trie->value[i])->mountpoint);
-		if (trie->children[i]) collect_mountpoints (trie->children[i], mountpoints);
-	}
-	if (trie->empty_value)
+	if (node->value) ksAppendKey (mountpoints, node->value->mountpoint);
+	for (size_t i = 0; i < node->nrChildren; ++i)
 	{
-		ksAppendKey (mountpoints, ((Backend *)trie->empty_value)->mountpoint);
+		collect_nodes (&node->children[i], mountpoints);
 	}
 }
 
+static void collect_mountpoints (Trie * trie, KeySet * mountpoints)
+{
+	collect_nodes (&trie->root, mountpoints);
+}
+
 static void test_iterate ()
 {
 	printf ("Test iterate trie\n");
@@ -788,6 +788,78 @@ static void test_emptyvalues ()
 	elektraTrieClose (trie, 0);
 }
 
+static void test_segments ()
+{
+	printf ("Test segments in trie\n");
+
+	Trie * trie = test_insert (0, "user/tests/a\\/b", "escaped");
+	trie = test_insert (trie, "user/tests/a", "a");
+	trie = test_insert (trie, "user/tests/ab/c", "abc");
+
+	Key * searchKey = keyNew ("user/tests/a\\/b/below", KEY_END);
+	Backend * backend = elektraTrieLookup (trie, searchKey);
+	exit_if_fail (backend, "there should be a backend");
+	succeed_if_same_string (keyString (backend->mountpoint), "escaped");
+
+	keySetName (searchKey, "user/tests/a/b");
+	backend = elektraTrieLookup (trie, searchKey);
+	exit_if_fail (backend, "there should be a backend");
+	succeed_if_same_string (keyString (backend->mountpoint), "a");
+
+	keySetName (searchKey, "user/tests/ab");
+	succeed_if (!elektraTrieLookup (trie, searchKey), "prefix of segment should not match");
+
+	keySetName (searchKey, "user/tests/abc");
+	succeed_if (!elektraTrieLookup (trie, searchKey), "prefix of segment should not match");
+
+	// the common segments are kept once
+	succeed_if (trie->root.nrChildren == 1, "user should be one node");
+	succeed_if (trie->root.children[0].nrChildren == 3, "a, a\\/b and ab should be below user/tests");
+
+	elektraTrieClose (trie, 0);
+	keyDel (searchKey);
+}
+
+static void test_lookupAll ()
+{
+	printf ("Test lookup of all keys in trie\n");
+
+	Trie * trie = test_insert (0, "", "root");
+	trie = test_insert (trie, "user/tests", "tests");
+	trie = test_insert (trie, "user/tests/hosts", "hosts");
+	trie = test_insert (trie, "user/tests/hosts/below", "below");
+	trie = test_insert (trie, "user/tests/hostsx", "hostsx");
+	trie = test_insert (trie, "system/tests/hosts", "syshosts");
+
+	KeySet * ks = ksNew (20, keyNew ("system", KEY_END), keyNew ("system/tests", KEY_END), keyNew ("system/tests/hosts", KEY_END),
+			     keyNew ("system/tests/hosts/a", KEY_END), keyNew ("system/tests/hosts/b", KEY_END),
+			     keyNew ("system/tests/other", KEY_END), keyNew ("user", KEY_END), keyNew ("user/tests", KEY_END),
+			     keyNew ("user/tests/a", KEY_END), keyNew ("user/tests/host", KEY_END), keyNew ("user/tests/hosts", KEY_END),
+			     keyNew ("user/tests/hosts/a", KEY_END), keyNew ("user/tests/hosts/below", KEY_END),
+			     keyNew ("user/tests/hosts/below/a", KEY_END), keyNew ("user/tests/hosts/c", KEY_END),
+			     keyNew ("user/tests/hosts\\/below", KEY_END), keyNew ("user/tests/hostsx", KEY_END),
+			     keyNew ("user/tests/hostsx/a", KEY_END), keyNew ("user/tests/z", KEY_END), keyNew ("user/z", KEY_END), KS_END);
+
+	Backend ** backends = elektraMalloc (ksGetSize (ks) * sizeof (Backend *));
+	elektraTrieLookupAll (trie, ks, backends);
+
+	Key * cur;
+	size_t i = 0;
+	ksRewind (ks);
+	while ((cur = ksNext (ks)) != 0)
+	{
+		succeed_if (backends[i] == elektraTrieLookup (trie, cur), "lookup of all keys differs from single lookup");
+		++i;
+	}
+
+	elektraTrieLookupAll (0, ks, backends);
+	succeed_if (!backends[0] && !backends[i - 1], "keys without trie should have no backend");
+
+	elektraFree (backends);
+	ksDel (ks);
+	elektraTrieClose (trie, 0);
+}
+
 
 int main (int argc, char ** argv)
 {
@@ -807,6 +879,8 @@ int main (int argc, char ** argv)
 	test_root ();
 	test_double ();
 	test_emptyvalues ();
+	test_segments ();
+	test_lookupAll ();
 
 	printf ("\ntest_trie RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
 